@@ -241,6 +241,16 @@ router.get("/defect-definitions/esp32", async (req, res) => {
       });
     }
 
+    // Scanners re-check every ~30 min with the ETag of the set they hold; an unchanged set costs a 304.
+    // The tag is the version plus the save time, so a set saved again under the same version is still seen.
+    const etag = `"${definitions.version}-${new Date(definitions.lastUpdated).getTime()}"`;
+    res.set("ETag", etag);
+    res.set("Cache-Control", "no-cache");
+    const ifNoneMatch = req.get("If-None-Match");
+    if (ifNoneMatch && ifNoneMatch.split(",").some(tag => tag.trim().replace(/^W\//, "") === etag)) {
+      return res.status(304).end();
+    }
+
     // Format for ESP32 consumption
     const esp32Format = {
       version: definitions.version,
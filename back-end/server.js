@@ -29,7 +29,7 @@ const validRfidsRoutes = require('./routes/validRfids')
 
 connectDB();
 
-// --- Express/Socket.IO server (port 8001) ---
+// --- Express/Socket.IO server (PORT, default 8001) ---
 const app = express();
 const httpServer = http.createServer(app);
 const io = new Server(httpServer, { cors: { origin: "*" } });
@@ -62,7 +62,7 @@ app.use('/api/valid-rfids', validRfidsRoutes);
 app.use("/", (req, res) => {
   res.json({
     "msg": "Hello Smart Garment production tracking system!",
-    "websocket": "Available at ws://localhost:8000/rfid-ws",
+    "websocket": `Available at ws://localhost:${WS_PORT}/rfid-ws`,
     "status": "WebSocket server running"
   });
 });
@@ -76,14 +76,16 @@ io.on("connection", (socket) => {
 });
 
 const SOCKET_IO_PORT = process.env.PORT || 8001;
+const WS_PORT = process.env.WS_PORT || 8000;
 httpServer.listen(SOCKET_IO_PORT, '0.0.0.0', () => {
   console.log(`<> Socket.IO server running on port ${SOCKET_IO_PORT} on all interfaces`);
 });
 
-// --- Plain WebSocket server for ESP32 (port 8000) ---
+// --- Plain WebSocket server for ESP32 (WS_PORT, default 8000) ---
+// A second instance on the same host needs its own PORT and WS_PORT; instances share MONGODB_URL
 const wsServer = http.createServer();
 const rfidWS = new RFIDWebSocketServer(wsServer, io); // ✅ Pass Socket.IO instance
-wsServer.listen(8000, '0.0.0.0', () => {
-  console.log(`-> WebSocket server available at: ws://0.0.0.0:8000/rfid-ws`);
+wsServer.listen(WS_PORT, '0.0.0.0', () => {
+  console.log(`-> WebSocket server available at: ws://0.0.0.0:${WS_PORT}/rfid-ws`);
   console.log(`-> Ready to receive RFID data from ESP32`);
 });
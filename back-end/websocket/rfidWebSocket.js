@@ -1,6 +1,7 @@
 const WebSocket = require("ws");
 const { RFIDTagScan, GarmentDefects } = require("../models/iot"); // Updated import
 const Station = require("../models/Station"); // Import Station model
+const { decodeFrame, WIRE_BINARY_NAME } = require("./wireCodec");
 
 class RFIDWebSocketServer {
   constructor(server, io = null) {
@@ -10,7 +11,6 @@ class RFIDWebSocketServer {
     });
     this.io = io; // Store Socket.IO instance for broadcasting to dashboard
 
-    console.log('-> WebSocket server available at: ws://localhost:8000/rfid-ws');
     console.log('-> Ready to receive RFID data from ESP32');
     if (io) {
       console.log('-> Socket.IO integration enabled for real-time dashboard updates');
@@ -18,6 +18,9 @@ class RFIDWebSocketServer {
 
     this.wss.on('connection', (ws) => {
       console.log('ESP32 client connected to WebSocket');
+      // Batch seqs are only compared within this connection: the ESP32 numbers from 1 again after a reboot
+      ws.nextBatchSeq = 0;     // Lowest scan batch on this connection not known to be saved
+      ws.savedBatches = new Set();
       
       // Send connection confirmation
       ws.send(JSON.stringify({
@@ -26,11 +29,32 @@ class RFIDWebSocketServer {
         message: 'WebSocket connected successfully'
       }));
 
-      ws.on('message', async (message) => {
+      ws.on('message', async (message, isBinary) => {
         try {
+          // Packed uploads (wireCodec.js) - only sent after this server accepted the format in the hello
+          if (isBinary) {
+            const frame = decodeFrame(message);
+            await this.saveScanBatch(ws, frame.records, frame.seq, frame.oldest);
+            return;
+          }
+
           const data = JSON.parse(message);
           
-          if (data.action === 'rfid_scan') {
+          if (data.action === 'hello') {
+            // Upload format negotiation - pick binary if the ESP32 offers it.
+            // acks: this server answers every scan batch with its seq, so the ESP32 keeps a batch until then
+            const formats = Array.isArray(data.formats) ? data.formats : [];
+            const format = formats.includes(WIRE_BINARY_NAME) ? WIRE_BINARY_NAME : 'json';
+            ws.send(JSON.stringify({
+              type: 'hello',
+              status: 'success',
+              format,
+              acks: data.acks === true
+            }));
+            console.log(`ESP32 upload format: ${format}`);
+          }
+
+          else if (data.action === 'rfid_scan') {
             // Save RFID scan data to MongoDB using new model
             const newScan = new RFIDTagScan({
               ID: data.data.ID,
@@ -72,89 +96,14 @@ class RFIDWebSocketServer {
             });
           } 
           
+          else if (data.action === 'rfid_scan_batch') {
+            // Batch of RFID scans and QC defects from the ESP32 upload queue (one frame, up to 16 records)
+            await this.saveScanBatch(ws, Array.isArray(data.data) ? data.data : [], data.seq || 0, data.oldest || 0);
+          }
+
           else if (data.action === 'defect_scan') {
             // Handle defect data from ESP32
-            const { ID, Section, Type, Subtype, Tag_UID, Station_ID, Time_Stamp } = data.data;
-
-            // Create new defect entry
-            const newDefectEntry = { Section, Type, Subtype };
-
-            // Try to find existing garment defects document
-            let garmentDefects = await GarmentDefects.findOne({ Tag_UID });
-
-            if (garmentDefects) {
-              // Check if this section-subtype combination already exists
-              const existingDefect = garmentDefects.Defects.find(
-                defect => defect.Section === Section && defect.Subtype === Subtype
-              );
-
-              if (existingDefect) {
-                // Send duplicate error response
-                ws.send(JSON.stringify({
-                  type: 'defect_scan_error',
-                  status: 'error',
-                  error: {
-                    type: 'Duplicate',
-                    message: 'Defect already registered for this section-subtype combination'
-                  }
-                }));
-                console.log(`Duplicate defect rejected: ${Tag_UID} - Section:${Section} Subtype:${Subtype}`);
-                return;
-              }
-
-              // Add new defect to existing document and update timestamp
-              garmentDefects.Defects.push(newDefectEntry);
-              garmentDefects.Time_Stamp = Time_Stamp;
-              await garmentDefects.save();
-
-              console.log(`Defect added to existing garment: ${Tag_UID} - Total defects: ${garmentDefects.Defects.length}`);
-            } else {
-              // Create new garment defects document
-              garmentDefects = new GarmentDefects({
-                ID, // Use the scan ID from first defect
-                Tag_UID,
-                Station_ID,
-                Defects: [newDefectEntry],
-                Time_Stamp
-              });
-
-              await garmentDefects.save();
-              console.log(`New garment defects created: ${Tag_UID} - First defect recorded`);
-            }
-
-            // Send success response
-            ws.send(JSON.stringify({
-              type: 'defect_scan_success',
-              status: 'success',
-              data: {
-                garmentId: garmentDefects._id,
-                totalDefects: garmentDefects.Defects.length,
-                newDefect: newDefectEntry,
-                message: 'Defect recorded successfully'
-              }
-            }));
-
-            // ✅ Emit Socket.IO event for defect updates
-            if (this.io) {
-              this.io.emit("defectUpdate", {
-                garmentDefects,
-                newDefect: newDefectEntry
-              });
-              console.log('📡 Emitted Socket.IO event: defectUpdate');
-            }
-
-            // Broadcast to all connected clients (for real-time dashboard)
-            this.wss.clients.forEach((client) => {
-              if (client !== ws && client.readyState === WebSocket.OPEN) {
-                client.send(JSON.stringify({
-                  type: 'new_defect',
-                  data: {
-                    garmentDefects,
-                    newDefect: newDefectEntry
-                  }
-                }));
-              }
-            });
+            await this.saveDefect(ws, data.data);
           }
         } catch (error) {
           console.error('Error processing WebSocket message:', error);
@@ -180,6 +129,213 @@ class RFIDWebSocketServer {
       });
     });
   }
+
+  // Record a saved batch and return the cumulative ack: every batch up to it is saved. Batches before
+  // `oldest` were acked earlier (maybe on another connection), so the ESP32's word is taken for those.
+  cumulativeBatchAck(ws, seq, oldest) {
+    if (oldest > ws.nextBatchSeq) {
+      ws.nextBatchSeq = oldest;
+    }
+    if (seq >= ws.nextBatchSeq) {
+      ws.savedBatches.add(seq);
+    }
+    for (const saved of [...ws.savedBatches].sort((a, b) => a - b)) {
+      if (saved === ws.nextBatchSeq) {
+        ws.nextBatchSeq++;
+      }
+      if (saved < ws.nextBatchSeq) {
+        ws.savedBatches.delete(saved);
+      }
+    }
+    return Math.max(ws.nextBatchSeq - 1, 0);
+  }
+
+  // Save a batch of RFID scans and QC defects (JSON rfid_scan_batch or a binary frame).
+  // seq/oldest come from the ESP32's retransmit window; the scan ID is unique and a defect is unique per
+  // garment section-subtype, so a batch sent again after a lost ack only adds duplicates.
+  // If the database fails, nothing is acked and the batch comes back.
+  async saveScanBatch(ws, records, seq = 0, oldest = 0) {
+    const defects = records.filter((record) => record.Kind === 'defect');
+    const scans = records.filter((record) => record.Kind !== 'defect').map((record) => ({
+      ID: record.ID,
+      Tag_UID: record.Tag_UID,
+      Station_ID: record.Station_ID,
+      Station_Number: record.Station_Number || 0,
+      Line_Number: record.Line_Number,
+      Time_Stamp: record.Time_Stamp
+    }));
+
+    // Unordered insert: one bad or already-saved record (resent after a lost reply) does not block the rest
+    let savedScans = [];
+    let duplicates = 0;
+    try {
+      savedScans = await RFIDTagScan.insertMany(scans, { ordered: false });
+    } catch (error) {
+      const writeErrors = error.writeErrors || [];
+      if (writeErrors.length === 0) {
+        throw error;
+      }
+      duplicates = writeErrors.filter((writeError) => writeError.code === 11000).length;
+      if (duplicates < writeErrors.length) {
+        console.error(`RFID scan batch: ${writeErrors.length - duplicates} record(s) rejected`);
+      }
+      savedScans = error.insertedDocs || [];
+    }
+
+    // Defects in batch order - several can land on the same garment document
+    let savedDefects = 0;
+    for (const defect of defects) {
+      try {
+        const { duplicate } = await this.storeDefect(ws, defect);
+        if (duplicate) {
+          duplicates++;
+        } else {
+          savedDefects++;
+        }
+      } catch (error) {
+        if (error.code === 11000) {
+          duplicates++;
+        } else if (error.name === 'ValidationError') {
+          // Resending will not fix it - ack so the device does not retry forever
+          console.error(`Defect rejected: ${defect.ID} - ${error.message}`);
+        } else {
+          throw error;
+        }
+      }
+    }
+
+    // Send success response
+    ws.send(JSON.stringify({
+      type: 'rfid_scan_batch_success',
+      status: 'success',
+      data: {
+        seq,
+        cumulative: seq > 0 ? this.cumulativeBatchAck(ws, seq, oldest) : 0,
+        received: records.length,
+        saved: savedScans.length + savedDefects,
+        defects: savedDefects,
+        duplicates,
+        message: 'RFID scan batch saved successfully'
+      }
+    }));
+
+    console.log(`RFID scan batch saved: ${savedScans.length + savedDefects}/${records.length} records (${savedDefects} defects)`);
+
+    // ✅ Emit Socket.IO event for real-time dashboard updates (once per batch)
+    if (this.io && savedScans.length > 0) {
+      this.io.emit("leadingLineUpdate");
+      console.log('📡 Emitted Socket.IO event: leadingLineUpdate');
+    }
+
+    // Broadcast to all connected clients (for real-time dashboard)
+    this.wss.clients.forEach((client) => {
+      if (client !== ws && client.readyState === WebSocket.OPEN) {
+        savedScans.forEach((savedScan) => {
+          client.send(JSON.stringify({
+            type: 'new_scan',
+            data: savedScan
+          }));
+        });
+      }
+    });
+  }
+
+  // Add one defect to its garment's document. Returns { duplicate: true } when that section-subtype is
+  // already registered (also the case for a defect sent again after a lost ack).
+  async storeDefect(ws, defect) {
+    const { ID, Section, Type, Subtype, Tag_UID, Station_ID, Time_Stamp } = defect;
+
+    // Create new defect entry
+    const newDefectEntry = { Section, Type, Subtype };
+
+    // Try to find existing garment defects document
+    let garmentDefects = await GarmentDefects.findOne({ Tag_UID });
+
+    if (garmentDefects) {
+      // Check if this section-subtype combination already exists
+      const existingDefect = garmentDefects.Defects.find(
+        defect => defect.Section === Section && defect.Subtype === Subtype
+      );
+
+      if (existingDefect) {
+        console.log(`Duplicate defect rejected: ${Tag_UID} - Section:${Section} Subtype:${Subtype}`);
+        return { duplicate: true };
+      }
+
+      // Add new defect to existing document and update timestamp
+      garmentDefects.Defects.push(newDefectEntry);
+      garmentDefects.Time_Stamp = Time_Stamp;
+      await garmentDefects.save();
+
+      console.log(`Defect added to existing garment: ${Tag_UID} - Total defects: ${garmentDefects.Defects.length}`);
+    } else {
+      // Create new garment defects document
+      garmentDefects = new GarmentDefects({
+        ID, // Use the scan ID from first defect
+        Tag_UID,
+        Station_ID,
+        Defects: [newDefectEntry],
+        Time_Stamp
+      });
+
+      await garmentDefects.save();
+      console.log(`New garment defects created: ${Tag_UID} - First defect recorded`);
+    }
+
+    // ✅ Emit Socket.IO event for defect updates
+    if (this.io) {
+      this.io.emit("defectUpdate", {
+        garmentDefects,
+        newDefect: newDefectEntry
+      });
+      console.log('📡 Emitted Socket.IO event: defectUpdate');
+    }
+
+    // Broadcast to all connected clients (for real-time dashboard)
+    this.wss.clients.forEach((client) => {
+      if (client !== ws && client.readyState === WebSocket.OPEN) {
+        client.send(JSON.stringify({
+          type: 'new_defect',
+          data: {
+            garmentDefects,
+            newDefect: newDefectEntry
+          }
+        }));
+      }
+    });
+
+    return { duplicate: false, garmentDefects, newDefectEntry };
+  }
+
+  // Save a single defect (defect_scan action from firmware that does not batch defects)
+  async saveDefect(ws, defect) {
+    const { duplicate, garmentDefects, newDefectEntry } = await this.storeDefect(ws, defect);
+
+    if (duplicate) {
+      // Send duplicate error response
+      ws.send(JSON.stringify({
+        type: 'defect_scan_error',
+        status: 'error',
+        error: {
+          type: 'Duplicate',
+          message: 'Defect already registered for this section-subtype combination'
+        }
+      }));
+      return;
+    }
+
+    // Send success response
+    ws.send(JSON.stringify({
+      type: 'defect_scan_success',
+      status: 'success',
+      data: {
+        garmentId: garmentDefects._id,
+        totalDefects: garmentDefects.Defects.length,
+        newDefect: newDefectEntry,
+        message: 'Defect recorded successfully'
+      }
+    }));
+  }
 }
 
 module.exports = RFIDWebSocketServer;
@@ -0,0 +1,105 @@
+// Decoder for the ESP32 binary upload format (iot/RFID_Scanner_connect/include/wire.h) - keep both in step.
+//
+// Frame:  magic 'R' 'W' | version | frame type | record count | behind u8 | seq u32 (0 = no ack wanted)
+//         behind = seq - oldest batch the ESP32 still waits on (everything older is acked)
+// Event:  kind u8 | time u32 | station u8 | line u8 | uid len u8, uid | scan ID len u8, chars | station ID len u8, chars
+//         then for a defect (kind 2): section u8 | type u8 | subtype u8
+// Multi-byte integers are little-endian.
+
+const WIRE_VERSION = 3;
+const WIRE_BINARY_NAME = 'binary/3';
+const WIRE_HEADER_SIZE = 10;
+
+const FRAME_SCAN_BATCH = 1;
+
+const EVENT_SCAN = 1;
+const EVENT_DEFECT = 2;
+
+class WireReader {
+  constructor(buffer, offset) {
+    this.buffer = buffer;
+    this.offset = offset;
+  }
+
+  u8() {
+    if (this.offset + 1 > this.buffer.length) {
+      throw new Error('Truncated binary frame');
+    }
+    return this.buffer.readUInt8(this.offset++);
+  }
+
+  u32() {
+    if (this.offset + 4 > this.buffer.length) {
+      throw new Error('Truncated binary frame');
+    }
+    const value = this.buffer.readUInt32LE(this.offset);
+    this.offset += 4;
+    return value;
+  }
+
+  bytes() {
+    const length = this.u8();
+    if (this.offset + length > this.buffer.length) {
+      throw new Error('Truncated binary frame');
+    }
+    const value = this.buffer.subarray(this.offset, this.offset + length);
+    this.offset += length;
+    return value;
+  }
+
+  // UID as the uppercase hex string the JSON path sends
+  uid() {
+    return this.bytes().toString('hex').toUpperCase();
+  }
+
+  text() {
+    return this.bytes().toString('latin1');
+  }
+}
+
+// Decode one binary frame into { type: 'rfid_scan_batch', seq, oldest, records }. Records use the same
+// field names as the JSON rfid_scan_batch items (defects carry Kind: 'defect'). Throws on a malformed frame.
+function decodeFrame(buffer) {
+  if (buffer.length < WIRE_HEADER_SIZE || buffer[0] !== 0x52 || buffer[1] !== 0x57) {
+    throw new Error('Not a binary upload frame');
+  }
+  if (buffer[2] !== WIRE_VERSION) {
+    throw new Error(`Unsupported binary frame version ${buffer[2]}`);
+  }
+
+  const frameType = buffer[3];
+  const count = buffer[4];
+  const seq = buffer.readUInt32LE(6);
+  const oldest = seq - buffer[5];
+  const reader = new WireReader(buffer, WIRE_HEADER_SIZE);
+  if (frameType !== FRAME_SCAN_BATCH) {
+    throw new Error(`Unknown binary frame type ${frameType}`);
+  }
+
+  const records = [];
+  for (let i = 0; i < count; i++) {
+    const kind = reader.u8();
+    const Time_Stamp = reader.u32();
+    const Station_Number = reader.u8();
+    const Line_Number = reader.u8();
+    const Tag_UID = reader.uid();
+    const ID = reader.text();
+    const Station_ID = reader.text();
+    if (kind === EVENT_DEFECT) {
+      const Section = reader.u8();
+      const Type = reader.u8();
+      const Subtype = reader.u8();
+      records.push({ Kind: 'defect', ID, Tag_UID, Station_ID, Time_Stamp, Section, Type, Subtype });
+    } else if (kind === EVENT_SCAN) {
+      records.push({ ID, Tag_UID, Station_ID, Station_Number, Line_Number, Time_Stamp });
+    } else {
+      throw new Error(`Unknown event kind ${kind}`);
+    }
+  }
+  if (reader.offset !== buffer.length) {
+    throw new Error('Trailing bytes in binary frame');
+  }
+  return { type: 'rfid_scan_batch', seq, oldest, records };
+}
+
+module.exports = { decodeFrame, WIRE_BINARY_NAME };
@@ -0,0 +1,52 @@
+// Defect definitions fetch: GET /api/defect-definitions/esp32 stepped from the connectivity loop, like the WiFi
+// state machine - each step reads what the socket already holds and returns, so a slow or stalled server never
+// holds up webSocket.loop() and the uploader (a blocked loop misses its pongs and drops a healthy link).
+// The body goes through the streaming parser (defparse.h); a failed fetch leaves the loaded definitions in place.
+// A parsed set is installed only while the QC dialog is not reading the loaded one (lockDefectDefinitions).
+#ifndef DEFFETCH_H
+#define DEFFETCH_H
+
+#include "hal.h"
+#include "defparse.h"
+
+const uint32_t DEFECT_FETCH_TIMEOUT_MS = 10000;     // Request sent to last body byte
+const size_t DEFECT_FETCH_STEP_BYTES = 2048;        // Most read per step - the loop gets back to the uplink quickly
+const uint8_t DEFECT_ETAG_MAX = 63;
+
+enum DefectFetchState : uint8_t {
+    FETCH_IDLE,
+    FETCH_RUNNING,
+    FETCH_LOADED,                // A new set is installed
+    FETCH_UNCHANGED,             // 304 - the loaded set is the server's current one
+    FETCH_FAILED                 // Not reachable, timed out, HTTP error or rejected set
+};
+
+// Last fetch, for the status command
+struct DefectRefreshStats {
+    uint32_t bytes;              // Body bytes parsed
+    uint32_t ms;                 // Request sent -> set installed
+    uint32_t heapPeak;           // Most heap in use above the free heap before the fetch (set by the board)
+    uint32_t subtypes;
+    uint32_t truncatedNames;
+    DefectParseError error;
+    uint32_t checks;             // Requests sent
+    uint32_t unchanged;          // ... answered 304 Not Modified
+    uint32_t loads;              // ... that loaded a set
+    uint32_t failures;
+};
+
+extern DefectRefreshStats defectRefreshStats;
+extern char defectDefinitionsEtag[DEFECT_ETAG_MAX + 1];    // Server's ETag for the loaded set
+
+// Connect and send the request. conditional: send the loaded set's ETag, so the server answers 304 and nothing
+// is parsed if it has not changed. false if the server is not reachable (nothing left running).
+bool defectFetchStart(HttpConnection* connection, const char* host, uint16_t port, bool conditional);
+
+// Read and parse what has arrived. FETCH_RUNNING until the fetch ends and the set is installed, then its result
+// once, then FETCH_IDLE.
+DefectFetchState defectFetchStep();
+
+// A fetch is running or its set waits to be installed
+bool defectFetchRunning();
+
+#endif
@@ -0,0 +1,82 @@
+// Defect definitions parser: reads the /api/defect-definitions/esp32 JSON as it arrives, a chunk at a time,
+// and writes sections, types and subtypes straight into the arrays the QC station uses - no copy of the
+// response and no JSON document in between.
+// Only this shape is kept (the filter); every other key, however large or deep, is skipped as it streams by:
+//   { "version": ..., "sections": [{"code", "name"}], "types": [{"code", "name", "subtypes": [{"code", "name"}]}] }
+// Memory is bounded whatever the server sends: the parser itself is a fixed struct, names are cut at
+// DEFECT_NAME_MAX characters, and a set with more entries than the limits below is rejected.
+#ifndef DEFPARSE_H
+#define DEFPARSE_H
+
+#include "pipeline.h"
+
+const uint8_t DEFECT_NAME_MAX = 31;          // Characters kept of a name (the LCD shows 16-20)
+const uint8_t DEFECT_VERSION_MAX = 31;
+const int DEFECT_MAX_SECTIONS = 64;
+const int DEFECT_MAX_TYPES = 64;
+const int DEFECT_MAX_SUBTYPES = 256;         // All types together - a subtype code is one byte
+
+enum DefectParseError : uint8_t {
+    DEFPARSE_OK = 0,
+    DEFPARSE_SYNTAX,                         // Not JSON, or brackets that do not match
+    DEFPARSE_TOO_DEEP,                       // Nested deeper than the definitions ever are, inside a kept part
+    DEFPARSE_TOO_MANY,                       // More sections, types or subtypes than the limits
+    DEFPARSE_BAD_CODE,                       // Code not a number in 0..255
+    DEFPARSE_SERVER_ERROR,                   // The body is the server's {"error": ...}
+    DEFPARSE_INCOMPLETE,                     // Input ended before the closing bracket, or no sections/types
+    DEFPARSE_NO_MEMORY
+};
+
+const uint8_t DEFPARSE_DEPTH_MAX = 6;        // root, types, type, subtypes, subtype - and one spare
+
+struct DefectParser {
+    // Output, owned by the parser until defectParserInstall()
+    DefectSection* sections;
+    int sectionCount;
+    int sectionCapacity;
+    DefectType* types;
+    int typeCount;
+    int typeCapacity;
+    int subtypeCapacity;                     // Of the type being parsed
+    int subtypeTotal;
+    char version[DEFECT_VERSION_MAX + 1];
+    bool sawSections;
+    bool sawTypes;
+
+    // Tokenizer
+    uint8_t token;                           // What the bytes being read belong to
+    char text[DEFECT_NAME_MAX + 1];          // String or number being read
+    uint8_t textLength;
+    uint8_t escape;                          // Hex digits of a \u escape still to skip (or 5 = after a backslash)
+    bool expectKey;                          // The next string in an object is a key
+    uint8_t key;                             // Last key read in a kept object
+
+    // Structure
+    uint8_t stack[DEFPARSE_DEPTH_MAX];       // What each open kept container is
+    uint8_t depth;
+    uint32_t skipDepth;                      // Containers open inside a skipped value
+    bool done;                               // Root closed
+
+    DefectParseError error;
+    uint32_t bytes;
+    uint32_t truncatedNames;
+};
+
+void defectParserBegin(DefectParser& parser);
+
+// Feed the next chunk of the body. false once the input is invalid or over a limit (parser.error says why);
+// anything after the root object closes is ignored.
+bool defectParserFeed(DefectParser& parser, const char* data, size_t length);
+
+// End of the body: true if a complete set was parsed
+bool defectParserEnd(DefectParser& parser);
+
+// Replace the loaded definitions with the parsed set (after defectParserEnd returned true); frees the old set
+void defectParserInstall(DefectParser& parser);
+
+// Free whatever the parser still owns - a failed parse leaves the loaded definitions untouched
+void defectParserFree(DefectParser& parser);
+
+const char* defectParseErrorName(DefectParseError error);
+
+#endif
@@ -0,0 +1,72 @@
+// Ingest endpoints: the back ends a scanner may upload to, with a health score each.
+// Every scanner has a home endpoint picked from its device ID, so a line of scanners spreads across the back ends.
+// The uploader reports what it sees on the current one (ping RTT, errors, failed or dead connections); when the
+// current endpoint fails, or another one scores clearly better, it moves there. A failed endpoint is skipped for
+// a backoff (5 s, doubling to 5 min); its errors fade with a 1-minute half-life, after which the home bonus brings
+// the scanner back home - that reconnect is the probe, and a home that is still down just doubles its backoff.
+#ifndef ENDPOINTS_H
+#define ENDPOINTS_H
+
+#include <Arduino.h>
+
+struct IngestEndpoint {
+    const char* host;
+    uint16_t wsPort;             // WebSocket ingest (scan batches)
+    uint16_t httpPort;           // HTTP API (defect definitions)
+};
+
+const uint8_t ENDPOINT_MAX = 4;
+
+const uint32_t ENDPOINT_CONNECT_TIMEOUT_MS = 8000;    // WebSocket must be open within this, or the endpoint failed
+const uint32_t ENDPOINT_BACKOFF_MIN_MS = 5000;
+const uint32_t ENDPOINT_BACKOFF_MAX_MS = 300000;
+const uint32_t ENDPOINT_UNKNOWN_RTT_MS = 200;         // Score of an endpoint without a recent RTT
+const uint32_t ENDPOINT_RTT_STALE_MS = 60000;         // RTT measured longer ago than this is not trusted
+const uint32_t ENDPOINT_ERROR_COST_MS = 1000;         // One recent error weighs like this much RTT
+const uint32_t ENDPOINT_ERROR_HALF_LIFE_MS = 60000;
+const uint32_t ENDPOINT_HOME_BONUS_MS = 1000;         // Home wins unless another endpoint is clearly better
+const uint32_t ENDPOINT_SWITCH_MARGIN_MS = 300;       // Hysteresis for moving a working connection
+const uint32_t ENDPOINT_EVALUATE_MS = 5000;           // How often a working connection is compared with the others
+
+struct EndpointHealth {
+    uint32_t rttMs;              // Smoothed ping RTT on the last connection (0 = none yet)
+    uint32_t rttAt;              // millis() of the last RTT sample
+    float errors;                // Recent errors, decaying
+    uint32_t errorsAt;           // millis() errors was last updated
+    uint8_t failuresInRow;       // Failed connections since the last good one (backoff exponent)
+    uint32_t retryAt;            // Not chosen before this millis() (0 = any time)
+    uint32_t connects;
+    uint32_t failures;           // Connections that did not open or died
+    uint32_t softErrors;         // Ack timeouts and failed sends
+};
+
+struct EndpointStats {
+    uint32_t switches;           // Moves from one endpoint to another
+    uint32_t homeReturns;        // ... of them back to the home endpoint
+};
+
+extern EndpointHealth endpointHealth[ENDPOINT_MAX];
+extern EndpointStats endpointStats;
+
+// Endpoint list (kept, not copied) and this device's ID, which picks the home endpoint. Starts on home.
+void endpointsBegin(const IngestEndpoint* list, uint8_t count, uint32_t deviceId);
+
+uint8_t endpointCount();
+uint8_t endpointCurrent();
+uint8_t endpointHome();
+const IngestEndpoint& endpointAt(uint8_t index);
+
+// Lower is better: RTT plus recent errors, minus the home bonus
+int32_t endpointScore(uint8_t index);
+
+// Reports about the current endpoint (connectivity task)
+void endpointConnected();
+void endpointRtt(uint32_t rttMs);
+void endpointSoftError();
+void endpointFailed();
+
+// Pick the endpoint to use. A working connection (connected) only moves for a clearly better score; after a
+// failure the best endpoint not backing off is taken. true if the current endpoint changed - reconnect then.
+bool endpointReselect(bool connected);
+
+#endif
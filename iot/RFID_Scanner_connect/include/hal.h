@@ -0,0 +1,153 @@
+// Hardware abstraction for the scan pipeline (src/pipeline.cpp).
+// The ESP32 implementations live in src/main.cpp, the Linux ones in src/native/.
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+// ISO14443A PICC commands used by the scan scheduler (same values as the MFRC522 library's PICC_Command)
+enum PiccCommand : uint8_t {
+    PICC_REQA = 0x26,
+    PICC_SEL_CL1 = 0x93,
+    PICC_SEL_CL2 = 0x95,
+    PICC_SEL_CL3 = 0x97,
+    PICC_HLTA = 0x50,
+    PICC_CASCADE_TAG = 0x88
+};
+
+// Result of checking a transceive that was started earlier
+enum TransceiveResult {
+    TRX_PENDING,
+    TRX_OK,
+    TRX_TIMEOUT,
+    TRX_COLLISION,
+    TRX_ERROR
+};
+
+// One ISO14443A reader at frame level - an RC522 on the ESP32, simulated tags on Linux
+class ReaderPort {
+public:
+    virtual ~ReaderPort() {}
+
+    // Start a transceive and return immediately (txLastBits/rxAlign as in the RC522 BitFramingReg)
+    virtual void startTransceive(const uint8_t* data, uint8_t length, uint8_t txLastBits, uint8_t rxAlign) = 0;
+
+    // Check a started transceive without blocking; copies the answer into backData when complete
+    virtual TransceiveResult pollTransceive(uint8_t* backData, uint8_t* backLen) = 0;
+
+    // Bit position (1..32) of the first collision in the last answer, 0 if not valid
+    virtual uint8_t collisionPosition() = 0;
+
+    // Send HLTA to the selected card and stop crypto communication
+    virtual void haltA() = 0;
+
+    // True while the reader's IRQ line wakes the scanning task - no need to poll it
+    virtual bool irqDriven() const { return false; }
+
+    // Called once per poll window; returns true if the link was reconfigured and the protocol must restart
+    virtual bool checkPollWindow(uint32_t, uint32_t) { return false; }
+};
+
+// Character LCD of a station (16 columns)
+class StationDisplay {
+public:
+    virtual ~StationDisplay() {}
+    virtual void clear() = 0;
+    virtual void setCursor(uint8_t col, uint8_t row) = 0;
+    virtual void print(const char* text) = 0;
+};
+
+enum StationButton {
+    BUTTON_OK,
+    BUTTON_CANCEL,
+    BUTTON_UP,                   // QC navigation only
+    BUTTON_DOWN
+};
+
+// Push buttons of a station
+class StationButtons {
+public:
+    virtual ~StationButtons() {}
+    virtual bool isPressed(StationButton button) = 0;
+};
+
+// Shared buzzer
+class Buzzer {
+public:
+    virtual ~Buzzer() {}
+    virtual void set(bool on) = 0;
+};
+
+// Time sources (esp_timer and the CPU cycle counter on the ESP32, host clocks on Linux).
+// Wall-clock time is built on monotonicUs() by the time service (timesync.h).
+class Clock {
+public:
+    virtual ~Clock() {}
+
+    // Microseconds since boot, 64-bit - never wraps or goes back
+    virtual uint64_t monotonicUs() = 0;
+
+    // Free-running cycle counter of the calling core, wraps (thread CPU nanoseconds on Linux) - cost measurements only
+    virtual uint32_t cycles() = 0;
+};
+
+// Raw NOR flash area (esp_partition on the ESP32, a file on Linux).
+// Writes can only clear bits; eraseSector() sets a whole sector back to 0xFF.
+class FlashRegion {
+public:
+    virtual ~FlashRegion() {}
+    virtual uint32_t size() = 0;
+    virtual uint32_t sectorSize() = 0;
+    virtual bool read(uint32_t offset, void* data, uint32_t length) = 0;
+    virtual bool write(uint32_t offset, const void* data, uint32_t length) = 0;
+    virtual bool eraseSector(uint32_t offset) = 0;
+};
+
+// TCP connection for a plain HTTP request (WiFiClient on the ESP32, a simulated definitions server on Linux)
+class HttpConnection {
+public:
+    virtual ~HttpConnection() {}
+    virtual bool connect(const char* host, uint16_t port) = 0;   // Blocks for the connect only, bounded by a short timeout
+    virtual size_t write(const char* data, size_t length) = 0;
+    virtual int available() = 0;                                 // Bytes that can be read without waiting
+    virtual int read(uint8_t* buffer, size_t length) = 0;
+    virtual bool connected() = 0;                                // false once the server closed and nothing is left
+    virtual void stop() = 0;
+};
+
+// Small persistent settings that survive a reset (NVS on the ESP32, a file or memory on Linux)
+class SettingsStore {
+public:
+    virtual ~SettingsStore() {}
+    virtual bool readU32(const char* key, uint32_t& value) = 0;   // false if the key was never written
+    virtual bool writeU32(const char* key, uint32_t value) = 0;
+};
+
+// Upload encoding agreed with the server when the connection opens (see include/wire.h)
+enum WireFormat : uint8_t {
+    WIRE_JSON,                   // TEXT frames, one JSON object per message (older servers)
+    WIRE_BINARY                  // BINARY frames in the packed format of include/wire.h
+};
+
+// Uplink to the server (WebSocket on the ESP32, in-process sink on Linux)
+class Transport {
+public:
+    virtual ~Transport() {}
+    virtual bool connected() = 0;
+    virtual bool networkUp() = 0;           // A way to the servers exists (WiFi up) - else not connecting is no one's fault
+    virtual WireFormat wireFormat() = 0;
+    virtual bool serverAcks() = 0;          // Server acks each scan batch by sequence number (agreed in the hello)
+    virtual bool helloAnswered() = 0;       // Server answered the hello on this connection - until then serverAcks() is not known
+    virtual bool sendText(const char* payload, size_t length) = 0;
+    virtual bool sendBinary(const uint8_t* payload, size_t length) = 0;
+
+    // Liveness probe (WebSocket ping) - the far end echoes token, reported with uploadPong(); false if not sent
+    virtual bool sendPing(uint32_t token) = 0;
+    // Drop the connection and connect again right away, to endpointCurrent() (endpoints.h) - after a dead
+    // link (half-open TCP) or when the uploader moves to another endpoint
+    virtual void reconnect() = 0;
+};
+
+#endif
@@ -0,0 +1,72 @@
+// Offline scan journal: append-only ring of CRC-protected records on a flash partition.
+// Scans and QC defects are journaled by a Core 0 task and uploaded from the oldest unacknowledged record,
+// so nothing is lost on reboot, brown-out or long WiFi outages.
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "hal.h"
+#include "pipeline.h"
+
+// Fixed-size record slots - a sector holds sectorSize / JOURNAL_SLOT_SIZE records
+const uint32_t JOURNAL_SLOT_SIZE = 64;
+const uint16_t JOURNAL_MAGIC = 0x4A52;       // "JR"
+
+// Record header. crc covers the header up to crc plus the payload; acked is cleared to 0
+// in place once the server has the record (NOR flash can clear bits without an erase).
+struct JournalRecordHeader {
+    uint16_t magic;
+    uint8_t type;                            // JOURNAL_RECORD_EVENT
+    uint8_t length;                          // Payload bytes
+    uint32_t seq;                            // 1, 2, 3, ... - never reused
+    uint32_t crc;
+    uint32_t acked;                          // 0xFFFFFFFF = pending, 0 = delivered
+};
+
+const uint8_t JOURNAL_RECORD_EVENT = 2;      // ScannedData (scan or defect) - the only record type
+
+// A record handed out by journalPeek() - the sequence number guards against the slot being reused
+struct JournalRef {
+    uint32_t slot;
+    uint32_t seq;
+};
+const uint32_t JOURNAL_PAYLOAD_SIZE = JOURNAL_SLOT_SIZE - sizeof(JournalRecordHeader);
+
+static_assert(sizeof(ScannedData) <= JOURNAL_PAYLOAD_SIZE, "ScannedData must fit in one journal slot");
+
+struct JournalStats {
+    uint32_t capacity;                       // Record slots in the partition
+    uint32_t appended;                       // Records written since boot
+    uint32_t acked;                          // Records acknowledged since boot
+    uint32_t overwritten;                    // Pending records lost because the ring was full
+    uint32_t corrupt;                        // Slots skipped at mount or append (CRC errors, torn writes)
+    uint32_t recovered;                      // Pending records found at mount
+    uint32_t erases;                         // Sectors erased since boot
+    uint32_t maxAppendUs;                    // Slowest append, including any inline sector erase
+};
+
+extern JournalStats journalStats;
+
+// Mount the journal on a flash region: find the newest record and the oldest pending one
+bool journalBegin(FlashRegion* region);
+bool journalMounted();
+
+// Append an upload event (Core 0 journal task). ref, if given, receives the new record's position.
+bool journalAppend(const ScannedData& data, JournalRef* ref = nullptr);
+
+// Read one record by ref - false if it was delivered or overwritten since the ref was handed out
+bool journalRead(const JournalRef& ref, ScannedData& data);
+
+// Pending scans in order, starting after `after` (or at the oldest if after is nullptr), up to maxRecords.
+// Returns how many were copied; refs identify them for journalAck().
+uint8_t journalPeek(ScannedData* data, JournalRef* refs, uint8_t maxRecords, const JournalRef* after);
+
+// Mark records returned by journalPeek() as delivered, in any order. Returns how many were still pending.
+uint8_t journalAck(const JournalRef* refs, uint8_t count);
+
+// Records waiting for upload
+uint32_t journalPending();
+
+// Erase the sector after the write head ahead of time, so appends do not wait for an erase
+void journalPrepareNextSector();
+
+#endif
@@ -0,0 +1,56 @@
+// Upload lanes: the RAM buffer between the station tasks and the journal (or, without a journal, the uploader).
+// Each station has its own lane, so a busy line cannot push another line's scans out during an outage,
+// and quality events (defects) go through a priority lane that is always drained first.
+// The station lanes are drained deficit-round-robin by their laneWeight from the station table.
+#ifndef LANES_H
+#define LANES_H
+
+#include "pipeline.h"
+
+// Lanes 0 .. STATION_COUNT-1 belong to the stations (same order as STATIONS[]), the last one is the priority lane
+const uint8_t LANE_PRIORITY = STATION_COUNT;
+const uint8_t LANE_COUNT = STATION_COUNT + 1;
+
+// Priority lane (defects) - small, and a full lane makes the QC station wait rather than lose a defect
+const uint8_t PRIORITY_LANE_DEPTH = 16;
+const LaneOverflow PRIORITY_LANE_OVERFLOW = OVERFLOW_WAIT;
+
+// How long OVERFLOW_WAIT blocks the producing station before giving up
+const uint32_t LANE_WAIT_MS = 500;
+
+struct LaneStats {
+    uint32_t enqueued;           // Events accepted since boot
+    uint32_t dropped;            // Events lost to the overflow policy (the oldest or the refused new one)
+    uint16_t maxDepth;           // Deepest the lane has been
+};
+
+extern LaneStats laneStats[LANE_COUNT];
+
+// Create the lane queues. false if out of memory.
+bool lanesBegin();
+
+// Task woken when an event is queued (the journal task), nullptr if nobody sleeps on the lanes
+void lanesSetConsumer(TaskHandle_t task);
+
+// Lane an event belongs to: the priority lane for anything but a production scan
+uint8_t laneFor(const ScannedData& event);
+
+// Queue an event on its lane, applying the lane's overflow policy. false if it was refused.
+bool laneEnqueue(const ScannedData& event);
+
+// Next event to forward: the priority lane first, then the station lanes by deficit round robin.
+// Returns false if every lane is empty. Single consumer only.
+bool laneDequeue(ScannedData& event, uint8_t& lane);
+
+// Put an event back at the front of its lane (the consumer could not forward it)
+void laneRequeue(const ScannedData& event, uint8_t lane);
+
+uint32_t laneDepth(uint8_t lane);
+uint32_t laneCapacity(uint8_t lane);
+const char* laneName(uint8_t lane);
+
+// Events waiting in / room in all lanes together
+uint32_t lanesWaiting();
+uint32_t lanesCapacity();
+
+#endif
@@ -0,0 +1,80 @@
+// Leveled log ring: tasks format a line into a lock-free ring and carry on; a low-priority Core 0 task
+// writes the ring to the UART. At 115200 baud an 80-character line takes ~7 ms once the UART FIFO is full,
+// which the scan and station tasks must not wait for. A full ring drops (and counts) the new line.
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+
+enum LogLevel : uint8_t {
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG
+};
+
+const uint8_t LOG_RING_SIZE = 64;          // Lines - must be a power of two
+const uint8_t LOG_LINE_SIZE = 96;          // Longer lines are truncated
+const uint32_t LOG_DRAIN_IDLE_MS = 10;     // Drain task poll interval while the ring is empty
+
+struct LogStats {
+    uint32_t written;                      // Lines handed to the UART
+    uint32_t dropped;                      // Lines lost because the ring was full
+    uint32_t maxDepth;                     // Most lines waiting at once
+};
+
+extern LogStats logStats;
+
+// Lines above this level are skipped at the call site - settable at runtime ('log' serial command),
+// up to LOG_COMPILE_LEVEL
+extern volatile uint8_t logLevel;
+
+// Set up the ring and start the drain task on Core 0. Call first in setup(), before any task is created.
+void logBegin();
+
+// Queue one line (no trailing newline needed). Safe from any task, never blocks; false if it was dropped.
+bool logPrintf(LogLevel level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+// Write waiting lines to Serial, at most maxLines. Returns how many were written (drain task).
+uint32_t logDrain(uint32_t maxLines);
+
+uint32_t logDepth();
+const char* logLevelName(uint8_t level);
+bool logLevelFromName(const char* name, uint8_t& level);
+
+// Most verbose level compiled in (0 = error .. 3 = debug). Sites above it compile away - no format string in
+// flash, no argument evaluation - but still have their format checked and their arguments count as used.
+// The release environment in platformio.ini sets 1 (warn).
+#ifndef LOG_COMPILE_LEVEL
+#ifdef RELEASE_BUILD
+#define LOG_COMPILE_LEVEL 1
+#else
+#define LOG_COMPILE_LEVEL 3
+#endif
+#endif
+
+// Log sites. Short names on purpose: LOG_INFO/LOG_DEBUG are taken by <syslog.h>, log_i/log_d by the ESP32 core.
+#define LOG_AT(level, ...) do { if ((level) <= logLevel) logPrintf((level), __VA_ARGS__); } while (0)
+#define LOG_COMPILED_OUT(...) do { if (0) logPrintf(LOG_LEVEL_DEBUG, __VA_ARGS__); } while (0)
+
+#define LOG_E(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#if LOG_COMPILE_LEVEL >= 1
+#define LOG_W(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_W(...) LOG_COMPILED_OUT(__VA_ARGS__)
+#endif
+
+#if LOG_COMPILE_LEVEL >= 2
+#define LOG_I(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_I(...) LOG_COMPILED_OUT(__VA_ARGS__)
+#endif
+
+#if LOG_COMPILE_LEVEL >= 3
+#define LOG_D(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_D(...) LOG_COMPILED_OUT(__VA_ARGS__)
+#endif
+
+#endif
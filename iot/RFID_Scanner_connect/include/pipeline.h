@@ -0,0 +1,300 @@
+// Scan pipeline: reader scheduling, station tasks (shift dialogs, QC defect entry, counting) and the upload queue.
+// Talks to hardware only through hal.h, so the same code runs on the ESP32 and in the Linux simulator.
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "hal.h"
+#include "stations.h"
+
+// Reader response timeout used by the scan scheduler (ATQA/SAK arrive well within 1ms)
+const uint8_t RFID_FRAME_TIMEOUT_MS = 5;
+
+// In IRQ mode, how often a fresh REQA is sent to each reader (a card cannot announce itself)
+const uint8_t RFID_IRQ_REARM_MS = 20;
+
+// Hand a bulk inventory over after this long even if tags keep answering (one unreadable tag must not stall a bundle)
+const uint16_t INVENTORY_MAX_PASS_MS = 300;
+
+// How often the scanning task recalculates polls/second per reader
+const unsigned long POLL_RATE_WINDOW_MS = 5000;
+
+// How long the 'bench' command measures each reader count
+const unsigned long READER_BENCH_STEP_MS = 3000;
+
+// Batched uploads - scans go out as one rfid_scan_batch frame of up to UPLOAD_BATCH_MAX records.
+// A partial batch waits at most UPLOAD_LINGER_MS for more scans; a backlog is sent as back-to-back full batches.
+const uint8_t UPLOAD_BATCH_MAX = 16;
+const uint32_t UPLOAD_LINGER_MS = 50;
+const uint8_t UPLOAD_BATCHES_PER_CALL = 4;
+
+// Acknowledged delivery - batches in flight at once, and how long to wait for an ack before resending
+const uint8_t UPLOAD_WINDOW_BATCHES = 4;
+const uint32_t UPLOAD_ACK_TIMEOUT_MS = 5000;
+// A server that has not answered the hello by then is an older back end without acks
+const uint32_t UPLOAD_HELLO_TIMEOUT_MS = 5000;
+
+// Liveness - a ping every uploadPingIntervalMs while connected; no pong within uploadPongTimeoutMs means the
+// connection is half-open (AP or server restarted without closing it) and it is dropped and reopened.
+// Interval 0 turns pings off (TCP then notices a dead link only after minutes).
+const uint32_t UPLOAD_PING_INTERVAL_MS = 2000;
+const uint32_t UPLOAD_PONG_TIMEOUT_MS = 3000;
+const size_t UPLOAD_BUFFER_SIZE = UPLOAD_BATCH_MAX * 176 + 64;   // ~160 bytes of JSON per record
+const unsigned long UPLOAD_RATE_WINDOW_MS = 5000;
+
+struct UploadStats {
+    uint32_t batches;            // Frames sent since boot
+    uint32_t records;            // Scans and defects sent since boot
+    uint32_t defects;            // QC defects among them
+    uint32_t failures;           // Sends that failed (batch kept for the next try)
+    uint64_t bytes;              // Encoded bytes sent (bytes per record = bytes / records)
+    uint32_t acked;              // Scans acknowledged by the server
+    uint32_t retransmits;        // Batches sent again (reconnect or ack timeout)
+    uint32_t maxAckMs;           // Slowest ack
+    uint32_t pongs;              // Pings answered
+    uint32_t lastRttMs;          // Ping round trip
+    uint32_t maxRttMs;
+    uint64_t rttTotalMs;         // For the average
+    uint32_t deadLinks;          // Connections dropped for a missed pong
+    uint32_t lastRecoveryMs;     // Missed pong -> first unacked batch on the wire again
+    uint8_t inFlight;            // Batches waiting for an ack
+    uint8_t maxBatch;            // Largest batch sent
+    float batchesPerSecond;      // In the last UPLOAD_RATE_WINDOW_MS
+    float recordsPerSecond;
+};
+
+// Cost of handing one counted scan to its upload lane on Core 1 (event build, lane enqueue, log line).
+// In CPU cycles on the ESP32 - compare debug and release builds with the 'status' command.
+struct ScanCostStats {
+    uint32_t scans;
+    uint64_t cycles;
+    uint32_t maxCycles;
+};
+
+// Journal task: wait for new lane events before it treats the line as idle and pre-erases the next flash sector
+const uint32_t JOURNAL_IDLE_MS = 250;
+
+// Per-station card queues - each station task consumes its own reader's cards
+const int STATION_CARD_QUEUE_SIZE = 4;
+
+// Duplicate scan prevention - recently scanned UIDs per station, kept for the station's duplicate window.
+// Fixed-size open-addressed table of 64-bit UID keys, probed a bounded number of slots (O(1), no heap).
+const int RECENT_UID_SLOTS = 32;          // Must be a power of two
+const int RECENT_UID_PROBE_LIMIT = 4;     // Slots checked per lookup/insert
+
+struct RecentUidEntry {
+    uint64_t key;                // 0 = empty slot
+    uint32_t seenAt;             // millis() when first counted
+};
+
+struct RecentUidTable {
+    RecentUidEntry entries[RECENT_UID_SLOTS];
+    uint32_t rejected;           // Scans rejected as duplicates
+    uint32_t evicted;            // Live entries overwritten because the probe window was full
+};
+
+// Shift confirmation states
+enum ShiftState {
+    WAITING_FOR_CARD,
+    WAITING_START_CONFIRMATION,
+    ACTIVE_SCANNING,
+    WAITING_END_CONFIRMATION
+};
+
+// Dynamic QC Defect Configuration - loaded from database
+struct DefectSubtype {
+  uint8_t code;
+  String name;
+
+  DefectSubtype() : code(0), name("") {}
+  DefectSubtype(uint8_t c, const char* n) : code(c), name(n) {}
+};
+
+struct DefectType {
+  uint8_t code;
+  String name;
+  DefectSubtype* subtypes;
+  int subtypeCount;
+
+  DefectType() : code(0), name(""), subtypes(nullptr), subtypeCount(0) {}
+  DefectType(uint8_t c, const char* n) : code(c), name(n), subtypes(nullptr), subtypeCount(0) {}
+};
+
+struct DefectSection {
+  uint8_t code;
+  String name;
+
+  DefectSection() : code(0), name("") {}
+  DefectSection(uint8_t c, const char* n) : code(c), name(n) {}
+};
+
+// Kinds of upload event
+const uint8_t EVENT_SCAN = 1;      // Garment counted at a sewing station
+const uint8_t EVENT_DEFECT = 2;    // Defect logged at the QC station
+
+// What ScannedData::timestamp counts from
+const uint8_t TIME_BASE_UNIX = 0;  // Unix seconds (0 = unknown)
+const uint8_t TIME_BASE_BOOT = 1;  // Seconds since boot bootEpoch - taken before the first SNTP sync
+
+// Upload event for the queue, journal and uploader - a production scan or a QC defect.
+// Kept at 48 bytes so it fits one journal slot.
+struct ScannedData {
+    uint32_t timestamp;          // See timeBase
+    uint8_t kind;                // EVENT_SCAN or EVENT_DEFECT
+    uint8_t stationNumber;       // Scanner ID (1, 2, or 3)
+    uint8_t lineNumber;          // Line number (1, 2, or 3)
+    uint8_t uidSize;             // Actual UID size
+    uint8_t uid[10];             // RFID UID (max 10 bytes for MIFARE)
+    uint8_t defectSection;       // EVENT_DEFECT: section, type and subtype codes
+    uint8_t defectType;
+    uint8_t defectSubtype;
+    char scanID[16];             // Generated scan ID
+    char stationID[8];           // Station ID (e.g., "A105", "A205", "Q001")
+    uint8_t timeBase;            // TIME_BASE_UNIX, or TIME_BASE_BOOT until the uploader resolves it
+    uint16_t bootEpoch;          // TIME_BASE_BOOT: boot the stamp belongs to (scanIdEpoch)
+};
+
+static_assert(sizeof(ScannedData) == 48, "ScannedData layout is journaled - new fields go in the tail padding");
+
+// Card read by the scanning task, handed to the owning station task
+struct CardEvent {
+    uint8_t uid[10];            // RFID UID (max 10 bytes for MIFARE)
+    uint8_t uidSize;           // Actual UID size
+};
+
+// Most tags enumerated in one inventory pass (a bundle of tagged garments)
+const uint8_t INVENTORY_MAX_TAGS = 16;
+
+// Upper-case hex of the longest UID plus the terminator (uidToHex)
+const uint8_t UID_HEX_SIZE = 21;
+
+// Every tag read from a reader in one inventory pass - queued to the station as one item
+struct CardBatch {
+    uint8_t count;
+    CardEvent cards[INVENTORY_MAX_TAGS];
+};
+
+// Per-reader scan scheduler states (ISO14443A: REQA -> anticollision -> select)
+enum ReaderScanState {
+    READER_IDLE,
+    READER_REQA_SENT,
+    READER_ANTICOLLISION,
+    READER_SELECT,
+    READER_DONE
+};
+
+// Scheduler state for one reader
+struct ReaderScanSlot {
+    ReaderScanState state;
+    uint8_t cascadeLevel;          // 1..3 for 4, 7 and 10 byte UIDs
+    uint8_t frame[9];              // Current SEL frame: SEL, NVB, 4 UID bytes/BCC, CRC_A
+    uint8_t knownBits;             // UID bits of the current cascade level resolved by anticollision
+    uint8_t uidBytes[10];
+    uint8_t uidSize;
+    uint8_t sak;
+    uint32_t pollCount;            // REQA polls completed in the current window
+    uint32_t totalPolls;           // REQA polls since boot (used by the 'bench' command)
+    uint32_t collisionCount;       // Anticollision rounds that saw more than one tag
+    uint32_t errorCount;           // Protocol/CRC/BCC errors
+    float pollsPerSecond;          // Achieved polls/second in the last window
+    uint32_t windowErrorBase;      // errorCount at the start of the current poll window
+    CardBatch inventory;           // Tags selected and halted in the current inventory pass
+    uint32_t inventoryStartedAt;   // millis() when the first tag of the pass was halted
+};
+
+// Hardware behind one station - set up by the platform before startPipelineTasks()
+struct StationPorts {
+    ReaderPort* reader;
+    StationDisplay* display;       // nullptr if the station has no LCD
+    StationButtons* buttons;
+};
+
+extern StationPorts stationPorts[STATION_COUNT];
+extern Buzzer* buzzerPort;
+extern Clock* clockPort;
+extern Transport* transportPort;
+
+// Station number (1-based) of the QC station, 0 if the table has none
+extern uint8_t qcStationNumber;
+extern volatile bool qcInPartsSelection;    // The QC defect dialog is open
+
+// Station counters and shift state
+extern volatile uint32_t stationScanCount[STATION_COUNT];
+extern RecentUidTable recentUids[STATION_COUNT];
+extern bool stationActive[STATION_COUNT];
+extern String stationEmployee[STATION_COUNT];
+extern volatile ShiftState stationState[STATION_COUNT];
+
+// Dynamic defect configuration variables
+extern DefectSection* qcSections;
+extern int qcSectionsCount;
+extern DefectType* qcTypes;
+extern int qcTypesCount;
+extern String defectDefinitionsVersion;
+extern bool defectDefinitionsLoaded;
+
+// Flag to track if defect definitions have been successfully updated from database
+// Until then the server is asked every few minutes; after that the loaded set is only re-checked (ETag)
+extern bool defect_def_updated;
+
+// Queues, reader scheduler state and task handles
+extern UploadStats uploadStats;
+extern uint32_t uploadPingIntervalMs;
+extern uint32_t uploadPongTimeoutMs;
+extern ScanCostStats scanCost;
+extern QueueHandle_t stationCardQueues[STATION_COUNT];
+extern volatile uint32_t stationCardDrops[STATION_COUNT];
+extern volatile uint32_t stationBundleCount[STATION_COUNT];
+extern ReaderScanSlot readerSlots[STATION_COUNT];
+extern volatile uint8_t activeReaderCount;
+extern TaskHandle_t rfidScanningTaskHandle;
+extern TaskHandle_t stationTaskHandles[STATION_COUNT];
+extern TaskHandle_t readerBenchTaskHandle;
+extern TaskHandle_t journalTaskHandle;
+
+// Pipeline setup - queues first, then the tasks once every port is bound
+bool createPipelineQueues();
+void startPipelineTasks();
+
+// FreeRTOS tasks
+void rfidScanningTask(void *parameter);
+void stationTask(void *parameter);
+void readerBenchTask(void *parameter);
+void journalTask(void *parameter);
+
+// Station task work items - one tag, or every tag of one inventory pass (Core 1)
+bool processScannedCard(const CardEvent& card, uint8_t stationNumber);
+void processScannedBundle(const CardBatch& batch, uint8_t stationNumber);
+
+// JSON encoding of a scan batch (the binary one is in wire.h) - 0 if it does not fit in capacity
+size_t encodeScanBatchJson(uint32_t seq, uint32_t oldest, const ScannedData* records, uint8_t count, char* buffer, size_t capacity);
+
+// Send queued scans in batches if the transport is up (Core 0 task)
+void drainScanQueue();
+
+// Server acknowledged batch seq, and every batch up to cumulative (0 = none) - call from the connectivity task
+void uploadAcked(uint32_t seq, uint32_t cumulative);
+
+// Pong carrying the token of our last ping - call from the connectivity task
+void uploadPong(uint32_t token);
+
+// Defect definitions
+void cleanupDefectDefinitions();
+void loadFallbackDefectDefinitions();
+
+// The QC defect dialog holds this while it reads qcSections/qcTypes; replace a loaded set only while holding it
+bool lockDefectDefinitions(TickType_t wait);
+void unlockDefectDefinitions();
+
+// Station LCD helpers
+void displayStationMessage(uint8_t stationNumber, const char* line1, const char* line2, const char* line3 = "", const char* line4 = "");
+void displayStationMessage(uint8_t stationNumber, const String& line1, const String& line2, const String& line3 = "", const String& line4 = "");
+void holdStationMessage(uint8_t stationNumber, uint32_t durationMs);
+
+// Calculate ISO14443A CRC_A in software (avoids waiting on the reader's CRC coprocessor)
+void calculateCRC_A(const uint8_t* data, uint8_t length, uint8_t* result);
+
+#endif
@@ -0,0 +1,31 @@
+// Scan IDs: one 64-bit number per scan or defect, unique across reboots and devices, so the server can
+// drop a resent record by its ID alone.
+//   bits 63..40  device  - NIC half of the factory MAC
+//   bits 39..24  epoch   - boot counter kept in NVS, bumped at every boot (and when the counter wraps)
+//   bits 23..0   counter - scans since the epoch began
+// Sent as 13 Crockford base32 characters (fixed width, no I/L/O/U), formatted without the heap.
+#ifndef SCANID_H
+#define SCANID_H
+
+#include "hal.h"
+
+const uint8_t SCAN_ID_LENGTH = 13;                 // Characters, without the terminator
+const uint32_t SCAN_ID_DEVICE_MASK = 0xFFFFFF;
+const uint32_t SCAN_ID_COUNTER_LIMIT = 1UL << 24;  // Scans per epoch
+const char* const SCAN_ID_EPOCH_KEY = "boot_epoch";
+
+// Take the next boot epoch from settings and store it back before any ID is handed out.
+// Without settings (or if the write fails) IDs are still unique until the next reset - false in that case.
+bool scanIdBegin(uint32_t deviceId, SettingsStore* settings);
+
+// Next ID - safe from any task
+uint64_t scanIdNext();
+
+// text holds SCAN_ID_LENGTH + 1 characters
+void scanIdFormat(uint64_t id, char* text);
+
+uint32_t scanIdDevice();
+uint16_t scanIdEpoch();
+uint16_t scanIdBootEpoch();                        // Epoch reserved at boot (scanIdEpoch moves on if the counter wraps)
+
+#endif
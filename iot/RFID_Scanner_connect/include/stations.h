@@ -0,0 +1,55 @@
+// Station table shared by the ESP32 firmware and the Linux simulator.
+// Board wiring (SS, IRQ, buttons, LCD) for each row is in STATION_WIRING in src/main.cpp.
+#ifndef STATIONS_H
+#define STATIONS_H
+
+#include <stdint.h>
+
+enum StationKind : uint8_t {
+    STATION_SEWING,              // Counts product tags
+    STATION_QC                   // Logs defects through the section/type/subtype dialog
+};
+
+// What a full upload lane does with the next event (see lanes.h)
+enum LaneOverflow : uint8_t {
+    OVERFLOW_DROP_OLDEST,        // Make room by dropping the oldest event - the newest counts are kept
+    OVERFLOW_DROP_NEWEST,        // Refuse the new event
+    OVERFLOW_WAIT                // Block the station for up to LANE_WAIT_MS, then refuse
+};
+
+// Everything that differs between stations. The scan scheduler, counters and shift state are sized from this table.
+struct StationDescriptor {
+    const char* name;            // Shown on the LCD and in the serial log
+    const char* shortName;       // Used in status lines and LCD prefixes
+    const char* stationID;       // Sent to the server (e.g., "A105", "A205", "Q001")
+    uint8_t lineNumber;          // 0 for QC - not line-specific
+    StationKind kind;
+    uint8_t displayRows;         // 0 if the station has no LCD, 2 for a 1602A, 4 for a 1604A
+    const char* employeeUID;     // Card of the employee assigned to this station
+    const char* employeeName;
+    uint32_t duplicateWindowMs;  // How long a scanned UID is rejected at this station
+    bool bulkInventory;          // Read every tag in the field (dropped bundle) before handing them over
+    uint8_t laneDepth;           // Events this station's upload lane buffers in RAM
+    uint8_t laneWeight;          // Share of the upload bandwidth when several lanes are backed up
+    LaneOverflow laneOverflow;
+};
+
+// Station table - one row per RC522 reader. At most one QC station per board (the defect dialog is single-instance).
+// Adding a station, e.g.:
+//   {"Line 1-Station 1", "L1S1", "A101", 1, STATION_SEWING, 0, "<card UID>", "<employee>", 5 * 60 * 1000, true,
+//    40, 1, OVERFLOW_DROP_OLDEST},
+const StationDescriptor STATIONS[] = {
+    {"Line 1-Station 5", "S1", "A105", 1, STATION_SEWING, 0,
+     "F5A628A1", "Employee_1", 5 * 60 * 1000, true,    // A bundle passes each station once
+     40, 1, OVERFLOW_DROP_OLDEST},
+    {"Line 2-Station 5", "S2", "A205", 2, STATION_SEWING, 2,
+     "E5B79BA1", "Employee_2", 5 * 60 * 1000, true,
+     40, 1, OVERFLOW_DROP_OLDEST},
+    {"QC Station", "QC", "Q001", 0, STATION_QC, 4,
+     "E9EB3903", "QC_Employee", 5 * 1000, false,  // Only guard against double reads, a garment may return with another defect
+     20, 1, OVERFLOW_DROP_OLDEST}                 // Defects go through the priority lane, this holds the QC tag scans
+};
+
+const uint8_t STATION_COUNT = sizeof(STATIONS) / sizeof(STATIONS[0]);
+
+#endif
@@ -0,0 +1,55 @@
+// Wall clock for the pipeline: a monotonic base (Clock::monotonicUs) plus the offset learned at the last SNTP sync.
+// Reading it is O(1) and never waits - the offset is published with a sequence counter, so a reader on Core 1 at
+// worst repeats two loads while Core 0 stores a new sync. Before the first sync events are stamped with seconds
+// since boot and resolved to Unix time when they are uploaded (see backfillTimestamps in pipeline.cpp).
+#ifndef TIMESYNC_H
+#define TIMESYNC_H
+
+#include <time.h>
+#include "hal.h"
+
+enum TimeSyncState : uint8_t {
+    TIME_UNSYNCED,                         // No SNTP answer since boot - events carry boot-relative stamps
+    TIME_SYNCED,
+    TIME_STALE                             // Synced once, but not for TIME_SYNC_STALE_MS (still counting on the last offset)
+};
+
+const uint32_t TIME_SYNC_STALE_MS = 6UL * 60 * 60 * 1000;
+
+struct TimeSyncStats {
+    uint32_t syncs;                        // SNTP results applied since boot
+    int32_t lastDriftMs;                   // Clock error found at the last sync (+: local clock was behind)
+    int32_t maxDriftMs;                    // Largest error seen, by magnitude
+    float driftPpm;                        // Last drift over the time since the sync before it
+    uint32_t backfilled;                   // Boot-stamped events given Unix time at upload
+    uint32_t unresolved;                   // Boot-stamped events from an earlier boot - sent with timestamp 0
+};
+
+extern TimeSyncStats timeSyncStats;
+
+// Monotonic source (must be called before any other function here)
+void timeSyncBegin(Clock* clock);
+
+// Apply an SNTP result: Unix time in ms, taken now. Core 0 only (SNTP callback or simulator).
+void timeSyncSet(uint64_t unixMs);
+
+// Milliseconds since boot - never goes back
+uint64_t monotonicMs();
+
+// Unix time in ms / s, 0 before the first sync
+uint64_t timeNowMs();
+uint32_t timeNow();
+
+// Unix ms for a point on the monotonic clock, 0 before the first sync
+uint64_t timeAtMonotonicMs(uint64_t monotonic);
+
+// Local calendar time, false before the first sync
+bool timeLocal(struct tm* timeinfo);
+
+TimeSyncState timeSyncState();
+const char* timeSyncStateName(TimeSyncState state);
+
+// Milliseconds since the last sync (0 before the first one)
+uint32_t timeSinceSyncMs();
+
+#endif
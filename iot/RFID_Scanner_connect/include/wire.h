@@ -0,0 +1,52 @@
+// Binary wire format for scan and defect uploads. Sent as WebSocket BINARY frames once the server
+// has accepted it in the connect-time hello; otherwise the JSON actions are used.
+// The back end decodes it in back-end/websocket/wireCodec.js - keep both in step.
+//
+// Frame:  magic 'R' 'W' | version | frame type | record count | behind u8 | seq u32 (0 = no ack wanted)
+//         behind = seq - oldest batch the device still waits on; everything older is acked, so the
+//         server can count it as done when it works out the cumulative ack
+//         seq only means something on the connection it was sent on: the device numbers batches from 1
+//         at every boot (nothing is persisted), and the server keeps its ack state per connection, so a
+//         reboot - always a new connection - starts both sides afresh. Duplicates are found by scan ID.
+// Event:  kind u8 | time u32 | station u8 | line u8 | uid len u8, uid | scan ID len u8, chars | station ID len u8, chars
+//         then for EVENT_DEFECT: section u8 | type u8 | subtype u8
+// Multi-byte integers are little-endian. Strings are not NUL-terminated.
+#ifndef WIRE_H
+#define WIRE_H
+
+#include "pipeline.h"
+
+const uint8_t WIRE_MAGIC_0 = 'R';
+const uint8_t WIRE_MAGIC_1 = 'W';
+const uint8_t WIRE_VERSION = 3;           // 2 added the batch sequence number and behind, 3 the event kind
+const size_t WIRE_HEADER_SIZE = 10;
+
+// Name offered in the hello and echoed back by a server that accepts it
+#define WIRE_BINARY_NAME "binary/3"
+
+// Defects travel in scan batches since version 3 - type 2 (one defect per frame) is no longer sent
+enum WireFrameType : uint8_t {
+    WIRE_FRAME_SCAN_BATCH = 1
+};
+
+// Decoded frame header
+struct WireHeader {
+    WireFrameType type;
+    uint8_t count;
+    uint32_t seq;
+    uint32_t oldest;                      // Oldest batch still unacked on the device (seq - behind)
+};
+
+// Largest encoded event (a defect with a 10-byte UID and full scan/station IDs)
+const size_t WIRE_EVENT_MAX_SIZE = 1 + 4 + 1 + 1 + 1 + 10 + 1 + 15 + 1 + 7 + 3;
+
+// Encode scans and defects into one frame. Returns the frame length, 0 if it does not fit in capacity.
+size_t wireEncodeScanBatch(uint32_t seq, uint32_t oldest, const ScannedData* records, uint8_t count, uint8_t* buffer, size_t capacity);
+
+// Check the header and decode it, false for a frame this version cannot read
+bool wireDecodeHeader(const uint8_t* frame, size_t length, WireHeader& header);
+
+// Decode a scan batch frame. Returns the number of records decoded (up to maxRecords), 0 if the frame is malformed.
+uint8_t wireDecodeScanBatch(const uint8_t* frame, size_t length, ScannedData* records, uint8_t maxRecords);
+
+#endif
@@ -0,0 +1,184 @@
+#include "deffetch.h"
+
+DefectRefreshStats defectRefreshStats = {};
+char defectDefinitionsEtag[DEFECT_ETAG_MAX + 1] = "";
+
+// The fetch in progress (connectivity task only)
+static HttpConnection* connection = nullptr;
+static DefectParser parser;
+static bool running = false;
+static bool installPending = false;      // Parsed set waiting for the QC dialog to let go of the loaded one
+static bool sentEtag = false;
+static unsigned long started = 0;
+static char line[96];                    // Status line or header being read
+static uint8_t lineLength = 0;
+static bool statusRead = false;
+static bool headersEnded = false;
+static int statusCode = 0;
+static char etag[DEFECT_ETAG_MAX + 1] = "";
+
+bool defectFetchStart(HttpConnection* http, const char* host, uint16_t port, bool conditional) {
+    if (running || installPending) {
+        return false;
+    }
+    Serial.println("Fetching defect definitions from server...");
+    Serial.printf("Connecting to: %s:%d\n", host, port);
+
+    if (!http->connect(host, port)) {
+        Serial.printf("!! Failed to connect to HTTP server %s:%d for defect definitions\n", host, port);
+        Serial.println("Check if:");
+        Serial.printf("1. Backend server is running on port %u\n", port);
+        Serial.printf("2. IP address is correct: %s\n", host);
+        Serial.println("3. Server is accessible from ESP32 network");
+        return false;
+    }
+
+    // HTTP/1.0 so the body is never chunked - it ends when the server closes
+    sentEtag = conditional && defect_def_updated && defectDefinitionsEtag[0] != '\0';
+    char request[192];
+    int length = snprintf(request, sizeof(request),
+                          "GET /api/defect-definitions/esp32 HTTP/1.0\r\nHost: %s:%u\r\n%s%s%sConnection: close\r\n\r\n",
+                          host, port, sentEtag ? "If-None-Match: " : "", sentEtag ? defectDefinitionsEtag : "",
+                          sentEtag ? "\r\n" : "");
+    http->write(request, length < (int)sizeof(request) ? length : sizeof(request) - 1);
+    defectRefreshStats.checks++;
+
+    connection = http;
+    defectParserBegin(parser);
+    lineLength = 0;
+    statusRead = false;
+    headersEnded = false;
+    statusCode = 0;
+    etag[0] = '\0';
+    started = millis();
+    running = true;
+    return true;
+}
+
+// Status line and headers a line at a time in a fixed buffer; returns where the body starts in chunk
+static int readHeaders(const char* chunk, int length) {
+    int at = 0;
+    while (!headersEnded && at < length) {
+        char c = chunk[at++];
+        if (c != '\n') {
+            if (c != '\r' && lineLength < sizeof(line) - 1) {
+                line[lineLength++] = c;
+            }
+            continue;
+        }
+        line[lineLength] = '\0';
+        if (!statusRead) {
+            statusRead = true;
+            statusCode = strncmp(line, "HTTP/1.", 7) == 0 ? atoi(line + 9) : 0;
+        } else if (lineLength == 0) {
+            headersEnded = true;
+        } else if (strncasecmp(line, "ETag:", 5) == 0) {
+            const char* value = line + 5;
+            while (*value == ' ') {
+                value++;
+            }
+            strncpy(etag, value, DEFECT_ETAG_MAX);
+            etag[DEFECT_ETAG_MAX] = '\0';
+        }
+        lineLength = 0;
+    }
+    return at;
+}
+
+// Swap the parsed set in unless the QC dialog is reading the loaded one - then try again on the next step
+static DefectFetchState install() {
+    if (!lockDefectDefinitions(0)) {
+        if (!installPending) {
+            Serial.println("Defect definitions parsed - installing once the QC dialog is closed");
+        }
+        installPending = true;
+        return FETCH_RUNNING;
+    }
+    defectParserInstall(parser);
+    unlockDefectDefinitions();
+    installPending = false;
+    strcpy(defectDefinitionsEtag, etag);     // Empty if the server sent none - the next fetch is then a full one
+    defectRefreshStats.loads++;
+    defectRefreshStats.ms = millis() - started;
+    return FETCH_LOADED;
+}
+
+// Response complete (server closed, parser done or gave up, or timed out) - install the set or keep the old one.
+// A body cut off by the timeout is rejected by the parser as incomplete.
+static DefectFetchState finish() {
+    connection->stop();
+    running = false;
+
+    if (!headersEnded) {
+        Serial.println("!! Timeout waiting for defect definitions response");
+        Serial.println("!! Server may be down or not responding");
+        defectParserFree(parser);
+        defectRefreshStats.failures++;
+        return FETCH_FAILED;
+    }
+    if (statusCode == 304 && sentEtag) {
+        defectParserFree(parser);
+        defectRefreshStats.unchanged++;
+        Serial.printf("Defect definitions unchanged (version %s) - %lu ms\n", defectDefinitionsVersion.c_str(),
+                      millis() - started);
+        return FETCH_UNCHANGED;
+    }
+    if (statusCode != 200) {
+        Serial.printf("!! HTTP Error: Status code %d\n", statusCode);
+        Serial.println("!! Expected 200 OK, but got error response");
+        defectParserFree(parser);
+        defectRefreshStats.failures++;
+        return FETCH_FAILED;
+    }
+
+    bool parsed = defectParserEnd(parser);
+    defectRefreshStats.error = parser.error;
+    if (!parsed) {
+        Serial.printf("!! Defect definitions rejected: %s after %lu bytes\n", defectParseErrorName(parser.error),
+                      (unsigned long)parser.bytes);
+        defectParserFree(parser);
+        defectRefreshStats.failures++;
+        return FETCH_FAILED;
+    }
+
+    defectRefreshStats.bytes = parser.bytes;
+    defectRefreshStats.subtypes = parser.subtypeTotal;
+    defectRefreshStats.truncatedNames = parser.truncatedNames;
+    return install();
+}
+
+DefectFetchState defectFetchStep() {
+    if (!running) {
+        return installPending ? install() : FETCH_IDLE;
+    }
+    if (millis() - started >= DEFECT_FETCH_TIMEOUT_MS) {
+        return finish();
+    }
+
+    char chunk[256];
+    size_t read = 0;
+    while (read < DEFECT_FETCH_STEP_BYTES) {
+        int available = connection->available();
+        if (available <= 0) {
+            // Closed with nothing left to read - the body is complete (or never came)
+            return connection->connected() ? FETCH_RUNNING : finish();
+        }
+        int length = connection->read((uint8_t*)chunk, (size_t)available < sizeof(chunk) ? available : sizeof(chunk));
+        if (length <= 0) {
+            return FETCH_RUNNING;
+        }
+        read += length;
+        int body = readHeaders(chunk, length);
+        if (headersEnded && statusCode != 200) {
+            return finish();
+        }
+        if (headersEnded && body < length && !defectParserFeed(parser, chunk + body, length - body)) {
+            return finish();
+        }
+    }
+    return FETCH_RUNNING;
+}
+
+bool defectFetchRunning() {
+    return running || installPending;
+}
@@ -0,0 +1,412 @@
+#include "defparse.h"
+#include <new>
+#include <utility>
+
+// What an open kept container is. Anything else the server sends is skipped by counting brackets.
+enum : uint8_t { CTX_ROOT, CTX_SECTIONS, CTX_SECTION, CTX_TYPES, CTX_TYPE, CTX_SUBTYPES, CTX_SUBTYPE };
+
+// Keys the filter keeps
+enum : uint8_t { KEY_NONE, KEY_OTHER, KEY_VERSION, KEY_ERROR, KEY_SECTIONS, KEY_TYPES, KEY_SUBTYPES, KEY_CODE, KEY_NAME };
+
+enum : uint8_t { TOKEN_NONE, TOKEN_STRING, TOKEN_NUMBER, TOKEN_LITERAL };
+
+const uint8_t ESCAPE_BACKSLASH = 5;
+
+static bool isObject(uint8_t context) {
+    return context == CTX_ROOT || context == CTX_SECTION || context == CTX_TYPE || context == CTX_SUBTYPE;
+}
+
+static bool fail(DefectParser& parser, DefectParseError error) {
+    parser.error = error;
+    return false;
+}
+
+static uint8_t keyOf(uint8_t context, const char* text) {
+    if (context == CTX_ROOT) {
+        if (strcmp(text, "version") == 0) return KEY_VERSION;
+        if (strcmp(text, "error") == 0) return KEY_ERROR;
+        if (strcmp(text, "sections") == 0) return KEY_SECTIONS;
+        if (strcmp(text, "types") == 0) return KEY_TYPES;
+        return KEY_OTHER;
+    }
+    if (strcmp(text, "code") == 0) return KEY_CODE;
+    if (strcmp(text, "name") == 0) return KEY_NAME;
+    if (context == CTX_TYPE && strcmp(text, "subtypes") == 0) return KEY_SUBTYPES;
+    return KEY_OTHER;
+}
+
+// Room for one more item: doubles the array (moving the names, not copying them) up to limit
+template <typename T>
+static bool grow(DefectParser& parser, T*& items, int count, int& capacity, int limit) {
+    if (count < capacity) {
+        return true;
+    }
+    if (count >= limit) {
+        return fail(parser, DEFPARSE_TOO_MANY);
+    }
+    int next = capacity == 0 ? 4 : capacity * 2;
+    if (next > limit) {
+        next = limit;
+    }
+    T* bigger = new (std::nothrow) T[next];
+    if (bigger == nullptr) {
+        return fail(parser, DEFPARSE_NO_MEMORY);
+    }
+    for (int i = 0; i < count; i++) {
+        bigger[i] = std::move(items[i]);
+    }
+    delete[] items;
+    items = bigger;
+    capacity = next;
+    return true;
+}
+
+static bool setCode(DefectParser& parser, uint8_t& code) {
+    if (parser.token != TOKEN_NUMBER || parser.textLength == 0 || parser.textLength > 3) {
+        return fail(parser, DEFPARSE_BAD_CODE);
+    }
+    int value = 0;
+    for (uint8_t i = 0; i < parser.textLength; i++) {
+        if (parser.text[i] < '0' || parser.text[i] > '9') {
+            return fail(parser, DEFPARSE_BAD_CODE);
+        }
+        value = value * 10 + (parser.text[i] - '0');
+    }
+    if (value > 255) {
+        return fail(parser, DEFPARSE_BAD_CODE);
+    }
+    code = (uint8_t)value;
+    return true;
+}
+
+static void setName(DefectParser& parser, String& name) {
+    if (parser.token != TOKEN_STRING) {
+        return;
+    }
+    name = parser.text;
+    if (parser.textLength > DEFECT_NAME_MAX) {
+        parser.truncatedNames++;
+    }
+}
+
+// A string, number or literal value has ended; parser.token still says which
+static bool scalarDone(DefectParser& parser) {
+    uint8_t key = parser.key;
+    parser.key = KEY_NONE;
+    if (parser.skipDepth > 0) {
+        return true;
+    }
+    if (parser.depth == 0) {
+        return fail(parser, DEFPARSE_SYNTAX);     // The body must be an object
+    }
+    if (parser.textLength > DEFECT_NAME_MAX) {
+        parser.text[DEFECT_NAME_MAX] = '\0';
+    } else {
+        parser.text[parser.textLength] = '\0';
+    }
+
+    switch (parser.stack[parser.depth - 1]) {
+        case CTX_ROOT:
+            if (key == KEY_ERROR && parser.token != TOKEN_LITERAL) {
+                return fail(parser, DEFPARSE_SERVER_ERROR);
+            }
+            if (key == KEY_VERSION && parser.token != TOKEN_LITERAL) {
+                strncpy(parser.version, parser.text, DEFECT_VERSION_MAX);
+                parser.version[DEFECT_VERSION_MAX] = '\0';
+            }
+            return true;
+        case CTX_SECTION: {
+            DefectSection& section = parser.sections[parser.sectionCount - 1];
+            if (key == KEY_CODE) return setCode(parser, section.code);
+            if (key == KEY_NAME) setName(parser, section.name);
+            return true;
+        }
+        case CTX_TYPE: {
+            DefectType& type = parser.types[parser.typeCount - 1];
+            if (key == KEY_CODE) return setCode(parser, type.code);
+            if (key == KEY_NAME) setName(parser, type.name);
+            return true;
+        }
+        case CTX_SUBTYPE: {
+            DefectType& type = parser.types[parser.typeCount - 1];
+            DefectSubtype& subtype = type.subtypes[type.subtypeCount - 1];
+            if (key == KEY_CODE) return setCode(parser, subtype.code);
+            if (key == KEY_NAME) setName(parser, subtype.name);
+            return true;
+        }
+        default:
+            return true;                          // Scalar in one of the arrays - not an entry, ignored
+    }
+}
+
+static bool addEntry(DefectParser& parser, uint8_t array, uint8_t& context) {
+    if (array == CTX_SECTIONS) {
+        if (!grow(parser, parser.sections, parser.sectionCount, parser.sectionCapacity, DEFECT_MAX_SECTIONS)) {
+            return false;
+        }
+        parser.sections[parser.sectionCount++] = DefectSection();
+        context = CTX_SECTION;
+    } else if (array == CTX_TYPES) {
+        if (!grow(parser, parser.types, parser.typeCount, parser.typeCapacity, DEFECT_MAX_TYPES)) {
+            return false;
+        }
+        parser.types[parser.typeCount++] = DefectType();
+        parser.subtypeCapacity = 0;
+        context = CTX_TYPE;
+    } else if (array == CTX_SUBTYPES) {
+        DefectType& type = parser.types[parser.typeCount - 1];
+        if (parser.subtypeTotal >= DEFECT_MAX_SUBTYPES) {
+            return fail(parser, DEFPARSE_TOO_MANY);
+        }
+        if (!grow(parser, type.subtypes, type.subtypeCount, parser.subtypeCapacity, DEFECT_MAX_SUBTYPES)) {
+            return false;
+        }
+        type.subtypes[type.subtypeCount++] = DefectSubtype();
+        parser.subtypeTotal++;
+        context = CTX_SUBTYPE;
+    }
+    return true;
+}
+
+static bool openContainer(DefectParser& parser, bool object) {
+    uint8_t key = parser.key;
+    parser.key = KEY_NONE;
+    if (parser.skipDepth > 0) {
+        parser.skipDepth++;
+        return true;
+    }
+
+    uint8_t context = 0xFF;                       // Skipped unless the filter keeps it
+    if (parser.depth == 0) {
+        if (!object) {
+            return fail(parser, DEFPARSE_SYNTAX);
+        }
+        context = CTX_ROOT;
+    } else {
+        uint8_t parent = parser.stack[parser.depth - 1];
+        if (parent == CTX_ROOT && key == KEY_ERROR) {
+            return fail(parser, DEFPARSE_SERVER_ERROR);
+        }
+        if (object && (parent == CTX_SECTIONS || parent == CTX_TYPES || parent == CTX_SUBTYPES)) {
+            if (!addEntry(parser, parent, context)) {
+                return false;
+            }
+        } else if (!object && parent == CTX_ROOT && key == KEY_SECTIONS) {
+            context = CTX_SECTIONS;
+            parser.sawSections = true;
+        } else if (!object && parent == CTX_ROOT && key == KEY_TYPES) {
+            context = CTX_TYPES;
+            parser.sawTypes = true;
+        } else if (!object && parent == CTX_TYPE && key == KEY_SUBTYPES) {
+            context = CTX_SUBTYPES;
+        }
+    }
+
+    if (context == 0xFF) {
+        parser.skipDepth = 1;
+        return true;
+    }
+    if (parser.depth == DEFPARSE_DEPTH_MAX) {
+        return fail(parser, DEFPARSE_TOO_DEEP);
+    }
+    parser.stack[parser.depth++] = context;
+    parser.expectKey = object;
+    return true;
+}
+
+static bool closeContainer(DefectParser& parser, bool object) {
+    if (parser.skipDepth > 0) {
+        parser.skipDepth--;                       // Brackets inside a skipped value are only counted
+        return true;
+    }
+    if (parser.depth == 0 || isObject(parser.stack[parser.depth - 1]) != object) {
+        return fail(parser, DEFPARSE_SYNTAX);
+    }
+    parser.depth--;
+    parser.expectKey = false;
+    parser.key = KEY_NONE;
+    if (parser.depth == 0) {
+        parser.done = true;
+    }
+    return true;
+}
+
+static void keepByte(DefectParser& parser, char c) {
+    if (parser.skipDepth > 0) {
+        return;
+    }
+    if (parser.textLength <= DEFECT_NAME_MAX) {
+        parser.text[parser.textLength] = c;   // text[DEFECT_NAME_MAX] is overwritten by the terminator
+        parser.textLength++;
+    }
+}
+
+static bool stringByte(DefectParser& parser, char c) {
+    if (parser.escape == ESCAPE_BACKSLASH) {
+        if (c == 'u') {
+            parser.escape = 4;
+            keepByte(parser, '_');                // The server already turns anything but [A-Za-z0-9_] into '_'
+        } else {
+            parser.escape = 0;
+            keepByte(parser, c == 'n' || c == 't' || c == 'r' || c == 'b' || c == 'f' ? ' ' : c);
+        }
+        return true;
+    }
+    if (parser.escape > 0) {
+        parser.escape--;
+        return true;
+    }
+    if (c == '\\') {
+        parser.escape = ESCAPE_BACKSLASH;
+        return true;
+    }
+    if (c != '"') {
+        keepByte(parser, c);
+        return true;
+    }
+
+    // End of the string: a key, or a value
+    if (parser.skipDepth == 0 && parser.expectKey && parser.depth > 0 && isObject(parser.stack[parser.depth - 1])) {
+        parser.text[parser.textLength > DEFECT_NAME_MAX ? DEFECT_NAME_MAX : parser.textLength] = '\0';
+        parser.key = keyOf(parser.stack[parser.depth - 1], parser.text);
+        parser.expectKey = false;
+        parser.token = TOKEN_NONE;
+        return true;
+    }
+    bool kept = scalarDone(parser);
+    parser.token = TOKEN_NONE;
+    return kept;
+}
+
+static bool step(DefectParser& parser, char c) {
+    if (parser.token == TOKEN_STRING) {
+        return stringByte(parser, c);
+    }
+    if (parser.token == TOKEN_NUMBER) {
+        if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+            keepByte(parser, c);
+            return true;
+        }
+        if (!scalarDone(parser)) {
+            return false;
+        }
+        parser.token = TOKEN_NONE;                // c still needs handling below
+    } else if (parser.token == TOKEN_LITERAL) {
+        if (c >= 'a' && c <= 'z') {
+            return true;
+        }
+        if (!scalarDone(parser)) {
+            return false;
+        }
+        parser.token = TOKEN_NONE;
+    }
+
+    switch (c) {
+        case ' ': case '\t': case '\r': case '\n':
+            return true;
+        case '"':
+            parser.token = TOKEN_STRING;
+            parser.textLength = 0;
+            parser.escape = 0;
+            return true;
+        case '{':
+        case '[':
+            return openContainer(parser, c == '{');
+        case '}':
+        case ']':
+            return closeContainer(parser, c == '}');
+        case ',':
+            parser.key = KEY_NONE;
+            parser.expectKey = parser.skipDepth == 0 && parser.depth > 0 && isObject(parser.stack[parser.depth - 1]);
+            return true;
+        case ':':
+            parser.expectKey = false;
+            return true;
+        default:
+            break;
+    }
+    parser.textLength = 0;
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        parser.token = TOKEN_NUMBER;
+        keepByte(parser, c);
+        return true;
+    }
+    if (c >= 'a' && c <= 'z') {
+        parser.token = TOKEN_LITERAL;             // true, false, null
+        return true;
+    }
+    return fail(parser, DEFPARSE_SYNTAX);
+}
+
+void defectParserBegin(DefectParser& parser) {
+    memset(&parser, 0, sizeof(parser));
+}
+
+bool defectParserFeed(DefectParser& parser, const char* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (parser.error != DEFPARSE_OK) {
+            return false;
+        }
+        if (parser.done) {
+            return true;
+        }
+        parser.bytes++;
+        if (!step(parser, data[i])) {
+            return false;
+        }
+    }
+    return parser.error == DEFPARSE_OK;
+}
+
+bool defectParserEnd(DefectParser& parser) {
+    if (parser.error != DEFPARSE_OK) {
+        return false;
+    }
+    if (!parser.done || !parser.sawSections || !parser.sawTypes) {
+        return fail(parser, DEFPARSE_INCOMPLETE);
+    }
+    return true;
+}
+
+void defectParserInstall(DefectParser& parser) {
+    cleanupDefectDefinitions();
+    qcSections = parser.sections;
+    qcSectionsCount = parser.sectionCount;
+    qcTypes = parser.types;
+    qcTypesCount = parser.typeCount;
+    if (parser.version[0] != '\0') {
+        defectDefinitionsVersion = parser.version;
+    }
+    defectDefinitionsLoaded = true;
+
+    parser.sections = nullptr;
+    parser.sectionCount = 0;
+    parser.types = nullptr;
+    parser.typeCount = 0;
+}
+
+void defectParserFree(DefectParser& parser) {
+    for (int i = 0; i < parser.typeCount; i++) {
+        delete[] parser.types[i].subtypes;
+    }
+    delete[] parser.types;
+    delete[] parser.sections;
+    parser.sections = nullptr;
+    parser.sectionCount = 0;
+    parser.types = nullptr;
+    parser.typeCount = 0;
+}
+
+const char* defectParseErrorName(DefectParseError error) {
+    switch (error) {
+        case DEFPARSE_OK: return "OK";
+        case DEFPARSE_SYNTAX: return "not valid JSON";
+        case DEFPARSE_TOO_DEEP: return "nested too deep";
+        case DEFPARSE_TOO_MANY: return "too many entries";
+        case DEFPARSE_BAD_CODE: return "code not in 0..255";
+        case DEFPARSE_SERVER_ERROR: return "server error";
+        case DEFPARSE_INCOMPLETE: return "incomplete";
+        case DEFPARSE_NO_MEMORY: return "out of memory";
+    }
+    return "?";
+}
@@ -0,0 +1,139 @@
+#include "endpoints.h"
+#include <math.h>
+
+EndpointHealth endpointHealth[ENDPOINT_MAX];
+EndpointStats endpointStats = {};
+
+static const IngestEndpoint* endpoints = nullptr;
+static uint8_t count = 0;
+static uint8_t current = 0;
+static uint8_t home = 0;
+
+void endpointsBegin(const IngestEndpoint* list, uint8_t listCount, uint32_t deviceId) {
+    endpoints = list;
+    count = listCount < ENDPOINT_MAX ? listCount : ENDPOINT_MAX;
+    home = count > 0 ? deviceId % count : 0;
+    current = home;
+    memset(endpointHealth, 0, sizeof(endpointHealth));
+}
+
+uint8_t endpointCount() {
+    return count;
+}
+
+uint8_t endpointCurrent() {
+    return current;
+}
+
+uint8_t endpointHome() {
+    return home;
+}
+
+const IngestEndpoint& endpointAt(uint8_t index) {
+    return endpoints[index];
+}
+
+// Errors left after the half-life decay since they were last updated
+static float decayedErrors(const EndpointHealth& health, uint32_t now) {
+    if (health.errors <= 0.0f) {
+        return 0.0f;
+    }
+    return health.errors * powf(0.5f, (float)(now - health.errorsAt) / ENDPOINT_ERROR_HALF_LIFE_MS);
+}
+
+static void addError(EndpointHealth& health, uint32_t now) {
+    health.errors = decayedErrors(health, now) + 1.0f;
+    health.errorsAt = now;
+}
+
+int32_t endpointScore(uint8_t index) {
+    const EndpointHealth& health = endpointHealth[index];
+    uint32_t now = millis();
+    bool fresh = health.rttAt != 0 && now - health.rttAt < ENDPOINT_RTT_STALE_MS;
+    int32_t score = fresh ? health.rttMs : ENDPOINT_UNKNOWN_RTT_MS;
+    score += (int32_t)(decayedErrors(health, now) * ENDPOINT_ERROR_COST_MS);
+    if (index == home) {
+        score -= ENDPOINT_HOME_BONUS_MS;
+    }
+    return score;
+}
+
+void endpointConnected() {
+    EndpointHealth& health = endpointHealth[current];
+    health.connects++;
+    health.failuresInRow = 0;
+    health.retryAt = 0;
+    health.rttAt = 0;                      // A new connection starts a new RTT average
+}
+
+void endpointRtt(uint32_t rttMs) {
+    EndpointHealth& health = endpointHealth[current];
+    // Smoothed 3/4 old + 1/4 new, the first sample of a connection taken as is
+    health.rttMs = health.rttAt == 0 ? rttMs : (health.rttMs * 3 + rttMs) / 4;
+    health.rttAt = millis();
+    if (health.rttAt == 0) {
+        health.rttAt = 1;
+    }
+}
+
+void endpointSoftError() {
+    endpointHealth[current].softErrors++;
+    addError(endpointHealth[current], millis());
+}
+
+void endpointFailed() {
+    EndpointHealth& health = endpointHealth[current];
+    uint32_t now = millis();
+    health.failures++;
+    addError(health, now);
+    uint8_t shift = health.failuresInRow < 6 ? health.failuresInRow : 6;
+    uint32_t backoff = ENDPOINT_BACKOFF_MIN_MS << shift;
+    health.retryAt = now + (backoff < ENDPOINT_BACKOFF_MAX_MS ? backoff : ENDPOINT_BACKOFF_MAX_MS);
+    if (health.retryAt == 0) {
+        health.retryAt = 1;
+    }
+    if (health.failuresInRow < 255) {
+        health.failuresInRow++;
+    }
+}
+
+static bool backingOff(uint8_t index, uint32_t now) {
+    uint32_t retryAt = endpointHealth[index].retryAt;
+    return retryAt != 0 && (int32_t)(retryAt - now) > 0;
+}
+
+bool endpointReselect(bool connected) {
+    if (count < 2) {
+        return false;
+    }
+    uint32_t now = millis();
+
+    // Best endpoint not backing off; if every one is, the one whose backoff ends first
+    int16_t best = -1;
+    for (uint8_t i = 0; i < count; i++) {
+        if (!backingOff(i, now) && (best < 0 || endpointScore(i) < endpointScore(best))) {
+            best = i;
+        }
+    }
+    if (best < 0) {
+        best = current;
+        for (uint8_t i = 0; i < count; i++) {
+            if ((int32_t)(endpointHealth[i].retryAt - endpointHealth[best].retryAt) < 0) {
+                best = i;
+            }
+        }
+    }
+
+    if (best == current) {
+        return false;
+    }
+    if (connected && endpointScore(current) <= endpointScore(best) + (int32_t)ENDPOINT_SWITCH_MARGIN_MS) {
+        return false;
+    }
+    current = best;
+    endpointStats.switches++;
+    if (current == home) {
+        endpointStats.homeReturns++;
+    }
+    return true;
+}
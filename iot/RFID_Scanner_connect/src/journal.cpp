@@ -0,0 +1,377 @@
+#include "journal.h"
+#include "logger.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+JournalStats journalStats = {};
+
+static FlashRegion* journalRegion = nullptr;
+static SemaphoreHandle_t journalLock = NULL;   // Journal task appends, connectivity task peeks/acks
+
+static uint32_t slotsPerSector = 0;
+static uint32_t sectorCount = 0;
+static uint32_t slotCount = 0;
+
+static uint32_t headSlot = 0;                  // Next slot to write
+static uint32_t nextSeq = 1;                   // Sequence number of the next record
+static uint32_t tailSlot = 0;                  // Oldest slot that may still hold a pending record
+static uint32_t pendingCount = 0;
+static int32_t preparedSector = -1;            // Sector after the head already erased, -1 if none
+static int32_t erasingSector = -1;             // Sector being prepared outside the lock - no reads or writes, -1 if none
+
+// CRC-32 (IEEE, reflected) - bitwise, a record is only 60 bytes
+static uint32_t crc32Update(uint32_t crc, const uint8_t* data, uint32_t length) {
+    crc = ~crc;
+    for (uint32_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t recordCrc(const JournalRecordHeader& header, const uint8_t* payload) {
+    uint32_t crc = crc32Update(0, (const uint8_t*)&header, offsetof(JournalRecordHeader, crc));
+    return crc32Update(crc, payload, header.length);
+}
+
+static uint32_t slotOffset(uint32_t slot) {
+    return slot * JOURNAL_SLOT_SIZE;
+}
+
+static uint32_t sectorOf(uint32_t slot) {
+    return slot / slotsPerSector;
+}
+
+// Sequence numbers older than one full ring are leftovers of an interrupted erase
+static bool seqInWindow(uint32_t seq) {
+    return seq < nextSeq && (nextSeq <= slotCount || seq >= nextSeq - slotCount);
+}
+
+// Read a slot and check it; false if blank, torn or corrupt
+static bool readRecord(uint32_t slot, JournalRecordHeader& header, uint8_t* payload) {
+    if ((int32_t)sectorOf(slot) == erasingSector) {
+        return false;
+    }
+    if (!journalRegion->read(slotOffset(slot), &header, sizeof(header))) {
+        return false;
+    }
+    if (header.magic != JOURNAL_MAGIC || header.length > JOURNAL_PAYLOAD_SIZE) {
+        return false;
+    }
+    if (!journalRegion->read(slotOffset(slot) + sizeof(header), payload, header.length)) {
+        return false;
+    }
+    return recordCrc(header, payload) == header.crc;
+}
+
+static bool slotIsBlank(uint32_t slot) {
+    uint32_t words[JOURNAL_SLOT_SIZE / 4];
+    if (!journalRegion->read(slotOffset(slot), words, sizeof(words))) {
+        return false;
+    }
+    for (uint32_t i = 0; i < JOURNAL_SLOT_SIZE / 4; i++) {
+        if (words[i] != 0xFFFFFFFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t pendingInSector(uint32_t sector) {
+    JournalRecordHeader header;
+    uint8_t payload[JOURNAL_PAYLOAD_SIZE];
+    uint32_t pending = 0;
+    uint32_t firstSlot = sector * slotsPerSector;
+
+    for (uint32_t slot = firstSlot; slot < firstSlot + slotsPerSector; slot++) {
+        if (readRecord(slot, header, payload) && header.acked == 0xFFFFFFFF && seqInWindow(header.seq)) {
+            pending++;
+        }
+    }
+    return pending;
+}
+
+// Account for a sector about to be erased for the head: pending records still in it are lost (ring full)
+static void releaseSectorForWrite(uint32_t sector) {
+    uint32_t lost = pendingCount > 0 ? pendingInSector(sector) : 0;
+    if (lost > 0) {
+        pendingCount = lost < pendingCount ? pendingCount - lost : 0;
+        journalStats.overwritten += lost;
+        LOG_W("!! Journal full - %lu oldest offline scans overwritten", (unsigned long)lost);
+    }
+    if (lost > 0 && sectorOf(tailSlot) == sector) {
+        tailSlot = ((sector + 1) * slotsPerSector) % slotCount;
+    }
+    if (pendingCount == 0) {
+        tailSlot = headSlot;
+    }
+}
+
+// Erase a sector so the head can write into it
+static void eraseSectorForWrite(uint32_t sector) {
+    releaseSectorForWrite(sector);
+    journalRegion->eraseSector(sector * journalRegion->sectorSize());
+    journalStats.erases++;
+}
+
+// Mount the journal on a flash region: find the newest record and the oldest pending one
+bool journalBegin(FlashRegion* region) {
+    if (region == nullptr || region->sectorSize() % JOURNAL_SLOT_SIZE != 0 || region->size() < 2 * region->sectorSize()) {
+        Serial.println("!! Journal: unusable flash region");
+        return false;
+    }
+    if (journalLock == NULL) {
+        journalLock = xSemaphoreCreateMutex();
+    }
+    xSemaphoreTake(journalLock, portMAX_DELAY);
+
+    journalRegion = region;
+    slotsPerSector = region->sectorSize() / JOURNAL_SLOT_SIZE;
+    sectorCount = region->size() / region->sectorSize();
+    slotCount = sectorCount * slotsPerSector;
+    journalStats.capacity = slotCount;
+    journalStats.corrupt = 0;
+
+    JournalRecordHeader header;
+    uint8_t payload[JOURNAL_PAYLOAD_SIZE];
+
+    // Pass 1: newest record
+    uint32_t maxSeq = 0;
+    uint32_t maxSlot = 0;
+    for (uint32_t slot = 0; slot < slotCount; slot++) {
+        if (readRecord(slot, header, payload)) {
+            if (header.seq > maxSeq) {
+                maxSeq = header.seq;
+                maxSlot = slot;
+            }
+        } else if (!slotIsBlank(slot)) {
+            journalStats.corrupt++;
+        }
+    }
+    nextSeq = maxSeq + 1;
+    headSlot = maxSeq > 0 ? (maxSlot + 1) % slotCount : 0;
+
+    // Pass 2: oldest pending record within one ring of the newest
+    uint32_t minPendingSeq = 0;
+    pendingCount = 0;
+    tailSlot = headSlot;
+    for (uint32_t slot = 0; slot < slotCount; slot++) {
+        if (!readRecord(slot, header, payload) || header.acked != 0xFFFFFFFF || !seqInWindow(header.seq)) {
+            continue;
+        }
+        pendingCount++;
+        if (minPendingSeq == 0 || header.seq < minPendingSeq) {
+            minPendingSeq = header.seq;
+            tailSlot = slot;
+        }
+    }
+
+    preparedSector = -1;
+    erasingSector = -1;
+    journalStats.recovered = pendingCount;
+    xSemaphoreGive(journalLock);
+
+    Serial.printf("Journal: %lu slots in %lu sectors, next seq %lu, %lu pending, %lu corrupt\n",
+                  (unsigned long)slotCount, (unsigned long)sectorCount, (unsigned long)nextSeq,
+                  (unsigned long)pendingCount, (unsigned long)journalStats.corrupt);
+    return true;
+}
+
+bool journalMounted() {
+    return journalRegion != nullptr;
+}
+
+// Append an upload event (Core 0 journal task). ref, if given, receives the new record's position.
+bool journalAppend(const ScannedData& data, JournalRef* ref) {
+    unsigned long started = micros();
+    uint8_t slotData[JOURNAL_SLOT_SIZE];
+    memset(slotData, 0xFF, sizeof(slotData));
+
+    JournalRecordHeader header;
+    header.magic = JOURNAL_MAGIC;
+    header.type = JOURNAL_RECORD_EVENT;
+    header.length = sizeof(ScannedData);
+    header.acked = 0xFFFFFFFF;
+    memcpy(&slotData[sizeof(header)], &data, sizeof(ScannedData));
+
+    xSemaphoreTake(journalLock, portMAX_DELAY);
+    bool written = false;
+    for (uint32_t attempt = 0; attempt < slotCount && !written; attempt++) {
+        // Entering a new sector - erase it unless it was prepared while idle
+        while (headSlot % slotsPerSector == 0 && (int32_t)sectorOf(headSlot) == erasingSector) {
+            xSemaphoreGive(journalLock);
+            vTaskDelay(1);
+            xSemaphoreTake(journalLock, portMAX_DELAY);
+        }
+        if (headSlot % slotsPerSector == 0) {
+            if ((int32_t)sectorOf(headSlot) == preparedSector) {
+                preparedSector = -1;
+            } else {
+                eraseSectorForWrite(sectorOf(headSlot));
+            }
+        }
+
+        // A torn write from before a reset leaves a dirty slot - step over it
+        if (!slotIsBlank(headSlot)) {
+            journalStats.corrupt++;
+            headSlot = (headSlot + 1) % slotCount;
+            continue;
+        }
+
+        header.seq = nextSeq;
+        header.crc = recordCrc(header, &slotData[sizeof(header)]);
+        memcpy(slotData, &header, sizeof(header));
+        if (!journalRegion->write(slotOffset(headSlot), slotData, sizeof(slotData))) {
+            journalStats.corrupt++;
+            headSlot = (headSlot + 1) % slotCount;
+            continue;
+        }
+
+        if (pendingCount == 0) {
+            tailSlot = headSlot;
+        }
+        if (ref != nullptr) {
+            ref->slot = headSlot;
+            ref->seq = nextSeq;
+        }
+        pendingCount++;
+        nextSeq++;
+        headSlot = (headSlot + 1) % slotCount;
+        journalStats.appended++;
+        written = true;
+    }
+    xSemaphoreGive(journalLock);
+
+    uint32_t elapsed = micros() - started;
+    if (elapsed > journalStats.maxAppendUs) {
+        journalStats.maxAppendUs = elapsed;
+    }
+    return written;
+}
+
+static bool slotIsPendingScan(uint32_t slot, JournalRecordHeader& header, uint8_t* payload) {
+    if (!readRecord(slot, header, payload) || header.acked != 0xFFFFFFFF || !seqInWindow(header.seq)) {
+        return false;
+    }
+    return header.type == JOURNAL_RECORD_EVENT && header.length == sizeof(ScannedData);
+}
+
+// Step the tail over delivered, corrupt and blank slots up to the oldest pending record
+static void advanceTail() {
+    JournalRecordHeader header;
+    uint8_t payload[JOURNAL_PAYLOAD_SIZE];
+    
+    while (pendingCount > 0 && !slotIsPendingScan(tailSlot, header, payload)) {
+        tailSlot = (tailSlot + 1) % slotCount;
+        if (tailSlot == headSlot) {
+            pendingCount = 0;          // Count was off (corrupt slots) - nothing left to send
+        }
+    }
+    if (pendingCount == 0) {
+        tailSlot = headSlot;
+    }
+}
+
+// Pending scans in order, starting after `after` (or at the oldest if after is nullptr), up to maxRecords.
+// Returns how many were copied; refs identify them for journalAck().
+uint8_t journalPeek(ScannedData* data, JournalRef* refs, uint8_t maxRecords, const JournalRef* after) {
+    JournalRecordHeader header;
+    uint8_t payload[JOURNAL_PAYLOAD_SIZE];
+    uint8_t found = 0;
+    
+    xSemaphoreTake(journalLock, portMAX_DELAY);
+    advanceTail();
+    uint32_t slot = tailSlot;
+    uint32_t afterSeq = 0;
+    if (after != nullptr && seqInWindow(after->seq)) {
+        slot = (after->slot + 1) % slotCount;
+        afterSeq = after->seq;
+    }
+    for (uint32_t scanned = 0; scanned < slotCount && found < maxRecords && pendingCount > 0; scanned++) {
+        if (slot == headSlot && (scanned > 0 || after != nullptr || pendingCount < slotCount)) {
+            break;
+        }
+        if (slotIsPendingScan(slot, header, payload) && header.seq > afterSeq) {
+            memcpy(&data[found], payload, sizeof(ScannedData));
+            refs[found].slot = slot;
+            refs[found].seq = header.seq;
+            found++;
+        }
+        slot = (slot + 1) % slotCount;
+    }
+    xSemaphoreGive(journalLock);
+    return found;
+}
+
+// Read one record by ref - false if it was delivered or overwritten since the ref was handed out
+bool journalRead(const JournalRef& ref, ScannedData& data) {
+    JournalRecordHeader header;
+    uint8_t payload[JOURNAL_PAYLOAD_SIZE];
+    
+    xSemaphoreTake(journalLock, portMAX_DELAY);
+    bool found = ref.slot < slotCount && slotIsPendingScan(ref.slot, header, payload) && header.seq == ref.seq;
+    if (found) {
+        memcpy(&data, payload, sizeof(ScannedData));
+    }
+    xSemaphoreGive(journalLock);
+    return found;
+}
+
+// Mark records returned by journalPeek() as delivered, in any order. Returns how many were still pending.
+uint8_t journalAck(const JournalRef* refs, uint8_t count) {
+    JournalRecordHeader header;
+    uint8_t payload[JOURNAL_PAYLOAD_SIZE];
+    uint8_t acked = 0;
+    
+    xSemaphoreTake(journalLock, portMAX_DELAY);
+    for (uint8_t i = 0; i < count; i++) {
+        // The record may have been overwritten while it was in flight
+        if (!readRecord(refs[i].slot, header, payload) || header.seq != refs[i].seq || header.acked != 0xFFFFFFFF) {
+            continue;
+        }
+        uint32_t cleared = 0;
+        journalRegion->write(slotOffset(refs[i].slot) + offsetof(JournalRecordHeader, acked), &cleared, sizeof(cleared));
+        if (pendingCount > 0) {
+            pendingCount--;
+        }
+        journalStats.acked++;
+        acked++;
+    }
+    advanceTail();
+    xSemaphoreGive(journalLock);
+    return acked;
+}
+
+uint32_t journalPending() {
+    return pendingCount;
+}
+
+// Erase the sector the write head enters next ahead of time, so appends do not wait for an erase.
+// Skipped while that sector still holds the oldest pending scans - they may yet be uploaded.
+// The sector is claimed under the lock and erased outside it, so peeks and acks are not held up for the
+// length of a flash erase; until it is done the sector reads as empty and the head does not enter it.
+void journalPrepareNextSector() {
+    if (journalRegion == nullptr) {
+        return;
+    }
+    xSemaphoreTake(journalLock, portMAX_DELAY);
+    int32_t next = headSlot % slotsPerSector == 0 ? sectorOf(headSlot) : (sectorOf(headSlot) + 1) % sectorCount;
+    if (next == preparedSector || erasingSector >= 0 || (pendingCount > 0 && pendingInSector(next) > 0)) {
+        xSemaphoreGive(journalLock);
+        return;
+    }
+    releaseSectorForWrite(next);
+    erasingSector = next;
+    xSemaphoreGive(journalLock);
+
+    journalRegion->eraseSector(next * journalRegion->sectorSize());
+
+    xSemaphoreTake(journalLock, portMAX_DELAY);
+    erasingSector = -1;
+    preparedSector = next;
+    journalStats.erases++;
+    xSemaphoreGive(journalLock);
+}
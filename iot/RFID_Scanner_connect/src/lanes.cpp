@@ -0,0 +1,148 @@
+#include "lanes.h"
+
+LaneStats laneStats[LANE_COUNT] = {};
+
+static QueueHandle_t laneQueues[LANE_COUNT] = {NULL};
+static TaskHandle_t laneConsumer = NULL;
+
+// Deficit round robin over the station lanes (consumer side only)
+static uint8_t drrLane = 0;                    // Lane being served
+static uint16_t drrDeficit[STATION_COUNT] = {0};
+
+static uint8_t laneDepthSetting(uint8_t lane) {
+    uint8_t depth = lane == LANE_PRIORITY ? PRIORITY_LANE_DEPTH : STATIONS[lane].laneDepth;
+    return depth > 0 ? depth : 1;
+}
+
+static LaneOverflow laneOverflowSetting(uint8_t lane) {
+    return lane == LANE_PRIORITY ? PRIORITY_LANE_OVERFLOW : STATIONS[lane].laneOverflow;
+}
+
+// Create the lane queues. false if out of memory.
+bool lanesBegin() {
+    for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+        laneQueues[lane] = xQueueCreate(laneDepthSetting(lane), sizeof(ScannedData));
+        if (laneQueues[lane] == NULL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void lanesSetConsumer(TaskHandle_t task) {
+    laneConsumer = task;
+}
+
+// Lane an event belongs to: the priority lane for anything but a production scan
+uint8_t laneFor(const ScannedData& event) {
+    if (event.kind != EVENT_SCAN || event.stationNumber < 1 || event.stationNumber > STATION_COUNT) {
+        return LANE_PRIORITY;
+    }
+    return event.stationNumber - 1;
+}
+
+// Queue an event on its lane, applying the lane's overflow policy. false if it was refused.
+bool laneEnqueue(const ScannedData& event) {
+    uint8_t lane = laneFor(event);
+    QueueHandle_t queue = laneQueues[lane];
+    LaneStats& stats = laneStats[lane];
+
+    bool queued = xQueueSend(queue, &event, 0) == pdTRUE;
+    if (!queued) {
+        switch (laneOverflowSetting(lane)) {
+            case OVERFLOW_DROP_OLDEST: {
+                ScannedData oldest;
+                if (xQueueReceive(queue, &oldest, 0) == pdTRUE) {
+                    stats.dropped++;
+                }
+                queued = xQueueSend(queue, &event, 0) == pdTRUE;
+                break;
+            }
+            case OVERFLOW_WAIT:
+                queued = xQueueSend(queue, &event, pdMS_TO_TICKS(LANE_WAIT_MS)) == pdTRUE;
+                break;
+            case OVERFLOW_DROP_NEWEST:
+                break;
+        }
+        if (!queued) {
+            stats.dropped++;
+        }
+    }
+    if (!queued) {
+        return false;
+    }
+
+    stats.enqueued++;
+    uint32_t depth = uxQueueMessagesWaiting(queue);
+    if (depth > stats.maxDepth) {
+        stats.maxDepth = depth;
+    }
+    if (laneConsumer != NULL) {
+        xTaskNotifyGive(laneConsumer);
+    }
+    return true;
+}
+
+// Next event to forward: the priority lane first, then the station lanes by deficit round robin.
+// Each station lane may forward laneWeight events in a row before the next backed-up lane gets its turn.
+bool laneDequeue(ScannedData& event, uint8_t& lane) {
+    if (xQueueReceive(laneQueues[LANE_PRIORITY], &event, 0) == pdTRUE) {
+        lane = LANE_PRIORITY;
+        return true;
+    }
+
+    for (uint8_t visits = 0; visits <= STATION_COUNT; visits++) {
+        uint8_t current = drrLane;
+        if (drrDeficit[current] == 0) {
+            drrDeficit[current] = STATIONS[current].laneWeight > 0 ? STATIONS[current].laneWeight : 1;
+        }
+        if (xQueueReceive(laneQueues[current], &event, 0) == pdTRUE) {
+            lane = current;
+            if (--drrDeficit[current] == 0) {
+                drrLane = (current + 1) % STATION_COUNT;
+            }
+            return true;
+        }
+        // An empty lane does not bank its turn
+        drrDeficit[current] = 0;
+        drrLane = (current + 1) % STATION_COUNT;
+    }
+    return false;
+}
+
+// Put an event back at the front of its lane (the consumer could not forward it)
+void laneRequeue(const ScannedData& event, uint8_t lane) {
+    if (xQueueSendToFront(laneQueues[lane], &event, 0) != pdTRUE) {
+        laneStats[lane].dropped++;             // A station refilled the lane in the meantime
+    }
+}
+
+uint32_t laneDepth(uint8_t lane) {
+    return laneQueues[lane] != NULL ? uxQueueMessagesWaiting(laneQueues[lane]) : 0;
+}
+
+uint32_t laneCapacity(uint8_t lane) {
+    return laneDepthSetting(lane);
+}
+
+const char* laneName(uint8_t lane) {
+    return lane == LANE_PRIORITY ? "Priority" : STATIONS[lane].shortName;
+}
+
+// Events waiting in all lanes together
+uint32_t lanesWaiting() {
+    uint32_t waiting = 0;
+    for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+        waiting += laneDepth(lane);
+    }
+    return waiting;
+}
+
+// Room in all lanes together
+uint32_t lanesCapacity() {
+    uint32_t capacity = 0;
+    for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+        capacity += laneCapacity(lane);
+    }
+    return capacity;
+}
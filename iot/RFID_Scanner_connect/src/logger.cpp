@@ -0,0 +1,120 @@
+#include "logger.h"
+#include <atomic>
+#include <stdarg.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of two");
+
+LogStats logStats = {};
+volatile uint8_t logLevel = LOG_COMPILE_LEVEL < LOG_LEVEL_INFO ? LOG_COMPILE_LEVEL : LOG_LEVEL_INFO;
+
+// Bounded multi-producer ring (Vyukov): a slot's sequence says whose turn it is.
+// sequence == position: free for the producer that claims position; position + 1: holds a line for the drain.
+struct LogSlot {
+    std::atomic<uint32_t> sequence;
+    char text[LOG_LINE_SIZE];
+};
+
+static LogSlot logRing[LOG_RING_SIZE];
+static std::atomic<uint32_t> logWritePos{0};   // Next position a producer claims
+static uint32_t logReadPos = 0;                // Next position the drain reads (drain task only)
+static std::atomic<uint32_t> logDropped{0};
+static uint32_t logDropsReported = 0;
+static TaskHandle_t logTaskHandle = NULL;
+
+static const char* const LOG_LEVEL_NAMES[] = {"error", "warn", "info", "debug"};
+
+// Core 0, lowest priority - the UART only gets time nobody else wants
+static void logTask(void* parameter) {
+    while (true) {
+        if (logDrain(LOG_RING_SIZE) == 0) {
+            vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_IDLE_MS));
+        }
+    }
+}
+
+// Set up the ring and start the drain task on Core 0 - before any other task exists, so nothing logs into an
+// unprepared ring and the setup needs no check on the logging path
+void logBegin() {
+    if (logTaskHandle != NULL) {
+        return;
+    }
+    for (uint32_t i = 0; i < LOG_RING_SIZE; i++) {
+        logRing[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    xTaskCreatePinnedToCore(logTask, "LogTask", 3072, NULL, 0, &logTaskHandle, 0);   // Idle priority
+}
+
+// Queue one line. Safe from any task, never blocks; false if it was dropped.
+bool logPrintf(LogLevel level, const char* format, ...) {
+    uint32_t position = logWritePos.load(std::memory_order_relaxed);
+    LogSlot* slot;
+    while (true) {
+        slot = &logRing[position & (LOG_RING_SIZE - 1)];
+        int32_t turn = (int32_t)(slot->sequence.load(std::memory_order_acquire) - position);
+        if (turn == 0) {
+            if (logWritePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (turn < 0) {
+            logDropped.fetch_add(1, std::memory_order_relaxed);   // Ring full - the drain is a lap behind
+            return false;
+        } else {
+            position = logWritePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(slot->text, sizeof(slot->text), format, args);
+    va_end(args);
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+// Write waiting lines to Serial, at most maxLines. Returns how many were written (drain task).
+uint32_t logDrain(uint32_t maxLines) {
+    uint32_t written = 0;
+    while (written < maxLines) {
+        LogSlot& slot = logRing[logReadPos & (LOG_RING_SIZE - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != logReadPos + 1) {
+            break;                                 // Empty, or the producer is still formatting
+        }
+        uint32_t depth = logWritePos.load(std::memory_order_relaxed) - logReadPos;
+        if (depth > logStats.maxDepth) {
+            logStats.maxDepth = depth;
+        }
+        Serial.println(slot.text);
+        slot.sequence.store(logReadPos + LOG_RING_SIZE, std::memory_order_release);
+        logReadPos++;
+        logStats.written++;
+        written++;
+    }
+
+    uint32_t dropped = logDropped.load(std::memory_order_relaxed);
+    if (dropped != logDropsReported) {
+        Serial.printf("!! Log: %lu line(s) dropped, ring full\n", (unsigned long)(dropped - logDropsReported));
+        logDropsReported = dropped;
+        logStats.dropped = dropped;
+    }
+    return written;
+}
+
+uint32_t logDepth() {
+    return logWritePos.load(std::memory_order_relaxed) - logReadPos;
+}
+
+const char* logLevelName(uint8_t level) {
+    return level <= LOG_LEVEL_DEBUG ? LOG_LEVEL_NAMES[level] : "?";
+}
+
+bool logLevelFromName(const char* name, uint8_t& level) {
+    for (uint8_t i = 0; i <= LOG_LEVEL_DEBUG; i++) {
+        if (strcasecmp(name, LOG_LEVEL_NAMES[i]) == 0) {
+            level = i;
+            return true;
+        }
+    }
+    return false;
+}
@@ -4,26 +4,43 @@
 #include <WebSocketsClient.h>
 #include <ArduinoJson.h>
 #include <time.h>
+#include <atomic>
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
 #include <freertos/task.h>
 #include <LiquidCrystal_I2C.h>
 #include <Wire.h>
+#include <esp_partition.h>
+#include <Preferences.h>
+#include <esp_sntp.h>
+#include <esp_timer.h>
+#include <esp_netif.h>
+#include <esp_netif_net_stack.h>
+#include <lwip/dhcp.h>
+#include "pipeline.h"
+#include "journal.h"
+#include "wire.h"
+#include "lanes.h"
+#include "logger.h"
+#include "scanid.h"
+#include "timesync.h"
+#include "endpoints.h"
+#include "defparse.h"
+#include "deffetch.h"
 
 // WiFi credentials - Replace with your network credentials
 const char* ssid = "Redmi Note 9 Pro";
 const char* password = "1234r65i";
 const char* wifi_ip = "192.168.50.159";
 
-// WebSocket server configuration
-const char* websocket_server = wifi_ip; // Wi-fi Server IP
-const int websocket_port = 8000;
+// Ingest back ends - WebSocket port for scan uploads, HTTP port (Express) for the API. Each scanner prefers
+// one of them, picked from its device ID so a line spreads across them, and fails over to the others.
+const IngestEndpoint INGEST_ENDPOINTS[] = {
+    {wifi_ip, 8000, 8001},
+    // {"192.168.50.160", 8000, 8001},   // Redundant back end
+};
 const char* websocket_path = "/rfid-ws";
 
-// HTTP API server configuration  
-const char* http_server = wifi_ip; // Same IP as WebSocket server
-const int http_port = 8001; // Express server port for API endpoints
-
 // NTP server configuration for Sri Lanka timezone
 const char* ntpServer = "pool.ntp.org";
 const long gmtOffset_sec = 19800;    // GMT+5:30 for Sri Lanka (5.5 hours * 3600 seconds)
@@ -44,192 +61,102 @@ const uint8_t LCD_QC_COLS = 16;
 const uint8_t LCD_QC_ROWS = 4;
 LiquidCrystal_I2C lcdQC(LCD_QC_I2C_ADDR, LCD_QC_COLS, LCD_QC_ROWS);
 
-// Individual station scan counters
-volatile uint32_t station1ScanCount = 0;
-volatile uint32_t station2ScanCount = 0;
-volatile uint32_t qcScanCount = 0;
-
-// Duplicate scan prevention - stores last scanned UID for normal employee stations
-String lastScannedUID_Station1 = "";
-String lastScannedUID_Station2 = "";
-// Note: QC station (Station 3) doesn't have duplicate prevention
-
-// Station access control - tracks which employee is logged in to each station
-bool station1Active = false;
-bool station2Active = false;
-bool qcActive = false;
-
-String station1Employee = "";
-String station2Employee = "";
-String qcEmployee = "";
-
-// Shift confirmation states
-enum ShiftState {
-    WAITING_FOR_CARD,
-    WAITING_START_CONFIRMATION,
-    ACTIVE_SCANNING,
-    WAITING_END_CONFIRMATION
+// Where a digital line is wired - directly to an ESP32 GPIO or to a pin of the I2C I/O expander
+enum IoSource : uint8_t {
+    IO_NONE,
+    IO_GPIO,
+    IO_EXPANDER
 };
 
-volatile ShiftState station1State = WAITING_FOR_CARD;
-volatile ShiftState station2State = WAITING_FOR_CARD;
-volatile ShiftState qcState = WAITING_FOR_CARD;
-
-// Dynamic QC Defect Configuration - loaded from database
-struct DefectSubtype {
-  uint8_t code;
-  String name;
-  
-  DefectSubtype() : code(0), name("") {}
-  DefectSubtype(uint8_t c, const char* n) : code(c), name(n) {}
+struct IoPin {
+    IoSource source;
+    uint8_t pin;                 // GPIO number, or expander pin (MCP23017: 0-15 = GPA0..GPB7, PCF8574: 0-7)
 };
 
-struct DefectType {
-  uint8_t code;
-  String name;
-  DefectSubtype* subtypes;
-  int subtypeCount;
-  
-  DefectType() : code(0), name(""), subtypes(nullptr), subtypeCount(0) {}
-  DefectType(uint8_t c, const char* n) : code(c), name(n), subtypes(nullptr), subtypeCount(0) {}
-};
+const IoPin NO_IO = {IO_NONE, 0};
 
-struct DefectSection {
-  uint8_t code;
-  String name;
-  
-  DefectSection() : code(0), name("") {}
-  DefectSection(uint8_t c, const char* n) : code(c), name(n) {}
+// Optional I/O expander on the shared Wire bus - provides SS/button lines when one ESP32 serves a whole line
+enum IoExpanderType {
+    EXPANDER_NONE,
+    EXPANDER_MCP23017,
+    EXPANDER_PCF8574
 };
 
-// Dynamic defect configuration variables
-DefectSection* qcSections = nullptr;
-int qcSectionsCount = 0;
-
-DefectType* qcTypes = nullptr;
-int qcTypesCount = 0;
-
-String defectDefinitionsVersion = "";
-bool defectDefinitionsLoaded = false;
-
-// Flag to track if defect definitions have been successfully updated from database
-// This prevents continuous database checking after first successful update
-bool defect_def_updated = false;
-
-// QC Parts selection variables (updated to use dynamic data)
-volatile int qcSelectedPart = 0;
-volatile int qcScrollOffset = 0;
-volatile bool qcInPartsSelection = false;
-
-// QC Selection state management
-enum QCSelectionStep {
-    QC_SELECT_SECTION,
-    QC_SELECT_TYPE,
-    QC_SELECT_SUBTYPE
+const IoExpanderType IO_EXPANDER_TYPE = EXPANDER_NONE;
+const uint8_t IO_EXPANDER_ADDR = 0x20;
+
+// Board wiring of each STATIONS[] row (include/stations.h), in the same order
+struct StationWiring {
+    IoPin ss;                    // RC522 SDA (SS)
+    int8_t irqPin;               // RC522 IRQ (input GPIO), -1 if not wired
+    IoPin okButton;
+    IoPin cancelButton;
+    IoPin upButton;              // QC navigation only
+    IoPin downButton;
+    LiquidCrystal_I2C* display;  // nullptr if the station has no LCD
 };
 
-volatile QCSelectionStep qcCurrentStep = QC_SELECT_SECTION;
-volatile int qcSelectedType = 0;
-volatile int qcSelectedSubtype = 0;
-volatile int qcTypeScrollOffset = 0;
-volatile int qcSubtypeScrollOffset = 0;
-
-// Dynamic numeric conversion functions for defect schema
-uint8_t getSectionCode(int sectionIndex) {
-    if (!defectDefinitionsLoaded || sectionIndex < 0 || sectionIndex >= qcSectionsCount) {
-        return 0; // Default to first section
-    }
-    return qcSections[sectionIndex].code;
-}
-
-uint8_t getTypeCode(int typeIndex) {
-    if (!defectDefinitionsLoaded || typeIndex < 0 || typeIndex >= qcTypesCount) {
-        return 0; // Default to first type
-    }
-    return qcTypes[typeIndex].code;
-}
-
-uint8_t getSubtypeCode(int typeIndex, int subtypeIndex) {
-    if (!defectDefinitionsLoaded || typeIndex < 0 || typeIndex >= qcTypesCount) {
-        return 0; // Default
-    }
-    
-    DefectType& type = qcTypes[typeIndex];
-    if (subtypeIndex < 0 || subtypeIndex >= type.subtypeCount) {
-        return 0; // Default
-    }
-    
-    return type.subtypes[subtypeIndex].code;
-}
+// For more stations than free GPIOs, set IO_EXPANDER_TYPE and move SS/button lines to {IO_EXPANDER, pin}, e.g.:
+//   {{IO_EXPANDER, 0}, -1, {IO_EXPANDER, 8}, {IO_EXPANDER, 9}, NO_IO, NO_IO, nullptr},
+const StationWiring STATION_WIRING[] = {
+    {{IO_GPIO, 5}, 35, {IO_GPIO, 32}, {IO_GPIO, 12}, NO_IO, NO_IO, nullptr},          // Line 1-Station 5
+    {{IO_GPIO, 4}, 36, {IO_GPIO, 13}, {IO_GPIO, 14}, NO_IO, NO_IO, &lcdStation2},     // Line 2-Station 5
+    {{IO_GPIO, 2}, 39, {IO_GPIO, 33}, {IO_GPIO, 25}, {IO_GPIO, 26}, {IO_GPIO, 27}, &lcdQC}  // QC Station
+};
 
-// Daily scan counter for ID generation
-volatile uint16_t dailyScanCount = 0;
-String lastDateString = "";
+static_assert(sizeof(STATION_WIRING) / sizeof(STATION_WIRING[0]) == STATION_COUNT,
+              "STATION_WIRING needs one row per STATIONS[] entry");
 
 // WebSocket connection status
 volatile bool wsConnected = false;
 
-// ScannedData structure for queue
-struct ScannedData {
-    time_t timestamp;             // Unix timestamp
-    uint8_t stationNumber;       // Scanner ID (1, 2, or 3)
-    uint8_t lineNumber;          // Line number (1, 2, or 3)
-    uint8_t uid[10];            // RFID UID (max 10 bytes for MIFARE)
-    uint8_t uidSize;           // Actual UID size
-    char scanID[16];           // Generated scan ID
-    char stationID[8];         // Station ID (e.g., "A105", "A205", "Q001")
-};
-
-// FreeRTOS Queue handle
-QueueHandle_t scannedDataQueue;
-const int QUEUE_SIZE = 100;      // Increased to 100 for better offline storage
+// Upload encoding the server accepted in reply to our hello - JSON until it answers
+volatile WireFormat wsWireFormat = WIRE_JSON;
+volatile bool wsServerAcks = false;       // Server acks scan batches - without acks a pong confirms what was sent
+volatile bool wsHelloAnswered = false;    // Until then the server may still turn acks on - nothing is released early
 
 // FreeRTOS Task handles
 TaskHandle_t connectivityTaskHandle = NULL;
-TaskHandle_t rfidScanningTaskHandle = NULL;
 
-// Time synchronization variables
-unsigned long lastNTPSync = 0;
+// Build profile - release images (RELEASE_BUILD) compile out log lines above LOG_COMPILE_LEVEL
+#ifdef RELEASE_BUILD
+const char* const BUILD_PROFILE = "release";
+#else
+const char* const BUILD_PROFILE = "debug";
+#endif
+uint32_t bootFreeHeap = 0;                // Free heap once setup() has started every task
+
+// Time synchronization - SNTP repeats on its own at this interval
 const unsigned long NTP_SYNC_INTERVAL = 2 * 60 * 60 * 1000; // 2 hours in milliseconds
 
 // Defect definitions refresh variables
-unsigned long lastDefectDefinitionsSync = 0;
+// Once a set from the server is loaded it is re-checked every interval, give or take the jitter, so new defect
+// codes reach QC without a restart. The check sends the ETag of the loaded set; an unchanged set costs a 304.
+const unsigned long DEFECT_REFRESH_INTERVAL = 30 * 60 * 1000;           // 30 minutes in milliseconds
+const unsigned long DEFECT_REFRESH_JITTER = 5 * 60 * 1000;              // +-, so a line of boards does not ask together
 const unsigned long DEFECT_DEFINITIONS_RETRY_INTERVAL = 5 * 60 * 1000; // 5 minutes in milliseconds
+const uint32_t DEFECT_FETCH_CONNECT_TIMEOUT = 1000;                     // The only wait of a fetch (deffetch.h)
+uint32_t defectRefreshIntervalMs = DEFECT_REFRESH_INTERVAL;             // 0 = only until the first set loads
+uint32_t defectRefreshJitterMs = DEFECT_REFRESH_JITTER;
+unsigned long nextDefectRefreshAt = 0;
+
+bool defectFetchManual = false;           // The running fetch answers the 'refresh' command
+uint32_t defectFetchHeapBefore = 0;       // Free heap when it started, and the lowest since
+uint32_t defectFetchHeapLow = 0;
 
 // WiFi and time synchronization status flags
 volatile bool wifiConnected = false;
-volatile bool timeInitialized = false;
 
 // Forward declarations for FreeRTOS tasks
 void connectivityTask(void *parameter);
-void rfidScanningTask(void *parameter);
 
 // Forward declarations for defect definitions functions
-bool fetchDefectDefinitions();
-bool parseDefectDefinitions(JsonDocument& doc);
-void cleanupDefectDefinitions();
-void loadFallbackDefectDefinitions();
+bool startDefectFetch(bool conditional, bool manual);
+void stepDefectFetch();
 
-// Forward declarations for LCD functions
+// Forward declarations for LCD and button setup
 void initLCDs();
-void updateStation2Display(const char* uid, uint32_t scanCount);
-void updateQCDisplay(const char* uid, uint32_t scanCount);
-void displayStation2Message(String line1, String line2);
-void displayQCMessage(String line1, String line2, String line3 = "", String line4 = "");
-
-// Forward declarations for button functions
 void initButtons();
-bool isOKPressed(uint8_t stationNumber);
-bool isCancelPressed(uint8_t stationNumber);
-void waitForButtonRelease(uint8_t stationNumber);
-bool waitForButtonPress(uint8_t stationNumber, unsigned long timeoutMs = 30000);
-
-// Forward declarations for QC navigation functions
-bool isQCUpPressed();
-bool isQCDownPressed();
-void waitForQCButtonRelease();
-void displayQCPartsList();
-bool handleQCPartsSelection();
 
 // Volatile variables for ISR-safe power detection
 volatile bool powerStateChanged = false;
@@ -248,26 +175,9 @@ String repeatString(const char* str, int count) {
     return result;
 }
 
-// RFID Scanner pins
-const uint8_t SCANNER_SS_PINS[] = {
-    5,   // Line 1-Station 5
-    4,   // Line 2-Station 5
-    2    // QC Station
-};
-
-// Button pins for shift confirmation
-const struct {
-    uint8_t ok;
-    uint8_t cancel;
-} BUTTON_PINS[] = {
-    {32, 12},  // Line 1-Station 5 - OK: 32, Cancel: 12
-    {13, 14},  // Line 2-Station 5 - OK: 13, Cancel: 14
-    {33, 25}   // QC Station - OK: 27, Cancel: 26
-};
-
-// QC Navigation button pins
-const uint8_t QC_UP_BUTTON = 26;
-const uint8_t QC_DOWN_BUTTON = 27;
+// Use the IRQ lines to wake the scanning task when a card answers.
+// Readers whose IRQ line does not pass the startup self-test fall back to polling.
+const bool RFID_IRQ_MODE = true;
 
 // Buzzer pin
 const uint8_t BUZZER_PIN = 15;
@@ -280,680 +190,1143 @@ const uint8_t SCK_PIN = 18;
 const uint8_t MOSI_PIN = 23;
 const uint8_t MISO_PIN = 19;
 
-// Create RFID instances
-MFRC522 readers[] = {
-    MFRC522(SCANNER_SS_PINS[0], 0), // RST pin not used
-    MFRC522(SCANNER_SS_PINS[1], 0),
-    MFRC522(SCANNER_SS_PINS[2], 0)
+// SPI clock steps tried per reader at startup (MFRC522 supports up to 10MHz)
+const uint32_t SPI_CLOCK_STEPS[] = {1000000, 2000000, 4000000, 8000000, 10000000};
+const uint8_t SPI_CLOCK_STEP_COUNT = sizeof(SPI_CLOCK_STEPS) / sizeof(SPI_CLOCK_STEPS[0]);
+const uint8_t SPI_CALIBRATION_ROUNDS = 20;       // VersionReg + FIFO loopback checks per step
+
+// Runtime fallback: step a reader's clock down when errors exceed this share of polls in a window
+const uint8_t SPI_ERROR_THRESHOLD_PERCENT = 2;
+const uint8_t SPI_ERROR_MIN_COUNT = 5;           // Ignore a handful of errors (cards leaving mid-select)
+const uint8_t SPI_ERROR_VERIFY_ROUNDS = 4;       // Bus checks at the current clock before blaming it for the errors
+const uint32_t SPI_REPROBE_MS = 60000;           // A lowered clock tries one notch up after this long without errors
+
+// SPI/IRQ link state of one MFRC522 reader (the protocol state is in readerSlots[])
+struct ReaderLink {
+    bool irqEnabled;               // IRQ line wired and verified - no need to poll this reader
+    uint8_t spiClockStep;          // Index into SPI_CLOCK_STEPS used for this reader
+    uint8_t calibratedStep;        // Fastest step that passed at startup - the runtime clock never goes above it
+    uint8_t version;               // VersionReg value read at the safe clock
+    uint32_t spiFallbacks;         // Times the clock was stepped down at runtime
+    uint32_t spiRestores;          // ... and stepped back up after a clean stretch
+    unsigned long spiChangedAt;    // Last runtime clock change or failed step up
 };
 
-void initRFID(MFRC522& rfid) {
-    rfid.PCD_Init();
-    delay(50);
-    
-    // Configure for reliable operation
-    rfid.PCD_WriteRegister(MFRC522::TxASKReg, 0x40);       // Force 100% ASK modulation
-    rfid.PCD_WriteRegister(MFRC522::RFCfgReg, 0x70);      // Receiver gain 48dB
-    rfid.PCD_WriteRegister(MFRC522::ModeReg, 0x3D);      // CRC with 0x6363
-    
-    // Enable antenna
-    rfid.PCD_WriteRegister(MFRC522::TxControlReg, 0x83);
+ReaderLink readerLinks[STATION_COUNT];
+
+// IRQ counters per reader, updated from ISR
+volatile uint32_t readerIrqCount[STATION_COUNT] = {0};
+
+// Output latch of the I/O expander - SS lines are only driven from setup() and the scanning task
+uint16_t ioExpanderLatch = 0xFFFF;
+uint16_t ioExpanderDirection = 0xFFFF;   // MCP23017 IODIR, 1 = input
+uint16_t ioExpanderPullups = 0x0000;     // MCP23017 GPPU
+
+// MCP23017 registers (IOCON.BANK = 0, A/B registers interleaved)
+const uint8_t MCP23017_IODIRA = 0x00;
+const uint8_t MCP23017_GPPUA = 0x0C;
+const uint8_t MCP23017_GPIOA = 0x12;
+const uint8_t MCP23017_OLATA = 0x14;
+
+// Write one A/B register pair of the MCP23017
+void mcp23017WritePair(uint8_t reg, uint16_t value) {
+    Wire.beginTransmission(IO_EXPANDER_ADDR);
+    Wire.write(reg);
+    Wire.write(value & 0xFF);
+    Wire.write(value >> 8);
+    Wire.endTransmission();
 }
 
-// Initialize WiFi connection (Core 0 task)
-void initWiFi() {
-    Serial.printf("Attempting to connect to WiFi network: %s\n", ssid);
-    WiFi.begin(ssid, password);
-    Serial.print("Connecting to WiFi");
-    
-    int attempts = 0;
-    const int maxAttempts = 40; // 20 seconds timeout
-    
-    while (WiFi.status() != WL_CONNECTED && attempts < maxAttempts) {
-        delay(500);
-        Serial.print(".");
-        attempts++;
-        
-        // Print status every 10 attempts (5 seconds)
-        if (attempts % 10 == 0) {
-            Serial.printf("\nWiFi Status: %d, Attempts: %d/%d\n", WiFi.status(), attempts, maxAttempts);
-            Serial.print("Continuing");
+// Write a single MCP23017 register (port A or B)
+void mcp23017WriteRegister(uint8_t reg, uint8_t value) {
+    Wire.beginTransmission(IO_EXPANDER_ADDR);
+    Wire.write(reg);
+    Wire.write(value);
+    Wire.endTransmission();
+}
+
+// Read the input port(s) of the expander
+uint16_t ioExpanderReadInputs() {
+    if (IO_EXPANDER_TYPE == EXPANDER_MCP23017) {
+        Wire.beginTransmission(IO_EXPANDER_ADDR);
+        Wire.write(MCP23017_GPIOA);
+        Wire.endTransmission(false);
+        if (Wire.requestFrom(IO_EXPANDER_ADDR, (uint8_t)2) != 2) {
+            return 0xFFFF;
         }
+        uint16_t value = Wire.read();
+        value |= (uint16_t)Wire.read() << 8;
+        return value;
     }
-    
-    if (WiFi.status() == WL_CONNECTED) {
-        Serial.println();
-        Serial.print("WiFi connected! IP address: ");
-        Serial.println(WiFi.localIP());
-        Serial.printf("RSSI: %d dBm\n", WiFi.RSSI());
-        wifiConnected = true;
-    } else {
-        Serial.println();
-        Serial.println("!!! WiFi connection failed after timeout !!!");
-        Serial.printf("Final WiFi Status: %d\n", WiFi.status());
-        Serial.println("Please check:");
-        Serial.println("1. WiFi network name (SSID) is correct");
-        Serial.println("2. WiFi password is correct");
-        Serial.println("3. WiFi network is 2.4GHz (ESP32 doesn't support 5GHz)");
-        Serial.println("4. ESP32 is close enough to the router/hotspot");
-        wifiConnected = false;
+    if (IO_EXPANDER_TYPE == EXPANDER_PCF8574) {
+        if (Wire.requestFrom(IO_EXPANDER_ADDR, (uint8_t)1) != 1) {
+            return 0xFFFF;
+        }
+        return 0xFF00 | Wire.read();
     }
+    return 0xFFFF;
 }
 
-// Initialize NTP and synchronize time (Core 0 task)
-void initNTP() {
-    if (!wifiConnected) {
-        Serial.println("WiFi not connected, cannot sync time");
+// Configure a station line as input (with pull-up) or output, wherever it is wired
+void ioPinMode(IoPin io, uint8_t mode) {
+    if (io.source == IO_GPIO) {
+        pinMode(io.pin, mode);
+        return;
+    }
+    if (io.source != IO_EXPANDER) {
         return;
     }
     
-    Serial.printf("Configuring NTP with server: %s\n", ntpServer);
-    configTime(gmtOffset_sec, daylightOffset_sec, ntpServer);
-    
-    Serial.print("Synchronizing time with NTP server");
-    struct tm timeinfo;
-    int attempts = 0;
-    const int maxAttempts = 40; // 20 seconds timeout
-    
-    while (!getLocalTime(&timeinfo) && attempts < maxAttempts) {
-        delay(500);
-        Serial.print(".");
-        attempts++;
-        
-        // Print status every 10 attempts (5 seconds)
-        if (attempts % 10 == 0) {
-            Serial.printf("\nNTP sync attempts: %d/%d\n", attempts, maxAttempts);
-            Serial.print("Continuing");
+    uint16_t mask = 1 << io.pin;
+    if (IO_EXPANDER_TYPE == EXPANDER_MCP23017) {
+        if (mode == OUTPUT) {
+            ioExpanderDirection &= ~mask;
+        } else {
+            ioExpanderDirection |= mask;
+            ioExpanderPullups |= mask;
         }
+        mcp23017WritePair(MCP23017_GPPUA, ioExpanderPullups);
+        mcp23017WritePair(MCP23017_OLATA, ioExpanderLatch);
+        mcp23017WritePair(MCP23017_IODIRA, ioExpanderDirection);
+    } else if (IO_EXPANDER_TYPE == EXPANDER_PCF8574) {
+        // Quasi-bidirectional: inputs are pins latched high (weak pull-up)
+        ioExpanderLatch |= mask;
+        Wire.beginTransmission(IO_EXPANDER_ADDR);
+        Wire.write(ioExpanderLatch & 0xFF);
+        Wire.endTransmission();
+    }
+}
+
+// Drive a station output line; on the expander only the changed port is written
+void ioWrite(IoPin io, uint8_t level) {
+    if (io.source == IO_GPIO) {
+        digitalWrite(io.pin, level);
+        return;
+    }
+    if (io.source != IO_EXPANDER) {
+        return;
     }
     
-    if (getLocalTime(&timeinfo)) {
-        Serial.println();
-        Serial.println("Time synchronized successfully!");
-        Serial.print("Current time: ");
-        Serial.println(asctime(&timeinfo));
-        lastNTPSync = millis();
-        timeInitialized = true;
+    uint16_t mask = 1 << io.pin;
+    if (level == HIGH) {
+        ioExpanderLatch |= mask;
     } else {
-        Serial.println();
-        Serial.println("!! NTP synchronization failed after timeout !!");
-        Serial.println("Continuing without time sync (timestamps will be 0)");
-        timeInitialized = false;
+        ioExpanderLatch &= ~mask;
+    }
+    
+    if (IO_EXPANDER_TYPE == EXPANDER_MCP23017) {
+        if (io.pin < 8) {
+            mcp23017WriteRegister(MCP23017_OLATA, ioExpanderLatch & 0xFF);
+        } else {
+            mcp23017WriteRegister(MCP23017_OLATA + 1, ioExpanderLatch >> 8);
+        }
+    } else if (IO_EXPANDER_TYPE == EXPANDER_PCF8574) {
+        Wire.beginTransmission(IO_EXPANDER_ADDR);
+        Wire.write(ioExpanderLatch & 0xFF);
+        Wire.endTransmission();
     }
 }
 
-// Check if NTP resync is needed and perform it (Core 0 task)
-void checkNTPSync() {
-    if (!wifiConnected) return;
-    
-    if (millis() - lastNTPSync >= NTP_SYNC_INTERVAL) {
-        Serial.println("Re-synchronizing time with NTP server...");
-        configTime(gmtOffset_sec, daylightOffset_sec, ntpServer);
-        lastNTPSync = millis();
+// Read a station input line, HIGH if the line is not wired
+uint8_t ioRead(IoPin io) {
+    if (io.source == IO_GPIO) {
+        return digitalRead(io.pin);
+    }
+    if (io.source == IO_EXPANDER) {
+        return (ioExpanderReadInputs() >> io.pin) & 0x01 ? HIGH : LOW;
     }
+    return HIGH;
 }
 
-// Check if defect definitions need to be refreshed (Core 0 task)
-void checkDefectDefinitionsSync() {
-    if (!wifiConnected) return;
+// Start the I2C bus (LCDs + expander) and park every reader's SS line high
+void initIoLines() {
+    Wire.begin();
+    if (IO_EXPANDER_TYPE != EXPANDER_NONE) {
+        Wire.setClock(400000);   // Each expander SS toggle is an I2C write - keep them short
+        Serial.printf("I/O expander %s at 0x%02X\n",
+                      IO_EXPANDER_TYPE == EXPANDER_MCP23017 ? "MCP23017" : "PCF8574", IO_EXPANDER_ADDR);
+    }
     
-    // Only check database if not already updated successfully since startup
-    if (!defect_def_updated && (millis() - lastDefectDefinitionsSync >= DEFECT_DEFINITIONS_RETRY_INTERVAL)) {
-        
-        Serial.println("Attempting to refresh defect definitions from server...");
-        if (fetchDefectDefinitions()) {
-            Serial.println("Successfully updated defect definitions from server!");
-            defect_def_updated = true; // Set flag to prevent further automatic checks
-        } else {
-            Serial.println("Failed to refresh defect definitions, keeping fallback data");
-        }
-        lastDefectDefinitionsSync = millis();
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+        ioWrite(STATION_WIRING[i].ss, HIGH);
+        ioPinMode(STATION_WIRING[i].ss, OUTPUT);
+        ioWrite(STATION_WIRING[i].ss, HIGH);
     }
 }
 
-// Fetch defect definitions from server (Core 0 task)
-bool fetchDefectDefinitions() {
-    if (!wifiConnected) {
-        Serial.println("WiFi not connected, cannot fetch defect definitions");
-        return false;
+// Write a reader register at the reader's calibrated SPI clock
+void rfidWriteRegister(uint8_t readerIndex, MFRC522::PCD_Register reg, uint8_t value) {
+    SPI.beginTransaction(SPISettings(SPI_CLOCK_STEPS[readerLinks[readerIndex].spiClockStep], MSBFIRST, SPI_MODE0));
+    ioWrite(STATION_WIRING[readerIndex].ss, LOW);
+    SPI.transfer(reg);
+    SPI.transfer(value);
+    ioWrite(STATION_WIRING[readerIndex].ss, HIGH);
+    SPI.endTransaction();
+}
+
+// Write several bytes to one reader register (FIFO) at the reader's calibrated SPI clock
+void rfidWriteRegister(uint8_t readerIndex, MFRC522::PCD_Register reg, uint8_t count, const uint8_t* values) {
+    SPI.beginTransaction(SPISettings(SPI_CLOCK_STEPS[readerLinks[readerIndex].spiClockStep], MSBFIRST, SPI_MODE0));
+    ioWrite(STATION_WIRING[readerIndex].ss, LOW);
+    SPI.transfer(reg);
+    for (uint8_t i = 0; i < count; i++) {
+        SPI.transfer(values[i]);
     }
+    ioWrite(STATION_WIRING[readerIndex].ss, HIGH);
+    SPI.endTransaction();
+}
 
-    Serial.println("Fetching defect definitions from server...");
-    Serial.printf("Connecting to: %s:%d\n", http_server, http_port);
-    
-    // Create HTTP client
-    WiFiClient client;
-    
-    if (!client.connect(http_server, http_port)) {
-        Serial.printf("!! Failed to connect to HTTP server %s:%d for defect definitions\n", http_server, http_port);
-        Serial.println("Check if:");
-        Serial.println("1. Backend server is running on port 8001");
-        Serial.println("2. IP address is correct: " + String(http_server));
-        Serial.println("3. Server is accessible from ESP32 network");
-        return false;
+// Read a reader register at the reader's calibrated SPI clock
+uint8_t rfidReadRegister(uint8_t readerIndex, MFRC522::PCD_Register reg) {
+    SPI.beginTransaction(SPISettings(SPI_CLOCK_STEPS[readerLinks[readerIndex].spiClockStep], MSBFIRST, SPI_MODE0));
+    ioWrite(STATION_WIRING[readerIndex].ss, LOW);
+    SPI.transfer(0x80 | reg);
+    uint8_t value = SPI.transfer(0);
+    ioWrite(STATION_WIRING[readerIndex].ss, HIGH);
+    SPI.endTransaction();
+    return value;
+}
+
+// Read several bytes from one reader register (FIFO) at the reader's calibrated SPI clock
+void rfidReadRegister(uint8_t readerIndex, MFRC522::PCD_Register reg, uint8_t count, uint8_t* values) {
+    if (count == 0) {
+        return;
+    }
+    uint8_t address = 0x80 | reg;
+    SPI.beginTransaction(SPISettings(SPI_CLOCK_STEPS[readerLinks[readerIndex].spiClockStep], MSBFIRST, SPI_MODE0));
+    ioWrite(STATION_WIRING[readerIndex].ss, LOW);
+    SPI.transfer(address);
+    for (uint8_t i = 0; i < count - 1; i++) {
+        values[i] = SPI.transfer(address);   // Each byte clocked out requests the next read
     }
+    values[count - 1] = SPI.transfer(0);
+    ioWrite(STATION_WIRING[readerIndex].ss, HIGH);
+    SPI.endTransaction();
+}
 
-    Serial.println("Connected to server, sending HTTP request...");
-    
-    // Send HTTP GET request
-    String request = "GET /api/defect-definitions/esp32 HTTP/1.1\r\n";
-    request += "Host: " + String(http_server) + ":" + String(http_port) + "\r\n";
-    request += "Connection: close\r\n\r\n";
+// Check VersionReg and a FIFO loopback pattern at the reader's current SPI clock
+bool rfidVerifySpi(uint8_t readerIndex, uint8_t rounds) {
+    uint8_t pattern[16];
+    uint8_t readBack[16];
     
-    Serial.println("HTTP Request:");
-    Serial.println(request);
-    
-    client.print(request);
-
-    // Wait for response
-    Serial.println("Waiting for server response...");
-    unsigned long timeout = millis() + 10000; // 10 second timeout
-    while (client.available() == 0) {
-        if (millis() > timeout) {
-            Serial.println("!! Timeout waiting for defect definitions response (10 seconds)");
-            Serial.println("!! Server may be down or not responding");
-            client.stop();
+    for (uint8_t round = 0; round < rounds; round++) {
+        if (rfidReadRegister(readerIndex, MFRC522::VersionReg) != readerLinks[readerIndex].version) {
+            return false;
+        }
+        
+        for (uint8_t i = 0; i < sizeof(pattern); i++) {
+            pattern[i] = (uint8_t)(0xA5 ^ (i * 37) ^ (round << 3)); // Mix of toggling bits
+        }
+        rfidWriteRegister(readerIndex, MFRC522::CommandReg, MFRC522::PCD_Idle);
+        rfidWriteRegister(readerIndex, MFRC522::FIFOLevelReg, 0x80);           // Flush FIFO
+        rfidWriteRegister(readerIndex, MFRC522::FIFODataReg, sizeof(pattern), pattern);
+        if (rfidReadRegister(readerIndex, MFRC522::FIFOLevelReg) != sizeof(pattern)) {
+            return false;
+        }
+        rfidReadRegister(readerIndex, MFRC522::FIFODataReg, sizeof(readBack), readBack);
+        if (memcmp(pattern, readBack, sizeof(pattern)) != 0) {
             return false;
         }
-        delay(10);
     }
+    return true;
+}
 
-    Serial.println("Receiving response from server...");
+// Step the reader's SPI clock up until VersionReg or FIFO loopback fails, keep the fastest good rate
+void calibrateReaderSpi(uint8_t readerIndex) {
+    ReaderLink& slot = readerLinks[readerIndex];
     
-    // Read response
-    String response = "";
-    String fullResponse = "";
-    bool headersEnded = false;
-    int statusCode = 0;
+    slot.spiClockStep = 0;
+    slot.version = rfidReadRegister(readerIndex, MFRC522::VersionReg);
+    if (slot.version == 0x00 || slot.version == 0xFF) {
+        Serial.printf("Reader %d not responding on SPI, staying at %lu Hz\n", readerIndex + 1, SPI_CLOCK_STEPS[0]);
+        return;
+    }
     
-    while (client.available()) {
-        String line = client.readStringUntil('\n');
-        fullResponse += line + "\n";
-        
-        if (!headersEnded) {
-            // Check HTTP status code
-            if (line.startsWith("HTTP/1.1 ") && statusCode == 0) {
-                statusCode = line.substring(9, 12).toInt();
-                Serial.println("HTTP Status Code: " + String(statusCode));
-            }
-            
-            if (line == "\r") {
-                headersEnded = true;
-                Serial.println("Headers received, reading body...");
-            }
-        } else {
-            response += line;
+    for (uint8_t step = 1; step < SPI_CLOCK_STEP_COUNT; step++) {
+        slot.spiClockStep = step;
+        if (!rfidVerifySpi(readerIndex, SPI_CALIBRATION_ROUNDS)) {
+            slot.spiClockStep = step - 1;
+            break;
         }
     }
     
-    client.stop();
+    slot.calibratedStep = slot.spiClockStep;
     
-    Serial.println("Full HTTP Response:");
-    Serial.println("==================");
-    Serial.println(fullResponse.substring(0, 500) + "..."); // Print first 500 chars
-    Serial.println("==================");
-
-    if (statusCode != 200) {
-        Serial.printf("!! HTTP Error: Status code %d\n", statusCode);
-        Serial.println("!! Expected 200 OK, but got error response");
-        return false;
-    }
+    // Leave the FIFO empty for the scheduler
+    rfidWriteRegister(readerIndex, MFRC522::FIFOLevelReg, 0x80);
+}
 
-    if (response.length() == 0) {
-        Serial.println("!! Empty response body from defect definitions endpoint");
-        Serial.println("!! Check if the endpoint /api/iot/defect-definitions/esp32 exists");
-        return false;
+// Adapt the reader's SPI clock to the last poll window (Core 1 task). The error count includes RF errors (noise,
+// cards leaving the field) that a slower bus does not fix, so the clock steps down only when the bus itself fails
+// its checks; after SPI_REPROBE_MS without errors a lowered clock tries one notch up again.
+// Returns true if the reader was touched (the checks use its FIFO) and the protocol must restart
+bool checkReaderSpiErrors(uint8_t readerIndex, uint32_t windowPolls, uint32_t windowErrors) {
+    ReaderLink& slot = readerLinks[readerIndex];
+    unsigned long now = millis();
+    
+    if (windowErrors < SPI_ERROR_MIN_COUNT) {
+        if (windowErrors > 0 || slot.spiClockStep >= slot.calibratedStep || now - slot.spiChangedAt < SPI_REPROBE_MS) {
+            return false;
+        }
+        slot.spiClockStep++;
+        slot.spiChangedAt = now;
+        if (!rfidVerifySpi(readerIndex, SPI_CALIBRATION_ROUNDS)) {
+            slot.spiClockStep--;
+        } else {
+            slot.spiRestores++;
+            LOG_I("Core 1 - Reader %d: SPI clock back up to %lu Hz", readerIndex + 1,
+                  SPI_CLOCK_STEPS[slot.spiClockStep]);
+        }
+        rfidWriteRegister(readerIndex, MFRC522::FIFOLevelReg, 0x80);
+        return true;
     }
-
-    Serial.println("Response body received:");
-    Serial.println(response.substring(0, 300) + "..."); // Print first 300 chars
-
-    // Parse JSON response
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, response);
-
-    if (error) {
-        Serial.print("Failed to parse defect definitions JSON: ");
-        Serial.println(error.c_str());
+    if (windowErrors * 100 <= windowPolls * SPI_ERROR_THRESHOLD_PERCENT || slot.spiClockStep == 0) {
         return false;
     }
-
-    return parseDefectDefinitions(doc);
+    
+    bool busGood = rfidVerifySpi(readerIndex, SPI_ERROR_VERIFY_ROUNDS);
+    if (!busGood) {
+        slot.spiFallbacks++;
+        slot.spiChangedAt = now;
+        // Step down until the bus passes
+        do {
+            slot.spiClockStep--;
+        } while (slot.spiClockStep > 0 && !rfidVerifySpi(readerIndex, SPI_ERROR_VERIFY_ROUNDS));
+        LOG_W("Core 1 - Reader %d: %lu errors in %lu polls, SPI clock lowered to %lu Hz",
+              readerIndex + 1, windowErrors, windowPolls, SPI_CLOCK_STEPS[slot.spiClockStep]);
+    } else {
+        LOG_D("Core 1 - Reader %d: %lu errors in %lu polls with the bus checks passing - RF errors, clock kept",
+              readerIndex + 1, windowErrors, windowPolls);
+    }
+    rfidWriteRegister(readerIndex, MFRC522::FIFOLevelReg, 0x80);
+    return true; // Restart the protocol (at the new clock)
 }
 
-// Parse and store defect definitions (Core 0 task)
-bool parseDefectDefinitions(JsonDocument& doc) {
-    Serial.println("Parsing defect definitions...");
+// Start a transceive on the reader and return immediately; the answer is collected by pcdPollTransceive()
+// rxAlign places the first received bit after the known bits of a partial anticollision byte
+void pcdStartTransceive(uint8_t readerIndex, const uint8_t* data, uint8_t length, uint8_t txLastBits, uint8_t rxAlign) {
+    rfidWriteRegister(readerIndex, MFRC522::CommandReg, MFRC522::PCD_Idle);   // Stop any active command
+    rfidWriteRegister(readerIndex, MFRC522::ComIrqReg, 0x7F);                 // Clear all IRQ bits
+    rfidWriteRegister(readerIndex, MFRC522::FIFOLevelReg, 0x80);              // Flush FIFO
+    rfidWriteRegister(readerIndex, MFRC522::FIFODataReg, length, data);
+    uint8_t bitFraming = (rxAlign << 4) | txLastBits;
+    rfidWriteRegister(readerIndex, MFRC522::BitFramingReg, bitFraming);
+    rfidWriteRegister(readerIndex, MFRC522::CommandReg, MFRC522::PCD_Transceive);
+    rfidWriteRegister(readerIndex, MFRC522::BitFramingReg, 0x80 | bitFraming); // StartSend
+}
 
-    // Check if we got an error response
-    if (doc["error"].is<const char*>()) {
-        Serial.println("Server returned error: " + String(doc["error"].as<const char*>()));
-        
-        // Try to use fallback data if provided
-        if (doc["fallback"].is<JsonObject>()) {
-            Serial.println("Using fallback defect definitions");
-            doc = doc["fallback"];
-        } else {
-            return false;
+// Check a started transceive without blocking; copies the answer into backData when complete
+TransceiveResult pcdPollTransceive(uint8_t readerIndex, uint8_t* backData, uint8_t* backLen) {
+    uint8_t irq = rfidReadRegister(readerIndex, MFRC522::ComIrqReg);
+    if (!(irq & 0x30)) {                 // Neither RxIRq nor IdleIRq yet
+        if (irq & 0x01) {
+            return TRX_TIMEOUT;          // TimerIRq - nobody answered
         }
+        return TRX_PENDING;
     }
     
-    // Check if this is a valid defect definitions response
-    if (!doc["sections"].is<JsonArray>() || !doc["types"].is<JsonArray>()) {
-        Serial.println("!! Invalid defect definitions format - missing sections or types");
-        Serial.println("!! Received: " + doc.as<String>());
-        Serial.println("!! Using fallback defect definitions");
-        return false; // This will trigger fallback in fetchDefectDefinitions
+    uint8_t error = rfidReadRegister(readerIndex, MFRC522::ErrorReg);
+    if (error & 0x13) {                  // BufferOvfl, ParityErr or ProtocolErr
+        return TRX_ERROR;
     }
-
-    // Free existing memory
-    cleanupDefectDefinitions();
-
-    // Parse version
-    if (doc["version"].is<const char*>()) {
-        defectDefinitionsVersion = doc["version"].as<String>();
+    
+    uint8_t n = rfidReadRegister(readerIndex, MFRC522::FIFOLevelReg);
+    if (n > *backLen) {
+        return TRX_ERROR;
     }
-
-    // Parse sections
-    JsonArray sectionsArray = doc["sections"];
-    qcSectionsCount = sectionsArray.size();
+    *backLen = n;
+    rfidReadRegister(readerIndex, MFRC522::FIFODataReg, n, backData);
     
-    if (qcSectionsCount > 0) {
-        qcSections = new DefectSection[qcSectionsCount];
-        
-        for (int i = 0; i < qcSectionsCount; i++) {
-            qcSections[i].code = sectionsArray[i]["code"];
-            qcSections[i].name = sectionsArray[i]["name"].as<String>();
-        }
-        
-        Serial.printf("Loaded %d sections\n", qcSectionsCount);
+    if (error & 0x08) {                  // CollErr - more than one tag answered
+        return TRX_COLLISION;
     }
+    return TRX_OK;
+}
 
-    // Parse types and subtypes
-    JsonArray typesArray = doc["types"];
-    qcTypesCount = typesArray.size();
+// Send HLTA to the selected card; no answer is expected, so only wait for the frame to leave (<1ms)
+void pcdHaltA(uint8_t readerIndex) {
+    uint8_t frame[4] = {MFRC522::PICC_CMD_HLTA, 0x00, 0, 0};
+    calculateCRC_A(frame, 2, &frame[2]);
+    pcdStartTransceive(readerIndex, frame, sizeof(frame), 0, 0);
     
-    if (qcTypesCount > 0) {
-        qcTypes = new DefectType[qcTypesCount];
-        
-        for (int i = 0; i < qcTypesCount; i++) {
-            qcTypes[i].code = typesArray[i]["code"];
-            qcTypes[i].name = typesArray[i]["name"].as<String>();
-            
-            // Parse subtypes for this type
-            JsonArray subtypesArray = typesArray[i]["subtypes"];
-            qcTypes[i].subtypeCount = subtypesArray.size();
-            
-            if (qcTypes[i].subtypeCount > 0) {
-                qcTypes[i].subtypes = new DefectSubtype[qcTypes[i].subtypeCount];
-                
-                for (int j = 0; j < qcTypes[i].subtypeCount; j++) {
-                    qcTypes[i].subtypes[j].code = subtypesArray[j]["code"];
-                    qcTypes[i].subtypes[j].name = subtypesArray[j]["name"].as<String>();
-                }
-            } else {
-                qcTypes[i].subtypes = nullptr;
-            }
-            
-            Serial.printf("Type %d (%s) has %d subtypes\n", 
-                         qcTypes[i].code, qcTypes[i].name.c_str(), qcTypes[i].subtypeCount);
+    unsigned long started = micros();
+    while (!(rfidReadRegister(readerIndex, MFRC522::ComIrqReg) & 0x40)) { // TxIRq
+        if (micros() - started > 2000) {
+            break;
         }
-        
-        Serial.printf("Loaded %d types\n", qcTypesCount);
     }
-
-    defectDefinitionsLoaded = true;
-    Serial.println("Defect definitions loaded successfully!");
-    Serial.println("Version: " + defectDefinitionsVersion);
+    rfidWriteRegister(readerIndex, MFRC522::CommandReg, MFRC522::PCD_Idle);
     
-    return true;
+    // Stop crypto communication (MFCrypto1On)
+    uint8_t status2 = rfidReadRegister(readerIndex, MFRC522::Status2Reg);
+    rfidWriteRegister(readerIndex, MFRC522::Status2Reg, status2 & ~0x08);
 }
 
-// Clean up dynamically allocated defect definitions memory
-void cleanupDefectDefinitions() {
-    if (qcSections) {
-        delete[] qcSections;
-        qcSections = nullptr;
-    }
+// Reader IRQ interrupt service routine - wakes the scanning task
+void IRAM_ATTR readerIrqISR(void* arg) {
+    uint32_t readerIndex = (uintptr_t)arg;
+    readerIrqCount[readerIndex]++;
     
-    if (qcTypes) {
-        for (int i = 0; i < qcTypesCount; i++) {
-            if (qcTypes[i].subtypes) {
-                delete[] qcTypes[i].subtypes;
-            }
+    if (rfidScanningTaskHandle != NULL) {
+        BaseType_t higherPriorityTaskWoken = pdFALSE;
+        vTaskNotifyGiveFromISR(rfidScanningTaskHandle, &higherPriorityTaskWoken);
+        if (higherPriorityTaskWoken) {
+            portYIELD_FROM_ISR();
         }
-        delete[] qcTypes;
-        qcTypes = nullptr;
     }
-    
-    qcSectionsCount = 0;
-    qcTypesCount = 0;
-    defectDefinitionsLoaded = false;
 }
 
-// Load fallback defect definitions (hardcoded)
-void loadFallbackDefectDefinitions() {
-    Serial.println("Loading fallback defect definitions...");
+// Reset and configure one reader through the station's SS line (no library calls, so SS may sit on the expander)
+void initReader(uint8_t readerIndex) {
+    rfidWriteRegister(readerIndex, MFRC522::CommandReg, MFRC522::PCD_SoftReset);
+    delay(50);
+    
+    unsigned long started = millis();
+    while (rfidReadRegister(readerIndex, MFRC522::CommandReg) & 0x10) {   // PowerDown - oscillator still starting
+        if (millis() - started > 100) {
+            break;
+        }
+        delay(1);
+    }
     
-    // Clean up any existing data
-    cleanupDefectDefinitions();
+    rfidWriteRegister(readerIndex, MFRC522::TxModeReg, 0x00);       // 106 kBd, no TX CRC
+    rfidWriteRegister(readerIndex, MFRC522::RxModeReg, 0x00);       // 106 kBd, no RX CRC
+    rfidWriteRegister(readerIndex, MFRC522::ModWidthReg, 0x26);
     
-    // Create sections
-    qcSectionsCount = 4;
-    qcSections = new DefectSection[qcSectionsCount];
+    // Response timer: 40kHz (25us per tick), started automatically at the end of each transmission
+    uint16_t reload = RFID_FRAME_TIMEOUT_MS * 40;
+    rfidWriteRegister(readerIndex, MFRC522::TModeReg, 0x80);
+    rfidWriteRegister(readerIndex, MFRC522::TPrescalerReg, 0xA9);
+    rfidWriteRegister(readerIndex, MFRC522::TReloadRegH, reload >> 8);
+    rfidWriteRegister(readerIndex, MFRC522::TReloadRegL, reload & 0xFF);
     
-    qcSections[0] = DefectSection(0, "Body");
-    qcSections[1] = DefectSection(1, "Hand");
-    qcSections[2] = DefectSection(2, "Collar");
-    qcSections[3] = DefectSection(3, "Upper Back");
+    // Configure for reliable operation
+    rfidWriteRegister(readerIndex, MFRC522::TxASKReg, 0x40);       // Force 100% ASK modulation
+    rfidWriteRegister(readerIndex, MFRC522::RFCfgReg, 0x70);       // Receiver gain 48dB
+    rfidWriteRegister(readerIndex, MFRC522::ModeReg, 0x3D);        // CRC with 0x6363
     
-    // Create types with subtypes
-    qcTypesCount = 4;
-    qcTypes = new DefectType[qcTypesCount];
+    // Keep received bits after a collision cleared (ValuesAfterColl = 0)
+    uint8_t coll = rfidReadRegister(readerIndex, MFRC522::CollReg);
+    rfidWriteRegister(readerIndex, MFRC522::CollReg, coll & ~0x80);
     
-    // Fabric type (4 subtypes)
-    qcTypes[0] = DefectType(0, "Fabric");
-    qcTypes[0].subtypeCount = 4;
-    qcTypes[0].subtypes = new DefectSubtype[4];
-    qcTypes[0].subtypes[0] = DefectSubtype(0, "Hole");
-    qcTypes[0].subtypes[1] = DefectSubtype(1, "Stain");
-    qcTypes[0].subtypes[2] = DefectSubtype(2, "Shading");
-    qcTypes[0].subtypes[3] = DefectSubtype(3, "Slub");
+    // Enable antenna
+    rfidWriteRegister(readerIndex, MFRC522::TxControlReg, 0x83);
+}
+
+// Route the reader's RxIRq to its IRQ pin and verify the line with a timer interrupt
+bool initReaderIRQ(uint8_t readerIndex) {
+    int8_t irqPin = STATION_WIRING[readerIndex].irqPin;
+    if (irqPin < 0) {
+        return false;
+    }
     
-    // Stitching type (4 subtypes)
-    qcTypes[1] = DefectType(1, "Stitching");
-    qcTypes[1].subtypeCount = 4;
-    qcTypes[1].subtypes = new DefectSubtype[4];
-    qcTypes[1].subtypes[0] = DefectSubtype(4, "Skipped");
-    qcTypes[1].subtypes[1] = DefectSubtype(5, "Broken");
-    qcTypes[1].subtypes[2] = DefectSubtype(6, "Uneven");
-    qcTypes[1].subtypes[3] = DefectSubtype(7, "Loose");
+    pinMode(irqPin, INPUT);
+    attachInterruptArg(digitalPinToInterrupt(irqPin), readerIrqISR,
+                       (void*)(uintptr_t)readerIndex, FALLING);
     
-    // Sewing type (5 subtypes)
-    qcTypes[2] = DefectType(2, "Sewing");
-    qcTypes[2].subtypeCount = 5;
-    qcTypes[2].subtypes = new DefectSubtype[5];
-    qcTypes[2].subtypes[0] = DefectSubtype(8, "Pluckering");
-    qcTypes[2].subtypes[1] = DefectSubtype(9, "Misalignment");
-    qcTypes[2].subtypes[2] = DefectSubtype(10, "Open_seam");
-    qcTypes[2].subtypes[3] = DefectSubtype(11, "Backtak");
-    qcTypes[2].subtypes[4] = DefectSubtype(12, "Seam_gap");
+    rfidWriteRegister(readerIndex, MFRC522::DivIEnReg, 0x80);    // IRQ pin is a push-pull output
     
-    // Other type (3 subtypes)
-    qcTypes[3] = DefectType(3, "Other");
-    qcTypes[3].subtypeCount = 3;
-    qcTypes[3].subtypes = new DefectSubtype[3];
-    qcTypes[3].subtypes[0] = DefectSubtype(13, "Measurement");
-    qcTypes[3].subtypes[1] = DefectSubtype(14, "Button/Button_hole");
-    qcTypes[3].subtypes[2] = DefectSubtype(15, "Twisted");
+    // Self-test: fire the timer once with TimerIEn and wait for the edge
+    uint32_t irqsBefore = readerIrqCount[readerIndex];
+    rfidWriteRegister(readerIndex, MFRC522::ComIEnReg, 0x81);    // IRqInv (active low) + TimerIEn
+    rfidWriteRegister(readerIndex, MFRC522::ComIrqReg, 0x7F);    // Clear all IRQ bits
+    uint8_t control = rfidReadRegister(readerIndex, MFRC522::ControlReg);
+    rfidWriteRegister(readerIndex, MFRC522::ControlReg, control | 0x40); // TStartNow
+    delay(RFID_FRAME_TIMEOUT_MS + 5);
+    bool irqSeen = readerIrqCount[readerIndex] != irqsBefore;
     
-    defectDefinitionsLoaded = true;
-    defectDefinitionsVersion = "Fallback v1.0";
+    // Normal operation: only raise IRQ when a card answers (RxIRq)
+    rfidWriteRegister(readerIndex, MFRC522::ComIEnReg, 0xA0);    // IRqInv (active low) + RxIEn
+    rfidWriteRegister(readerIndex, MFRC522::ComIrqReg, 0x7F);
     
-    Serial.println("Fallback defect definitions loaded successfully!");
-    Serial.printf("Loaded %d sections, %d types\n", qcSectionsCount, qcTypesCount);
+    if (!irqSeen) {
+        detachInterrupt(digitalPinToInterrupt(irqPin));
+    }
+    return irqSeen;
 }
 
-// Handle incoming WebSocket messages
-void handleWebSocketMessage(const char* message) {
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, message);
+// ---- ESP32 implementations of the pipeline's hardware ports (include/hal.h) ----
 
-    if (error) {
-        Serial.println("! Failed to parse WebSocket message !");
-        return;
-    }    String type = doc["type"];
-    String status = doc["status"];
-    
-    if (type == "connection" && status == "success") {
-        Serial.println("WebSocket connection confirmed");
-    } else if (type == "rfid_scan_success") {
-        Serial.println("RFID scan saved successfully");
-        String scanId = doc["data"]["scanId"];
-        Serial.println("Database ID: " + scanId);
-    } else if (type == "error") {
-        String errorType = doc["error"]["type"];
-        String errorMsg = doc["error"]["message"];
-        Serial.println("!! Server Error: " + errorType + " - " + errorMsg);
+// RC522 on the shared SPI bus, driven through the register layer above
+class Esp32Reader : public ReaderPort {
+public:
+    uint8_t readerIndex = 0;
+
+    void startTransceive(const uint8_t* data, uint8_t length, uint8_t txLastBits, uint8_t rxAlign) override {
+        pcdStartTransceive(readerIndex, data, length, txLastBits, rxAlign);
     }
-}
 
-//These are the RFID card UIDs of employees that have been assigned to each station
-String qcSta = "E9EB3903";       //QC station employee card
-String emp1Sta = "F5A628A1";     //Employee 1 station card  
-String emp2Sta = "E5B79BA1";     //Employee 2 station card
+    TransceiveResult pollTransceive(uint8_t* backData, uint8_t* backLen) override {
+        return pcdPollTransceive(readerIndex, backData, backLen);
+    }
 
-// Function to check if a scanned UID matches an employee card
-bool isEmployeeCard(String scannedUID) {
-    return (scannedUID == qcSta || scannedUID == emp1Sta || scannedUID == emp2Sta);
-}
+    uint8_t collisionPosition() override {
+        uint8_t coll = rfidReadRegister(readerIndex, MFRC522::CollReg);
+        if (coll & 0x20) {               // CollPosNotValid
+            return 0;
+        }
+        uint8_t collPos = coll & 0x1F;
+        return collPos == 0 ? 32 : collPos;
+    }
+
+    void haltA() override {
+        pcdHaltA(readerIndex);
+    }
 
-// Function to get employee name from UID
-String getEmployeeName(String uid) {
-    if (uid == qcSta) return "QC_Employee";
-    if (uid == emp1Sta) return "Employee_1";
-    if (uid == emp2Sta) return "Employee_2";
-    return "Unknown";
+    bool irqDriven() const override {
+        return readerLinks[readerIndex].irqEnabled;
+    }
+
+    bool checkPollWindow(uint32_t windowPolls, uint32_t windowErrors) override {
+        return checkReaderSpiErrors(readerIndex, windowPolls, windowErrors);
+    }
+};
+
+// Station LCD on the I2C bus
+class LcdDisplay : public StationDisplay {
+public:
+    LiquidCrystal_I2C* lcd = nullptr;
+
+    void clear() override { lcd->clear(); }
+    void setCursor(uint8_t col, uint8_t row) override { lcd->setCursor(col, row); }
+    void print(const char* text) override { lcd->print(text); }
+};
+
+// Station buttons on GPIOs or the I/O expander (LOW when pressed due to pull-up)
+class WiredButtons : public StationButtons {
+public:
+    const StationWiring* wiring = nullptr;
+
+    bool isPressed(StationButton button) override {
+        switch (button) {
+            case BUTTON_OK: return ioRead(wiring->okButton) == LOW;
+            case BUTTON_CANCEL: return ioRead(wiring->cancelButton) == LOW;
+            case BUTTON_UP: return ioRead(wiring->upButton) == LOW;
+            case BUTTON_DOWN: return ioRead(wiring->downButton) == LOW;
+        }
+        return false;
+    }
+};
+
+class PinBuzzer : public Buzzer {
+public:
+    void set(bool on) override { digitalWrite(BUZZER_PIN, on ? HIGH : LOW); }
+};
+
+// Time sources for the pipeline - wall-clock time comes from the time service (timesync.h)
+class BoardClock : public Clock {
+public:
+    uint64_t monotonicUs() override {
+        return esp_timer_get_time();
+    }
+
+    uint32_t cycles() override {
+        return ESP.getCycleCount();
+    }
+};
+
+class WebSocketTransport : public Transport {
+public:
+    bool connected() override { return wsConnected; }
+    WireFormat wireFormat() override { return wsWireFormat; }
+    bool serverAcks() override { return wsServerAcks; }
+    bool helloAnswered() override { return wsHelloAnswered; }
+    bool sendText(const char* payload, size_t length) override {
+        return webSocket.sendTXT((uint8_t*)payload, length);
+    }
+    bool sendBinary(const uint8_t* payload, size_t length) override {
+        return webSocket.sendBIN(payload, length);
+    }
+    bool sendPing(uint32_t token) override {
+        return webSocket.sendPing((uint8_t*)&token, sizeof(token));
+    }
+    bool networkUp() override { return wifiConnected; }
+    void reconnect() override {
+        wsConnected = false;
+        webSocket.disconnect();
+        const IngestEndpoint& endpoint = endpointAt(endpointCurrent());
+        webSocket.begin(endpoint.host, endpoint.wsPort, websocket_path);   // Connects on the next loop(), no interval wait
+    }
+};
+
+// Offline scan journal on the "journal" data partition (partitions.csv)
+class PartitionFlash : public FlashRegion {
+public:
+    const esp_partition_t* partition = nullptr;
+
+    bool begin() {
+        partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "journal");
+        return partition != nullptr;
+    }
+
+    uint32_t size() override { return partition->size; }
+    uint32_t sectorSize() override { return SPI_FLASH_SEC_SIZE; }
+    bool read(uint32_t offset, void* data, uint32_t length) override {
+        return esp_partition_read(partition, offset, data, length) == ESP_OK;
+    }
+    bool write(uint32_t offset, const void* data, uint32_t length) override {
+        return esp_partition_write(partition, offset, data, length) == ESP_OK;
+    }
+    bool eraseSector(uint32_t offset) override {
+        return esp_partition_erase_range(partition, offset, SPI_FLASH_SEC_SIZE) == ESP_OK;
+    }
+};
+
+// Settings that must survive a reset, in the "scanner" NVS namespace
+class NvsSettings : public SettingsStore {
+public:
+    Preferences preferences;
+    bool opened = false;
+
+    bool begin() {
+        opened = preferences.begin("scanner", false);
+        return opened;
+    }
+
+    bool readU32(const char* key, uint32_t& value) override {
+        if (!opened || !preferences.isKey(key)) {
+            return false;
+        }
+        value = preferences.getUInt(key);
+        return true;
+    }
+    bool writeU32(const char* key, uint32_t value) override {
+        return opened && preferences.putUInt(key, value) == sizeof(uint32_t);
+    }
+};
+
+PartitionFlash journalFlash;
+NvsSettings nvsSettings;
+
+Esp32Reader esp32Readers[STATION_COUNT];
+LcdDisplay lcdDisplays[STATION_COUNT];
+WiredButtons wiredButtons[STATION_COUNT];
+PinBuzzer pinBuzzer;
+BoardClock boardClock;
+WebSocketTransport webSocketTransport;
+
+// Hand the board's hardware to the scan pipeline
+void bindPipelinePorts() {
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+        esp32Readers[i].readerIndex = i;
+        lcdDisplays[i].lcd = STATION_WIRING[i].display;
+        wiredButtons[i].wiring = &STATION_WIRING[i];
+        stationPorts[i].reader = &esp32Readers[i];
+        stationPorts[i].display = STATION_WIRING[i].display != nullptr ? &lcdDisplays[i] : nullptr;
+        stationPorts[i].buttons = &wiredButtons[i];
+    }
+    buzzerPort = &pinBuzzer;
+    clockPort = &boardClock;
+    timeSyncBegin(&boardClock);
+    transportPort = &webSocketTransport;
 }
 
-// Function to get the assigned station number for an employee
-uint8_t getAssignedStation(String uid) {
-    if (uid == emp1Sta) return 1;  // Employee 1 -> Line 1-Station 5
-    if (uid == emp2Sta) return 2;  // Employee 2 -> Line 2-Station 5
-    if (uid == qcSta) return 3;    // QC Employee -> QC Station
-    return 0; // Unknown
+// WiFi link manager (Core 0). WiFi.onEvent only records what happened; wifiLoop() runs the state machine from
+// the connectivity loop and never waits, so webSocket.loop() and the upload lanes keep running during an outage.
+// The first attempt after a drop or a reset goes straight to the last access point (BSSID + channel, no scan) with
+// the last DHCP lease (no DHCP exchange) while that lease is known to run a while longer - otherwise with DHCP.
+// If that does not come up in time, the cache is dropped and the link falls back to a full scan with DHCP,
+// retried with exponential backoff plus jitter. A link on a reused lease rejoins through DHCP before it ends.
+enum WifiState : uint8_t {
+    WIFI_IDLE,                   // wifiBegin() not called yet
+    WIFI_CONNECTING,             // WiFi.begin() issued, waiting for an IP
+    WIFI_CONNECTED,
+    WIFI_BACKOFF                 // Waiting for the next attempt
+};
+
+const uint32_t WIFI_FAST_TIMEOUT_MS = 3000;        // Cached BSSID/channel/lease attempt
+const uint32_t WIFI_CONNECT_TIMEOUT_MS = 20000;    // Full scan + DHCP attempt
+const uint32_t WIFI_BACKOFF_MIN_MS = 1000;
+const uint32_t WIFI_BACKOFF_MAX_MS = 60000;
+const uint32_t WIFI_LEASE_CHECK_MS = 15000;        // A cached lease must reach the server within this, or it is dropped
+const uint32_t WIFI_LEASE_MARGIN_S = 300;          // Lease time that must be left to reuse it; renewed when it gets here
+const uint32_t WIFI_EVENT_SETTLE_MS = 250;         // Disconnects this soon after WiFi.begin() belong to the previous attempt
+
+// Bits set by the WiFi event handler (system event task), taken by wifiLoop()
+const uint32_t WIFI_EVENT_GOT_IP = 1;
+const uint32_t WIFI_EVENT_DOWN = 2;
+
+struct WifiStats {
+    uint32_t attempts;           // WiFi.begin() calls
+    uint32_t connects;           // Times an IP was obtained
+    uint32_t fastConnects;       // ... of them through the cached access point (with its lease or DHCP)
+    uint32_t fastMisses;         // Cached attempts that timed out or failed
+    uint32_t drops;              // Links lost after connecting
+    uint32_t firstConnectMs;     // Boot -> first IP
+    uint32_t lastReconnectMs;    // Link lost -> IP again, last outage
+    uint32_t maxReconnectMs;
+    uint32_t totalReconnectMs;   // For the average (connects after the first)
+};
+
+// Last good link, kept in NVS (keys "wifi_*")
+struct WifiCache {
+    bool valid;
+    uint32_t ssidHash;           // Cache belongs to this SSID
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t ip, gateway, subnet, dns;
+    uint32_t leaseExpires;       // Unix s the lease ends, 0 = unknown (not reused)
+};
+
+WifiStats wifiStats = {};
+WifiState wifiState = WIFI_IDLE;
+WifiCache wifiCache = {};
+std::atomic<uint32_t> wifiEvents{0};
+volatile uint8_t wifiDisconnectReason = 0;   // wifi_err_reason_t of the last disconnect
+bool wifiAttemptFast = false;              // Current attempt uses the cache
+bool wifiAttemptLease = false;             // ... and its lease (static address, no DHCP)
+bool wifiLinkSeen = false;                 // Connected at least once since boot
+uint8_t wifiFailures = 0;                  // Failed attempts in a row (backoff exponent)
+unsigned long wifiAttemptStarted = 0;
+unsigned long wifiRetryAt = 0;
+unsigned long wifiDownSince = 0;           // When the outage began (boot for the first connect)
+unsigned long wifiFastConnectedAt = 0;     // Fast connect waiting for the WebSocket to prove the lease, 0 = none
+uint32_t wifiLeaseSeconds = 0;             // Lease DHCP granted on the current link, at wifiLeaseGrantedAt
+unsigned long wifiLeaseGrantedAt = 0;
+
+void onWiFiUp();
+
+static uint32_t ssidHash(const char* text) {
+    uint32_t hash = 2166136261u;           // FNV-1a
+    while (*text) {
+        hash = (hash ^ (uint8_t)*text++) * 16777619u;
+    }
+    return hash;
 }
 
-// Function to get station name
-String getStationName(uint8_t stationNumber) {
-    switch(stationNumber) {
-        case 1: return "Line 1-Station 5";
-        case 2: return "Line 2-Station 5"; 
-        case 3: return "QC Station";
-        default: return "Unknown";
+static void loadWifiCache() {
+    uint32_t hash, bssidLow, bssidHigh;
+    WifiCache& c = wifiCache;
+    c.valid = nvsSettings.readU32("wifi_ssid", hash) && hash == ssidHash(ssid) &&
+              nvsSettings.readU32("wifi_bssid0", bssidLow) && nvsSettings.readU32("wifi_bssid1", bssidHigh) &&
+              nvsSettings.readU32("wifi_ip", c.ip) && nvsSettings.readU32("wifi_gw", c.gateway) &&
+              nvsSettings.readU32("wifi_mask", c.subnet) && nvsSettings.readU32("wifi_dns", c.dns) &&
+              c.ip != 0;
+    if (!nvsSettings.readU32("wifi_lease", c.leaseExpires)) {
+        c.leaseExpires = 0;
+    }
+    if (c.valid) {
+        c.ssidHash = hash;
+        memcpy(c.bssid, &bssidLow, 4);
+        memcpy(c.bssid + 4, &bssidHigh, 2);
+        c.channel = (uint8_t)(bssidHigh >> 16);
     }
 }
 
-// Function to display message on Line 2-Station 5 LCD
-void displayStation2Message(String line1, String line2) {
-    lcdStation2.clear();
-    lcdStation2.setCursor(0, 0);
-    lcdStation2.print(line1.substring(0, 16)); // Truncate to 16 chars
-    lcdStation2.setCursor(0, 1);
-    lcdStation2.print(line2.substring(0, 16)); // Truncate to 16 chars
+// Lease the DHCP server granted on the current link, in seconds (0 if unknown)
+static uint32_t dhcpLeaseSeconds() {
+    esp_netif_t* station = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    struct netif* lwip = station ? (struct netif*)esp_netif_get_netif_impl(station) : nullptr;
+    struct dhcp* dhcp = lwip ? netif_dhcp_data(lwip) : nullptr;
+    return dhcp ? dhcp->offered_t0_lease : 0;
 }
 
-// Function to display message on QC LCD (supports up to 4 lines)
-void displayQCMessage(String line1, String line2, String line3, String line4) {
-    lcdQC.clear();
-    lcdQC.setCursor(0, 0);
-    lcdQC.print(line1.substring(0, 16)); // Truncate to 16 chars
-    lcdQC.setCursor(0, 1);
-    lcdQC.print(line2.substring(0, 16)); // Truncate to 16 chars
-    if (line3.length() > 0) {
-        lcdQC.setCursor(0, 2);
-        lcdQC.print(line3.substring(0, 16)); // Truncate to 16 chars
-    }
-    if (line4.length() > 0) {
-        lcdQC.setCursor(0, 3);
-        lcdQC.print(line4.substring(0, 16)); // Truncate to 16 chars
+// Unix s the granted lease ends - 0 until the clock is synced, then the expiry is stored (wifiLoop)
+static uint32_t wifiLeaseExpiry() {
+    uint32_t nowUnix = timeNow();
+    if (wifiLeaseSeconds == 0 || nowUnix == 0) {
+        return 0;
     }
+    uint64_t expires = (uint64_t)nowUnix - (millis() - wifiLeaseGrantedAt) / 1000 + wifiLeaseSeconds;
+    return expires > UINT32_MAX ? UINT32_MAX : (uint32_t)expires;    // An infinite lease is 0xFFFFFFFF s
 }
 
-// Function to handle employee login/logout with station assignment validation and button confirmation
-void handleEmployeeAccess(String scannedUID, uint8_t stationNumber) {
-    String employeeName = getEmployeeName(scannedUID);
-    uint8_t assignedStation = getAssignedStation(scannedUID);
-    String stationName = getStationName(stationNumber);
-    String assignedStationName = getStationName(assignedStation);
-    
-    // Check if employee is trying to access their assigned station
-    if (assignedStation != stationNumber) {
-        String message = "Wrong station, Go to " + assignedStationName;
-        Serial.println(employeeName + " tried to access " + stationName + " - " + message);
-        
-        // Display message on LCD for Line 2-Station 5
-        if (stationNumber == 2) {
-            displayStation2Message("Wrong Station!", "Go to " + assignedStationName);
-            vTaskDelay(pdMS_TO_TICKS(2500)); // Use vTaskDelay instead of delay()
-            displayStation2Message("Line 2-Station 5", "Scan your card");
-        }
-        // Display message on LCD for QC Station
-        else if (stationNumber == 3) {
-            displayQCMessage("Wrong Station!", "Go to " + assignedStationName, "Access Denied", "");
-            vTaskDelay(pdMS_TO_TICKS(2500)); // Use vTaskDelay instead of delay()
-            displayQCMessage("QC Station", "Scan your card", "", "");
-        }
+// A lease is reused only while it has WIFI_LEASE_MARGIN_S left - not before the first time sync after a boot,
+// when its expiry cannot be checked
+static bool wifiLeaseUsable() {
+    uint32_t nowUnix = timeNow();
+    return wifiCache.leaseExpires != 0 && nowUnix != 0 &&
+           (uint64_t)nowUnix + WIFI_LEASE_MARGIN_S < wifiCache.leaseExpires;
+}
+
+// Write the link we just got - only keys that changed, to spare NVS
+static void saveWifiCache() {
+    WifiCache now = {};
+    now.valid = true;
+    now.ssidHash = ssidHash(ssid);
+    uint8_t* bssid = WiFi.BSSID();
+    if (bssid == nullptr) {
         return;
     }
-    
-    // Employee is at their correct station - handle state-based logic
-    switch(stationNumber) {
-        case 1: // Line 1-Station 5 - Employee 1
-            if (station1State == WAITING_FOR_CARD && !station1Active) {
-                // Request confirmation to start shift
-                Serial.println("Line 1-Station 5: " + employeeName + " requesting to start shift");
-                station1State = WAITING_START_CONFIRMATION;
-                
-                // Wait for button press (OK to start, Cancel to postpone)
-                if (waitForButtonPress(1, 30000)) { // 30 second timeout
-                    // OK pressed - start shift
-                    station1Active = true;
-                    station1Employee = employeeName;
-                    station1State = ACTIVE_SCANNING;
-                    lastScannedUID_Station1 = ""; // Reset duplicate prevention for new shift
-                    Serial.println("Line 1-Station 5: Shift starting... - " + employeeName);
-                } else {
-                    // Cancel pressed or timeout - postpone
-                    station1State = WAITING_FOR_CARD;
-                    Serial.println("Line 1-Station 5: Shift postponed - " + employeeName);
-                }
-            } else if (station1State == ACTIVE_SCANNING && station1Employee == employeeName) {
-                // Request confirmation to end shift
-                Serial.println("Line 1-Station 5: " + employeeName + " requesting to end shift");
-                station1State = WAITING_END_CONFIRMATION;
-                
-                // Wait for button press (OK to end, Cancel to continue)
-                if (waitForButtonPress(1, 30000)) { // 30 second timeout
-                    // OK pressed - end shift
-                    station1Active = false;
-                    station1Employee = "";
-                    station1State = WAITING_FOR_CARD;
-                    lastScannedUID_Station1 = ""; // Reset duplicate prevention
-                    Serial.println("Line 1-Station 5: Shift ended - " + employeeName);
-                } else {
-                    // Cancel pressed or timeout - continue working
-                    station1State = ACTIVE_SCANNING;
-                    Serial.println("Line 1-Station 5: Shift ending denied - " + employeeName);
-                }
-            }
-            break;
-            
-        case 2: // Line 2-Station 5 - Employee 2
-            if (station2State == WAITING_FOR_CARD && !station2Active) {
-                // Request confirmation to start shift
-                Serial.println("Line 2-Station 5: " + employeeName + " requesting to start shift");
-                station2State = WAITING_START_CONFIRMATION;
-                displayStation2Message("Press OK to", "Start the Shift");
-                
-                // Wait for button press (OK to start, Cancel to postpone)
-                if (waitForButtonPress(2, 30000)) { // 30 second timeout
-                    // OK pressed - start shift
-                    station2Active = true;
-                    station2Employee = employeeName;
-                    station2State = ACTIVE_SCANNING;
-                    lastScannedUID_Station2 = ""; // Reset duplicate prevention for new shift
-                    Serial.println("Line 2-Station 5: Shift starting... - " + employeeName);
-                    displayStation2Message("Shift starting...", employeeName);
-                    delay(1500); // Reduced from 2000ms for faster login
-                    displayStation2Message("Line 2-Station 5", "Ready to scan");
-                } else {
-                    // Cancel pressed or timeout - postpone
-                    station2State = WAITING_FOR_CARD;
-                    Serial.println("Line 2-Station 5: Shift postponed - " + employeeName);
-                    displayStation2Message("Postponed Shift!", "Scan again to start");
-                    delay(3000);
-                    displayStation2Message("Line 2-Station 5", "Scan your card");
-                }
-            } else if (station2State == ACTIVE_SCANNING && station2Employee == employeeName) {
-                // Request confirmation to end shift
-                Serial.println("Line 2-Station 5: " + employeeName + " requesting to end shift");
-                station2State = WAITING_END_CONFIRMATION;
-                displayStation2Message("Press OK to", "End the Shift");
-                
-                // Wait for button press (OK to end, Cancel to continue)
-                if (waitForButtonPress(2, 30000)) { // 30 second timeout
-                    // OK pressed - end shift
-                    station2Active = false;
-                    station2Employee = "";
-                    station2State = WAITING_FOR_CARD;
-                    lastScannedUID_Station2 = ""; // Reset duplicate prevention
-                    Serial.println("Line 2-Station 5: Shift ended - " + employeeName);
-                    displayStation2Message("Shift Ending...", employeeName);
-                    delay(2000);
-                    displayStation2Message("Line 2-Station 5", "Scan your card");
-                } else {
-                    // Cancel pressed or timeout - continue working
-                    station2State = ACTIVE_SCANNING;
-                    Serial.println("Line 2-Station 5: Shift ending denied - " + employeeName);
-                    displayStation2Message("Denied ending!", "Back to Tag scanning");
-                    delay(3000);
-                    displayStation2Message("Line 2-Station 5", "Ready to scan");
-                }
+    memcpy(now.bssid, bssid, 6);
+    now.channel = (uint8_t)WiFi.channel();
+    now.ip = WiFi.localIP();
+    now.gateway = WiFi.gatewayIP();
+    now.subnet = WiFi.subnetMask();
+    now.dns = WiFi.dnsIP();
+    now.leaseExpires = wifiAttemptLease ? wifiCache.leaseExpires : wifiLeaseExpiry();
+    
+    uint32_t bssidLow = 0, bssidHigh = 0;
+    memcpy(&bssidLow, now.bssid, 4);
+    memcpy(&bssidHigh, now.bssid + 4, 2);
+    bssidHigh |= (uint32_t)now.channel << 16;
+    
+    const char* keys[] = {"wifi_ssid", "wifi_bssid0", "wifi_bssid1", "wifi_ip", "wifi_gw", "wifi_mask", "wifi_dns",
+                          "wifi_lease"};
+    uint32_t values[] = {now.ssidHash, bssidLow, bssidHigh, now.ip, now.gateway, now.subnet, now.dns, now.leaseExpires};
+    for (uint8_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        uint32_t stored;
+        if (!nvsSettings.readU32(keys[i], stored) || stored != values[i]) {
+            nvsSettings.writeU32(keys[i], values[i]);
+        }
+    }
+    wifiCache = now;
+}
+
+static void forgetWifiCache() {
+    wifiCache.valid = false;
+    nvsSettings.writeU32("wifi_ip", 0);    // Invalidates the whole cache on the next boot
+}
+
+// WiFi driver events (system event task) - record and return, wifiLoop() does the work
+void onWiFiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+    switch (event) {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            wifiEvents.fetch_or(WIFI_EVENT_GOT_IP);
+            break;
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            wifiDisconnectReason = info.wifi_sta_disconnected.reason;
+            wifiEvents.fetch_or(WIFI_EVENT_DOWN);
+            break;
+        case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+            wifiEvents.fetch_or(WIFI_EVENT_DOWN);
+            break;
+        default:
+            break;
+    }
+}
+
+static void startWifiAttempt() {
+    wifiAttemptFast = wifiCache.valid && wifiFailures == 0;
+    wifiAttemptLease = wifiAttemptFast && wifiLeaseUsable();
+    if (wifiAttemptLease) {
+        // Reuse the last lease
+        WiFi.config(IPAddress(wifiCache.ip), IPAddress(wifiCache.gateway), IPAddress(wifiCache.subnet),
+                    IPAddress(wifiCache.dns));
+    } else {
+        WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));   // Back to DHCP
+    }
+    if (wifiAttemptFast) {
+        WiFi.begin(ssid, password, wifiCache.channel, wifiCache.bssid);    // Skip the channel scan
+    } else {
+        WiFi.begin(ssid, password);
+    }
+    wifiStats.attempts++;
+    wifiAttemptStarted = millis();
+    wifiState = WIFI_CONNECTING;
+    LOG_D("WiFi: connecting to %s (%s)", ssid,
+          wifiAttemptLease ? "cached access point and lease" : wifiAttemptFast ? "cached access point" : "scan");
+}
+
+// Give up on the current attempt and schedule the next: 1 s, 2 s, 4 s ... 60 s, each +-25% so a line of
+// boards coming back from the same outage does not hit the access point in lockstep
+static void scheduleWifiRetry() {
+    if (wifiAttemptFast) {
+        wifiStats.fastMisses++;
+        forgetWifiCache();
+    }
+    if (wifiFailures < 7) {
+        wifiFailures++;                    // Saturates - the backoff tops out at the 7th failure anyway
+    }
+    uint32_t backoff = WIFI_BACKOFF_MIN_MS << (wifiFailures - 1);
+    if (backoff > WIFI_BACKOFF_MAX_MS) {
+        backoff = WIFI_BACKOFF_MAX_MS;
+    }
+    backoff = backoff - backoff / 4 + esp_random() % (backoff / 2 + 1);
+    WiFi.disconnect();
+    wifiRetryAt = millis() + backoff;
+    wifiState = WIFI_BACKOFF;
+    LOG_W("WiFi: attempt %lu failed (reason %u) - next in %lu ms", (unsigned long)wifiStats.attempts,
+          wifiDisconnectReason, (unsigned long)backoff);
+}
+
+// Start the link without waiting for it (connectivity task)
+void wifiBegin() {
+    Serial.printf("Connecting to WiFi network: %s\n", ssid);
+    WiFi.persistent(false);                // The cache below is ours - keep the driver out of flash
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false);          // Retries are paced by wifiLoop()
+    WiFi.onEvent(onWiFiEvent);
+    loadWifiCache();
+    if (wifiCache.valid) {
+        Serial.printf("WiFi cache: channel %u, %02X:%02X:%02X:%02X:%02X:%02X, IP %s\n", wifiCache.channel,
+                     wifiCache.bssid[0], wifiCache.bssid[1], wifiCache.bssid[2], wifiCache.bssid[3],
+                     wifiCache.bssid[4], wifiCache.bssid[5], IPAddress(wifiCache.ip).toString().c_str());
+    }
+    wifiDownSince = millis();
+    startWifiAttempt();
+}
+
+// One step of the link state machine - called every connectivity loop, returns at once
+void wifiLoop() {
+    uint32_t events = wifiEvents.exchange(0);
+    unsigned long now = millis();
+    
+    if ((events & WIFI_EVENT_DOWN) && wifiState == WIFI_CONNECTED) {
+        wifiStats.drops++;
+        wifiConnected = false;
+        wsConnected = false;
+        wifiDownSince = now;
+        wifiFastConnectedAt = 0;
+        wifiFailures = 0;                  // Straight back to the cached access point
+        LOG_W("!! WiFi lost (reason %u) - reconnecting", wifiDisconnectReason);
+        startWifiAttempt();
+        return;
+    }
+    
+    if ((events & WIFI_EVENT_GOT_IP) && wifiState == WIFI_CONNECTING && WiFi.status() == WL_CONNECTED) {
+        uint32_t took = now - wifiDownSince;
+        wifiStats.connects++;
+        if (wifiAttemptFast) {
+            wifiStats.fastConnects++;
+        }
+        if (wifiAttemptLease) {
+            wifiFastConnectedAt = now;
+        } else {
+            wifiLeaseSeconds = dhcpLeaseSeconds();
+            wifiLeaseGrantedAt = now;
+        }
+        if (!wifiLinkSeen) {
+            wifiStats.firstConnectMs = took;
+        } else {
+            wifiStats.lastReconnectMs = took;
+            wifiStats.totalReconnectMs += took;
+            if (took > wifiStats.maxReconnectMs) {
+                wifiStats.maxReconnectMs = took;
+            }
+        }
+        wifiFailures = 0;
+        wifiState = WIFI_CONNECTED;
+        wifiConnected = true;
+        saveWifiCache();
+        LOG_I("WiFi connected in %lu ms (%s) - IP %s, RSSI %d dBm", (unsigned long)took,
+              wifiAttemptFast ? "cached" : "scan", WiFi.localIP().toString().c_str(), WiFi.RSSI());
+        onWiFiUp();
+        wifiLinkSeen = true;
+        return;
+    }
+    
+    switch (wifiState) {
+        case WIFI_CONNECTING:
+            // A disconnect while connecting is a failed attempt (wrong password, AP gone); otherwise wait it out
+            if (((events & WIFI_EVENT_DOWN) && now - wifiAttemptStarted >= WIFI_EVENT_SETTLE_MS) ||
+                now - wifiAttemptStarted >= (wifiAttemptLease ? WIFI_FAST_TIMEOUT_MS : WIFI_CONNECT_TIMEOUT_MS)) {
+                scheduleWifiRetry();
             }
             break;
-            
-        case 3: // QC Station - QC Employee
-            if (qcState == WAITING_FOR_CARD && !qcActive) {
-                // Request confirmation to start shift
-                Serial.println("QC Station: " + employeeName + " requesting to start shift");
-                qcState = WAITING_START_CONFIRMATION;
-                displayQCMessage("Press OK to", "Start the Shift", "", "");
-                
-                // Wait for button press (OK to start, Cancel to postpone)
-                if (waitForButtonPress(3, 30000)) { // 30 second timeout
-                    // OK pressed - start shift
-                    qcActive = true;
-                    qcEmployee = employeeName;
-                    qcState = ACTIVE_SCANNING;
-                    Serial.println("QC Station: Shift starting... - " + employeeName);
-                    displayQCMessage("QC Station", "Shift starting...", employeeName, "Ready to scan");
-                    delay(1500); // Reduced from 2000ms for faster login
-                    displayQCMessage("QC Station", "Ready to scan", "", "");
-                } else {
-                    // Cancel pressed or timeout - postpone
-                    qcState = WAITING_FOR_CARD;
-                    Serial.println("QC Station: Shift postponed - " + employeeName);
-                    displayQCMessage("Postponed Shift!", "Scan again to start", "", "");
-                    delay(3000);
-                    displayQCMessage("QC Station", "Scan your card", "", "");
+        case WIFI_BACKOFF:
+            if ((long)(now - wifiRetryAt) >= 0) {
+                startWifiAttempt();
+            }
+            break;
+        case WIFI_CONNECTED:
+            // A reused lease may have been handed to someone else meanwhile - if the server stays out of
+            // reach, forget it and rejoin through DHCP
+            if (wifiFastConnectedAt != 0) {
+                if (wsConnected) {
+                    wifiFastConnectedAt = 0;
+                } else if (now - wifiFastConnectedAt >= WIFI_LEASE_CHECK_MS) {
+                    LOG_W("!! Server unreachable on the cached lease - renewing through DHCP");
+                    wifiFastConnectedAt = 0;
+                    wifiConnected = false;
+                    wifiDownSince = now;
+                    wifiAttemptFast = true;
+                    scheduleWifiRetry();
+                    break;
                 }
-            } else if (qcState == ACTIVE_SCANNING && qcEmployee == employeeName) {
-                // Request confirmation to end shift
-                Serial.println("QC Station: " + employeeName + " requesting to end shift");
-                qcState = WAITING_END_CONFIRMATION;
-                displayQCMessage("Press OK to", "End the Shift", "", "");
-                
-                // Wait for button press (OK to end, Cancel to continue)
-                if (waitForButtonPress(3, 30000)) { // 30 second timeout
-                    // OK pressed - end shift
-                    qcActive = false;
-                    qcEmployee = "";
-                    qcState = WAITING_FOR_CARD;
-                    Serial.println("QC Station: Shift ended - " + employeeName);
-                    displayQCMessage("QC Station", "Shift Ending...", employeeName, "");
-                    delay(2000);
-                    displayQCMessage("QC Station", "Scan your card", "", "");
-                } else {
-                    // Cancel pressed or timeout - continue working
-                    qcState = ACTIVE_SCANNING;
-                    Serial.println("QC Station: Shift ending denied - " + employeeName);
-                    displayQCMessage("Denied ending!", "Back to Tag scanning", "", "");
-                    delay(3000);
-                    displayQCMessage("QC Station", "Ready to scan", "", "");
+            }
+            if (wifiAttemptLease) {
+                // The reused lease holds a static address that nobody renews - rejoin through DHCP before it ends
+                if (timeNow() != 0 && (uint64_t)timeNow() + WIFI_LEASE_MARGIN_S >= wifiCache.leaseExpires) {
+                    LOG_I("WiFi: cached lease ends - renewing through DHCP");
+                    wifiCache.leaseExpires = 0;
+                    wifiConnected = false;
+                    wsConnected = false;
+                    wifiDownSince = now;
+                    wifiFastConnectedAt = 0;
+                    WiFi.disconnect();
+                    startWifiAttempt();
                 }
+            } else if (wifiLeaseSeconds != 0 && wifiCache.leaseExpires == 0 && timeNow() != 0) {
+                // The clock was not synced when DHCP answered - store the expiry now
+                wifiCache.leaseExpires = wifiLeaseExpiry();
+                nvsSettings.writeU32("wifi_lease", wifiCache.leaseExpires);
             }
             break;
+        default:
+            break;
+    }
+}
+
+const char* wifiStateName() {
+    switch (wifiState) {
+        case WIFI_CONNECTING: return wifiAttemptFast ? "Connecting (cached)" : "Connecting";
+        case WIFI_CONNECTED: return "Connected";
+        case WIFI_BACKOFF: return "Waiting to retry";
+        default: return "Off";
+    }
+}
+
+// SNTP answered (lwIP task) - hand the time to the time service, which also measures the drift
+void onTimeSync(struct timeval* tv) {
+    bool first = timeSyncState() == TIME_UNSYNCED;
+    timeSyncSet((uint64_t)tv->tv_sec * 1000 + tv->tv_usec / 1000);
+    if (first) {
+        LOG_I("Time synchronized - queued scans get their real timestamps");
+    } else {
+        LOG_I("Time re-synchronized - drift %ld ms (%.1f ppm)", (long)timeSyncStats.lastDriftMs, timeSyncStats.driftPpm);
+    }
+}
+
+// Start SNTP in the background (Core 0 task). Nothing waits for it: scans taken before the first answer
+// are stamped relative to boot and get their Unix time when they are uploaded.
+void initNTP() {
+    if (!wifiConnected) {
+        Serial.println("WiFi not connected, cannot sync time");
+        return;
+    }
+    
+    Serial.printf("Configuring NTP with server: %s (every %lu min)\n", ntpServer, NTP_SYNC_INTERVAL / 60000);
+    sntp_set_time_sync_notification_cb(onTimeSync);
+    sntp_set_sync_interval(NTP_SYNC_INTERVAL);
+    configTime(gmtOffset_sec, daylightOffset_sec, ntpServer);
+}
+
+// Next automatic fetch after baseMs, moved by up to the jitter (at most half of baseMs) either way
+static void scheduleDefectRefresh(uint32_t baseMs) {
+    uint32_t jitter = defectRefreshJitterMs < baseMs / 2 ? defectRefreshJitterMs : baseMs / 2;
+    nextDefectRefreshAt = millis() + baseMs - jitter + esp_random() % (2 * jitter + 1);
+}
+
+// Check if defect definitions need to be refreshed (Core 0 task)
+void checkDefectDefinitionsSync() {
+    if (!wifiConnected) return;
+    
+    // With the periodic check off, only retry until a set from the server is loaded
+    if (defect_def_updated && defectRefreshIntervalMs == 0) return;
+    if ((long)(millis() - nextDefectRefreshAt) < 0 || defectFetchRunning()) return;
+    
+    startDefectFetch(true, false);
+}
+
+// HTTP connection for the defect definitions fetch
+class WiFiHttpConnection : public HttpConnection {
+public:
+    bool connect(const char* host, uint16_t port) override {
+        return client.connect(host, port, DEFECT_FETCH_CONNECT_TIMEOUT);
+    }
+    size_t write(const char* data, size_t length) override { return client.write((const uint8_t*)data, length); }
+    int available() override { return client.available(); }
+    int read(uint8_t* buffer, size_t length) override { return client.read(buffer, length); }
+    bool connected() override { return client.connected(); }
+    void stop() override { client.stop(); }
+
+private:
+    WiFiClient client;
+};
+
+WiFiHttpConnection definitionsConnection;
+
+// Start fetching defect definitions from the server (Core 0 task); stepDefectFetch() runs it from the
+// connectivity loop and handles the result. A failed fetch leaves the loaded definitions in place.
+// conditional: send the loaded set's ETag, so the server answers 304 and nothing is parsed if it has not changed.
+// manual: answer the 'refresh' command when it ends. false if the request could not be sent.
+bool startDefectFetch(bool conditional, bool manual) {
+    if (!wifiConnected) {
+        Serial.println("WiFi not connected, cannot fetch defect definitions");
+        return false;
+    }
+    defectFetchHeapBefore = ESP.getFreeHeap();
+    defectFetchHeapLow = defectFetchHeapBefore;
+    defectFetchManual = manual;
+    const IngestEndpoint& endpoint = endpointAt(endpointCurrent());
+    if (defectFetchStart(&definitionsConnection, endpoint.host, endpoint.httpPort, conditional)) {
+        return true;
+    }
+    if (manual) {
+        Serial.println(">> Manual refresh failed!");
+    } else {
+        Serial.println("Failed to fetch defect definitions, keeping the loaded set");
+        scheduleDefectRefresh(DEFECT_DEFINITIONS_RETRY_INTERVAL);
+    }
+    return false;
+}
+
+// Read what the server has sent so far (Core 0 task, every loop while a fetch runs) and finish the fetch
+void stepDefectFetch() {
+    DefectFetchState state = defectFetchStep();
+    uint32_t heapFree = ESP.getFreeHeap();    // Sampled per step - old and new set are both held just before install
+    if (heapFree < defectFetchHeapLow) {
+        defectFetchHeapLow = heapFree;
+    }
+    if (state == FETCH_IDLE || state == FETCH_RUNNING) {
+        return;
+    }
+    
+    if (state == FETCH_FAILED) {
+        if (defectFetchManual) {
+            Serial.println(">> Manual refresh failed!");
+        } else {
+            Serial.println("Failed to fetch defect definitions, keeping the loaded set");
+            scheduleDefectRefresh(DEFECT_DEFINITIONS_RETRY_INTERVAL);
+        }
+        return;
+    }
+    
+    defect_def_updated = true;
+    scheduleDefectRefresh(defectRefreshIntervalMs);
+    if (state == FETCH_LOADED) {
+        defectRefreshStats.heapPeak = defectFetchHeapBefore - defectFetchHeapLow;
+        for (int i = 0; i < qcTypesCount; i++) {
+            Serial.printf("Type %d (%s) has %d subtypes\n",
+                          qcTypes[i].code, qcTypes[i].name.c_str(), qcTypes[i].subtypeCount);
+        }
+        Serial.printf("Loaded %d sections, %d types, %lu subtypes - %lu bytes in %lu ms, heap peak %lu bytes\n",
+                      qcSectionsCount, qcTypesCount, defectRefreshStats.subtypes, defectRefreshStats.bytes,
+                      defectRefreshStats.ms, defectRefreshStats.heapPeak);
+        if (defectRefreshStats.truncatedNames > 0) {
+            Serial.printf("!! %lu defect names longer than %u characters were cut\n", defectRefreshStats.truncatedNames,
+                          DEFECT_NAME_MAX);
+        }
+        Serial.println("Defect definitions loaded successfully!");
+        Serial.println("Version: " + defectDefinitionsVersion);
+    }
+    if (defectFetchManual) {
+        Serial.println(">> Manual refresh successful!");
+    }
+}
+
+// Handle incoming WebSocket messages
+void handleWebSocketMessage(const char* message) {
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, message);
+
+    if (error) {
+        Serial.println("! Failed to parse WebSocket message !");
+        return;
+    }    String type = doc["type"];
+    String status = doc["status"];
+    
+    if (type == "connection" && status == "success") {
+        Serial.println("WebSocket connection confirmed");
+    } else if (type == "hello") {
+        // Server's pick from the formats we offered; a server that does not know the hello never answers
+        String format = doc["format"];
+        wsWireFormat = format == WIRE_BINARY_NAME ? WIRE_BINARY : WIRE_JSON;
+        wsServerAcks = doc["acks"].as<bool>();
+        wsHelloAnswered = true;
+        Serial.printf("Upload format: %s, acks: %s\n", wsWireFormat == WIRE_BINARY ? "binary" : "JSON",
+                      wsServerAcks ? "on" : "off");
+    } else if (type == "rfid_scan_batch_success") {
+        // Ack for one batch (seq) and everything before it on this connection (cumulative)
+        uploadAcked(doc["data"]["seq"].as<uint32_t>(), doc["data"]["cumulative"].as<uint32_t>());
+    } else if (type == "rfid_scan_success") {
+        String scanId = doc["data"]["scanId"];
+        LOG_D("RFID scan saved successfully - Database ID: %s", scanId.c_str());
+    } else if (type == "error") {
+        String errorType = doc["error"]["type"];
+        String errorMsg = doc["error"]["message"];
+        LOG_E("!! Server Error: %s - %s", errorType.c_str(), errorMsg.c_str());
     }
 }
 
@@ -961,22 +1334,39 @@ void handleEmployeeAccess(String scannedUID, uint8_t stationNumber) {
 void webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
     switch(type) {
         case WStype_DISCONNECTED:
-            Serial.println("!! WebSocket Disconnected");
+            LOG_W("!! WebSocket Disconnected");
             wsConnected = false;
+            wsWireFormat = WIRE_JSON;
+            wsServerAcks = false;
+            wsHelloAnswered = false;
             break;
             
         case WStype_CONNECTED:
             Serial.printf("WebSocket Connected to: %s\n", payload);
+            wsWireFormat = WIRE_JSON;
+            wsServerAcks = false;
+            wsHelloAnswered = false;
+            // Offer the binary format and batch acks - uploads stay JSON, fire-and-forget until the server accepts
+            webSocket.sendTXT("{\"action\":\"hello\",\"formats\":[\"" WIRE_BINARY_NAME "\",\"json\"],\"acks\":true}");
             wsConnected = true;
             break;
             
         case WStype_TEXT:
-            Serial.printf("Received: %s\n", payload);
+            LOG_D("Received: %s", (const char*)payload);   // Every batch ack lands here - debug level only
             handleWebSocketMessage((char*)payload);
             break;
             
+        case WStype_PONG:
+            // Answer to our liveness ping (RFC 6455 - every server echoes the payload, no back-end change)
+            if (length == sizeof(uint32_t)) {
+                uint32_t token;
+                memcpy(&token, payload, sizeof(token));
+                uploadPong(token);
+            }
+            break;
+            
         case WStype_ERROR:
-            Serial.printf("!! WebSocket Error: %s\n", payload);
+            LOG_E("!! WebSocket Error: %s", (const char*)payload);
             wsConnected = false;
             break;
             
@@ -987,50 +1377,47 @@ void webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
 
 // Initialize WebSocket connection
 void initWebSocket() {
-    webSocket.begin(websocket_server, websocket_port, websocket_path);
+    const IngestEndpoint& endpoint = endpointAt(endpointCurrent());
+    webSocket.begin(endpoint.host, endpoint.wsPort, websocket_path);
     webSocket.onEvent(webSocketEvent);
     webSocket.setReconnectInterval(5000);
     Serial.println("<- WebSocket client initialized ->");
 }
 
-// Initialize both LCD displays
+// Initialize the LCD of every station that has one
 void initLCDs() {
-    Wire.begin();
-    
-    // Initialize Line 2-Station 5 LCD (1602A)
-    lcdStation2.init();
-    lcdStation2.backlight();
-    lcdStation2.setCursor(0, 0);
-    lcdStation2.print("Line 2-Station 5");
-    lcdStation2.setCursor(0, 1);
-    lcdStation2.print("Ready");
-    
-    // Initialize QC LCD (1604A)
-    lcdQC.init();
-    lcdQC.backlight();
-    lcdQC.setCursor(0, 0);
-    lcdQC.print("QC Station LCD");
-    lcdQC.setCursor(0, 1);
-    lcdQC.print("Ready");
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+        LiquidCrystal_I2C* lcd = STATION_WIRING[i].display;
+        if (lcd == nullptr) {
+            continue;
+        }
+        lcd->init();
+        lcd->backlight();
+        lcd->setCursor(0, 0);
+        lcd->print(STATIONS[i].name);
+        lcd->setCursor(0, 1);
+        lcd->print("Ready");
+    }
     
     delay(1500); // Reduced from 2000ms for faster startup
     
     // Clear and show initial state
-    displayStation2Message("Line 2-Station 5", "Scan your card");
-    displayQCMessage("QC Station", "Scan your card", "", "");
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+        displayStationMessage(i + 1, STATIONS[i].name, "Scan your card");
+    }
 }
 
 // Initialize button pins with internal pull-up resistors
 void initButtons() {
-    for (int i = 0; i < 3; i++) {
-        pinMode(BUTTON_PINS[i].ok, INPUT_PULLUP);
-        pinMode(BUTTON_PINS[i].cancel, INPUT_PULLUP);
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+        ioPinMode(STATION_WIRING[i].okButton, INPUT_PULLUP);
+        ioPinMode(STATION_WIRING[i].cancelButton, INPUT_PULLUP);
+        
+        // QC navigation buttons (not wired on sewing stations)
+        ioPinMode(STATION_WIRING[i].upButton, INPUT_PULLUP);
+        ioPinMode(STATION_WIRING[i].downButton, INPUT_PULLUP);
     }
     
-    // Initialize QC navigation buttons
-    pinMode(QC_UP_BUTTON, INPUT_PULLUP);
-    pinMode(QC_DOWN_BUTTON, INPUT_PULLUP);
-    
     // Initialize buzzer pin
     pinMode(BUZZER_PIN, OUTPUT);
     digitalWrite(BUZZER_PIN, LOW); // Ensure buzzer is off initially
@@ -1059,653 +1446,29 @@ void initPowerDetection() {
     Serial.println(currentPowerState ? "Available" : "Out");
 }
 
-// Buzzer beep function
-void beepBuzzer(int duration = 200) {
-    digitalWrite(BUZZER_PIN, HIGH);
-    vTaskDelay(pdMS_TO_TICKS(duration)); // Use vTaskDelay instead of delay()
-    digitalWrite(BUZZER_PIN, LOW);
-}
-
-// Double beep function for consecutive scan notification
-void doubleBeepBuzzer() {
-    digitalWrite(BUZZER_PIN, HIGH);
-    vTaskDelay(pdMS_TO_TICKS(50)); // 50ms beep
-    digitalWrite(BUZZER_PIN, LOW);
-    vTaskDelay(pdMS_TO_TICKS(50)); // 50ms pause
-    digitalWrite(BUZZER_PIN, HIGH);
-    vTaskDelay(pdMS_TO_TICKS(50)); // 50ms beep
-    digitalWrite(BUZZER_PIN, LOW);
-}
-
-// Check if OK button is pressed (LOW when pressed due to pull-up)
-bool isOKPressed(uint8_t stationNumber) {
-    if (stationNumber < 1 || stationNumber > 3) return false;
-    return digitalRead(BUTTON_PINS[stationNumber - 1].ok) == LOW;
-}
-
-// Check if Cancel button is pressed (LOW when pressed due to pull-up)
-bool isCancelPressed(uint8_t stationNumber) {
-    if (stationNumber < 1 || stationNumber > 3) return false;
-    return digitalRead(BUTTON_PINS[stationNumber - 1].cancel) == LOW;
-}
-
-// Wait for button to be released (for debouncing)
-void waitForButtonRelease(uint8_t stationNumber) {
-    if (stationNumber < 1 || stationNumber > 3) return;
-    
-    while (digitalRead(BUTTON_PINS[stationNumber - 1].ok) == LOW || 
-           digitalRead(BUTTON_PINS[stationNumber - 1].cancel) == LOW) {
-        vTaskDelay(pdMS_TO_TICKS(50)); // Use vTaskDelay instead of delay()
-    }
-    vTaskDelay(pdMS_TO_TICKS(100)); // Use vTaskDelay for additional debounce delay
-}
-
-// Wait for button press with timeout, returns true if OK pressed, false if Cancel or timeout
-bool waitForButtonPress(uint8_t stationNumber, unsigned long timeoutMs) {
-    if (stationNumber < 1 || stationNumber > 3) return false;
-    
-    unsigned long startTime = millis();
-    
-    while (millis() - startTime < timeoutMs) {
-        if (isOKPressed(stationNumber)) {
-            waitForButtonRelease(stationNumber);
-            return true;
-        }
-        if (isCancelPressed(stationNumber)) {
-            waitForButtonRelease(stationNumber);
-            return false;
-        }
-        vTaskDelay(pdMS_TO_TICKS(50)); // Use vTaskDelay instead of delay()
-    }
+// WiFi came up (at boot or after an outage) - start what needs the network
+void onWiFiUp() {
+    // Restart SNTP so the clock catches up right after the outage
+    initNTP();
+    initWebSocket();
     
-    return false; // Timeout - treat as cancel
-}
-
-// Check if QC Up button is pressed
-bool isQCUpPressed() {
-    return digitalRead(QC_UP_BUTTON) == LOW;
-}
-
-// Check if QC Down button is pressed
-bool isQCDownPressed() {
-    return digitalRead(QC_DOWN_BUTTON) == LOW;
-}
-
-// Wait for QC navigation buttons to be released
-void waitForQCButtonRelease() {
-    while (digitalRead(QC_UP_BUTTON) == LOW || digitalRead(QC_DOWN_BUTTON) == LOW) {
-        vTaskDelay(pdMS_TO_TICKS(50)); // Use vTaskDelay instead of delay()
-    }
-    vTaskDelay(pdMS_TO_TICKS(100)); // Use vTaskDelay for additional debounce delay
-}
-
-// Display QC parts selection list
-void displayQCPartsList() {
-    if (!defectDefinitionsLoaded || qcSectionsCount == 0) {
-        lcdQC.clear();
-        lcdQC.setCursor(0, 0);
-        lcdQC.print("No defect data");
-        lcdQC.setCursor(0, 1);
-        lcdQC.print("Check connection");
-        return;
-    }
-
-    lcdQC.clear();
-    
-    // First line: Title at index 3
-    lcdQC.setCursor(3, 0);
-    lcdQC.print("-SECTION-");
-    
-    // Display 3 items starting from scroll offset
-    for (int i = 0; i < 3; i++) {
-        int partIndex = qcScrollOffset + i;
-        if (partIndex < qcSectionsCount) {
-            int row = i + 1;
-            
-            // Selected item indented by 1 space, others at index 0
-            if (partIndex == qcSelectedPart) {
-                lcdQC.setCursor(1, row); // Selected item at index 1
-                lcdQC.print(qcSections[partIndex].name);
-            } else {
-                lcdQC.setCursor(0, row); // Non-selected items at index 0
-                lcdQC.print(qcSections[partIndex].name);
-            }
-        }
-    }
-}
-
-// Display QC defect types selection list
-void displayQCTypesList() {
-    if (!defectDefinitionsLoaded || qcTypesCount == 0) {
-        lcdQC.clear();
-        lcdQC.setCursor(0, 0);
-        lcdQC.print("No types data");
-        lcdQC.setCursor(0, 1);
-        lcdQC.print("Check connection");
-        return;
-    }
-
-    lcdQC.clear();
-    
-    // First line: Title at index 2
-    lcdQC.setCursor(2, 0);
-    lcdQC.print("-DEFECT TYPES-");
-    
-    // Display 3 items starting from scroll offset
-    for (int i = 0; i < 3; i++) {
-        int typeIndex = qcTypeScrollOffset + i;
-        if (typeIndex < qcTypesCount) {
-            int row = i + 1;
-            
-            // Selected item indented by 1 space, others at index 0
-            if (typeIndex == qcSelectedType) {
-                lcdQC.setCursor(1, row); // Selected item at index 1
-                lcdQC.print(qcTypes[typeIndex].name);
-            } else {
-                lcdQC.setCursor(0, row); // Non-selected items at index 0
-                lcdQC.print(qcTypes[typeIndex].name);
-            }
-        }
-    }
-}
-
-// Get subtypes array and count based on selected type (dynamic version)
-bool getSubtypesForType(int typeIndex, DefectSubtype*& subtypes, int& count) {
-    if (!defectDefinitionsLoaded || typeIndex < 0 || typeIndex >= qcTypesCount) {
-        subtypes = nullptr;
-        count = 0;
-        return false;
-    }
-    
-    subtypes = qcTypes[typeIndex].subtypes;
-    count = qcTypes[typeIndex].subtypeCount;
-    return true;
-}
-
-// Display QC defect subtypes selection list
-void displayQCSubtypesList() {
-    lcdQC.clear();
-    
-    // First line: Title at index 4
-    lcdQC.setCursor(4, 0);
-    lcdQC.print("-DEFECT-");
-    
-    // Get subtypes for selected type
-    DefectSubtype* subtypes;
-    int subtypesCount;
-    if (!getSubtypesForType(qcSelectedType, subtypes, subtypesCount)) {
-        lcdQC.setCursor(0, 1);
-        lcdQC.print("No subtypes");
-        return;
-    }
-    
-    // Display 3 items starting from scroll offset
-    for (int i = 0; i < 3; i++) {
-        int subtypeIndex = qcSubtypeScrollOffset + i;
-        if (subtypeIndex < subtypesCount) {
-            int row = i + 1;
-            
-            // Selected item indented by 1 space, others at index 0
-            if (subtypeIndex == qcSelectedSubtype) {
-                lcdQC.setCursor(1, row); // Selected item at index 1
-                lcdQC.print(subtypes[subtypeIndex].name);
-            } else {
-                lcdQC.setCursor(0, row); // Non-selected items at index 0
-                lcdQC.print(subtypes[subtypeIndex].name);
-            }
-        }
-    }
-}
-
-// Handle QC multi-step selection navigation: Section -> Type -> Subtype
-// Returns true if complete selection confirmed, false if cancelled
-bool handleQCPartsSelection() {
-    qcInPartsSelection = true;
-    qcCurrentStep = QC_SELECT_SECTION;
-    
-    // Reset all selections and scroll offsets
-    qcSelectedPart = 0;
-    qcSelectedType = 0;
-    qcSelectedSubtype = 0;
-    qcScrollOffset = 0;
-    qcTypeScrollOffset = 0;
-    qcSubtypeScrollOffset = 0;
-    
-    Serial.println("QC: Starting multi-step selection - Section -> Type -> Subtype");
-    displayQCPartsList();
-    
-    unsigned long startTime = millis();
-    const unsigned long selectionTimeout = 120000; // 2 minutes timeout for complete selection
-    
-    while (millis() - startTime < selectionTimeout) {
-        // Handle navigation based on current step
-        switch(qcCurrentStep) {
-            case QC_SELECT_SECTION:
-                // Navigation UP
-                if (isQCUpPressed()) {
-                    waitForQCButtonRelease();
-                    qcSelectedPart--;
-                    if (qcSelectedPart < 0) {
-                        qcSelectedPart = qcSectionsCount - 1; // Wrap to bottom
-                    }
-
-                    // Adjust scroll offset if needed
-                    if (qcSelectedPart < qcScrollOffset) {
-                        qcScrollOffset = qcSelectedPart;
-                    } else if (qcSelectedPart >= qcScrollOffset + 3) {
-                        qcScrollOffset = qcSelectedPart - 2;
-                    }
-
-                    Serial.println("QC: Section UP - Selected: " + qcSections[qcSelectedPart].name);
-                    displayQCPartsList();
-                    startTime = millis(); // Reset timeout
-                }
-                
-                // Navigation DOWN
-                if (isQCDownPressed()) {
-                    waitForQCButtonRelease();
-                    qcSelectedPart++;
-                    if (qcSelectedPart >= qcSectionsCount) {
-                        qcSelectedPart = 0; // Wrap to top
-                        qcScrollOffset = 0;
-                    }
-
-                    // Adjust scroll offset if needed
-                    if (qcSelectedPart >= qcScrollOffset + 3) {
-                        qcScrollOffset = qcSelectedPart - 2;
-                    } else if (qcSelectedPart < qcScrollOffset) {
-                        qcScrollOffset = qcSelectedPart;
-                    }
-                    
-                    Serial.println("QC: Section DOWN - Selected: " + qcSections[qcSelectedPart].name);
-                    displayQCPartsList();
-                    startTime = millis(); // Reset timeout
-                }
-                
-                // OK button - proceed to type selection
-                if (isOKPressed(3)) {
-                    waitForButtonRelease(3);
-                    Serial.println("QC: Section confirmed - " + qcSections[qcSelectedPart].name + " -> Moving to Type selection");
-                    qcCurrentStep = QC_SELECT_TYPE;
-                    qcSelectedType = 0;
-                    qcTypeScrollOffset = 0;
-                    displayQCTypesList();
-                    startTime = millis(); // Reset timeout
-                }
-                
-                // Cancel button - exit selection
-                if (isCancelPressed(3)) {
-                    waitForButtonRelease(3);
-                    Serial.println("QC: Section selection cancelled");
-                    qcInPartsSelection = false;
-                    return false;
-                }
-                break;
-                
-            case QC_SELECT_TYPE:
-                // Navigation UP
-                if (isQCUpPressed()) {
-                    waitForQCButtonRelease();
-                    qcSelectedType--;
-                    if (qcSelectedType < 0) {
-                        qcSelectedType = qcTypesCount - 1; // Wrap to bottom
-                    }
-                    
-                    // Adjust scroll offset if needed
-                    if (qcSelectedType < qcTypeScrollOffset) {
-                        qcTypeScrollOffset = qcSelectedType;
-                    } else if (qcSelectedType >= qcTypeScrollOffset + 3) {
-                        qcTypeScrollOffset = qcSelectedType - 2;
-                    }
-                    
-                    Serial.println("QC: Type UP - Selected: " + qcTypes[qcSelectedType].name);
-                    displayQCTypesList();
-                    startTime = millis(); // Reset timeout
-                }
-                
-                // Navigation DOWN
-                if (isQCDownPressed()) {
-                    waitForQCButtonRelease();
-                    qcSelectedType++;
-                    if (qcSelectedType >= qcTypesCount) {
-                        qcSelectedType = 0; // Wrap to top
-                        qcTypeScrollOffset = 0;
-                    }
-                    
-                    // Adjust scroll offset if needed
-                    if (qcSelectedType >= qcTypeScrollOffset + 3) {
-                        qcTypeScrollOffset = qcSelectedType - 2;
-                    } else if (qcSelectedType < qcTypeScrollOffset) {
-                        qcTypeScrollOffset = qcSelectedType;
-                    }
-                    
-                    Serial.println("QC: Type DOWN - Selected: " + qcTypes[qcSelectedType].name);
-                    displayQCTypesList();
-                    startTime = millis(); // Reset timeout
-                }
-                
-                // OK button - proceed to subtype selection
-                if (isOKPressed(3)) {
-                    waitForButtonRelease(3);
-                    Serial.println("QC: Type confirmed - " + qcTypes[qcSelectedType].name + " -> Moving to Subtype selection");
-                    qcCurrentStep = QC_SELECT_SUBTYPE;
-                    qcSelectedSubtype = 0;
-                    qcSubtypeScrollOffset = 0;
-                    displayQCSubtypesList();
-                    startTime = millis(); // Reset timeout
-                }
-                
-                // Cancel button - go back to section selection
-                if (isCancelPressed(3)) {
-                    waitForButtonRelease(3);
-                    Serial.println("QC: Type selection cancelled - Back to Section selection");
-                    qcCurrentStep = QC_SELECT_SECTION;
-                    displayQCPartsList();
-                    startTime = millis(); // Reset timeout
-                }
-                break;
-                
-            case QC_SELECT_SUBTYPE:
-                // Get subtypes count for current type
-                DefectSubtype* subtypes;
-                int subtypesCount;
-                if (!getSubtypesForType(qcSelectedType, subtypes, subtypesCount)) {
-                    // Handle error case
-                    qcInPartsSelection = false;
-                    return false;
-                }
-                
-                // Navigation UP
-                if (isQCUpPressed()) {
-                    waitForQCButtonRelease();
-                    qcSelectedSubtype--;
-                    if (qcSelectedSubtype < 0) {
-                        qcSelectedSubtype = subtypesCount - 1; // Wrap to bottom
-                    }
-                    
-                    // Adjust scroll offset if needed
-                    if (qcSelectedSubtype < qcSubtypeScrollOffset) {
-                        qcSubtypeScrollOffset = qcSelectedSubtype;
-                    } else if (qcSelectedSubtype >= qcSubtypeScrollOffset + 3) {
-                        qcSubtypeScrollOffset = qcSelectedSubtype - 2;
-                    }
-                    
-                    Serial.println("QC: Subtype UP - Selected: " + subtypes[qcSelectedSubtype].name);
-                    displayQCSubtypesList();
-                    startTime = millis(); // Reset timeout
-                }
-                
-                // Navigation DOWN
-                if (isQCDownPressed()) {
-                    waitForQCButtonRelease();
-                    qcSelectedSubtype++;
-                    if (qcSelectedSubtype >= subtypesCount) {
-                        qcSelectedSubtype = 0; // Wrap to top
-                        qcSubtypeScrollOffset = 0;
-                    }
-                    
-                    // Adjust scroll offset if needed
-                    if (qcSelectedSubtype >= qcSubtypeScrollOffset + 3) {
-                        qcSubtypeScrollOffset = qcSelectedSubtype - 2;
-                    } else if (qcSelectedSubtype < qcSubtypeScrollOffset) {
-                        qcSubtypeScrollOffset = qcSelectedSubtype;
-                    }
-                    
-                    Serial.println("QC: Subtype DOWN - Selected: " + subtypes[qcSelectedSubtype].name);
-                    displayQCSubtypesList();
-                    startTime = millis(); // Reset timeout
-                }
-                
-                // OK button - complete selection
-                if (isOKPressed(3)) {
-                    waitForButtonRelease(3);
-                    Serial.println("QC: Complete selection confirmed!");
-                    Serial.println("Section: " + qcSections[qcSelectedPart].name);
-                    Serial.println("Type: " + qcTypes[qcSelectedType].name);
-                    
-                    // Get selected subtype name
-                    DefectSubtype* subtypes;
-                    int subtypesCount;
-                    if (getSubtypesForType(qcSelectedType, subtypes, subtypesCount) && 
-                        qcSelectedSubtype < subtypesCount) {
-                        Serial.println("Subtype: " + subtypes[qcSelectedSubtype].name);
-                    }
-                    
-                    qcInPartsSelection = false;
-                    return true;
-                }
-                
-                // Cancel button - go back to type selection
-                if (isCancelPressed(3)) {
-                    waitForButtonRelease(3);
-                    Serial.println("QC: Subtype selection cancelled - Back to Type selection");
-                    qcCurrentStep = QC_SELECT_TYPE;
-                    displayQCTypesList();
-                    startTime = millis(); // Reset timeout
-                }
-                break;
+    if (!wifiLinkSeen) {
+        // First link since boot: load the server's set now, then checkDefectDefinitionsSync() keeps it current.
+        // It arrives over the next loops - until then QC uses the fallback definitions.
+        Serial.println("Attempting to update defect definitions from server...");
+        if (!defectFetchRunning()) {
+            startDefectFetch(false, false);
         }
-        
-        vTaskDelay(pdMS_TO_TICKS(50)); // Use vTaskDelay instead of delay()
-    }
-    
-    // Timeout
-    Serial.println("QC: Multi-step selection timeout");
-    qcInPartsSelection = false;
-    return false;
-}
-
-// Update Line 2-Station 5 LCD with latest RFID UID and scan count
-void updateStation2Display(const char* uid, uint32_t scanCount) {
-    char line1[17];
-    char line2[17];
-    
-    // Format UID for display (truncate if too long)
-    if (strlen(uid) <= 12) {
-        snprintf(line1, sizeof(line1), "S2: %s", uid);
-    } else {
-        // Show first 10 chars if longer (accounting for "S2: " prefix)
-        char truncatedUid[11];
-        strncpy(truncatedUid, uid, 10);
-        truncatedUid[10] = '\0';
-        snprintf(line1, sizeof(line1), "S2: %s..", truncatedUid);
     }
-    
-    // Format scan count for Line 2-Station 5
-    snprintf(line2, sizeof(line2), "Count: %lu", scanCount);
-    
-    // Update display
-    lcdStation2.clear();
-    lcdStation2.setCursor(0, 0);
-    lcdStation2.print(line1);
-    lcdStation2.setCursor(0, 1);
-    lcdStation2.print(line2);
-}
-
-// Update QC LCD with latest RFID UID and scan count
-void updateQCDisplay(const char* uid, uint32_t scanCount) {
-    char line1[17];
-    char line2[17];
-    char line3[17];
-    
-    // Format UID for display (truncate if too long)
-    if (strlen(uid) <= 13) {
-        snprintf(line1, sizeof(line1), "QC: %s", uid);
-    } else {
-        // Show first 11 chars if longer (accounting for "QC: " prefix)
-        char truncatedUid[12];
-        strncpy(truncatedUid, uid, 11);
-        truncatedUid[11] = '\0';
-        snprintf(line1, sizeof(line1), "QC: %s..", truncatedUid);
-    }
-    
-    // Format scan count and timestamp
-    snprintf(line2, sizeof(line2), "Count: %lu", scanCount);
-    
-    // Get current time if available
-    struct tm timeinfo;
-    if (getLocalTime(&timeinfo)) {
-        strftime(line3, sizeof(line3), "%H:%M:%S", &timeinfo);
-    } else {
-        snprintf(line3, sizeof(line3), "Time: N/A");
-    }
-    
-    // Update display
-    lcdQC.clear();
-    lcdQC.setCursor(0, 0);
-    lcdQC.print(line1);
-    lcdQC.setCursor(0, 1);
-    lcdQC.print(line2);
-    lcdQC.setCursor(0, 2);
-    lcdQC.print(line3);
-    lcdQC.setCursor(0, 3);
-    lcdQC.print("QC Active");
-}
-
-// Generate unique scan ID (format: YYMMDDSA# where A# is hex counter)
-String generateScanID(uint8_t stationNumber) {
-    struct tm timeinfo;
-    if (!getLocalTime(&timeinfo)) {
-        // Fallback with millis for uniqueness when time not available
-        return "000000S" + String(stationNumber) + String(millis() % 10000, HEX);
-    }
-    
-    char dateStr[7];
-    strftime(dateStr, sizeof(dateStr), "%y%m%d", &timeinfo);
-    
-    String currentDate = String(dateStr);
-    if (currentDate != lastDateString) {
-        dailyScanCount = 0; // Reset counter for new day
-        lastDateString = currentDate;
-    }
-    
-    dailyScanCount++;
-    // Include station number and millis for better uniqueness
-    String scanID = currentDate + "S" + String(stationNumber) + String(dailyScanCount, HEX) + String(millis() % 100, HEX);
-    scanID.toUpperCase();
-    return scanID;
-}
-
-// Generate station ID based on station type
-String generateStationID(uint8_t stationNumber) {
-    switch(stationNumber) {
-        case 1: return "A105";  // Sewing Unit A, Line 1, Station 05
-        case 2: return "A205";  // Sewing Unit A, Line 2, Station 05
-        case 3: return "Q001";  // QC Unit, No Line (0), Station 01
-        default: return "0000"; // Unknown
-    }
-}
-
-// Get line number based on station
-uint8_t getLineNumber(uint8_t stationNumber) {
-    switch(stationNumber) {
-        case 1: return 1;  // Sewing Unit A, Line 1, Station 05
-        case 2: return 2;  // Sewing Unit A, Line 2, Station 05
-        case 3: return 0;  // QC Unit, No Line (0), Station 01
-        default: return 0; // Unknown
-    }
-}
-
-// Convert UID bytes to hex string with bounds checking
-String uidToString(uint8_t* uid, uint8_t uidSize) {
-    if (uid == nullptr || uidSize == 0 || uidSize > 10) {
-        return "INVALID_UID"; // Safety check
-    }
-    
-    String uidStr = "";
-    uidStr.reserve(uidSize * 2); // Pre-allocate memory for efficiency
-    
-    for (byte i = 0; i < uidSize; i++) {
-        if (uid[i] < 0x10) uidStr += "0";
-        uidStr += String(uid[i], HEX);
-    }
-    uidStr.toUpperCase();
-    return uidStr;
-}
-
-// Send RFID data via WebSocket
-bool sendRFIDDataViaWebSocket(const ScannedData& data) {
-    if (!wsConnected) {
-        Serial.println("!! WebSocket not connected, cannot send data");
-        return false;
-    }
-    
-    JsonDocument doc;
-    doc["action"] = "rfid_scan";
-    doc["data"]["ID"] = String(data.scanID);
-    doc["data"]["Tag_UID"] = uidToString((uint8_t*)data.uid, data.uidSize);
-    doc["data"]["Station_ID"] = String(data.stationID);
-    doc["data"]["Station_Number"] = data.stationNumber; // Single digit station number
-    doc["data"]["Line_Number"] = data.lineNumber;
-    doc["data"]["Time_Stamp"] = data.timestamp;
-    
-    // Debug: Print individual values
-    Serial.println("DEBUG - Preparing WebSocket data:");
-    Serial.println("  Station Number: " + String(data.stationNumber));
-    Serial.println("  Line Number: " + String(data.lineNumber));
-    Serial.println("  Station ID: " + String(data.stationID));
-    
-    String jsonString;
-    serializeJson(doc, jsonString);
-    
-    Serial.println("Sending via WebSocket: " + jsonString);
-    webSocket.sendTXT(jsonString);
-    return true;
-}
-
-// Send Defect data via WebSocket
-bool sendDefectDataViaWebSocket(String scanID, String tagUID, String stationID, time_t timestamp, 
-                               uint8_t sectionCode, uint8_t typeCode, uint8_t subtypeCode) {
-    if (!wsConnected) {
-        Serial.println("!! WebSocket not connected, cannot send defect data");
-        return false;
-    }
-    
-    JsonDocument doc;
-    doc["action"] = "defect_scan";
-    doc["data"]["ID"] = scanID;
-    doc["data"]["Section"] = sectionCode;
-    doc["data"]["Type"] = typeCode;
-    doc["data"]["Subtype"] = subtypeCode;
-    doc["data"]["Tag_UID"] = tagUID;
-    doc["data"]["Station_ID"] = stationID;
-    // Note: Line_Number omitted for QC defects - QC is not line-specific
-    doc["data"]["Time_Stamp"] = timestamp;
-    
-    String jsonString;
-    serializeJson(doc, jsonString);
-    
-    Serial.println("Sending Defect via WebSocket: " + jsonString);
-    webSocket.sendTXT(jsonString);
-    return true;
 }
 
 // Core 0 Task: Handle WiFi connectivity and time synchronization
 void connectivityTask(void *parameter) {
     Serial.println("Core 0: Starting connectivity task...");
     
-    // Initialize WiFi
-    initWiFi();
-    
-    // Initialize NTP (only if WiFi connected)
-    if (wifiConnected) {
-        initNTP();
-        // Initialize WebSocket
-        initWebSocket();
-        
-        // Attempt to update defect definitions from server (only once after startup)
-        Serial.println("Attempting to update defect definitions from server...");
-        if (fetchDefectDefinitions()) {
-            Serial.println("Successfully updated defect definitions from server!");
-            defect_def_updated = true; // Mark as updated to prevent further automatic checks
-        } else {
-            Serial.println("Failed to update from server, keeping fallback defect definitions");
-        }
-    } else {
-        Serial.println("!! Skipping NTP, WebSocket, and database defect definitions due to WiFi failure");
-        Serial.println("RFID scanning will work in OFFLINE mode with fallback defect definitions");
-        Serial.println("Scans will be queued and sent when WiFi/WebSocket connection is restored");
-    }
+    // Start WiFi - NTP, the WebSocket and the defect definitions follow once it is up (onWiFiUp).
+    // Until then scanning works offline with the fallback definitions and scans wait in the journal.
+    wifiBegin();
     
     // Signal that connectivity task is ready
     Serial.println("Core 0 connectivity task is ready!");
@@ -1719,389 +1482,330 @@ void connectivityTask(void *parameter) {
             
             if (command == "refresh" || command == "REFRESH") {
                 Serial.println("\n>> Manual defect definitions refresh requested!");
-                if (wifiConnected) {
-                    if (fetchDefectDefinitions()) {
-                        Serial.println(">> Manual refresh successful!");
-                        defect_def_updated = true; // Update flag after successful manual refresh
-                    } else {
-                        Serial.println(">> Manual refresh failed!");
-                    }
+                if (defectFetchRunning()) {
+                    Serial.println(">> A defect definitions fetch is already running");
+                } else if (wifiConnected) {
+                    // Always a full fetch - also a way to reload a set the server changed under the same ETag.
+                    // The answer follows when it ends (stepDefectFetch).
+                    startDefectFetch(false, true);
                 } else {
                     Serial.println(">> WiFi not connected, cannot refresh");
                 }
             } else if (command == "status" || command == "STATUS") {
                 Serial.println("\n>> System Status:");
-                Serial.printf("   WiFi: %s\n", wifiConnected ? "Connected" : "Disconnected");
+                Serial.printf("   WiFi: %s | RSSI: %d dBm | Channel: %ld | Attempts: %lu | Connects: %lu (cached: %lu, cache misses: %lu) | Drops: %lu | Last reason: %u\n",
+                             wifiStateName(), wifiConnected ? WiFi.RSSI() : 0, (long)WiFi.channel(), wifiStats.attempts,
+                             wifiStats.connects, wifiStats.fastConnects, wifiStats.fastMisses, wifiStats.drops,
+                             wifiDisconnectReason);
+                Serial.printf("   Reconnect: first %lu ms | last %lu ms | avg %lu ms | max %lu ms\n",
+                             wifiStats.firstConnectMs, wifiStats.lastReconnectMs,
+                             wifiStats.connects > 1 ? wifiStats.totalReconnectMs / (wifiStats.connects - 1) : 0,
+                             wifiStats.maxReconnectMs);
                 Serial.printf("   WebSocket: %s\n", wsConnected ? "Connected" : "Disconnected");
+                Serial.printf("   Time: %s | Syncs: %lu | Last: %lu s ago | Drift: %+ld ms (%.1f ppm), max %+ld ms | Backfilled: %lu | Unknown: %lu\n",
+                             timeSyncStateName(timeSyncState()), timeSyncStats.syncs, timeSinceSyncMs() / 1000,
+                             (long)timeSyncStats.lastDriftMs, timeSyncStats.driftPpm, (long)timeSyncStats.maxDriftMs,
+                             timeSyncStats.backfilled, timeSyncStats.unresolved);
                 Serial.printf("   Defect Definitions: %s\n", defectDefinitionsLoaded ? "Loaded" : "Not loaded");
                 Serial.printf("   Database Updated: %s\n", defect_def_updated ? "Yes" : "No");
                 Serial.printf("   Version: %s\n", defectDefinitionsVersion.c_str());
                 Serial.printf("   Sections: %d, Types: %d\n", qcSectionsCount, qcTypesCount);
-                Serial.println("   Commands: 'refresh' to update defects, 'status' for info");
+                Serial.printf("   Last fetch: %lu bytes in %lu ms | Heap peak: %lu bytes | Names cut: %lu | Result: %s\n",
+                             defectRefreshStats.bytes, defectRefreshStats.ms, defectRefreshStats.heapPeak,
+                             defectRefreshStats.truncatedNames, defectParseErrorName(defectRefreshStats.error));
+                if (defectRefreshIntervalMs == 0) {
+                    Serial.print("   Defect refresh: off");
+                } else {
+                    long nextIn = (long)(nextDefectRefreshAt - millis());
+                    Serial.printf("   Defect refresh: every %lu s +-%lu s | Next in: %ld s",
+                                 defectRefreshIntervalMs / 1000, defectRefreshJitterMs / 1000, nextIn > 0 ? nextIn / 1000 : 0L);
+                }
+                Serial.printf(" | ETag: %s | Checks: %lu (unchanged %lu, loaded %lu, failed %lu)\n",
+                             defectDefinitionsEtag[0] ? defectDefinitionsEtag : "none", defectRefreshStats.checks,
+                             defectRefreshStats.unchanged, defectRefreshStats.loads, defectRefreshStats.failures);
+                Serial.print("   Reader Polls/s:");
+                for (uint8_t i = 0; i < STATION_COUNT; i++) {
+                    Serial.printf("%s %s: %.1f", i ? " |" : "", STATIONS[i].shortName, readerSlots[i].pollsPerSecond);
+                }
+                Serial.print("\n   Reader Errors:");
+                for (uint8_t i = 0; i < STATION_COUNT; i++) {
+                    Serial.printf("%s %s: %lu/%lu", i ? " |" : "", STATIONS[i].shortName,
+                                 readerSlots[i].collisionCount, readerSlots[i].errorCount);
+                }
+                Serial.println(" (collisions/errors)");
+                for (uint8_t i = 0; i < STATION_COUNT; i++) {
+                    Serial.printf("   Reader %d SPI: %lu Hz | Version: 0x%02X | Errors: %lu | Fallbacks: %lu | Restores: %lu\n",
+                                 i + 1, SPI_CLOCK_STEPS[readerLinks[i].spiClockStep], readerLinks[i].version,
+                                 readerSlots[i].errorCount, readerLinks[i].spiFallbacks, readerLinks[i].spiRestores);
+                }
+                Serial.print("   Duplicates Rejected:");
+                for (uint8_t i = 0; i < STATION_COUNT; i++) {
+                    Serial.printf("%s %s: %lu", i ? " |" : "", STATIONS[i].shortName, recentUids[i].rejected);
+                }
+                Serial.print("\n   Station Cards Dropped:");
+                for (uint8_t i = 0; i < STATION_COUNT; i++) {
+                    Serial.printf("%s %s: %lu", i ? " |" : "", STATIONS[i].shortName, stationCardDrops[i]);
+                }
+                Serial.print("\n   Bundles Read:");
+                for (uint8_t i = 0; i < STATION_COUNT; i++) {
+                    Serial.printf("%s %s: %lu", i ? " |" : "", STATIONS[i].shortName, stationBundleCount[i]);
+                }
+                Serial.print("\n   Lanes (depth/max/dropped):");
+                for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+                    Serial.printf("%s %s: %lu/%u/%lu", lane ? " |" : "", laneName(lane), laneDepth(lane),
+                                 laneStats[lane].maxDepth, laneStats[lane].dropped);
+                }
+                Serial.println();
+                Serial.printf("   Uploads: %.1f batches/s, %.1f records/s | Batches: %lu | Records: %lu (Defects: %lu) | Max batch: %u | Failures: %lu\n",
+                             uploadStats.batchesPerSecond, uploadStats.recordsPerSecond, uploadStats.batches,
+                             uploadStats.records, uploadStats.defects, uploadStats.maxBatch, uploadStats.failures);
+                Serial.printf("   Upload Format: %s | Bytes/record: %.1f\n", wsWireFormat == WIRE_BINARY ? "binary" : "JSON",
+                             uploadStats.records ? (float)uploadStats.bytes / uploadStats.records : 0.0f);
+                Serial.printf("   Delivery: acks %s | In flight: %u/%u batches | Acked: %lu | Retransmits: %lu | Max ack: %lu ms\n",
+                             wsServerAcks ? "on" : "off", uploadStats.inFlight, UPLOAD_WINDOW_BATCHES,
+                             uploadStats.acked, uploadStats.retransmits, uploadStats.maxAckMs);
+                Serial.printf("   Liveness: ping every %lu ms, timeout %lu ms | RTT: %lu ms, avg %lu ms, max %lu ms | Dead links: %lu | Last recovery: %lu ms\n",
+                             uploadPingIntervalMs, uploadPongTimeoutMs, uploadStats.lastRttMs,
+                             uploadStats.pongs ? (uint32_t)(uploadStats.rttTotalMs / uploadStats.pongs) : 0,
+                             uploadStats.maxRttMs, uploadStats.deadLinks, uploadStats.lastRecoveryMs);
+                for (uint8_t i = 0; i < endpointCount(); i++) {
+                    const EndpointHealth& health = endpointHealth[i];
+                    int32_t retryIn = health.retryAt != 0 ? (int32_t)(health.retryAt - millis()) : 0;
+                    Serial.printf("   Endpoint %c: %s:%u%s%s | Score: %ld | RTT: %lu ms | Connects: %lu | Failures: %lu | Soft errors: %lu | Retry in: %ld s\n",
+                                 'A' + i, endpointAt(i).host, endpointAt(i).wsPort, i == endpointHome() ? " (home)" : "",
+                                 i == endpointCurrent() ? " <- in use" : "", (long)endpointScore(i), health.rttMs,
+                                 health.connects, health.failures, health.softErrors, retryIn > 0 ? (long)retryIn / 1000 : 0L);
+                }
+                Serial.printf("   Endpoint switches: %lu (%lu back home)\n", endpointStats.switches, endpointStats.homeReturns);
+                if (journalMounted()) {
+                    Serial.printf("   Journal: %lu/%lu pending | Appended: %lu | Acked: %lu | Recovered: %lu | Overwritten: %lu | Corrupt: %lu | Erases: %lu | Max append: %lu us",
+                                 journalPending(), journalStats.capacity, journalStats.appended, journalStats.acked,
+                                 journalStats.recovered, journalStats.overwritten, journalStats.corrupt,
+                                 journalStats.erases, journalStats.maxAppendUs);
+                } else {
+                    Serial.print("   Journal: not mounted");
+                }
+                Serial.print("\n   Reader IRQ:");
+                for (uint8_t i = 0; i < STATION_COUNT; i++) {
+                    Serial.printf("%s %s: %s (%lu)", i ? " |" : "", STATIONS[i].shortName,
+                                 readerLinks[i].irqEnabled ? "ON" : "OFF", readerIrqCount[i]);
+                }
+                Serial.println();
+                Serial.printf("   Log: level %s | Written: %lu | Dropped: %lu | Waiting: %lu/%u | Max depth: %lu\n",
+                             logLevelName(logLevel), logStats.written, logStats.dropped, logDepth(), LOG_RING_SIZE,
+                             logStats.maxDepth);
+                Serial.printf("   Build: %s (logs up to %s) | Sketch: %lu bytes | Heap: %lu at boot, %lu free, %lu lowest\n",
+                             BUILD_PROFILE, logLevelName(LOG_COMPILE_LEVEL), (unsigned long)ESP.getSketchSize(),
+                             (unsigned long)bootFreeHeap, (unsigned long)ESP.getFreeHeap(),
+                             (unsigned long)ESP.getMinFreeHeap());
+                Serial.printf("   Scan cost: %lu cycles avg, %lu max over %lu scans (event + lane + log line, Core 1)\n",
+                             scanCost.scans ? (unsigned long)(scanCost.cycles / scanCost.scans) : 0UL,
+                             (unsigned long)scanCost.maxCycles, (unsigned long)scanCost.scans);
+                Serial.println("   Commands: 'refresh' to update defects, 'status' for info, 'bench' for reader scaling, 'log <level>' to filter, 'ping <ms> [timeout]' for liveness, 'defects <s> [jitter]' for the refresh");
+            } else if (command == "bench" || command == "BENCH") {
+                if (readerBenchTaskHandle != NULL) {
+                    Serial.println(">> Reader benchmark already running");
+                } else {
+                    Serial.printf(">> Reader benchmark: 1..%d readers, %lu ms each (scanning continues on the active readers)\n",
+                                 STATION_COUNT, READER_BENCH_STEP_MS);
+                    xTaskCreatePinnedToCore(readerBenchTask, "ReaderBenchTask", 3072, NULL, 1,
+                                            &readerBenchTaskHandle, 0);
+                }
+            } else if (command.startsWith("log") || command.startsWith("LOG")) {
+                // 'log' shows the level, 'log <error|warn|info|debug>' changes it (lines above it are skipped at the source)
+                String name = command.substring(3);
+                name.trim();
+                uint8_t level;
+                if (name.length() == 0) {
+                    Serial.printf(">> Log level: %s\n", logLevelName(logLevel));
+                } else if (logLevelFromName(name.c_str(), level) && level > LOG_COMPILE_LEVEL) {
+                    Serial.printf("!! %s messages are compiled out of this build - level stays %s\n",
+                                 logLevelName(level), logLevelName(logLevel));
+                } else if (logLevelFromName(name.c_str(), level)) {
+                    logLevel = level;
+                    Serial.printf(">> Log level set to %s\n", logLevelName(level));
+                } else {
+                    Serial.println("!! Unknown log level - use error, warn, info or debug");
+                }
+            } else if (command.startsWith("defects") || command.startsWith("DEFECTS")) {
+                // 'defects' shows the refresh schedule, 'defects <interval-s> [jitter-s]' changes it (0 = off)
+                String args = command.substring(7);
+                args.trim();
+                if (args.length() > 0) {
+                    int space = args.indexOf(' ');
+                    uint32_t interval = args.substring(0, space < 0 ? args.length() : space).toInt();
+                    uint32_t jitter = space < 0 ? defectRefreshJitterMs / 1000 : args.substring(space + 1).toInt();
+                    if (interval != 0 && interval < 60) {
+                        Serial.println("!! Refresh interval must be at least 60 s");
+                    } else {
+                        defectRefreshIntervalMs = interval * 1000;
+                        defectRefreshJitterMs = jitter * 1000;
+                        if (defect_def_updated) {
+                            scheduleDefectRefresh(defectRefreshIntervalMs);
+                        }
+                    }
+                }
+                if (defectRefreshIntervalMs == 0) {
+                    Serial.println(">> Defect definitions refresh off (retried only until the server's set loads)");
+                } else {
+                    Serial.printf(">> Defect definitions: checked every %lu s +-%lu s\n",
+                                 defectRefreshIntervalMs / 1000, defectRefreshJitterMs / 1000);
+                }
+            } else if (command.startsWith("ping") || command.startsWith("PING")) {
+                // 'ping' shows the liveness settings, 'ping <interval-ms> [timeout-ms]' changes them (0 = off)
+                String args = command.substring(4);
+                args.trim();
+                if (args.length() > 0) {
+                    int space = args.indexOf(' ');
+                    uint32_t interval = args.substring(0, space < 0 ? args.length() : space).toInt();
+                    uint32_t timeout = space < 0 ? uploadPongTimeoutMs : args.substring(space + 1).toInt();
+                    if (interval != 0 && timeout < 500) {
+                        Serial.println("!! Pong timeout must be at least 500 ms");
+                    } else {
+                        uploadPingIntervalMs = interval;
+                        uploadPongTimeoutMs = timeout;
+                    }
+                }
+                if (uploadPingIntervalMs == 0) {
+                    Serial.println(">> Liveness pings off");
+                } else {
+                    Serial.printf(">> Liveness: ping every %lu ms, reconnect after %lu ms without a pong\n",
+                                 uploadPingIntervalMs, uploadPongTimeoutMs);
+                }
             }
         }
         
+        // WiFi link - connects, detects drops and paces retries without blocking this loop
+        wifiLoop();
+        
         if (wifiConnected) {
             // Handle WebSocket events
             webSocket.loop();
             
-            // Check WiFi connection status
-            if (WiFi.status() != WL_CONNECTED) {
-                Serial.println("!! WiFi disconnected, attempting reconnection...");
-                wifiConnected = false;
-                wsConnected = false;
-                WiFi.reconnect();
-                delay(5000);
-            }
-            
-            // Check for NTP re-synchronization
-            checkNTPSync();
-            
             // Check for defect definitions refresh
             checkDefectDefinitionsSync();
-        } else {
-            // Try to reconnect WiFi periodically
-            if (WiFi.status() == WL_CONNECTED) {
-                wifiConnected = true;
-                Serial.println("WiFi reconnected!");
-                // Re-sync time after reconnection
-                initNTP();
-                // Reconnect WebSocket
-                initWebSocket();
-            } else {
-                // Try to reconnect every 30 seconds
-                static unsigned long lastReconnectAttempt = 0;
-                if (millis() - lastReconnectAttempt >= 30000) {
-                    Serial.println("Attempting WiFi reconnection...");
-                    WiFi.disconnect();
-                    delay(1000);
-                    WiFi.begin(ssid, password);
-                    lastReconnectAttempt = millis();
-                }
-            }
+        }
+        if (defectFetchRunning()) {
+            // A step at a time, so pongs and uploads keep flowing while a slow server answers
+            stepDefectFetch();
         }
         
         // Process queue and send data via WebSocket (only when connected)
-        if (wsConnected) {
-            ScannedData queueData;
-            // Try to send one item from queue per loop iteration
-            if (xQueueReceive(scannedDataQueue, &queueData, 0) == pdTRUE) {
-                // Try to send data via WebSocket
-                if (sendRFIDDataViaWebSocket(queueData)) {
-                    Serial.println("Core 0: Data sent via WebSocket successfully");
-                } else {
-                    Serial.println("Core 0: Failed to send data, will retry next cycle");
-                    // Put the failed item back at front of queue to retry later
-                    xQueueSendToFront(scannedDataQueue, &queueData, 0);
-                    // Don't break - let scanning continue
-                }
-            }
-        }
+        drainScanQueue();
         // If WebSocket not connected, just let the queue fill up - scanning continues
         
         // Optional: Print status periodically (every 30 seconds)
         static unsigned long lastStatus = 0;
         if (millis() - lastStatus >= 30000) {
-            int queueCount = uxQueueMessagesWaiting(scannedDataQueue);
-            uint32_t totalScans = station1ScanCount + station2ScanCount + qcScanCount;
-            Serial.printf("Core 0 - Queue: %d/%d | WiFi: %s | WebSocket: %s | DefDB: %s | Total: %lu (S1:%lu S2:%lu QC:%lu)\n", 
-                         queueCount, QUEUE_SIZE,
+            int queueCount = lanesWaiting();
+            int queueCapacity = lanesCapacity();
+            uint32_t totalScans = 0;
+            for (uint8_t i = 0; i < STATION_COUNT; i++) {
+                totalScans += stationScanCount[i];
+            }
+            Serial.printf("Core 0 - Queue: %d/%d | WiFi: %s | WebSocket: %s | DefDB: %s | Total: %lu (", 
+                         queueCount, queueCapacity,
                          wifiConnected ? "OK" : "Not-OK",
                          wsConnected ? "OK" : "Not-OK",
                          defect_def_updated ? "Updated" : "Fallback",
-                         totalScans, station1ScanCount, station2ScanCount, qcScanCount);
+                         totalScans);
+            for (uint8_t i = 0; i < STATION_COUNT; i++) {
+                Serial.printf("%s%s:%lu", i ? " " : "", STATIONS[i].shortName, stationScanCount[i]);
+            }
+            Serial.println(")");
             
             // Show station status
-            Serial.printf("Station Status - S1: %s%s | S2: %s%s | QC: %s%s\n",
-                         station1Active ? "ACTIVE" : "INACTIVE",
-                         station1Active ? (" (" + station1Employee + ")").c_str() : "",
-                         station2Active ? "ACTIVE" : "INACTIVE", 
-                         station2Active ? (" (" + station2Employee + ")").c_str() : "",
-                         qcActive ? "ACTIVE" : "INACTIVE",
-                         qcActive ? (" (" + qcEmployee + ")").c_str() : "");
+            Serial.print("Station Status -");
+            for (uint8_t i = 0; i < STATION_COUNT; i++) {
+                Serial.printf("%s %s: %s%s", i ? " |" : "", STATIONS[i].shortName,
+                             stationActive[i] ? "ACTIVE" : "INACTIVE",
+                             stationActive[i] ? (" (" + stationEmployee[i] + ")").c_str() : "");
+            }
             
             // Show shift states
             const char* stateNames[] = {"WAITING_CARD", "WAIT_START_CONF", "ACTIVE_SCAN", "WAIT_END_CONF"};
-            Serial.printf("Shift States - S1: %s | S2: %s | QC: %s\n",
-                         stateNames[station1State], stateNames[station2State], stateNames[qcState]);
-            
-            // Warn if queue is getting full
-            if (queueCount > QUEUE_SIZE * 0.8) {
-                Serial.printf("!! WARNING: Queue is %d%% full - %d items pending\n", 
-                             (queueCount * 100) / QUEUE_SIZE, queueCount);
+            Serial.print("\nShift States -");
+            for (uint8_t i = 0; i < STATION_COUNT; i++) {
+                Serial.printf("%s %s: %s", i ? " |" : "", STATIONS[i].shortName, stateNames[stationState[i]]);
             }
-            lastStatus = millis();
-        }
-        
-        // Task delay to prevent watchdog issues
-        vTaskDelay(pdMS_TO_TICKS(100)); // Check every 100ms for responsive WebSocket
-    }
-}
-
-// Process scanned RFID card and add to queue (Core 1 task)
-bool processScannedCard(MFRC522& rfid, uint8_t stationNumber) {
-    // Convert UID to string for comparison
-    String uidString = uidToString((uint8_t*)rfid.uid.uidByte, rfid.uid.size);
-    
-    // Check if this is an employee card
-    if (isEmployeeCard(uidString)) {
-        // Beep for employee card scan
-        beepBuzzer(200); // 200ms beep for employee cards (reduced from 300ms)
-        // Handle employee login/logout
-        handleEmployeeAccess(uidString, stationNumber);
-        return false; // Don't queue employee cards
-    }
-    
-    // Beep immediately for product card detection (instant feedback)
-    beepBuzzer(100); // 100ms beep for immediate scan confirmation
-    
-    // Check if station is active before scanning regular cards
-    bool stationActive = false;
-    String stationName = "";
-    volatile uint32_t* stationCounter = nullptr;
-    ShiftState currentState;
-    
-    switch(stationNumber) {
-        case 1:
-            stationActive = station1Active;
-            stationName = "Line 1-Station 5";
-            stationCounter = &station1ScanCount;
-            currentState = station1State;
-            break;
-        case 2:
-            stationActive = station2Active;
-            stationName = "Line 2-Station 5";
-            stationCounter = &station2ScanCount;
-            currentState = station2State;
-            break;
-        case 3:
-            stationActive = qcActive;
-            stationName = "QC Station";
-            stationCounter = &qcScanCount;
-            currentState = qcState;
-            break;
-    }
-    
-    if (!stationActive || currentState != ACTIVE_SCANNING) {
-        String message = stationName + " is not active - First scan your card";
-        Serial.println(message);
-        
-        // Display message on LCD for Line 2-Station 5
-        if (stationNumber == 2) {
-            displayStation2Message("First scan", "your card");
-            vTaskDelay(pdMS_TO_TICKS(1500)); // Use vTaskDelay instead of delay()
-            displayStation2Message("Line 2-Station 5", "Scan your card");
-        }
-        // Display message on LCD for QC Station
-        else if (stationNumber == 3) {
-            displayQCMessage("First scan", "your card", "", "");
-            vTaskDelay(pdMS_TO_TICKS(1500)); // Use vTaskDelay instead of delay()
-            displayQCMessage("QC Station", "Scan your card", "", "");
-        }
-        return false;
-    }
-    
-    // Check for consecutive duplicate scans for normal employee stations only (Line 1-Station 5 & Line 2-Station 5)
-    // This validation happens BEFORE counting to prevent duplicate increments  
-    if (stationNumber == 1 || stationNumber == 2) {
-        String* lastScannedUID = (stationNumber == 1) ? &lastScannedUID_Station1 : &lastScannedUID_Station2;
-        
-        if (*lastScannedUID == uidString) {
-            // Consecutive duplicate scan detected - double beep and reject
-            doubleBeepBuzzer();
-            
-            Serial.println(stationName + " - Consecutive duplicate scan rejected: " + uidString);
             
-            // Display message on Line 2-Station 5 LCD (but don't increment counter)
-            if (stationNumber == 2) {
-                displayStation2Message("Already scanned", "Try different tag");
-                vTaskDelay(pdMS_TO_TICKS(1500)); // Show message for 1.5 seconds
-                // Restore the count display without incrementing
-                updateStation2Display(uidString.c_str(), station2ScanCount);
+            // Show achieved reader poll rates
+            Serial.print("\nReader Polls/s -");
+            for (uint8_t i = 0; i < STATION_COUNT; i++) {
+                Serial.printf("%s %s: %.1f", i ? " |" : "", STATIONS[i].shortName, readerSlots[i].pollsPerSecond);
             }
-            
-            return false; // Don't process consecutive duplicates
-        }
-        
-        // Update last scanned UID for this station
-        *lastScannedUID = uidString;
-    }
-    // Note: QC station (stationNumber == 3) has no duplicate prevention
-    
-    // NOW increment counters and update LCD displays (after duplicate validation)
-    if (stationNumber == 1) {
-        station1ScanCount++; // Increment counter for Line 1-Station 5 (no LCD update)
-    } else if (stationNumber == 2) {
-        station2ScanCount++; // Increment counter for immediate display
-        updateStation2Display(uidString.c_str(), station2ScanCount);
-    }
-    // Note: QC station has special handling below and manages its own counter
-    
-    // Special handling for QC Station - show parts selection
-    if (stationNumber == 3) {
-        Serial.println("QC: Product tag scanned - " + uidString);
-        displayQCMessage("Product scanned!", "UID: " + uidString.substring(0, 12), "Select section", "Use UP/DOWN + OK");
-        vTaskDelay(pdMS_TO_TICKS(1000)); // Use vTaskDelay instead of delay()
-        
-        // Show multi-step selection and wait for user choice
-        bool selectionConfirmed = handleQCPartsSelection();
-        
-        if (!selectionConfirmed) {
-            // User cancelled or timeout
-            displayQCMessage("Selection", "Cancelled", "Scan next product", "");
-            vTaskDelay(pdMS_TO_TICKS(1500)); // Use vTaskDelay instead of delay()
-            displayQCMessage("QC Station", "Ready to scan", "", "");
-            return false;
-        }
-        
-        // Get selected subtype name for display
-        DefectSubtype* subtypes;
-        int subtypesCount;
-        String selectedSubtype = "";
-        if (getSubtypesForType(qcSelectedType, subtypes, subtypesCount) && 
-            qcSelectedSubtype < subtypesCount) {
-            selectedSubtype = subtypes[qcSelectedSubtype].name;
-        }
-        
-        // User confirmed complete selection - process as defect
-        Serial.println("QC: Processing defect scan with complete selection:");
-        Serial.println("  Section: " + qcSections[qcSelectedPart].name);
-        Serial.println("  Type: " + qcTypes[qcSelectedType].name); 
-        Serial.println("  Subtype: " + selectedSubtype);
-        
-        displayQCMessage("Processing...", "Sec:" + qcSections[qcSelectedPart].name, "Typ:" + qcTypes[qcSelectedType].name, "Sub:" + selectedSubtype.substring(0, 12));
-        vTaskDelay(pdMS_TO_TICKS(1500)); // Use vTaskDelay instead of delay()
-        
-        // Generate scan ID and get timestamp
-        String scanID = generateScanID(stationNumber);
-        String stationID = generateStationID(stationNumber);
-        time_t now = 0;
-        if (timeInitialized) {
-            time(&now);
-        }
-        
-        // Convert selections to numeric codes
-        uint8_t sectionCode = getSectionCode(qcSelectedPart);
-        uint8_t typeCode = getTypeCode(qcSelectedType);
-        uint8_t subtypeCode = getSubtypeCode(qcSelectedType, qcSelectedSubtype);
-        
-        // Send defect data immediately if connected
-        if (wsConnected) {
-            bool defectSent = sendDefectDataViaWebSocket(scanID, uidString, stationID, now, 
-                                                        sectionCode, typeCode, subtypeCode);
-            if (defectSent) {
-                qcScanCount++; // Increment QC scan counter
-                updateQCDisplay(uidString.c_str(), qcScanCount);
-                Serial.println("QC: Defect data sent successfully - ID: " + scanID);
-                
-                // Beep for successful defect scan
-                beepBuzzer(100); // 100ms beep for successful defect (reduced from 150ms)
-                
-                // Show success message
-                displayQCMessage("Defect Logged!", "ID: " + scanID, "Scan next product", "");
-                delay(2000); // Reduced from 3000ms for faster next scan
-                displayQCMessage("QC Station", "Ready to scan", "", "");
-                return true;
-            } else {
-                Serial.println("QC: Failed to send defect data");
-                displayQCMessage("Send Failed!", "Try again", "", "");
-                delay(2000);
-                displayQCMessage("QC Station", "Ready to scan", "", "");
-                return false;
+            Serial.println();
+            Serial.printf("Uploads - %.1f batches/s | %.1f records/s | Failures: %lu\n",
+                         uploadStats.batchesPerSecond, uploadStats.recordsPerSecond, uploadStats.failures);
+            if (journalMounted()) {
+                Serial.printf("Journal - Pending: %lu/%lu | Overwritten: %lu | Max append: %lu us\n",
+                             journalPending(), journalStats.capacity, journalStats.overwritten, journalStats.maxAppendUs);
             }
-        } else {
-            // If not connected, show offline message
-            Serial.println("QC: Offline - Defect data will be queued when connection restored");
-            displayQCMessage("Offline Mode", "Data will sync", "when connected", "");
-            delay(3000);
-            displayQCMessage("QC Station", "Ready to scan", "", "");
-            return false;
-        }
-    }
-    
-    // Get current timestamp (only if time is initialized)
-    time_t now = 0;
-    if (timeInitialized) {
-        time(&now);
-    }
-    
-    // Create ScannedData structure
-    ScannedData scannedData;
-    scannedData.timestamp = now;
-    scannedData.stationNumber = stationNumber;
-    scannedData.lineNumber = getLineNumber(stationNumber);
-    scannedData.uidSize = rfid.uid.size;
-    
-    // Copy UID to structure
-    for (byte i = 0; i < rfid.uid.size && i < 10; i++) {
-        scannedData.uid[i] = rfid.uid.uidByte[i];
-    }
-    
-        // Generate scan ID and station ID
-        String scanID = generateScanID(stationNumber);
-        String stationID = generateStationID(stationNumber);    scanID.toCharArray(scannedData.scanID, sizeof(scannedData.scanID));
-    stationID.toCharArray(scannedData.stationID, sizeof(scannedData.stationID));
-    
-    // Try to add to queue (non-blocking for maximum speed)
-    if (xQueueSend(scannedDataQueue, &scannedData, 0) == pdTRUE) {
-        // Successfully added to queue
-        // Note: Station counters and LCD updates already handled above for immediate feedback
-        
-        // Minimal logging for speed (only essential info)
-        Serial.printf("Queued %s: %s\n", stationName.c_str(), uidString.c_str());
-        
-        return true;
-    } else {
-        // Queue is full - remove oldest item to make space for new scan
-        ScannedData oldestData;
-        if (xQueueReceive(scannedDataQueue, &oldestData, 0) == pdTRUE) {
-            // Now try to add the new scan
-            if (xQueueSend(scannedDataQueue, &scannedData, 0) == pdTRUE) {
-                // Note: Station counters and LCD updates already handled above
-                Serial.println("Queue full - replaced oldest scan");
-                return true;
+            
+            // Warn if a lane is getting full
+            for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+                uint32_t depth = laneDepth(lane);
+                if (depth > laneCapacity(lane) * 0.8) {
+                    Serial.printf("!! WARNING: %s lane is %lu%% full - %lu items pending\n", laneName(lane),
+                                 (depth * 100) / laneCapacity(lane), depth);
+                }
             }
+            lastStatus = millis();
         }
         
-        // Queue management failed - show error only on Line 2-Station 5 for immediate feedback
-        if (stationNumber == 2) {
-            updateStation2Display("Queue Error", station2ScanCount);
-        } else if (stationNumber == 3) {
-            updateQCDisplay("Queue Error", qcScanCount);
-        }
-        Serial.println("Queue management failed");
-        return false;
+        // Task delay to prevent watchdog issues
+        // Check every 100ms for responsive WebSocket - every 10ms while definitions are coming in
+        vTaskDelay(pdMS_TO_TICKS(defectFetchRunning() ? 10 : 100));
     }
 }
 
 void setup() {
     Serial.begin(115200);
     delay(1000);
+    
+    // Log ring and drain first - every task logs through the ring from its first line
+    logBegin();
     Serial.println("\n" + repeatString("=", 50));
     Serial.println("<-> ESP32 Dual-Core RFID Scanner Starting...");
     Serial.println(repeatString("=", 50));
     Serial.printf("> Target WiFi: %s\n", ssid);
-    Serial.printf("> WebSocket Server: %s:%d%s\n", websocket_server, websocket_port, websocket_path);
+    for (uint8_t i = 0; i < sizeof(INGEST_ENDPOINTS) / sizeof(INGEST_ENDPOINTS[0]); i++) {
+        Serial.printf("> Ingest endpoint %c: %s:%u%s (API %u)\n", 'A' + i, INGEST_ENDPOINTS[i].host,
+                     INGEST_ENDPOINTS[i].wsPort, websocket_path, INGEST_ENDPOINTS[i].httpPort);
+    }
     Serial.println(repeatString("=", 50));
     
-    // Create FreeRTOS queue for scanned data (must be created before tasks)
-    Serial.print("Creating FreeRTOS queue... ");
-    scannedDataQueue = xQueueCreate(QUEUE_SIZE, sizeof(ScannedData));
-    if (scannedDataQueue == NULL) {
-        Serial.println("!! FAILED !!");
-        Serial.println("ERROR: Failed to create queue!");
+    // Create FreeRTOS queues for scanned data and station cards (must be created before tasks)
+    if (!createPipelineQueues()) {
         while (1); // Halt execution
     }
-    Serial.println("<> Success!");
     
-    // Configure all SS pins as OUTPUT and HIGH
-    Serial.print("Configuring RFID scanner SS pins... ");
-    for (int i = 0; i < 3; i++) {
-        pinMode(SCANNER_SS_PINS[i], OUTPUT);
-        digitalWrite(SCANNER_SS_PINS[i], HIGH);
-    }
+    // Start the I2C bus and configure all SS lines as OUTPUT and HIGH
+    Serial.print("Configuring RFID scanner SS lines... ");
+    initIoLines();
     Serial.println("<> Done!");
     
+    // Readers, LCDs, buttons, buzzer, clock and WebSocket behind the pipeline's hardware ports
+    bindPipelinePorts();
+    
+    // Mount the offline scan journal - without it scans are only kept in the RAM queue
+    Serial.print("Mounting scan journal... ");
+    if (journalFlash.begin() && journalBegin(&journalFlash)) {
+        Serial.printf("<> %lu scans to resume\n", journalPending());
+    } else {
+        Serial.println("!! No journal partition - RAM queue only");
+    }
+    
+    // Scan IDs: device from the MAC, a fresh boot epoch from NVS - never reused after a reset
+    Serial.print("Reserving scan ID epoch... ");
+    uint32_t deviceId = (uint32_t)(ESP.getEfuseMac() >> 24) & SCAN_ID_DEVICE_MASK;
+    if (scanIdBegin(deviceId, nvsSettings.begin() ? &nvsSettings : nullptr)) {
+        Serial.printf("<> Device %06lX, epoch %u\n", (unsigned long)deviceId, scanIdEpoch());
+    } else {
+        Serial.println("!! NVS unavailable - scan IDs may repeat after a reset");
+    }
+    endpointsBegin(INGEST_ENDPOINTS, sizeof(INGEST_ENDPOINTS) / sizeof(INGEST_ENDPOINTS[0]), deviceId);
+    
     // Initialize button pins
     Serial.print("Configuring button pins... ");
     initButtons();
@@ -2114,18 +1818,28 @@ void setup() {
     
     // Initialize SPI
     SPI.begin(SCK_PIN, MISO_PIN, MOSI_PIN);
-    SPI.setFrequency(100000);  // 100kHz for stability
+    SPI.setFrequency(SPI_CLOCK_STEPS[0]);  // Safe clock until each reader is calibrated
     SPI.setDataMode(SPI_MODE0);
     SPI.setBitOrder(MSBFIRST);
     
     // Initialize all readers
-    for (int i = 0; i < 3; i++) {
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
         Serial.print("Initializing Reader "); 
         Serial.println(i + 1);
-        initRFID(readers[i]);
-        byte ver = readers[i].PCD_ReadRegister(MFRC522::VersionReg);
+        initReader(i);
+        byte ver = rfidReadRegister(i, MFRC522::VersionReg);
         Serial.print("Version: 0x"); 
         Serial.println(ver, HEX);
+        
+        // Find the fastest SPI clock this reader handles reliably
+        calibrateReaderSpi(i);
+        Serial.printf("SPI clock: %lu Hz\n", SPI_CLOCK_STEPS[readerLinks[i].spiClockStep]);
+        
+        if (RFID_IRQ_MODE) {
+            readerLinks[i].irqEnabled = initReaderIRQ(i);
+            Serial.printf("IRQ on GPIO %d: %s\n", STATION_WIRING[i].irqPin,
+                          readerLinks[i].irqEnabled ? "OK" : "Not responding - using polling");
+        }
         delay(50);
     }
     
@@ -2156,76 +1870,20 @@ void setup() {
     );
     Serial.println("<> Created!");
     
-    // Create Core 1 task for RFID scanning (App Core)
-    Serial.print("Creating Core 1 (RFID Scanning) task... ");
-    xTaskCreatePinnedToCore(
-        rfidScanningTask,           // Task function
-        "RFIDScanningTask",         // Task name
-        4096,                       // Stack size (bytes)
-        NULL,                       // Task parameter
-        2,                          // Task priority (higher than connectivity)
-        &rfidScanningTaskHandle,    // Task handle
-        1                           // Core 1 (App Core)
-    );
-    Serial.println("<> Created!");
+    // Create Core 1 tasks for RFID scanning and the stations (App Core)
+    startPipelineTasks();
     
     Serial.println("\n" + repeatString("=", 50));
     Serial.println("<-> ESP32 Dual-Core RFID Scanner is starting up!");
     Serial.println("> Core 0: WiFi, NTP sync, and WebSocket communication");
-    Serial.println("> Core 1: RFID scanning operations");
+    Serial.println("> Core 1: RFID scanning operations and station tasks");
+    bootFreeHeap = ESP.getFreeHeap();
+    Serial.printf("> Build: %s, logs up to %s | Sketch: %lu bytes | Free heap: %lu bytes\n", BUILD_PROFILE,
+                  logLevelName(LOG_COMPILE_LEVEL), (unsigned long)ESP.getSketchSize(), (unsigned long)bootFreeHeap);
     Serial.println(repeatString("=", 50));
     Serial.println("! Please wait for connectivity and scanning tasks to initialize...");
 }
 
-// Optimized scanning function for Core 1 (App Core)
-void scanCard(MFRC522& rfid, uint8_t stationNumber) {
-    // Check if new card is present and can be read
-    if (rfid.PICC_IsNewCardPresent() && rfid.PICC_ReadCardSerial()) {
-        // Process the scanned card and add to queue
-        processScannedCard(rfid, stationNumber);
-        
-        // Halt the card and stop crypto communication
-        rfid.PICC_HaltA();
-        rfid.PCD_StopCrypto1();
-    }
-}
-
-// Core 1 Task: Handle RFID scanning operations (time-critical)
-void rfidScanningTask(void *parameter) {
-    Serial.println("Core 1: Starting RFID scanning task...");
-    
-    // Wait a moment for Core 0 to initialize
-    vTaskDelay(pdMS_TO_TICKS(3000)); // Increased to 3 seconds
-    
-    Serial.println("> Core 1: RFID scanning task ready!");
-    Serial.println("> Ready to scan RFID cards on all 3 stations!");
-    Serial.println("> Line 1-Station 5, Line 2-Station 5, and QC Station");
-    Serial.println("> First scan employee cards to activate stations");
-    Serial.println("> Use OK/Cancel buttons to confirm shift start/end");
-    Serial.println("> LCD will show Line 2-Station 5 and QC scans");
-    
-    // Main RFID scanning loop - optimized for maximum speed
-    while (true) {
-        // Check each reader in sequence - Optimized for Core 1 performance
-        for (int i = 0; i < 3; i++) {
-            // Set current reader's SS pin LOW, others HIGH
-            for (int j = 0; j < 3; j++) {
-                digitalWrite(SCANNER_SS_PINS[j], j == i ? LOW : HIGH);
-            }
-            delayMicroseconds(10000);  // 10ms delay in microseconds for precision
-            
-            // Use the optimized scanCard function
-            scanCard(readers[i], i + 1);  // Station numbers are 1-based
-            
-            digitalWrite(SCANNER_SS_PINS[i], HIGH);
-            delayMicroseconds(50000);  // 50ms delay between readers for stability
-        }
-        
-        // Minimal task delay to prevent watchdog issues while maintaining speed
-        vTaskDelay(pdMS_TO_TICKS(1)); // 1ms delay
-    }
-}
-
 void loop() {
     // Handle power state change detected in ISR
     if (powerStateChanged) {
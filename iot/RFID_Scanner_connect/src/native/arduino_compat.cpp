@@ -0,0 +1,113 @@
+// Arduino core functions for the native build
+#include <Arduino.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+HostSerial Serial;
+
+// One lock for all output, so lines from different tasks do not interleave
+static std::mutex serialLock;
+
+static const std::chrono::steady_clock::time_point bootTime = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+unsigned long micros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+String::String(long number, unsigned char base) {
+    if (base == HEX) {
+        char text[20];
+        snprintf(text, sizeof(text), "%lx", (unsigned long)number);
+        value = text;
+    } else {
+        value = std::to_string(number);
+    }
+}
+
+String::String(unsigned long number, unsigned char base) {
+    char text[24];
+    snprintf(text, sizeof(text), base == HEX ? "%lx" : "%lu", number);
+    value = text;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (to > value.size()) {
+        to = value.size();
+    }
+    if (from >= to) {
+        return String();
+    }
+    return String(value.substr(from, to - from));
+}
+
+void String::toUpperCase() {
+    for (char& c : value) {
+        c = toupper((unsigned char)c);
+    }
+}
+
+void String::trim() {
+    size_t first = value.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) {
+        value.clear();
+        return;
+    }
+    value = value.substr(first, value.find_last_not_of(" \t\r\n") - first + 1);
+}
+
+void String::toCharArray(char* buffer, unsigned int size) const {
+    if (size == 0) {
+        return;
+    }
+    strncpy(buffer, value.c_str(), size - 1);
+    buffer[size - 1] = '\0';
+}
+
+size_t HostSerial::print(const char* text) {
+    if (quiet) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(serialLock);
+    return fputs(text, stdout) < 0 ? 0 : strlen(text);
+}
+
+size_t HostSerial::print(long number, int base) {
+    return print(String(number, (unsigned char)base).c_str());
+}
+
+size_t HostSerial::println(const char* text) {
+    if (quiet) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(serialLock);
+    fputs(text, stdout);
+    fputc('\n', stdout);
+    return strlen(text) + 1;
+}
+
+size_t HostSerial::println(long number, int base) {
+    return println(String(number, (unsigned char)base).c_str());
+}
+
+size_t HostSerial::printf(const char* format, ...) {
+    if (quiet) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(serialLock);
+    va_list args;
+    va_start(args, format);
+    int written = vprintf(format, args);
+    va_end(args);
+    return written < 0 ? 0 : written;
+}
@@ -0,0 +1,231 @@
+// FreeRTOS queues, tasks and task notifications on pthreads (native build)
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+struct NativeQueue {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    std::vector<uint8_t> storage;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    UBaseType_t head;              // Index of the oldest item
+    UBaseType_t count;
+};
+
+struct NativeTask {
+    pthread_t thread;
+    TaskFunction_t function;
+    void* parameter;
+    pthread_mutex_t lock;
+    pthread_cond_t notified;
+    uint32_t notifyCount;
+};
+
+struct NativeMutex {
+    pthread_mutex_t lock;
+    pthread_cond_t released;
+    bool taken;
+};
+
+static thread_local NativeTask* currentTask = nullptr;
+
+// Absolute deadline for pthread_cond_timedwait, ticks from now
+static timespec deadlineAfter(TickType_t ticks) {
+    timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ticks / 1000;
+    deadline.tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return deadline;
+}
+
+// Wait on cond until predicate holds or the ticks run out; lock must be held
+template <typename Predicate>
+static bool waitFor(pthread_cond_t* cond, pthread_mutex_t* lock, TickType_t ticks, Predicate ready) {
+    if (ticks == portMAX_DELAY) {
+        while (!ready()) {
+            pthread_cond_wait(cond, lock);
+        }
+        return true;
+    }
+    timespec deadline = deadlineAfter(ticks);
+    while (!ready()) {
+        if (pthread_cond_timedwait(cond, lock, &deadline) != 0) {
+            return ready();
+        }
+    }
+    return true;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    NativeQueue* queue = new NativeQueue();
+    pthread_mutex_init(&queue->lock, nullptr);
+    pthread_cond_init(&queue->changed, nullptr);
+    queue->storage.resize((size_t)length * itemSize);
+    queue->length = length;
+    queue->itemSize = itemSize;
+    queue->head = 0;
+    queue->count = 0;
+    return queue;
+}
+
+static BaseType_t queueSend(QueueHandle_t queue, const void* item, TickType_t ticksToWait, bool toFront) {
+    pthread_mutex_lock(&queue->lock);
+    if (!waitFor(&queue->changed, &queue->lock, ticksToWait, [queue] { return queue->count < queue->length; })) {
+        pthread_mutex_unlock(&queue->lock);
+        return pdFALSE;
+    }
+    UBaseType_t slot;
+    if (toFront) {
+        queue->head = (queue->head + queue->length - 1) % queue->length;
+        slot = queue->head;
+    } else {
+        slot = (queue->head + queue->count) % queue->length;
+    }
+    memcpy(&queue->storage[(size_t)slot * queue->itemSize], item, queue->itemSize);
+    queue->count++;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+    return pdTRUE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+    return queueSend(queue, item, ticksToWait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+    return queueSend(queue, item, ticksToWait, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticksToWait) {
+    pthread_mutex_lock(&queue->lock);
+    if (!waitFor(&queue->changed, &queue->lock, ticksToWait, [queue] { return queue->count > 0; })) {
+        pthread_mutex_unlock(&queue->lock);
+        return pdFALSE;
+    }
+    memcpy(item, &queue->storage[(size_t)queue->head * queue->itemSize], queue->itemSize);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+static void* taskEntry(void* arg) {
+    currentTask = (NativeTask*)arg;
+    currentTask->function(currentTask->parameter);
+    return nullptr;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth, void* parameter,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t coreId) {
+    NativeTask* task = new NativeTask();
+    task->function = function;
+    task->parameter = parameter;
+    task->notifyCount = 0;
+    pthread_mutex_init(&task->lock, nullptr);
+    pthread_cond_init(&task->notified, nullptr);
+    if (handle != nullptr) {
+        *handle = task;            // Set before the task runs, as FreeRTOS does
+    }
+    if (pthread_create(&task->thread, nullptr, taskEntry, task) != 0) {
+        if (handle != nullptr) {
+            *handle = nullptr;
+        }
+        delete task;
+        return pdFALSE;
+    }
+    pthread_detach(task->thread);
+    return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    timespec duration = {(time_t)(ticks / 1000), (long)(ticks % 1000) * 1000000L};
+    nanosleep(&duration, nullptr);
+}
+
+// Only a task deleting itself is supported (all the firmware does)
+void vTaskDelete(TaskHandle_t task) {
+    if (task == nullptr || task == currentTask) {
+        pthread_exit(nullptr);
+    }
+}
+
+TickType_t xTaskGetTickCount() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (TickType_t)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait) {
+    NativeTask* task = currentTask;
+    if (task == nullptr) {
+        vTaskDelay(ticksToWait);
+        return 0;
+    }
+    pthread_mutex_lock(&task->lock);
+    waitFor(&task->notified, &task->lock, ticksToWait, [task] { return task->notifyCount > 0; });
+    uint32_t count = task->notifyCount;
+    if (count > 0) {
+        task->notifyCount = clearCountOnExit ? 0 : count - 1;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    pthread_mutex_lock(&task->lock);
+    task->notifyCount++;
+    pthread_cond_signal(&task->notified);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+    xTaskNotifyGive(task);
+    if (higherPriorityTaskWoken != nullptr) {
+        *higherPriorityTaskWoken = pdFALSE;
+    }
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    NativeMutex* mutex = new NativeMutex();
+    pthread_mutex_init(&mutex->lock, nullptr);
+    pthread_cond_init(&mutex->released, nullptr);
+    mutex->taken = false;
+    return mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticksToWait) {
+    pthread_mutex_lock(&mutex->lock);
+    bool acquired = waitFor(&mutex->released, &mutex->lock, ticksToWait, [mutex] { return !mutex->taken; });
+    if (acquired) {
+        mutex->taken = true;
+    }
+    pthread_mutex_unlock(&mutex->lock);
+    return acquired ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) {
+    pthread_mutex_lock(&mutex->lock);
+    mutex->taken = false;
+    pthread_cond_signal(&mutex->released);
+    pthread_mutex_unlock(&mutex->lock);
+    return pdTRUE;
+}
@@ -0,0 +1,89 @@
+// Minimal Arduino core for the native (Linux) build - just what src/pipeline.cpp uses.
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define DEC 10
+#define HEX 16
+#define IRAM_ATTR
+
+using std::min;
+using std::max;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+// Arduino String on top of std::string
+class String {
+public:
+    String() {}
+    String(const char* text) : value(text ? text : "") {}
+    String(const std::string& text) : value(text) {}
+    String(char c) : value(1, c) {}
+    String(unsigned char number, unsigned char base = DEC) : String((unsigned long)number, base) {}
+    String(int number, unsigned char base = DEC) : String((long)number, base) {}
+    String(unsigned int number, unsigned char base = DEC) : String((unsigned long)number, base) {}
+    String(long number, unsigned char base = DEC);
+    String(unsigned long number, unsigned char base = DEC);
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return value.size(); }
+    bool reserve(unsigned int size) { value.reserve(size); return true; }
+    String substring(unsigned int from) const { return substring(from, value.size()); }
+    String substring(unsigned int from, unsigned int to) const;
+    void toUpperCase();
+    void trim();
+    void toCharArray(char* buffer, unsigned int size) const;
+
+    String& operator+=(const String& other) { value += other.value; return *this; }
+    String& operator+=(const char* other) { value += other; return *this; }
+    String& operator+=(char other) { value += other; return *this; }
+    bool operator==(const String& other) const { return value == other.value; }
+    bool operator==(const char* other) const { return value == (other ? other : ""); }
+    bool operator!=(const String& other) const { return !(*this == other); }
+    bool operator!=(const char* other) const { return !(*this == other); }
+
+    friend String operator+(const String& a, const String& b) { return String(a.value + b.value); }
+    friend String operator+(const String& a, const char* b) { return String(a.value + b); }
+    friend String operator+(const char* a, const String& b) { return String(a + b.value); }
+
+private:
+    std::string value;
+};
+
+// Serial port on stdout; setQuiet(true) drops everything (benchmark runs)
+class HostSerial {
+public:
+    void begin(unsigned long) {}
+    void setQuiet(bool on) { quiet = on; }
+    bool isQuiet() const { return quiet; }
+
+    size_t print(const char* text);
+    size_t print(const String& text) { return print(text.c_str()); }
+    size_t print(long number, int base = DEC);
+    size_t println() { return print("\n"); }
+    size_t println(const char* text);
+    size_t println(const String& text) { return println(text.c_str()); }
+    size_t println(long number, int base = DEC);
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+    volatile bool quiet = false;
+};
+
+extern HostSerial Serial;
+
+#endif
@@ -0,0 +1,717 @@
+// Simulated readers, LCDs, buttons, buzzer, clock and server for the native build
+#include "sim_hal.h"
+#include <Arduino.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "pipeline.h"
+#include "wire.h"
+
+// Time from the start of a transceive to the tag's answer being in the FIFO (SPI writes + air time)
+const unsigned long SIM_RESPONSE_US = 400;
+
+// Typical SPI NOR timings (ESP32 module flash): 4KB sector erase, 64-byte page program
+const unsigned long SIM_FLASH_ERASE_US = 45000;
+const unsigned long SIM_RECONNECT_MS = 150;        // New WebSocket: TCP + HTTP upgrade on the LAN
+const unsigned long SIM_FLASH_WRITE_US = 120;
+
+// The 4 UID/cascade-tag bytes and BCC a tag sends at one cascade level
+static void cascadeBytes(const SimTag& tag, uint8_t level, uint8_t* out) {
+    uint8_t levels = tag.uidSize == 4 ? 1 : (tag.uidSize == 7 ? 2 : 3);
+    uint8_t offset = (level - 1) * 3;
+    if (level < levels) {
+        out[0] = PICC_CASCADE_TAG;
+        memcpy(&out[1], &tag.uid[offset], 3);
+    } else {
+        memcpy(out, &tag.uid[offset], 4);
+    }
+    out[4] = out[0] ^ out[1] ^ out[2] ^ out[3];
+}
+
+static bool bitAt(const uint8_t* bytes, uint8_t bit) {
+    return (bytes[bit / 8] >> (bit % 8)) & 0x01;
+}
+
+void SimReader::placeTag(const uint8_t* uid, uint8_t uidSize) {
+    std::lock_guard<std::mutex> guard(lock);
+    SimTag tag = {};
+    memcpy(tag.uid, uid, uidSize);
+    tag.uidSize = uidSize;
+    tag.state = TAG_IDLE;
+    tag.level = 1;
+    tags.push_back(tag);
+}
+
+void SimReader::clearField() {
+    std::lock_guard<std::mutex> guard(lock);
+    tags.clear();
+}
+
+void SimReader::startTransceive(const uint8_t* data, uint8_t length, uint8_t txLastBits, uint8_t rxAlign) {
+    std::lock_guard<std::mutex> guard(lock);
+    result = TRX_TIMEOUT;
+    answerLength = 0;
+    collPos = 0;
+    
+    if (length == 1 && txLastBits == 7 && data[0] == PICC_REQA) {
+        answerRequest();
+    } else if (length >= 2 && (data[0] == PICC_SEL_CL1 || data[0] == PICC_SEL_CL2 || data[0] == PICC_SEL_CL3)) {
+        answerSelect(data, length);
+    }
+    answerAt = micros() + (result == TRX_TIMEOUT ? RFID_FRAME_TIMEOUT_MS * 1000UL : SIM_RESPONSE_US);
+}
+
+// REQA: every tag that is not halted answers with its ATQA
+void SimReader::answerRequest() {
+    bool first = true;
+    for (SimTag& tag : tags) {
+        if (tag.state == TAG_HALT) {
+            continue;
+        }
+        tag.state = TAG_READY;
+        tag.level = 1;
+        uint8_t atqa = tag.uidSize == 4 ? 0x04 : (tag.uidSize == 7 ? 0x44 : 0x84);
+        if (first) {
+            answer[0] = atqa;
+            answer[1] = 0x00;
+            answerLength = 2;
+            result = TRX_OK;
+            first = false;
+        } else if (answer[0] != atqa) {
+            result = TRX_COLLISION;   // Different UID sizes - the ATQA bits collide
+        }
+    }
+}
+
+// SEL: anticollision (NVB < 0x70) or select (NVB 0x70) at one cascade level
+void SimReader::answerSelect(const uint8_t* data, uint8_t length) {
+    uint8_t level = data[0] == PICC_SEL_CL1 ? 1 : (data[0] == PICC_SEL_CL2 ? 2 : 3);
+    uint8_t nvb = data[1];
+    uint8_t cascade[5];
+    
+    if (nvb == 0x70) {
+        if (length != 9) {
+            return;
+        }
+        SimTag* selected = nullptr;
+        for (SimTag& tag : tags) {
+            if (tag.state != TAG_READY || tag.level != level) {
+                continue;
+            }
+            cascadeBytes(tag, level, cascade);
+            if (selected == nullptr && memcmp(cascade, &data[2], 5) == 0) {
+                selected = &tag;
+            } else {
+                tag.state = TAG_IDLE;     // Not selected - drops out until the next REQA
+            }
+        }
+        if (selected == nullptr) {
+            return;
+        }
+        uint8_t levels = selected->uidSize == 4 ? 1 : (selected->uidSize == 7 ? 2 : 3);
+        if (level < levels) {
+            selected->level++;
+            answer[0] = 0x04;         // SAK: UID not complete
+        } else {
+            selected->state = TAG_ACTIVE;
+            answer[0] = 0x08;
+        }
+        calculateCRC_A(answer, 1, &answer[1]);
+        answerLength = 3;
+        result = TRX_OK;
+        return;
+    }
+    
+    // Anticollision: tags whose first knownBits match answer with the rest of their cascade bytes
+    uint8_t knownBits = ((nvb >> 4) - 2) * 8 + (nvb & 0x0F);
+    if (knownBits > 32) {
+        return;
+    }
+    uint8_t merged[5] = {0};
+    uint8_t firstDiff = 40;           // First bit where the answering tags differ
+    bool anyAnswer = false;
+    for (SimTag& tag : tags) {
+        if (tag.state != TAG_READY || tag.level != level) {
+            continue;
+        }
+        cascadeBytes(tag, level, cascade);
+        bool matches = true;
+        for (uint8_t bit = 0; bit < knownBits && matches; bit++) {
+            matches = bitAt(cascade, bit) == bitAt(&data[2], bit);
+        }
+        if (!matches) {
+            continue;
+        }
+        if (!anyAnswer) {
+            memcpy(merged, cascade, 5);
+            anyAnswer = true;
+            continue;
+        }
+        for (uint8_t bit = knownBits; bit < firstDiff; bit++) {
+            if (bitAt(cascade, bit) != bitAt(merged, bit)) {
+                firstDiff = bit;
+                break;
+            }
+        }
+    }
+    if (!anyAnswer) {
+        return;
+    }
+    
+    if (firstDiff < 40) {
+        // Bits from the collision on are garbage on air - the reader reports them cleared
+        for (uint8_t bit = firstDiff; bit < 40; bit++) {
+            merged[bit / 8] &= ~(1 << (bit % 8));
+        }
+        collPos = firstDiff + 1;
+        result = TRX_COLLISION;
+    } else {
+        result = TRX_OK;
+    }
+    uint8_t knownBytes = knownBits / 8;
+    answerLength = 5 - knownBytes;
+    memcpy(answer, &merged[knownBytes], answerLength);
+}
+
+TransceiveResult SimReader::pollTransceive(uint8_t* backData, uint8_t* backLen) {
+    std::lock_guard<std::mutex> guard(lock);
+    if ((long)(micros() - answerAt) < 0) {
+        return TRX_PENDING;
+    }
+    if (result == TRX_OK || result == TRX_COLLISION) {
+        if (answerLength > *backLen) {
+            return TRX_ERROR;
+        }
+        memcpy(backData, answer, answerLength);
+        *backLen = answerLength;
+    }
+    return result;
+}
+
+uint8_t SimReader::collisionPosition() {
+    std::lock_guard<std::mutex> guard(lock);
+    return collPos;
+}
+
+void SimReader::haltA() {
+    std::lock_guard<std::mutex> guard(lock);
+    for (SimTag& tag : tags) {
+        if (tag.state == TAG_ACTIVE) {
+            tag.state = TAG_HALT;
+        }
+    }
+}
+
+void SimDisplay::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    memset(rows, 0, sizeof(rows));
+    cursorCol = 0;
+    cursorRow = 0;
+}
+
+void SimDisplay::setCursor(uint8_t col, uint8_t row) {
+    std::lock_guard<std::mutex> guard(lock);
+    cursorCol = col < 16 ? col : 16;
+    cursorRow = row < 4 ? row : 3;
+}
+
+void SimDisplay::print(const char* text) {
+    std::lock_guard<std::mutex> guard(lock);
+    for (; *text != '\0' && cursorCol < 16; text++) {
+        for (uint8_t col = 0; col < cursorCol; col++) {
+            if (rows[cursorRow][col] == '\0') {
+                rows[cursorRow][col] = ' ';
+            }
+        }
+        rows[cursorRow][cursorCol++] = *text;
+    }
+}
+
+std::string SimDisplay::row(uint8_t index) {
+    std::lock_guard<std::mutex> guard(lock);
+    return std::string(rows[index]);
+}
+
+void SimButtons::press(StationButton button, unsigned long durationMs) {
+    pressedUntil[button] = millis() + durationMs;
+}
+
+bool SimButtons::isPressed(StationButton button) {
+    return millis() < pressedUntil[button];
+}
+
+uint64_t HostClock::monotonicUs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+uint64_t HostClock::unixMs() {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000ULL + now.tv_nsec / 1000000;
+}
+
+uint32_t HostClock::cycles() {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (uint32_t)(now.tv_sec * 1000000000ULL + now.tv_nsec);
+}
+
+void SimSettings::begin(const char* path) {
+    filePath = path != nullptr ? path : "";
+    FILE* file = filePath.empty() ? nullptr : fopen(filePath.c_str(), "r");
+    if (file == nullptr) {
+        return;
+    }
+    char key[32];
+    unsigned long value;
+    while (fscanf(file, "%31s %lu", key, &value) == 2) {
+        values[key] = value;
+    }
+    fclose(file);
+}
+
+bool SimSettings::readU32(const char* key, uint32_t& value) {
+    auto found = values.find(key);
+    if (found == values.end()) {
+        return false;
+    }
+    value = found->second;
+    return true;
+}
+
+bool SimSettings::writeU32(const char* key, uint32_t value) {
+    values[key] = value;
+    if (filePath.empty()) {
+        return true;
+    }
+    FILE* file = fopen(filePath.c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+    for (const auto& entry : values) {
+        fprintf(file, "%s %lu\n", entry.first.c_str(), (unsigned long)entry.second);
+    }
+    return fclose(file) == 0;
+}
+
+bool SimFlash::begin(uint32_t sizeBytes, const char* path) {
+    regionSize = sizeBytes - sizeBytes % sectorSize();
+    if (path == nullptr) {
+        memory = (uint8_t*)malloc(regionSize);
+        if (memory != nullptr) {
+            memset(memory, 0xFF, regionSize);
+        }
+        return memory != nullptr;
+    }
+    
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    off_t existing = lseek(fd, 0, SEEK_END);
+    if (existing != (off_t)regionSize) {
+        // New (or resized) image - start from erased flash
+        uint8_t erased[4096];
+        memset(erased, 0xFF, sizeof(erased));
+        bool ok = ftruncate(fd, 0) == 0;
+        for (uint32_t offset = 0; ok && offset < regionSize; offset += sizeof(erased)) {
+            ok = pwrite(fd, erased, sizeof(erased), offset) == (ssize_t)sizeof(erased);
+        }
+        if (!ok) {
+            close(fd);
+            return false;
+        }
+    }
+    void* mapped = mmap(nullptr, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    memory = (uint8_t*)mapped;
+    return true;
+}
+
+bool SimFlash::read(uint32_t offset, void* data, uint32_t length) {
+    if (offset + length > regionSize) {
+        return false;
+    }
+    memcpy(data, &memory[offset], length);
+    return true;
+}
+
+bool SimFlash::write(uint32_t offset, const void* data, uint32_t length) {
+    if (offset + length > regionSize) {
+        return false;
+    }
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (uint32_t i = 0; i < length; i++) {
+        memory[offset + i] &= bytes[i];
+    }
+    usleep(SIM_FLASH_WRITE_US);
+    return true;
+}
+
+bool SimFlash::eraseSector(uint32_t offset) {
+    if (offset % sectorSize() != 0 || offset >= regionSize) {
+        return false;
+    }
+    memset(&memory[offset], 0xFF, sectorSize());
+    usleep(SIM_FLASH_ERASE_US);
+    return true;
+}
+
+void SinkTransport::expect(const std::string& tagUid, unsigned long placedAtUs) {
+    std::lock_guard<std::mutex> guard(lock);
+    placedAt[tagUid] = placedAtUs;
+}
+
+void SinkTransport::expectDefect(const std::string& tagUid, unsigned long loggedAtUs) {
+    std::lock_guard<std::mutex> guard(lock);
+    placedAt[tagUid] = loggedAtUs;
+    defectUids.insert(tagUid);
+}
+
+bool SinkTransport::connected() {
+    if (halfOpen() && millis() - halfOpenAtMs >= tcpTimeoutMs) {
+        // No heartbeat noticed it - TCP retransmissions finally give up
+        halfOpenEndedAtMs = millis();
+        offlineUntilMs = millis() + SIM_RECONNECT_MS;
+    }
+    return online && millis() >= offlineUntilMs && serverUp(endpointCurrent());
+}
+
+bool SinkTransport::helloAnswered() {
+    return helloDelayMs >= 0 && millis() >= offlineUntilMs + helloDelayMs;
+}
+
+bool SinkTransport::serverUp(uint8_t index) {
+    unsigned long now = millis();
+    const Server& server = servers[index];
+    return server.downUntilMs == 0 || now < server.downFromMs || now >= server.downUntilMs;
+}
+
+bool SinkTransport::halfOpen() {
+    return halfOpenAtMs != 0 && halfOpenEndedAtMs == 0 && millis() >= halfOpenAtMs;
+}
+
+void SinkTransport::reconnect() {
+    if (halfOpen()) {
+        halfOpenEndedAtMs = millis();
+        endedByPing = true;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    pendingAcks.clear();                           // Answers on the old connection never arrive
+    pendingPongs.clear();
+    offlineUntilMs = millis() + SIM_RECONNECT_MS;
+}
+
+bool SinkTransport::sendPing(uint32_t token) {
+    if (!online || !serverUp(endpointCurrent())) {
+        return false;
+    }
+    if (halfOpen()) {
+        return true;                               // Into the void, like any other frame
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    unsigned long roundTrip = servers[endpointCurrent()].ackDelayMs != 0 ? servers[endpointCurrent()].ackDelayMs : ackDelayMs;
+    pendingPongs.push_back({millis() + roundTrip, token});
+    return true;
+}
+
+// Caller holds lock
+void SinkTransport::received(const std::string& tagUid, const std::string& scanId, uint32_t timestamp, unsigned long sentAt) {
+    records++;
+    servers[endpointCurrent()].records++;
+    if (halfOpenEndedAtMs != 0 && recoveredAtMs == 0) {
+        recoveredAtMs = millis();
+    }
+    if (timestamp == 0) {
+        zeroTimestamps++;
+    }
+    if (!seenUids.insert(tagUid).second) {
+        duplicateRecords++;
+    }
+    auto owner = scanIdOwners.emplace(scanId, tagUid);
+    if (!owner.second && owner.first->second != tagUid) {
+        idCollisions++;
+    }
+    auto placed = placedAt.find(tagUid);
+    if (placed != placedAt.end()) {
+        expectedRecords++;
+        if (placed->second != 0 && defectUids.erase(tagUid) > 0) {
+            defectLatencies.push_back(sentAt - placed->second);
+        } else if (placed->second != 0) {
+            latencies.push_back(sentAt - placed->second);
+        }
+        placedAt.erase(placed);
+    }
+}
+
+// Caller holds lock
+bool SinkTransport::frameLost() {
+    if (losePercent > 0 && (int)(random() % 100) < losePercent) {
+        lostFrames++;
+        return true;
+    }
+    return false;
+}
+
+// Caller holds lock. Same bookkeeping as the back end: batches before `oldest` are done on the device's word,
+// the cumulative point then only moves over batches actually saved.
+void SinkTransport::batchSaved(uint32_t seq, uint32_t oldest) {
+    if (seq == 0 || !acks) {
+        return;
+    }
+    if (oldest > nextSeq) {
+        nextSeq = oldest;
+    }
+    if (seq >= nextSeq) {
+        savedSeqs.insert(seq);
+    }
+    while (!savedSeqs.empty() && *savedSeqs.begin() <= nextSeq) {
+        if (*savedSeqs.begin() == nextSeq) {
+            nextSeq++;
+        }
+        savedSeqs.erase(savedSeqs.begin());
+    }
+    unsigned long roundTrip = servers[endpointCurrent()].ackDelayMs != 0 ? servers[endpointCurrent()].ackDelayMs : ackDelayMs;
+    pendingAcks.push_back({millis() + roundTrip, seq, nextSeq > 0 ? nextSeq - 1 : 0});
+}
+
+void SinkTransport::deliverAcks() {
+    std::vector<PendingAck> due;
+    std::vector<uint32_t> duePongs;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (halfOpen() || !serverUp(endpointCurrent())) {
+            pendingAcks.clear();                   // The server's answers are lost with the connection
+            pendingPongs.clear();
+        }
+        for (size_t i = 0; i < pendingPongs.size();) {
+            if ((long)(millis() - pendingPongs[i].dueAt) >= 0) {
+                duePongs.push_back(pendingPongs[i].token);
+                pendingPongs.erase(pendingPongs.begin() + i);
+            } else {
+                i++;
+            }
+        }
+        for (size_t i = 0; i < pendingAcks.size();) {
+            if ((long)(millis() - pendingAcks[i].dueAt) >= 0) {
+                due.push_back(pendingAcks[i]);
+                pendingAcks.erase(pendingAcks.begin() + i);
+            } else {
+                i++;
+            }
+        }
+    }
+    for (const PendingAck& ack : due) {
+        uploadAcked(ack.seq, ack.cumulative);
+    }
+    for (uint32_t token : duePongs) {
+        uploadPong(token);
+    }
+}
+
+bool SinkTransport::sendText(const char* payload, size_t length) {
+    if (!online || !serverUp(endpointCurrent())) {
+        return false;
+    }
+    if (halfOpen()) {
+        voidFrames++;
+        return true;                               // The TCP stack takes it; nobody reads it
+    }
+    unsigned long sentAt = micros();
+    messages++;
+    bytes += length;
+    
+    // One record per Tag_UID in the message
+    std::lock_guard<std::mutex> guard(lock);
+    if (frameLost()) {
+        return true;
+    }
+    // Each record starts with its ID, the tag follows
+    const char* idKey = "\"ID\":\"";
+    const char* key = "\"Tag_UID\":\"";
+    for (const char* at = strstr(payload, idKey); at != nullptr; at = strstr(at, idKey)) {
+        at += strlen(idKey);
+        const char* idEnd = strchr(at, '"');
+        const char* uid = idEnd != nullptr ? strstr(idEnd, key) : nullptr;
+        const char* end = uid != nullptr ? strchr(uid + strlen(key), '"') : nullptr;
+        if (end == nullptr) {
+            break;
+        }
+        uid += strlen(key);
+        const char* stamp = strstr(end, "\"Time_Stamp\":");
+        uint32_t timestamp = stamp != nullptr ? strtoul(stamp + 13, nullptr, 10) : 0;
+        received(std::string(uid, end - uid), std::string(at, idEnd - at), timestamp, sentAt);
+        at = end;
+    }
+    const char* seqKey = strstr(payload, "\"seq\":");
+    const char* oldestKey = strstr(payload, "\"oldest\":");
+    batchSaved(seqKey != nullptr ? strtoul(seqKey + 6, nullptr, 10) : 0,
+               oldestKey != nullptr ? strtoul(oldestKey + 9, nullptr, 10) : 0);
+    return true;
+}
+
+bool SinkTransport::sendBinary(const uint8_t* payload, size_t length) {
+    if (!online || !serverUp(endpointCurrent())) {
+        return false;
+    }
+    if (halfOpen()) {
+        voidFrames++;
+        return true;                               // The TCP stack takes it; nobody reads it
+    }
+    unsigned long sentAt = micros();
+    messages++;
+    bytes += length;
+    
+    WireHeader header;
+    ScannedData decoded[255];
+    std::lock_guard<std::mutex> guard(lock);
+    if (frameLost()) {
+        return true;
+    }
+    if (!wireDecodeHeader(payload, length, header)) {
+        badFrames++;
+        return true;
+    }
+    if (header.type != WIRE_FRAME_SCAN_BATCH) {
+        return true;                               // Defects are not tracked by the scenario
+    }
+    if (wireDecodeScanBatch(payload, length, decoded, 255) != header.count) {
+        badFrames++;
+        return true;
+    }
+    for (uint8_t i = 0; i < header.count; i++) {
+        char uidText[21];
+        for (uint8_t b = 0; b < decoded[i].uidSize; b++) {
+            snprintf(&uidText[b * 2], 3, "%02X", decoded[i].uid[b]);
+        }
+        received(std::string(uidText, decoded[i].uidSize * 2), decoded[i].scanID, decoded[i].timestamp, sentAt);
+    }
+    batchSaved(header.seq, header.oldest);
+    return true;
+}
+
+std::vector<unsigned long> SinkTransport::latenciesUs() {
+    std::lock_guard<std::mutex> guard(lock);
+    return latencies;
+}
+
+std::vector<unsigned long> SinkTransport::defectLatenciesUs() {
+    std::lock_guard<std::mutex> guard(lock);
+    return defectLatencies;
+}
+
+// Counting is per thread, so the simulator's own threads (server, readers) do not show up
+static thread_local bool allocCounting = false;
+static thread_local uint32_t allocCount = 0;
+
+void allocCountStart() {
+    allocCount = 0;
+    allocCounting = true;
+}
+
+uint32_t allocCountStop() {
+    allocCounting = false;
+    return allocCount;
+}
+
+static thread_local bool heapTracking = false;
+static thread_local long heapLive = 0;
+static thread_local long heapPeak = 0;
+
+void heapTrackStart() {
+    heapLive = 0;
+    heapPeak = 0;
+    heapTracking = true;
+}
+
+void heapTrackStop(long& peakBytes, long& liveBytes) {
+    heapTracking = false;
+    peakBytes = heapPeak;
+    liveBytes = heapLive;
+}
+
+static void heapFreed(void* memory) {
+    if (heapTracking && memory != nullptr) {
+        heapLive -= (long)malloc_usable_size(memory);
+    }
+}
+
+void* operator new(size_t size) {
+    if (allocCounting) {
+        allocCount++;
+    }
+    void* memory = malloc(size ? size : 1);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    if (heapTracking) {
+        heapLive += (long)malloc_usable_size(memory);
+        if (heapLive > heapPeak) {
+            heapPeak = heapLive;
+        }
+    }
+    return memory;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+// new/delete are malloc/free underneath - GCC cannot tell once they are replaced
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void operator delete(void* memory) noexcept {
+    heapFreed(memory);
+    free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    heapFreed(memory);
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    heapFreed(memory);
+    free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    heapFreed(memory);
+    free(memory);
+}
+
+bool SimDefinitionsServer::connect(const char* host, uint16_t port) {
+    response = "HTTP/1.0 200 OK\r\nContent-Type: application/json\r\nETag: \"sim-1\"\r\n\r\n" + body;
+    sent = 0;
+    openedAt = millis();
+    open = true;
+    requests++;
+    return true;
+}
+
+int SimDefinitionsServer::available() {
+    if (!open) {
+        return 0;
+    }
+    unsigned long elapsed = millis() - openedAt;
+    size_t due = answerMs == 0 || elapsed >= answerMs ? response.size() : response.size() * elapsed / answerMs;
+    return due > sent ? due - sent : 0;
+}
+
+int SimDefinitionsServer::read(uint8_t* buffer, size_t length) {
+    size_t count = std::min((size_t)available(), length);
+    memcpy(buffer, response.data() + sent, count);
+    sent += count;
+    return count;
+}
+
+bool SimDefinitionsServer::connected() {
+    return open && sent < response.size();
+}
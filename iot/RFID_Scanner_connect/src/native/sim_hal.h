@@ -0,0 +1,251 @@
+// Linux implementations of the pipeline's hardware ports (include/hal.h) for the native simulator.
+#ifndef SIM_HAL_H
+#define SIM_HAL_H
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include "hal.h"
+#include "endpoints.h"
+
+// ISO14443A tag lifecycle as seen by one reader
+enum SimTagState {
+    TAG_IDLE,                    // In the field, answers REQA
+    TAG_READY,                   // Answered REQA, taking part in anticollision at `level`
+    TAG_ACTIVE,                  // Selected
+    TAG_HALT                     // Halted, ignores REQA until it leaves the field
+};
+
+struct SimTag {
+    uint8_t uid[10];
+    uint8_t uidSize;             // 4, 7 or 10
+    SimTagState state;
+    uint8_t level;               // Cascade level being resolved (1..3)
+};
+
+// RC522 with tags in its field. Answers arrive SIM_RESPONSE_US after the transceive starts,
+// a missing answer after RFID_FRAME_TIMEOUT_MS - like the real reader's timer.
+class SimReader : public ReaderPort {
+public:
+    void placeTag(const uint8_t* uid, uint8_t uidSize);
+    void clearField();
+
+    void startTransceive(const uint8_t* data, uint8_t length, uint8_t txLastBits, uint8_t rxAlign) override;
+    TransceiveResult pollTransceive(uint8_t* backData, uint8_t* backLen) override;
+    uint8_t collisionPosition() override;
+    void haltA() override;
+
+private:
+    void answerRequest();
+    void answerSelect(const uint8_t* data, uint8_t length);
+
+    std::mutex lock;             // The scenario places tags while the scanning task talks to them
+    std::vector<SimTag> tags;
+    TransceiveResult result = TRX_TIMEOUT;
+    uint8_t answer[5];
+    uint8_t answerLength = 0;
+    uint8_t collPos = 0;
+    unsigned long answerAt = 0;  // micros() when the answer (or timeout) is available
+};
+
+// 16x4 character buffer - the scenario prints it in the report
+class SimDisplay : public StationDisplay {
+public:
+    void clear() override;
+    void setCursor(uint8_t col, uint8_t row) override;
+    void print(const char* text) override;
+    std::string row(uint8_t index);
+
+private:
+    std::mutex lock;
+    char rows[4][17] = {};
+    uint8_t cursorCol = 0;
+    uint8_t cursorRow = 0;
+};
+
+// Buttons pressed by the scenario for a given time
+class SimButtons : public StationButtons {
+public:
+    void press(StationButton button, unsigned long durationMs);
+    bool isPressed(StationButton button) override;
+
+private:
+    std::atomic<unsigned long> pressedUntil[4] = {};
+};
+
+class SimBuzzer : public Buzzer {
+public:
+    void set(bool on) override { beeps += on ? 1 : 0; }
+    std::atomic<uint32_t> beeps{0};
+};
+
+// Host wall clock - always synchronized
+class HostClock : public Clock {
+public:
+    uint64_t monotonicUs() override;
+    uint32_t cycles() override;
+
+    // What an SNTP server would answer - the host's wall clock in ms
+    static uint64_t unixMs();
+};
+
+// NOR flash: writes can only clear bits, erase sets a whole sector back to 0xFF, both take time.
+// Backed by a memory-mapped file if one is given, so the journal survives killing the simulator.
+class SimFlash : public FlashRegion {
+public:
+    bool begin(uint32_t sizeBytes, const char* path);
+
+    uint32_t size() override { return regionSize; }
+    uint32_t sectorSize() override { return 4096; }
+    bool read(uint32_t offset, void* data, uint32_t length) override;
+    bool write(uint32_t offset, const void* data, uint32_t length) override;
+    bool eraseSector(uint32_t offset) override;
+
+private:
+    uint8_t* memory = nullptr;
+    uint32_t regionSize = 0;
+};
+
+// NVS stand-in: key/value lines in a file if one is given (next to the journal file), else in memory
+class SimSettings : public SettingsStore {
+public:
+    void begin(const char* path);
+    bool readU32(const char* key, uint32_t& value) override;
+    bool writeU32(const char* key, uint32_t value) override;
+
+private:
+    std::string filePath;
+    std::map<std::string, uint32_t> values;
+};
+
+// In-process server: decodes JSON or binary uploads, counts records and measures tag-placed -> record-sent latency.
+// Acks each batch after ackDelayMs (selective seq + cumulative), and can drop whole frames to exercise retransmits.
+class SinkTransport : public Transport {
+public:
+    void expect(const std::string& tagUid, unsigned long placedAtUs);   // placedAtUs 0: count it, but no latency sample
+    void expectDefect(const std::string& tagUid, unsigned long loggedAtUs);
+    bool connected() override;
+    bool networkUp() override { return online; }
+    WireFormat wireFormat() override { return helloAnswered() ? format : WIRE_JSON; }
+    bool serverAcks() override { return acks && helloAnswered(); }
+    bool helloAnswered() override;
+    bool sendText(const char* payload, size_t length) override;
+    bool sendBinary(const uint8_t* payload, size_t length) override;
+    bool sendPing(uint32_t token) override;
+    void reconnect() override;
+
+    WireFormat format = WIRE_BINARY;               // What the server answers to the hello
+    bool acks = true;
+    long helloDelayMs = 0;                         // Hello answered this long after each connect (-1 = never)
+    unsigned long ackDelayMs = 20;                 // Server round trip
+    int losePercent = 0;                           // Frames lost on the way (never saved, never acked)
+    void seed(unsigned int value) { random.seed(value); }
+
+    // Hand due acks and pongs to the pipeline - call from the uplink task, like the board's WebSocket loop
+    void deliverAcks();
+
+    // Back ends behind the endpoint list (endpoints.h), simulated here rather than run as rfidWebSocket.js
+    // processes. They share one database, like redundant back ends, so a batch may go to any of them; the
+    // connection always goes to endpointCurrent().
+    struct Server {
+        std::atomic<unsigned long> downFromMs{0};  // Unreachable from this millis() ...
+        std::atomic<unsigned long> downUntilMs{0}; // ... until this one (both 0 = always up)
+        unsigned long ackDelayMs = 0;              // Overloaded: answers this slowly (0 = the common ackDelayMs)
+        std::atomic<uint32_t> records{0};          // Records saved through this server
+    };
+    Server servers[ENDPOINT_MAX];
+    bool serverUp(uint8_t index);
+
+    // Half-open connection: from this millis() on, frames and pings vanish while connected() stays true,
+    // until the device reconnects or TCP gives up after tcpTimeoutMs (0 = never goes half-open)
+    std::atomic<unsigned long> halfOpenAtMs{0};
+    unsigned long tcpTimeoutMs = 60000;
+    std::atomic<unsigned long> halfOpenEndedAtMs{0};   // Reconnect (or TCP timeout) that ended it
+    std::atomic<unsigned long> recoveredAtMs{0};       // First record saved after that
+    std::atomic<uint32_t> voidFrames{0};               // Upload frames sent into the dead connection
+    std::atomic<bool> endedByPing{false};
+
+    std::atomic<bool> online{true};
+    std::atomic<unsigned long> offlineUntilMs{0};  // Simulated outage until this millis()
+    std::atomic<uint32_t> messages{0};
+    std::atomic<uint32_t> records{0};
+    std::atomic<uint32_t> expectedRecords{0};      // Records for tags placed in this run
+    std::atomic<uint64_t> bytes{0};
+    std::vector<unsigned long> latenciesUs();
+    std::vector<unsigned long> defectLatenciesUs();
+
+    std::atomic<uint32_t> badFrames{0};
+    std::atomic<uint32_t> lostFrames{0};
+    std::atomic<uint32_t> duplicateRecords{0};     // Records received again (retransmitted after a lost ack)
+    std::atomic<uint32_t> idCollisions{0};         // Scan IDs the server saw on two different tags
+    std::atomic<uint32_t> zeroTimestamps{0};       // Records saved without a time
+
+private:
+    struct PendingAck {
+        unsigned long dueAt;
+        uint32_t seq;
+        uint32_t cumulative;
+    };
+
+    void received(const std::string& tagUid, const std::string& scanId, uint32_t timestamp, unsigned long sentAt);
+    bool frameLost();
+    void batchSaved(uint32_t seq, uint32_t oldest);
+
+    std::mt19937 random;
+    struct PendingPong {
+        unsigned long dueAt;
+        uint32_t token;
+    };
+
+    bool halfOpen();
+
+    std::vector<PendingAck> pendingAcks;
+    std::vector<PendingPong> pendingPongs;
+    std::set<uint32_t> savedSeqs;                  // Saved out of order, past nextSeq
+    uint32_t nextSeq = 0;                          // Lowest batch not known to be saved
+    std::set<std::string> seenUids;
+    std::map<std::string, std::string> scanIdOwners; // Scan ID -> tag it was first seen on
+
+    std::mutex lock;
+    std::map<std::string, unsigned long> placedAt;
+    std::vector<unsigned long> latencies;
+    std::set<std::string> defectUids;              // Timed into defectLatencies instead
+    std::vector<unsigned long> defectLatencies;
+};
+
+// Heap allocations (operator new) made by the calling thread between start and stop - the scan path must make none
+void allocCountStart();
+uint32_t allocCountStop();
+
+// Heap bytes the calling thread allocated and has not freed since start: the most at any point, and at stop.
+// Freeing older blocks counts too, so both can end up below zero.
+void heapTrackStart();
+void heapTrackStop(long& peakBytes, long& liveBytes);
+
+// HTTP API of the simulated back ends: answers the defect definitions request with body, the response
+// trickling in evenly over answerMs (a slow or overloaded server). Used from the uplink task only.
+class SimDefinitionsServer : public HttpConnection {
+public:
+    bool connect(const char* host, uint16_t port) override;
+    size_t write(const char* data, size_t length) override { return length; }
+    int available() override;
+    int read(uint8_t* buffer, size_t length) override;
+    bool connected() override;
+    void stop() override { open = false; }
+
+    std::string body;
+    unsigned long answerMs = 0;
+    uint32_t requests = 0;
+
+private:
+    std::string response;
+    size_t sent = 0;
+    unsigned long openedAt = 0;
+    bool open = false;
+};
+
+#endif
@@ -0,0 +1,951 @@
+// Native simulator: runs the scan pipeline (src/pipeline.cpp) against simulated readers and a local sink,
+// logs employees in, drops tag bundles on the sewing stations and reports throughput and latency.
+//
+//   pio run -e native && .pio/build/native/program --rounds 10 --bundle 8
+//
+// Exits non-zero if a tag was not delivered (or p95 latency exceeds --max-p95-ms), so CI can gate on it.
+#include <Arduino.h>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <unistd.h>
+#include "journal.h"
+#include "lanes.h"
+#include "logger.h"
+#include "pipeline.h"
+#include "scanid.h"
+#include "timesync.h"
+#include "endpoints.h"
+#include "defparse.h"
+#include "deffetch.h"
+#include "sim_hal.h"
+#include "wire.h"
+
+const uint32_t SIM_DEVICE_ID = 0x5C1A70;         // Stands in for the NIC half of the board's MAC
+
+// Endpoint table for --endpoints - the back ends are simulated in-process by SinkTransport, nothing listens here
+const IngestEndpoint SIM_ENDPOINTS[ENDPOINT_MAX] = {
+    {"127.0.0.1", 8000, 8001},
+    {"127.0.0.1", 8100, 8101},
+    {"127.0.0.1", 8200, 8201},
+    {"127.0.0.1", 8300, 8301},
+};
+
+struct SimOptions {
+    int rounds = 5;                  // Bundles dropped per sewing station
+    int bundleSize = 8;              // Tags per bundle (max INVENTORY_MAX_TAGS)
+    unsigned long dwellMs = 500;     // How long a bundle stays on the reader
+    unsigned long gapMs = 1500;      // Pause between bundles
+    int sevenBytePercent = 50;       // Share of 7-byte UIDs (the rest are 4-byte)
+    int defects = 0;                 // QC defects logged while the bundles are scanned
+    unsigned long maxP95Ms = 0;      // Fail if p95 latency is above this (0 = no limit)
+    unsigned long offlineMs = 0;     // Server unreachable for this long after the first bundle
+    long ntpDelayMs = -1;            // SNTP answers this long after the first bundle (-1: synced before the run)
+    uint32_t journalKb = 256;        // Flash journal size (0 = RAM queue only, like a board without the partition)
+    const char* journalFile = nullptr; // Keep the journal in this file across runs
+    WireFormat wire = WIRE_BINARY;   // Upload format the sink accepts at connect
+    bool acks = true;                // Server acks batches (off = older back end, fire-and-forget)
+    long defsMs = -1;                // Fetch the defect definitions over and over during the run from a server this slow (-1: no fetch)
+    long helloMs = 0;                // Server answers the hello this long after connecting (-1: never, older back end)
+    unsigned long ackDelayMs = 20;   // Server round trip
+    int losePercent = 0;             // Upload frames lost on the way
+    unsigned long halfOpenAtMs = 0;  // Connection goes half-open this long after the first bundle (0 = never)
+    unsigned long tcpTimeoutMs = 60000; // ...and TCP notices on its own after this
+    long pingMs = -1;                // Liveness ping interval (-1: firmware default, 0: off)
+    long pongTimeoutMs = -1;
+    uint8_t endpoints = 1;           // Simulated back ends (endpoints.h)
+    struct Outage {
+        uint8_t endpoint;
+        unsigned long fromMs, toMs;  // After the first bundle
+    };
+    std::vector<Outage> outages;     // Back ends that are down for a while
+    unsigned long slowMs[ENDPOINT_MAX] = {0}; // Back ends that answer this slowly (overloaded)
+    uint32_t deviceId = SIM_DEVICE_ID; // Picks the home endpoint
+    int benchWire = 0;               // Only compare the JSON and binary encoders, this many batches each
+    int benchScan = 0;               // Only push this many tags through the station scan path, counting allocations
+    int benchDefs = 0;               // Only parse defect definition sets of up to this many types, measuring heap
+    unsigned int seed = 1;
+    bool verbose = false;            // Show the firmware's serial log
+};
+
+SimReader simReaders[STATION_COUNT];
+SimDisplay simDisplays[STATION_COUNT];
+SimButtons simButtons[STATION_COUNT];
+SimBuzzer simBuzzer;
+HostClock hostClock;
+SinkTransport sinkTransport;
+SimFlash simFlash;
+SimSettings simSettings;
+std::atomic<unsigned long> ntpDueAtMs{0};        // millis() when the simulated SNTP server first answers (0 = never)
+SimDefinitionsServer simDefinitions;
+std::atomic<bool> definitionsFetching{false};    // Fetch the defect definitions again as soon as a fetch ends
+std::atomic<uint32_t> definitionsLoads{0};
+std::atomic<uint32_t> definitionsFailures{0};
+std::atomic<unsigned long> definitionsMaxMs{0};  // Longest fetch
+
+
+// Stands in for the firmware's Core 0 connectivity loop: acks in, a step of the definitions fetch if one runs,
+// one queue drain every 100ms (10ms while the definitions come in)
+void uplinkTask(void *parameter) {
+    unsigned long fetchStarted = 0;
+    while (true) {
+        if (ntpDueAtMs != 0 && millis() >= ntpDueAtMs && timeSyncState() == TIME_UNSYNCED) {
+            timeSyncSet(HostClock::unixMs());
+        }
+        sinkTransport.deliverAcks();
+        if (definitionsFetching && !defectFetchRunning()) {
+            const IngestEndpoint& endpoint = endpointAt(endpointCurrent());
+            fetchStarted = millis();
+            if (!defectFetchStart(&simDefinitions, endpoint.host, endpoint.httpPort, false)) {
+                definitionsFailures++;
+            }
+        }
+        if (defectFetchRunning()) {
+            DefectFetchState state = defectFetchStep();
+            if (state == FETCH_LOADED) {
+                definitionsLoads++;
+            } else if (state != FETCH_RUNNING) {
+                definitionsFailures++;
+            }
+            if (state != FETCH_RUNNING && millis() - fetchStarted > definitionsMaxMs) {
+                definitionsMaxMs = millis() - fetchStarted;
+            }
+        }
+        drainScanQueue();
+        vTaskDelay(pdMS_TO_TICKS(defectFetchRunning() ? 10 : 100));
+    }
+}
+
+static void usage(const char* program) {
+    printf("Usage: %s [--rounds N] [--bundle N] [--dwell-ms MS] [--gap-ms MS] [--seven-byte-percent P]\n"
+           "          [--defects N] [--max-p95-ms MS] [--offline-ms MS] [--ntp-delay-ms MS] [--journal-kb KB]\n"
+           "          [--journal-file PATH] [--wire json|binary] [--no-acks] [--hello-ms MS] [--ack-delay-ms MS]\n"
+           "          [--lose-percent P] [--half-open-at-ms MS] [--tcp-timeout-ms MS] [--ping-ms MS] [--pong-timeout-ms MS]\n"
+           "          [--endpoints N] [--down E:FROM_MS:TO_MS] [--slow E:MS] [--device-id HEX]\n"
+           "          [--defs-ms MS] [--bench-wire BATCHES] [--bench-scan TAGS] [--bench-defs TYPES] [--seed N]\n"
+           "          [--verbose]\n", program);
+}
+
+static bool parseOptions(int argc, char** argv, SimOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        String arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--verbose") {
+            options.verbose = true;
+        } else if (arg == "--defects" && hasValue) {
+            options.defects = atoi(argv[++i]);
+        } else if (arg == "--rounds" && hasValue) {
+            options.rounds = atoi(argv[++i]);
+        } else if (arg == "--bundle" && hasValue) {
+            options.bundleSize = atoi(argv[++i]);
+        } else if (arg == "--dwell-ms" && hasValue) {
+            options.dwellMs = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--gap-ms" && hasValue) {
+            options.gapMs = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--seven-byte-percent" && hasValue) {
+            options.sevenBytePercent = atoi(argv[++i]);
+        } else if (arg == "--max-p95-ms" && hasValue) {
+            options.maxP95Ms = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--offline-ms" && hasValue) {
+            options.offlineMs = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--ntp-delay-ms" && hasValue) {
+            options.ntpDelayMs = strtol(argv[++i], nullptr, 10);
+        } else if (arg == "--journal-kb" && hasValue) {
+            options.journalKb = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--journal-file" && hasValue) {
+            options.journalFile = argv[++i];
+        } else if (arg == "--wire" && hasValue) {
+            String format = argv[++i];
+            if (format != "json" && format != "binary") {
+                return false;
+            }
+            options.wire = format == "json" ? WIRE_JSON : WIRE_BINARY;
+        } else if (arg == "--no-acks") {
+            options.acks = false;
+        } else if (arg == "--defs-ms" && hasValue) {
+            options.defsMs = strtol(argv[++i], nullptr, 10);
+        } else if (arg == "--hello-ms" && hasValue) {
+            options.helloMs = strtol(argv[++i], nullptr, 10);
+        } else if (arg == "--ack-delay-ms" && hasValue) {
+            options.ackDelayMs = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--lose-percent" && hasValue) {
+            options.losePercent = atoi(argv[++i]);
+        } else if (arg == "--half-open-at-ms" && hasValue) {
+            options.halfOpenAtMs = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--tcp-timeout-ms" && hasValue) {
+            options.tcpTimeoutMs = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--ping-ms" && hasValue) {
+            options.pingMs = strtol(argv[++i], nullptr, 10);
+        } else if (arg == "--pong-timeout-ms" && hasValue) {
+            options.pongTimeoutMs = strtol(argv[++i], nullptr, 10);
+        } else if (arg == "--endpoints" && hasValue) {
+            options.endpoints = atoi(argv[++i]);
+        } else if (arg == "--down" && hasValue) {
+            // E:FROM:TO - endpoint letter, outage from..to ms after the first bundle
+            SimOptions::Outage outage;
+            char letter;
+            if (sscanf(argv[++i], "%c:%lu:%lu", &letter, &outage.fromMs, &outage.toMs) != 3 || outage.toMs <= outage.fromMs) {
+                return false;
+            }
+            outage.endpoint = toupper(letter) - 'A';
+            options.outages.push_back(outage);
+        } else if (arg == "--slow" && hasValue) {
+            char letter;
+            unsigned long ms;
+            if (sscanf(argv[++i], "%c:%lu", &letter, &ms) != 2 || toupper(letter) - 'A' >= ENDPOINT_MAX || toupper(letter) < 'A') {
+                return false;
+            }
+            options.slowMs[toupper(letter) - 'A'] = ms;
+        } else if (arg == "--device-id" && hasValue) {
+            options.deviceId = strtoul(argv[++i], nullptr, 16) & SCAN_ID_DEVICE_MASK;
+        } else if (arg == "--bench-wire" && hasValue) {
+            options.benchWire = atoi(argv[++i]);
+        } else if (arg == "--bench-scan" && hasValue) {
+            options.benchScan = atoi(argv[++i]);
+        } else if (arg == "--bench-defs" && hasValue) {
+            options.benchDefs = atoi(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = strtoul(argv[++i], nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    if (options.bundleSize < 1 || options.bundleSize > INVENTORY_MAX_TAGS || options.rounds < 1) {
+        return false;
+    }
+    if (options.endpoints < 1 || options.endpoints > ENDPOINT_MAX) {
+        return false;
+    }
+    for (const SimOptions::Outage& outage : options.outages) {
+        if (outage.endpoint >= options.endpoints) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Same format as the pipeline's uidToString()
+static std::string uidHex(const uint8_t* uid, uint8_t uidSize) {
+    char text[21];
+    for (uint8_t i = 0; i < uidSize; i++) {
+        snprintf(&text[i * 2], 3, "%02X", uid[i]);
+    }
+    return std::string(text, uidSize * 2);
+}
+
+static uint8_t parseUid(const char* hex, uint8_t* uid) {
+    uint8_t size = 0;
+    for (; hex[0] != '\0' && hex[1] != '\0' && size < 10; hex += 2) {
+        char byteText[3] = {hex[0], hex[1], '\0'};
+        uid[size++] = (uint8_t)strtoul(byteText, nullptr, 16);
+    }
+    return size;
+}
+
+static void sleepMs(unsigned long ms) {
+    usleep(ms * 1000);
+}
+
+// Wait until a condition holds, false on timeout
+template <typename Condition>
+static bool waitUntil(unsigned long timeoutMs, Condition condition) {
+    unsigned long started = millis();
+    while (!condition()) {
+        if (millis() - started >= timeoutMs) {
+            return false;
+        }
+        sleepMs(10);
+    }
+    return true;
+}
+
+// Badge in at a station and confirm the shift start with OK
+static bool loginEmployee(uint8_t stationNumber) {
+    uint8_t index = stationNumber - 1;
+    uint8_t uid[10];
+    uint8_t uidSize = parseUid(STATIONS[index].employeeUID, uid);
+    
+    simReaders[index].placeTag(uid, uidSize);
+    bool prompted = waitUntil(2000, [index] { return stationState[index] == WAITING_START_CONFIRMATION; });
+    simReaders[index].clearField();
+    if (!prompted) {
+        return false;
+    }
+    simButtons[index].press(BUTTON_OK, 200);
+    return waitUntil(2000, [index] { return stationState[index] == ACTIVE_SCANNING; });
+}
+
+// Random tag UID; 0x88 is reserved for the cascade tag: UID0 of a 4-byte UID, UID3 of a 7-byte one (ISO 14443-3)
+static uint8_t randomUid(std::mt19937& random, int sevenBytePercent, uint8_t* uid) {
+    uint8_t uidSize = (int)(random() % 100) < sevenBytePercent ? 7 : 4;
+    for (uint8_t b = 0; b < uidSize; b++) {
+        uid[b] = (uint8_t)random();
+    }
+    uint8_t first = uidSize == 4 ? 0 : 3;
+    if (uid[first] == PICC_CASCADE_TAG) {
+        uid[first] = 0x08;
+    }
+    return uidSize;
+}
+
+// Log a defect at the QC station: product tag on the reader, then OK through section, type and subtype
+static bool logDefect(const uint8_t* uid, uint8_t uidSize) {
+    uint8_t index = qcStationNumber - 1;
+    uint32_t before = stationScanCount[index];
+    
+    simReaders[index].placeTag(uid, uidSize);
+    bool prompted = waitUntil(4000, [] { return qcInPartsSelection; });
+    simReaders[index].clearField();
+    if (!prompted) {
+        return false;
+    }
+    for (int step = 0; step < 3; step++) {
+        sleepMs(300);
+        if (step == 2) {
+            sinkTransport.expectDefect(uidHex(uid, uidSize), micros());   // The subtype OK logs it
+        }
+        simButtons[index].press(BUTTON_OK, 200);
+        sleepMs(300);
+    }
+    if (!waitUntil(6000, [index, before] { return stationScanCount[index] > before; })) {
+        return false;
+    }
+    // The station shows "Defect Logged!" before it reads the next tag
+    return waitUntil(4000, [index] { return stationState[index] == ACTIVE_SCANNING && !qcInPartsSelection; });
+}
+
+static unsigned long percentile(std::vector<unsigned long>& sorted, int percent) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t rank = (sorted.size() * percent + 99) / 100;
+    return sorted[rank == 0 ? 0 : rank - 1];
+}
+
+// Encode the same full batch with both formats and compare size and encode time
+static int benchWireFormats(int batches, unsigned int seed) {
+    std::mt19937 random(seed);
+    ScannedData records[UPLOAD_BATCH_MAX];
+    for (uint8_t i = 0; i < UPLOAD_BATCH_MAX; i++) {
+        ScannedData& data = records[i];
+        memset(&data, 0, sizeof(data));
+        data.timestamp = 1760000000 + i;
+        data.stationNumber = 1 + i % 2;
+        data.lineNumber = data.stationNumber;
+        data.uidSize = i % 2 ? 7 : 4;
+        for (uint8_t b = 0; b < data.uidSize; b++) {
+            data.uid[b] = (uint8_t)random();
+        }
+        scanIdFormat(scanIdNext(), data.scanID);
+        snprintf(data.stationID, sizeof(data.stationID), "A%u05", data.stationNumber);
+        data.kind = EVENT_SCAN;
+        if (i % 8 == 7) {
+            // Every eighth record is a QC defect
+            data.kind = EVENT_DEFECT;
+            data.defectSection = i % 4;
+            data.defectType = 1;
+            data.defectSubtype = 5;
+        }
+    }
+    
+    static char jsonFrame[UPLOAD_BUFFER_SIZE];
+    static uint8_t binaryFrame[UPLOAD_BUFFER_SIZE];
+    size_t jsonLength = 0;
+    size_t binaryLength = 0;
+    
+    unsigned long started = micros();
+    allocCountStart();
+    for (int i = 0; i < batches; i++) {
+        jsonLength = encodeScanBatchJson(i + 1, i + 1, records, UPLOAD_BATCH_MAX, jsonFrame, sizeof(jsonFrame));
+    }
+    uint32_t jsonAllocs = allocCountStop();
+    unsigned long jsonUs = micros() - started;
+    
+    started = micros();
+    allocCountStart();
+    for (int i = 0; i < batches; i++) {
+        binaryLength = wireEncodeScanBatch(i + 1, i + 1, records, UPLOAD_BATCH_MAX, binaryFrame, sizeof(binaryFrame));
+    }
+    uint32_t binaryAllocs = allocCountStop();
+    unsigned long binaryUs = micros() - started;
+    
+    ScannedData decoded[UPLOAD_BATCH_MAX];
+    bool roundTrip = wireDecodeScanBatch(binaryFrame, binaryLength, decoded, UPLOAD_BATCH_MAX) == UPLOAD_BATCH_MAX;
+    for (uint8_t i = 0; roundTrip && i < UPLOAD_BATCH_MAX; i++) {
+        roundTrip = decoded[i].timestamp == records[i].timestamp && decoded[i].uidSize == records[i].uidSize &&
+                    decoded[i].kind == records[i].kind && decoded[i].defectSection == records[i].defectSection &&
+                    decoded[i].defectType == records[i].defectType && decoded[i].defectSubtype == records[i].defectSubtype &&
+                    memcmp(decoded[i].uid, records[i].uid, records[i].uidSize) == 0 &&
+                    strcmp(decoded[i].scanID, records[i].scanID) == 0 && strcmp(decoded[i].stationID, records[i].stationID) == 0;
+    }
+    
+    double scans = (double)batches * UPLOAD_BATCH_MAX;
+    printf("Wire formats, %d batch(es) of %u scans (half 4-byte, half 7-byte UIDs, 1 in 8 a defect):\n", batches, UPLOAD_BATCH_MAX);
+    printf("JSON:              %5.1f bytes/scan | %6.2f us/scan encode | %lu allocations\n",
+           (double)jsonLength / UPLOAD_BATCH_MAX, jsonUs / scans, (unsigned long)jsonAllocs);
+    printf("Binary:            %5.1f bytes/scan | %6.2f us/scan encode | %lu allocations\n",
+           (double)binaryLength / UPLOAD_BATCH_MAX, binaryUs / scans, (unsigned long)binaryAllocs);
+    printf("Binary round trip: %s\n", roundTrip ? "OK" : "MISMATCH");
+    return jsonLength > 0 && binaryLength > 0 && roundTrip && jsonAllocs == 0 && binaryAllocs == 0 ? 0 : 1;
+}
+
+static uint64_t threadCpuNs() {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// Push tags through the station scan path (duplicate check, count, LCD, scan ID, lane) on the first sewing station,
+// as bundles and as single scans. Counts heap allocations and CPU time - sleeps (the beep) do not count.
+static int benchScanPath(int tags, const SimOptions& options) {
+    uint8_t index = 0;
+    while (index < STATION_COUNT && STATIONS[index].kind != STATION_SEWING) {
+        index++;
+    }
+    if (index == STATION_COUNT) {
+        printf("!! No sewing station to benchmark\n");
+        return 1;
+    }
+    stationActive[index] = true;
+    stationEmployee[index] = STATIONS[index].employeeName;
+    stationState[index] = ACTIVE_SCANNING;
+    
+    std::mt19937 random(options.seed);
+    auto fillBatch = [&](CardBatch& batch, uint8_t count) {
+        batch.count = count;
+        for (uint8_t i = 0; i < count; i++) {
+            uint8_t uid[7];
+            batch.cards[i].uidSize = randomUid(random, options.sevenBytePercent, uid);
+            memcpy(batch.cards[i].uid, uid, batch.cards[i].uidSize);
+        }
+    };
+    
+    // Warm up once - first-use allocations (stdout buffer, statics) are not per scan
+    CardBatch batch;
+    fillBatch(batch, INVENTORY_MAX_TAGS);
+    processScannedBundle(batch, index + 1);
+    
+    uint32_t bundleTags = 0;
+    uint32_t bundleAllocs = 0;
+    uint64_t bundleNs = 0;
+    while ((int)bundleTags < tags) {
+        fillBatch(batch, INVENTORY_MAX_TAGS);
+        uint64_t started = threadCpuNs();
+        allocCountStart();
+        processScannedBundle(batch, index + 1);
+        bundleAllocs += allocCountStop();
+        bundleNs += threadCpuNs() - started;
+        bundleTags += batch.count;
+        logDrain(LOG_RING_SIZE);               // The firmware drains on Core 0 - keep the ring from filling up
+    }
+    
+    const int singles = 10;                    // Each one beeps for 100 ms
+    uint32_t singleAllocs = 0;
+    uint64_t singleNs = 0;
+    for (int i = 0; i < singles; i++) {
+        fillBatch(batch, 1);
+        uint64_t started = threadCpuNs();
+        allocCountStart();
+        processScannedCard(batch.cards[0], index + 1);
+        singleAllocs += allocCountStop();
+        singleNs += threadCpuNs() - started;
+        logDrain(LOG_RING_SIZE);
+    }
+    
+    printf("Scan path on %s, %lu tags in bundles of %u and %d single scans (logs compiled up to %s):\n",
+           STATIONS[index].shortName, (unsigned long)bundleTags, INVENTORY_MAX_TAGS, singles,
+           logLevelName(LOG_COMPILE_LEVEL));
+    printf("Bundles:           %5.2f allocations/tag  | %7.2f us CPU/tag\n",
+           (double)bundleAllocs / bundleTags, bundleNs / 1000.0 / bundleTags);
+    printf("Single scans:      %5.2f allocations/scan | %7.2f us CPU/scan\n",
+           (double)singleAllocs / singles, singleNs / 1000.0 / singles);
+    printf("Lane handoff:      %7.2f us avg | %7.2f us max (event + lane + log line)\n",
+           scanCost.scans ? scanCost.cycles / 1000.0 / scanCost.scans : 0.0, scanCost.maxCycles / 1000.0);
+    if (bundleAllocs > 0 || singleAllocs > 0) {
+        printf("!! FAIL: the scan path allocated from the heap\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
+
+// A definitions body shaped like the server's, with sections and types each, subtypes per type, and an ignored
+// description of describeBytes characters on every entry
+static std::string definitionsJson(int sections, int types, int subtypes, int describeBytes) {
+    std::string description = describeBytes > 0 ? ",\"description\":\"" + std::string(describeBytes, 'd') + "\"" : "";
+    char entry[96];
+    std::string json = "{\"version\":\"bench-" + std::to_string(types) + "\",\"lastUpdated\":\"2026-10-17T08:00:00.000Z\",";
+    json += "\"sections\":[";
+    for (int i = 0; i < sections; i++) {
+        snprintf(entry, sizeof(entry), "%s{\"code\":%d,\"name\":\"Section_%03d_Front_Panel\"", i ? "," : "", i, i);
+        json += entry + description + "}";
+    }
+    json += "],\"types\":[";
+    int code = 0;
+    for (int i = 0; i < types; i++) {
+        snprintf(entry, sizeof(entry), "%s{\"code\":%d,\"name\":\"Type_%03d_Stitching\"", i ? "," : "", i, i);
+        json += entry + description + ",\"subtypes\":[";
+        for (int j = 0; j < subtypes; j++, code++) {
+            snprintf(entry, sizeof(entry), "%s{\"code\":%d,\"name\":\"Subtype_%03d_Open_Seam\"", j ? "," : "", code, code);
+            json += entry + description + "}";
+        }
+        json += "]}";
+    }
+    json += "],\"metadata\":{\"totalSections\":" + std::to_string(sections) + ",\"totalTypes\":" + std::to_string(types) +
+            ",\"totalSubtypes\":" + std::to_string(code) + "}}";
+    return json;
+}
+
+// Parse body into parser, chunk bytes at a time as the socket would hand them over
+static bool parseDefinitions(DefectParser& parser, const std::string& body, size_t chunk) {
+    defectParserBegin(parser);
+    for (size_t at = 0; at < body.size(); at += chunk) {
+        if (!defectParserFeed(parser, body.data() + at, std::min(chunk, body.size() - at))) {
+            return false;
+        }
+    }
+    return defectParserEnd(parser);
+}
+
+// The parsed set matches what definitionsJson wrote
+static bool definitionsMatch(const DefectParser& parser, int sections, int types, int subtypes) {
+    if (parser.sectionCount != sections || parser.typeCount != types) {
+        return false;
+    }
+    char name[40];
+    for (int i = 0; i < sections; i++) {
+        snprintf(name, sizeof(name), "Section_%03d_Front_Panel", i);
+        if (parser.sections[i].code != i || !(parser.sections[i].name == name)) {
+            return false;
+        }
+    }
+    int code = 0;
+    for (int i = 0; i < types; i++) {
+        snprintf(name, sizeof(name), "Type_%03d_Stitching", i);
+        if (parser.types[i].code != i || !(parser.types[i].name == name) || parser.types[i].subtypeCount != subtypes) {
+            return false;
+        }
+        for (int j = 0; j < subtypes; j++, code++) {
+            snprintf(name, sizeof(name), "Subtype_%03d_Open_Seam", code);
+            if (parser.types[i].subtypes[j].code != code || !(parser.types[i].subtypes[j].name == name)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Parse definition sets from the server's size up to maxTypes types and 256 subtypes, fed in TCP-segment chunks.
+// Reports time, allocations and the heap the parse needs at its peak next to what the parsed set keeps (the old
+// fetch held the body twice in Strings and then built a JsonDocument on top), and checks the rejections.
+static int benchDefectDefinitions(int maxTypes) {
+    const size_t chunk = 1460;
+    const int repeats = 200;
+    int types = std::min(maxTypes, DEFECT_MAX_TYPES);
+    int subtypes = DEFECT_MAX_SUBTYPES / types;
+    struct DefinitionSet {
+        const char* label;
+        int sections, types, subtypes, describeBytes;
+    } sets[] = {
+        {"Server today:", 4, 4, 4, 0},
+        {"Largest:", types, types, subtypes, 0},
+        {"With 200 B notes:", types, types, subtypes, 200},
+    };
+    
+    loadFallbackDefectDefinitions();           // A refresh replaces a loaded set - both are live at the peak
+    printf("Defect definitions, fed in %u-byte chunks (limits %d sections, %d types, %d subtypes, names %u chars):\n",
+           (unsigned)chunk, DEFECT_MAX_SECTIONS, DEFECT_MAX_TYPES, DEFECT_MAX_SUBTYPES, DEFECT_NAME_MAX);
+    bool ok = true;
+    DefectParser parser;
+    for (const DefinitionSet& set : sets) {
+        std::string body = definitionsJson(set.sections, set.types, set.subtypes, set.describeBytes);
+        
+        long peakBytes = 0, keptBytes = 0;
+        allocCountStart();
+        heapTrackStart();
+        bool parsed = parseDefinitions(parser, body, chunk);
+        heapTrackStop(peakBytes, keptBytes);
+        uint32_t allocs = allocCountStop();
+        bool match = parsed && definitionsMatch(parser, set.sections, set.types, set.subtypes);
+        defectParserFree(parser);
+        
+        uint64_t started = threadCpuNs();
+        for (int i = 0; i < repeats; i++) {
+            parseDefinitions(parser, body, chunk);
+            defectParserFree(parser);
+        }
+        double us = (threadCpuNs() - started) / 1000.0 / repeats;
+        
+        // Byte by byte, as a slow link might deliver it, must give the same set
+        match = match && parseDefinitions(parser, body, 1) && definitionsMatch(parser, set.sections, set.types, set.subtypes);
+        defectParserFree(parser);
+        
+        printf("%-18s %6lu bytes | %2d/%2d/%3d | %7.1f us (%5.1f MB/s) | %4lu allocations | heap %6ld peak, %6ld kept%s\n",
+               set.label, (unsigned long)body.size(), set.sections, set.types, set.types * set.subtypes, us,
+               body.size() / us, (unsigned long)allocs, peakBytes, keptBytes,
+               match ? "" : " MISMATCH");
+        ok = ok && match;
+    }
+    printf("Parser state:      %u bytes, fixed (the old fetch needed about 2x the body in Strings plus a JsonDocument)\n",
+           (unsigned)sizeof(DefectParser));
+    
+    // Long names are cut, not rejected
+    std::string longNames = definitionsJson(1, 1, 1, 0);
+    size_t name = longNames.find("Section_000");
+    longNames.insert(name, 40, 'L');
+    bool cut = parseDefinitions(parser, longNames, chunk) && parser.truncatedNames == 1 &&
+               parser.sections[0].name.length() == DEFECT_NAME_MAX;
+    defectParserFree(parser);
+    
+    // Rejected bodies leave the loaded set alone
+    String versionBefore = defectDefinitionsVersion;
+    int typesBefore = qcTypesCount;
+    auto rejects = [&](const std::string& body, DefectParseError expected) {
+        bool parsed = parseDefinitions(parser, body, chunk);
+        defectParserFree(parser);
+        return !parsed && parser.error == expected;
+    };
+    std::string full = definitionsJson(4, 4, 4, 0);
+    bool serverError = rejects("{\"error\":\"No active defect definitions found\",\"fallback\":" + full + "}",
+                               DEFPARSE_SERVER_ERROR);
+    bool tooMany = rejects(definitionsJson(1, DEFECT_MAX_TYPES + 1, 0, 0), DEFPARSE_TOO_MANY);
+    bool tooManySubtypes = rejects(definitionsJson(1, 2, DEFECT_MAX_SUBTYPES / 2 + 1, 0), DEFPARSE_TOO_MANY);
+    bool cutBody = rejects(full.substr(0, full.size() / 2), DEFPARSE_INCOMPLETE);
+    bool badCode = rejects("{\"sections\":[{\"code\":300,\"name\":\"Body\"}],\"types\":[]}", DEFPARSE_BAD_CODE);
+    bool notJson = rejects("<html>502 Bad Gateway</html>", DEFPARSE_SYNTAX);
+    bool kept = defectDefinitionsVersion == versionBefore && qcTypesCount == typesBefore;
+    printf("Rejected:          server error %s | over limits %s | cut body %s | bad code %s | HTML %s | loaded set kept %s\n",
+           serverError ? "OK" : "FAIL", tooMany && tooManySubtypes ? "OK" : "FAIL", cutBody ? "OK" : "FAIL",
+           badCode ? "OK" : "FAIL", notJson ? "OK" : "FAIL", kept ? "OK" : "FAIL");
+    printf("Long names:        %s\n", cut ? "cut, not rejected - OK" : "FAIL");
+    
+    ok = ok && cut && serverError && tooMany && tooManySubtypes && cutBody && badCode && notJson && kept;
+    printf("%s\n", ok ? "OK" : "!! FAIL");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    SimOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+    Serial.setQuiet(!options.verbose);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    logBegin();                                // As in setup() - before any task
+    if (options.benchWire > 0) {
+        return benchWireFormats(options.benchWire, options.seed);
+    }
+    if (options.benchDefs > 0) {
+        return benchDefectDefinitions(options.benchDefs);
+    }
+    sinkTransport.format = options.wire;
+    sinkTransport.acks = options.acks && options.helloMs >= 0;   // A back end without the hello has no acks either
+    sinkTransport.helloDelayMs = options.helloMs;
+    sinkTransport.ackDelayMs = options.ackDelayMs;
+    sinkTransport.losePercent = options.losePercent;
+    sinkTransport.tcpTimeoutMs = options.tcpTimeoutMs;
+    for (uint8_t i = 0; i < ENDPOINT_MAX; i++) {
+        sinkTransport.servers[i].ackDelayMs = options.slowMs[i];
+    }
+    if (options.pingMs >= 0) {
+        uploadPingIntervalMs = options.pingMs;
+    }
+    if (options.pongTimeoutMs >= 0) {
+        uploadPongTimeoutMs = options.pongTimeoutMs;
+    }
+    sinkTransport.seed(options.seed);
+    
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+        stationPorts[i].reader = &simReaders[i];
+        stationPorts[i].display = STATIONS[i].displayRows > 0 ? &simDisplays[i] : nullptr;
+        stationPorts[i].buttons = &simButtons[i];
+    }
+    buzzerPort = &simBuzzer;
+    clockPort = &hostClock;
+    timeSyncBegin(&hostClock);
+    transportPort = &sinkTransport;
+    
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+        displayStationMessage(i + 1, STATIONS[i].name, "Scan your card");
+    }
+    
+    loadFallbackDefectDefinitions();
+    if (!createPipelineQueues()) {
+        return 1;
+    }
+    if (options.journalKb > 0) {
+        if (!simFlash.begin(options.journalKb * 1024, options.journalFile) || !journalBegin(&simFlash)) {
+            printf("!! Could not set up a %lu KB journal\n", (unsigned long)options.journalKb);
+            return 1;
+        }
+        printf("Journal: %lu slots, %lu scans recovered from a previous run\n",
+               (unsigned long)journalStats.capacity, (unsigned long)journalStats.recovered);
+    }
+    // The boot epoch lives next to the journal file, so a rerun with the same file is a reboot
+    std::string settingsPath = options.journalFile != nullptr ? std::string(options.journalFile) + ".nvs" : "";
+    simSettings.begin(settingsPath.empty() ? nullptr : settingsPath.c_str());
+    scanIdBegin(options.deviceId, &simSettings);
+    endpointsBegin(SIM_ENDPOINTS, options.endpoints, options.deviceId);
+    if (options.benchScan > 0) {
+        return benchScanPath(options.benchScan, options);
+    }
+    startPipelineTasks();
+    TaskHandle_t uplinkTaskHandle;
+    xTaskCreatePinnedToCore(uplinkTask, "UplinkTask", 4096, NULL, 1, &uplinkTaskHandle, 0);
+    
+    // The scanning task waits 3s for the connectivity task at startup
+    sleepMs(3200);
+    
+    if (options.defects > 0 && (qcStationNumber == 0 || !loginEmployee(qcStationNumber))) {
+        printf("!! QC: employee login failed\n");
+        return 1;
+    }
+    
+    std::vector<uint8_t> sewingStations;
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+        if (STATIONS[i].kind != STATION_SEWING) {
+            continue;
+        }
+        if (!loginEmployee(i + 1)) {
+            printf("!! %s: employee login failed\n", STATIONS[i].name);
+            return 1;
+        }
+        sewingStations.push_back(i);
+    }
+    
+    printf("Simulating %d bundle(s) of %d tags on %d sewing station(s), dwell %lu ms, gap %lu ms\n",
+           options.rounds, options.bundleSize, (int)sewingStations.size(), options.dwellMs, options.gapMs);
+    if (options.defects > 0) {
+        printf("Logging %d QC defect(s) at the same time\n", options.defects);
+    }
+    
+    std::mt19937 random(options.seed);
+    uint32_t countedBefore[STATION_COUNT];
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+        countedBefore[i] = stationScanCount[i];
+    }
+    uint32_t qcBefore = qcStationNumber != 0 ? stationScanCount[qcStationNumber - 1] : 0;
+    uint32_t tagsPlaced = 0;
+    unsigned long runStarted = millis();
+    if (options.offlineMs > 0) {
+        sinkTransport.offlineUntilMs = runStarted + options.offlineMs;
+        printf("Server offline for the first %lu ms\n", options.offlineMs);
+    }
+    for (const SimOptions::Outage& outage : options.outages) {
+        SinkTransport::Server& server = sinkTransport.servers[outage.endpoint];
+        server.downFromMs = runStarted + outage.fromMs;
+        server.downUntilMs = runStarted + outage.toMs;
+        printf("Endpoint %c down from %lu to %lu ms\n", 'A' + outage.endpoint, outage.fromMs, outage.toMs);
+    }
+    if (options.halfOpenAtMs > 0) {
+        sinkTransport.halfOpenAtMs = runStarted + options.halfOpenAtMs;
+        printf("Connection goes half-open after %lu ms (TCP gives up after %lu ms, ping %lu ms)\n",
+               options.halfOpenAtMs, options.tcpTimeoutMs, (unsigned long)uploadPingIntervalMs);
+    }
+    if (options.defsMs >= 0) {
+        simDefinitions.body = definitionsJson(8, 12, 6, 64);
+        simDefinitions.answerMs = options.defsMs;
+        definitionsFetching = true;
+        printf("Defect definitions fetched again and again from a server answering in %ld ms (%lu bytes)\n", options.defsMs,
+               (unsigned long)simDefinitions.body.size());
+    }
+    if (options.ntpDelayMs >= 0) {
+        ntpDueAtMs = runStarted + options.ntpDelayMs + 1;
+        printf("SNTP answers after %ld ms\n", options.ntpDelayMs);
+    } else {
+        timeSyncSet(HostClock::unixMs());
+    }
+    
+    // The QC inspector logs defects one after another while the sewing stations scan
+    int defectsLogged = 0;
+    std::thread inspector([&options, &defectsLogged] {
+        std::mt19937 random(options.seed + 1);
+        for (int i = 0; i < options.defects; i++) {
+            uint8_t uid[7];
+            uint8_t uidSize = randomUid(random, options.sevenBytePercent, uid);
+            if (!logDefect(uid, uidSize)) {
+                printf("!! QC: defect %d was not logged\n", i + 1);
+                return;
+            }
+            defectsLogged++;
+        }
+    });
+    
+    // Each round drops one bundle on every sewing station at once
+    for (int round = 0; round < options.rounds; round++) {
+        for (uint8_t index : sewingStations) {
+            for (int t = 0; t < options.bundleSize; t++) {
+                uint8_t uid[7];
+                uint8_t uidSize = randomUid(random, options.sevenBytePercent, uid);
+                sinkTransport.expect(uidHex(uid, uidSize), micros());
+                simReaders[index].placeTag(uid, uidSize);
+                tagsPlaced++;
+            }
+        }
+        sleepMs(options.dwellMs);
+        for (uint8_t index : sewingStations) {
+            simReaders[index].clearField();
+        }
+        sleepMs(options.gapMs);
+    }
+    
+    inspector.join();
+    
+    // Let the upload queue drain (records recovered from an earlier run are sent too, but not counted here)
+    uint32_t expected = tagsPlaced + defectsLogged;
+    bool delivered = waitUntil(60000 + expected * 200UL + options.offlineMs + (options.halfOpenAtMs > 0 ? options.tcpTimeoutMs : 0),
+                               [&] { return sinkTransport.expectedRecords >= expected; });
+    // ...and the last acks come back (a lost frame only shows up after the ack timeout)
+    waitUntil(2 * UPLOAD_ACK_TIMEOUT_MS, [] { return uploadStats.inFlight == 0; });
+    definitionsFetching = false;
+    waitUntil(DEFECT_FETCH_TIMEOUT_MS, [] { return !defectFetchRunning(); });
+    float elapsed = (millis() - runStarted) / 1000.0f;
+    uint32_t records = sinkTransport.expectedRecords;
+    
+    uint32_t counted = 0;
+    for (uint8_t index : sewingStations) {
+        counted += stationScanCount[index] - countedBefore[index];
+    }
+    std::vector<unsigned long> latencies = sinkTransport.latenciesUs();
+    std::sort(latencies.begin(), latencies.end());
+    std::vector<unsigned long> defectLatencies = sinkTransport.defectLatenciesUs();
+    std::sort(defectLatencies.begin(), defectLatencies.end());
+    
+    printf("Tags placed:       %lu\n", (unsigned long)tagsPlaced);
+    printf("Tags counted:      %lu (", (unsigned long)counted);
+    for (size_t i = 0; i < sewingStations.size(); i++) {
+        uint8_t index = sewingStations[i];
+        printf("%s%s:%lu", i ? " " : "", STATIONS[index].shortName,
+               (unsigned long)(stationScanCount[index] - countedBefore[index]));
+    }
+    printf(")\n");
+    if (options.defects > 0) {
+        printf("Defects logged:    %d of %d (QC count +%lu, %lu uploaded)\n", defectsLogged, options.defects,
+               (unsigned long)(stationScanCount[qcStationNumber - 1] - qcBefore), (unsigned long)uploadStats.defects);
+    }
+    printf("Records sent:      %lu in %.1f s (%.1f records/s, %lu messages, %llu bytes)\n",
+           (unsigned long)records, elapsed, records / elapsed, (unsigned long)sinkTransport.messages,
+           (unsigned long long)sinkTransport.bytes);
+    printf("Latency (ms):      p50 %.1f | p95 %.1f | max %.1f (tag placed -> record sent)\n",
+           percentile(latencies, 50) / 1000.0, percentile(latencies, 95) / 1000.0,
+           latencies.empty() ? 0.0 : latencies.back() / 1000.0);
+    if (!defectLatencies.empty()) {
+        printf("Defect latency:    p50 %.1f | max %.1f ms (subtype OK -> record sent)\n",
+               percentile(defectLatencies, 50) / 1000.0, defectLatencies.back() / 1000.0);
+    }
+    printf("Reader polls/s:    ");
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+        printf("%s%s: %.1f", i ? " | " : "", STATIONS[i].shortName, readerSlots[i].pollsPerSecond);
+    }
+    printf("\nReader errors:     ");
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+        printf("%s%s: %lu/%lu", i ? " | " : "", STATIONS[i].shortName,
+               (unsigned long)readerSlots[i].collisionCount, (unsigned long)readerSlots[i].errorCount);
+    }
+    printf(" (collisions/errors)\nCards dropped:     ");
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+        printf("%s%s: %lu", i ? " | " : "", STATIONS[i].shortName, (unsigned long)stationCardDrops[i]);
+    }
+    printf("\nLanes:             ");
+    for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+        printf("%s%s: max %u/%lu, %lu dropped", lane ? " | " : "", laneName(lane), laneStats[lane].maxDepth,
+               (unsigned long)laneCapacity(lane), (unsigned long)laneStats[lane].dropped);
+    }
+    printf("\nLog:               level %s | %lu written | %lu dropped | max depth %lu/%u\n", logLevelName(logLevel),
+           (unsigned long)logStats.written, (unsigned long)logStats.dropped, (unsigned long)logStats.maxDepth,
+           LOG_RING_SIZE);
+    printf("Upload batches:    %lu (max %u records, %lu failed sends, %s, %.1f bytes/record)\n",
+           (unsigned long)uploadStats.batches, uploadStats.maxBatch, (unsigned long)uploadStats.failures,
+           options.wire == WIRE_BINARY ? "binary" : "JSON",
+           uploadStats.records ? (double)uploadStats.bytes / uploadStats.records : 0.0);
+    printf("Delivery:          acks %s | %lu acked | %lu retransmits | %lu frames lost | %lu duplicates | max ack %lu ms\n",
+           sinkTransport.acks ? "on" : "off", (unsigned long)uploadStats.acked, (unsigned long)uploadStats.retransmits,
+           (unsigned long)sinkTransport.lostFrames, (unsigned long)sinkTransport.duplicateRecords,
+           (unsigned long)uploadStats.maxAckMs);
+    printf("Liveness:          ping %lu ms | rtt avg %lu ms, max %lu ms | %lu dead links\n",
+           (unsigned long)uploadPingIntervalMs,
+           uploadStats.pongs ? (unsigned long)(uploadStats.rttTotalMs / uploadStats.pongs) : 0UL,
+           (unsigned long)uploadStats.maxRttMs, (unsigned long)uploadStats.deadLinks);
+    // Whatever the definitions server does, the uplink keeps answering pings - no dead link, no failover
+    bool definitionsFailover = options.defsMs >= 0 && options.halfOpenAtMs == 0 && options.outages.empty() &&
+                               (uploadStats.deadLinks > 0 || endpointStats.switches > 0);
+    if (options.defsMs >= 0) {
+        printf("Definitions:       %lu fetches loaded, %lu failed, max %lu ms (%d types, %lu bytes) | %lu dead links, %lu endpoint switches\n",
+               (unsigned long)definitionsLoads, (unsigned long)definitionsFailures, (unsigned long)definitionsMaxMs,
+               qcTypesCount, (unsigned long)defectRefreshStats.bytes, (unsigned long)uploadStats.deadLinks,
+               (unsigned long)endpointStats.switches);
+    }
+    if (endpointCount() > 1) {
+        printf("Endpoints:         ");
+        for (uint8_t i = 0; i < endpointCount(); i++) {
+            printf("%s%c%s: %lu records, %lu connects, %lu failures", i ? " | " : "", 'A' + i,
+                   i == endpointHome() ? " (home)" : "", (unsigned long)sinkTransport.servers[i].records,
+                   (unsigned long)endpointHealth[i].connects, (unsigned long)endpointHealth[i].failures);
+        }
+        printf(" | %lu switches, %lu back home, ended on %c\n", (unsigned long)endpointStats.switches,
+               (unsigned long)endpointStats.homeReturns, 'A' + endpointCurrent());
+    }
+    if (sinkTransport.halfOpenAtMs != 0) {
+        unsigned long deadAt = sinkTransport.halfOpenAtMs;
+        unsigned long endedAt = sinkTransport.halfOpenEndedAtMs;
+        unsigned long recoveredAt = sinkTransport.recoveredAtMs;
+        printf("Half-open link:    %s after %lu ms | first record saved again %lu ms after the link died | %lu frames into the void\n",
+               endedAt == 0 ? "never ended" : sinkTransport.endedByPing ? "missed pong" : "TCP timeout",
+               endedAt != 0 ? endedAt - deadAt : 0UL, recoveredAt != 0 ? recoveredAt - deadAt : 0UL,
+               (unsigned long)sinkTransport.voidFrames);
+    }
+    printf("Time:              %s | %lu backfilled | %lu unknown | %lu records saved without a time\n",
+           timeSyncStateName(timeSyncState()), (unsigned long)timeSyncStats.backfilled,
+           (unsigned long)timeSyncStats.unresolved, (unsigned long)sinkTransport.zeroTimestamps);
+    printf("Scan IDs:          device %06lX | epoch %u | %lu collisions\n", (unsigned long)scanIdDevice(), scanIdEpoch(),
+           (unsigned long)sinkTransport.idCollisions);
+    if (journalMounted()) {
+        printf("Journal:           %lu appended | %lu acked | %lu overwritten | %lu erases | max append %.1f ms\n",
+               (unsigned long)journalStats.appended, (unsigned long)journalStats.acked,
+               (unsigned long)journalStats.overwritten, (unsigned long)journalStats.erases,
+               journalStats.maxAppendUs / 1000.0);
+        // Mount again as after a reset - everything delivered must come back acknowledged
+        journalBegin(&simFlash);
+        printf("Journal remount:   %lu pending\n", (unsigned long)journalPending());
+    }
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+        if (stationPorts[i].display != nullptr) {
+            printf("LCD %-4s          [%s] [%s]\n", STATIONS[i].shortName,
+                   simDisplays[i].row(0).c_str(), simDisplays[i].row(1).c_str());
+        }
+    }
+    
+    int status = 0;
+    if (sinkTransport.badFrames > 0) {
+        printf("!! FAIL: %lu undecodable frames\n", (unsigned long)sinkTransport.badFrames);
+        status = 1;
+    } else if (sinkTransport.idCollisions > 0) {
+        printf("!! FAIL: %lu scan IDs reused for different tags\n", (unsigned long)sinkTransport.idCollisions);
+        status = 1;
+    } else if (sinkTransport.zeroTimestamps > 0 && timeSyncStats.unresolved == 0) {
+        printf("!! FAIL: %lu records sent without a time that was known\n", (unsigned long)sinkTransport.zeroTimestamps);
+        status = 1;
+    } else if (defectsLogged != options.defects || uploadStats.defects < (uint32_t)defectsLogged) {
+        printf("!! FAIL: %d of %d defects logged, %lu uploaded\n", defectsLogged, options.defects,
+               (unsigned long)uploadStats.defects);
+        status = 1;
+    } else if (!delivered || counted != tagsPlaced) {
+        printf("!! FAIL: %lu of %lu tags counted, %lu records delivered\n",
+               (unsigned long)counted, (unsigned long)tagsPlaced, (unsigned long)records);
+        status = 1;
+    } else if (options.defsMs >= 0 && (definitionsLoads == 0 || definitionsFailures > 0 || definitionsFailover)) {
+        printf("!! FAIL: defect definitions fetches %s\n",
+               definitionsFailover ? "dropped the upload connection" : "did not load the set");
+        status = 1;
+    } else if (options.maxP95Ms > 0 && percentile(latencies, 95) > options.maxP95Ms * 1000) {
+        printf("!! FAIL: p95 latency above %lu ms\n", options.maxP95Ms);
+        status = 1;
+    } else {
+        printf("OK\n");
+    }
+    
+    // The pipeline tasks never return - leave without running static destructors under them
+    fflush(stdout);
+    _exit(status);
+}
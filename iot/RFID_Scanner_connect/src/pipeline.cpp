@@ -0,0 +1,2381 @@
+#include "pipeline.h"
+#include "journal.h"
+#include "wire.h"
+#include "lanes.h"
+#include "logger.h"
+#include "scanid.h"
+#include "timesync.h"
+#include "endpoints.h"
+#include "defparse.h"
+#include <freertos/semphr.h>
+
+// Hardware bound by the platform (src/main.cpp on the ESP32, src/native/ on Linux)
+StationPorts stationPorts[STATION_COUNT];
+Buzzer* buzzerPort = nullptr;
+Clock* clockPort = nullptr;
+Transport* transportPort = nullptr;
+
+// Station number (1-based) of the QC station, 0 if the table has none
+uint8_t qcStationNumber = 0;
+
+// Individual station scan counters
+volatile uint32_t stationScanCount[STATION_COUNT] = {0};
+
+// Recently counted UIDs per station (duplicate scan prevention)
+RecentUidTable recentUids[STATION_COUNT];
+
+// Station access control - tracks which employee is logged in to each station
+bool stationActive[STATION_COUNT] = {false};
+String stationEmployee[STATION_COUNT];
+volatile ShiftState stationState[STATION_COUNT] = {WAITING_FOR_CARD};
+
+// Dynamic defect configuration variables
+DefectSection* qcSections = nullptr;
+int qcSectionsCount = 0;
+
+DefectType* qcTypes = nullptr;
+int qcTypesCount = 0;
+
+String defectDefinitionsVersion = "";
+bool defectDefinitionsLoaded = false;
+bool defect_def_updated = false;
+
+// QC Parts selection variables (updated to use dynamic data)
+volatile int qcSelectedPart = 0;
+volatile int qcScrollOffset = 0;
+volatile bool qcInPartsSelection = false;
+
+// QC Selection state management
+enum QCSelectionStep {
+    QC_SELECT_SECTION,
+    QC_SELECT_TYPE,
+    QC_SELECT_SUBTYPE
+};
+
+volatile QCSelectionStep qcCurrentStep = QC_SELECT_SECTION;
+volatile int qcSelectedType = 0;
+volatile int qcSelectedSubtype = 0;
+volatile int qcTypeScrollOffset = 0;
+volatile int qcSubtypeScrollOffset = 0;
+
+// Held by the QC station while its dialog reads the definitions - a refresh installs only when it gets it
+static SemaphoreHandle_t defectDefinitionsLock = NULL;
+
+// A confirmed QC selection, copied out of the definitions - a refresh after the dialog cannot change it
+struct QCSelection {
+    uint8_t sectionCode;
+    uint8_t typeCode;
+    uint8_t subtypeCode;
+    char sectionName[DEFECT_NAME_MAX + 1];
+    char typeName[DEFECT_NAME_MAX + 1];
+    char subtypeName[DEFECT_NAME_MAX + 1];
+};
+
+// Journal records of priority-lane events not yet picked up by the uploader - they skip the journal order
+static QueueHandle_t priorityRefQueue;
+
+// Batched uploads (connectivity task)
+UploadStats uploadStats = {};
+uint32_t uploadPingIntervalMs = UPLOAD_PING_INTERVAL_MS;
+uint32_t uploadPongTimeoutMs = UPLOAD_PONG_TIMEOUT_MS;
+
+// Per-scan cost on the station tasks
+ScanCostStats scanCost = {};
+
+// Per-station card queues - each station task consumes its own reader's cards
+QueueHandle_t stationCardQueues[STATION_COUNT];
+volatile uint32_t stationCardDrops[STATION_COUNT] = {0}; // Cards dropped while a station was busy
+volatile uint32_t stationBundleCount[STATION_COUNT] = {0}; // Inventory passes that found more than one tag
+
+// Scheduler state per reader
+ReaderScanSlot readerSlots[STATION_COUNT];
+
+// Number of readers the scanning task steps (first N stations) - all of them except while benchmarking
+volatile uint8_t activeReaderCount = STATION_COUNT;
+
+// FreeRTOS Task handles
+TaskHandle_t rfidScanningTaskHandle = NULL;
+TaskHandle_t stationTaskHandles[STATION_COUNT] = {NULL};
+TaskHandle_t readerBenchTaskHandle = NULL;
+TaskHandle_t journalTaskHandle = NULL;
+
+// Forward declarations for LCD functions
+void updateSewingDisplay(uint8_t stationNumber, const char* uid, uint32_t scanCount);
+void updateQCDisplay(uint8_t stationNumber, const char* uid, uint32_t scanCount);
+
+// Forward declarations for button functions
+bool isOKPressed(uint8_t stationNumber);
+bool isCancelPressed(uint8_t stationNumber);
+void waitForButtonRelease(uint8_t stationNumber);
+bool waitForButtonPress(uint8_t stationNumber, unsigned long timeoutMs = 30000);
+
+// Forward declarations for QC navigation functions
+bool isQCUpPressed();
+bool isQCDownPressed();
+void waitForQCButtonRelease();
+void displayQCPartsList();
+bool handleQCPartsSelection(QCSelection& selection);
+
+// Dynamic numeric conversion functions for defect schema
+uint8_t getSectionCode(int sectionIndex) {
+    if (!defectDefinitionsLoaded || sectionIndex < 0 || sectionIndex >= qcSectionsCount) {
+        return 0; // Default to first section
+    }
+    return qcSections[sectionIndex].code;
+}
+
+uint8_t getTypeCode(int typeIndex) {
+    if (!defectDefinitionsLoaded || typeIndex < 0 || typeIndex >= qcTypesCount) {
+        return 0; // Default to first type
+    }
+    return qcTypes[typeIndex].code;
+}
+
+uint8_t getSubtypeCode(int typeIndex, int subtypeIndex) {
+    if (!defectDefinitionsLoaded || typeIndex < 0 || typeIndex >= qcTypesCount) {
+        return 0; // Default
+    }
+    
+    DefectType& type = qcTypes[typeIndex];
+    if (subtypeIndex < 0 || subtypeIndex >= type.subtypeCount) {
+        return 0; // Default
+    }
+    
+    return type.subtypes[subtypeIndex].code;
+}
+
+// Calculate ISO14443A CRC_A in software (avoids waiting on the reader's CRC coprocessor)
+void calculateCRC_A(const uint8_t* data, uint8_t length, uint8_t* result) {
+    uint16_t crc = 0x6363;
+    for (uint8_t i = 0; i < length; i++) {
+        uint8_t b = data[i] ^ (crc & 0xFF);
+        b ^= b << 4;
+        crc = (crc >> 8) ^ ((uint16_t)b << 8) ^ ((uint16_t)b << 3) ^ (b >> 4);
+    }
+    result[0] = crc & 0xFF;
+    result[1] = crc >> 8;
+}
+
+// Clean up dynamically allocated defect definitions memory
+void cleanupDefectDefinitions() {
+    if (qcSections) {
+        delete[] qcSections;
+        qcSections = nullptr;
+    }
+    
+    if (qcTypes) {
+        for (int i = 0; i < qcTypesCount; i++) {
+            if (qcTypes[i].subtypes) {
+                delete[] qcTypes[i].subtypes;
+            }
+        }
+        delete[] qcTypes;
+        qcTypes = nullptr;
+    }
+    
+    qcSectionsCount = 0;
+    qcTypesCount = 0;
+    defectDefinitionsLoaded = false;
+}
+
+bool lockDefectDefinitions(TickType_t wait) {
+    return xSemaphoreTake(defectDefinitionsLock, wait) == pdTRUE;
+}
+
+void unlockDefectDefinitions() {
+    xSemaphoreGive(defectDefinitionsLock);
+}
+
+// Load fallback defect definitions (hardcoded)
+void loadFallbackDefectDefinitions() {
+    Serial.println("Loading fallback defect definitions...");
+    
+    // Clean up any existing data
+    cleanupDefectDefinitions();
+    
+    // Create sections
+    qcSectionsCount = 4;
+    qcSections = new DefectSection[qcSectionsCount];
+    
+    qcSections[0] = DefectSection(0, "Body");
+    qcSections[1] = DefectSection(1, "Hand");
+    qcSections[2] = DefectSection(2, "Collar");
+    qcSections[3] = DefectSection(3, "Upper Back");
+    
+    // Create types with subtypes
+    qcTypesCount = 4;
+    qcTypes = new DefectType[qcTypesCount];
+    
+    // Fabric type (4 subtypes)
+    qcTypes[0] = DefectType(0, "Fabric");
+    qcTypes[0].subtypeCount = 4;
+    qcTypes[0].subtypes = new DefectSubtype[4];
+    qcTypes[0].subtypes[0] = DefectSubtype(0, "Hole");
+    qcTypes[0].subtypes[1] = DefectSubtype(1, "Stain");
+    qcTypes[0].subtypes[2] = DefectSubtype(2, "Shading");
+    qcTypes[0].subtypes[3] = DefectSubtype(3, "Slub");
+    
+    // Stitching type (4 subtypes)
+    qcTypes[1] = DefectType(1, "Stitching");
+    qcTypes[1].subtypeCount = 4;
+    qcTypes[1].subtypes = new DefectSubtype[4];
+    qcTypes[1].subtypes[0] = DefectSubtype(4, "Skipped");
+    qcTypes[1].subtypes[1] = DefectSubtype(5, "Broken");
+    qcTypes[1].subtypes[2] = DefectSubtype(6, "Uneven");
+    qcTypes[1].subtypes[3] = DefectSubtype(7, "Loose");
+    
+    // Sewing type (5 subtypes)
+    qcTypes[2] = DefectType(2, "Sewing");
+    qcTypes[2].subtypeCount = 5;
+    qcTypes[2].subtypes = new DefectSubtype[5];
+    qcTypes[2].subtypes[0] = DefectSubtype(8, "Pluckering");
+    qcTypes[2].subtypes[1] = DefectSubtype(9, "Misalignment");
+    qcTypes[2].subtypes[2] = DefectSubtype(10, "Open_seam");
+    qcTypes[2].subtypes[3] = DefectSubtype(11, "Backtak");
+    qcTypes[2].subtypes[4] = DefectSubtype(12, "Seam_gap");
+    
+    // Other type (3 subtypes)
+    qcTypes[3] = DefectType(3, "Other");
+    qcTypes[3].subtypeCount = 3;
+    qcTypes[3].subtypes = new DefectSubtype[3];
+    qcTypes[3].subtypes[0] = DefectSubtype(13, "Measurement");
+    qcTypes[3].subtypes[1] = DefectSubtype(14, "Button/Button_hole");
+    qcTypes[3].subtypes[2] = DefectSubtype(15, "Twisted");
+    
+    defectDefinitionsLoaded = true;
+    defectDefinitionsVersion = "Fallback v1.0";
+    
+    Serial.println("Fallback defect definitions loaded successfully!");
+    Serial.printf("Loaded %d sections, %d types\n", qcSectionsCount, qcTypesCount);
+}
+
+// Build a 64-bit key from a UID - 4/7 byte UIDs are packed exactly, 10 byte UIDs are hashed (FNV-1a)
+uint64_t uidKey(const uint8_t* uid, uint8_t uidSize) {
+    uint64_t key = 0;
+    if (uidSize <= 7) {
+        for (uint8_t i = 0; i < uidSize; i++) {
+            key = (key << 8) | uid[i];
+        }
+        return key | ((uint64_t)uidSize << 56); // Size in the top byte - never 0 for a real UID
+    }
+    
+    key = 0xCBF29CE484222325ULL;
+    for (uint8_t i = 0; i < uidSize; i++) {
+        key = (key ^ uid[i]) * 0x100000001B3ULL;
+    }
+    return key ? key : 1;
+}
+
+// Employee cards as UID keys (from STATIONS[].employeeUID) - set up by createPipelineQueues()
+static uint64_t employeeKeys[STATION_COUNT];
+
+// Key of a UID written as hex (e.g., "F5A628A1"), 0 if it is not valid hex
+static uint64_t hexUidKey(const char* hex) {
+    uint8_t uid[10];
+    uint8_t size = 0;
+    while (hex[0] != '\0' && hex[1] != '\0' && size < sizeof(uid)) {
+        char byteText[3] = {hex[0], hex[1], '\0'};
+        char* end;
+        uid[size++] = (uint8_t)strtoul(byteText, &end, 16);
+        if (*end != '\0') {
+            return 0;
+        }
+        hex += 2;
+    }
+    return size > 0 ? uidKey(uid, size) : 0;
+}
+
+// Function to get the assigned station number for an employee card
+uint8_t getAssignedStation(uint64_t cardKey) {
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+        if (cardKey == employeeKeys[i]) {
+            return i + 1;
+        }
+    }
+    return 0; // Unknown
+}
+
+// Function to check if a scanned card is an employee card (employee cards are listed in STATIONS)
+bool isEmployeeCard(uint64_t cardKey) {
+    return getAssignedStation(cardKey) != 0;
+}
+
+// Function to get employee name from a card
+const char* getEmployeeName(uint64_t cardKey) {
+    uint8_t stationNumber = getAssignedStation(cardKey);
+    return stationNumber != 0 ? STATIONS[stationNumber - 1].employeeName : "Unknown";
+}
+
+// Function to get station name
+const char* getStationName(uint8_t stationNumber) {
+    if (stationNumber < 1 || stationNumber > STATION_COUNT) {
+        return "Unknown";
+    }
+    return STATIONS[stationNumber - 1].name;
+}
+
+// First slot to probe for a key
+uint8_t recentUidHome(uint64_t key) {
+    return (uint8_t)((key * 0x9E3779B97F4A7C15ULL) >> 59) & (RECENT_UID_SLOTS - 1);
+}
+
+// Check whether a UID was already counted at this station within its duplicate window
+bool isRecentUid(uint8_t stationNumber, uint64_t key) {
+    RecentUidTable& table = recentUids[stationNumber - 1];
+    uint32_t now = millis();
+    uint8_t home = recentUidHome(key);
+    
+    for (int p = 0; p < RECENT_UID_PROBE_LIMIT; p++) {
+        RecentUidEntry& entry = table.entries[(home + p) & (RECENT_UID_SLOTS - 1)];
+        if (entry.key == key && now - entry.seenAt < STATIONS[stationNumber - 1].duplicateWindowMs) {
+            table.rejected++;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Record a counted UID - reuses its own, an empty or an expired slot, otherwise evicts the oldest
+void rememberUid(uint8_t stationNumber, uint64_t key) {
+    RecentUidTable& table = recentUids[stationNumber - 1];
+    uint32_t now = millis();
+    uint32_t window = STATIONS[stationNumber - 1].duplicateWindowMs;
+    uint8_t home = recentUidHome(key);
+    RecentUidEntry* target = nullptr;
+    RecentUidEntry* oldest = nullptr;
+    
+    for (int p = 0; p < RECENT_UID_PROBE_LIMIT; p++) {
+        RecentUidEntry& entry = table.entries[(home + p) & (RECENT_UID_SLOTS - 1)];
+        if (entry.key == key) {
+            target = &entry;
+            break;
+        }
+        if (target == nullptr && (entry.key == 0 || now - entry.seenAt >= window)) {
+            target = &entry;
+        }
+        if (oldest == nullptr || now - entry.seenAt > now - oldest->seenAt) {
+            oldest = &entry;
+        }
+    }
+    
+    if (target == nullptr) {
+        target = oldest;
+        table.evicted++;
+    }
+    target->key = key;
+    target->seenAt = now;
+}
+
+// Forget all recent UIDs for a station (new shift)
+void clearRecentUids(uint8_t stationNumber) {
+    RecentUidTable& table = recentUids[stationNumber - 1];
+    for (int i = 0; i < RECENT_UID_SLOTS; i++) {
+        table.entries[i].key = 0;
+    }
+}
+
+// Function to display a message on a station's LCD (lines beyond the display's rows are dropped)
+void displayStationMessage(uint8_t stationNumber, const char* line1, const char* line2, const char* line3, const char* line4) {
+    StationDisplay* display = stationPorts[stationNumber - 1].display;
+    if (display == nullptr) {
+        return; // Station has no LCD
+    }
+    
+    const char* lines[] = {line1, line2, line3, line4};
+    display->clear();
+    for (uint8_t row = 0; row < STATIONS[stationNumber - 1].displayRows && row < 4; row++) {
+        const char* line = lines[row] != nullptr ? lines[row] : "";
+        if (row >= 2 && line[0] == '\0') {
+            continue;
+        }
+        char text[17];
+        snprintf(text, sizeof(text), "%s", line); // Truncate to 16 chars
+        display->setCursor(0, row);
+        display->print(text);
+    }
+}
+
+// Same for messages built from Strings (login dialog, defect names)
+void displayStationMessage(uint8_t stationNumber, const String& line1, const String& line2, const String& line3, const String& line4) {
+    displayStationMessage(stationNumber, line1.c_str(), line2.c_str(), line3.c_str(), line4.c_str());
+}
+
+// Keep a station message on screen for a while - stations without an LCD carry on immediately
+void holdStationMessage(uint8_t stationNumber, uint32_t durationMs) {
+    if (stationPorts[stationNumber - 1].display != nullptr) {
+        vTaskDelay(pdMS_TO_TICKS(durationMs)); // Use vTaskDelay instead of delay()
+    }
+}
+
+// Function to handle employee login/logout with station assignment validation and button confirmation
+void handleEmployeeAccess(uint64_t cardKey, uint8_t stationNumber) {
+    String employeeName = getEmployeeName(cardKey);
+    uint8_t assignedStation = getAssignedStation(cardKey);
+    String stationName = getStationName(stationNumber);
+    String assignedStationName = getStationName(assignedStation);
+    
+    // Check if employee is trying to access their assigned station
+    if (assignedStation != stationNumber) {
+        String message = "Wrong station, Go to " + assignedStationName;
+        LOG_W("%s tried to access %s - %s", employeeName.c_str(), stationName.c_str(), message.c_str());
+        
+        displayStationMessage(stationNumber, "Wrong Station!", "Go to " + assignedStationName, "Access Denied");
+        holdStationMessage(stationNumber, 2500);
+        displayStationMessage(stationNumber, stationName, "Scan your card");
+        return;
+    }
+    
+    // Employee is at their correct station - handle state-based logic
+    uint8_t index = stationNumber - 1;
+    bool largeDisplay = STATIONS[index].displayRows >= 4;
+    
+    if (stationState[index] == WAITING_FOR_CARD && !stationActive[index]) {
+        // Request confirmation to start shift
+        LOG_I("%s: %s requesting to start shift", stationName.c_str(), employeeName.c_str());
+        stationState[index] = WAITING_START_CONFIRMATION;
+        displayStationMessage(stationNumber, "Press OK to", "Start the Shift");
+        
+        // Wait for button press (OK to start, Cancel to postpone)
+        if (waitForButtonPress(stationNumber, 30000)) { // 30 second timeout
+            // OK pressed - start shift
+            stationActive[index] = true;
+            stationEmployee[index] = employeeName;
+            stationState[index] = ACTIVE_SCANNING;
+            clearRecentUids(stationNumber); // Reset duplicate prevention for new shift
+            LOG_I("%s: Shift starting... - %s", stationName.c_str(), employeeName.c_str());
+            if (largeDisplay) {
+                displayStationMessage(stationNumber, stationName, "Shift starting...", employeeName, "Ready to scan");
+            } else {
+                displayStationMessage(stationNumber, "Shift starting...", employeeName);
+            }
+            holdStationMessage(stationNumber, 1500); // Reduced from 2000ms for faster login
+            displayStationMessage(stationNumber, stationName, "Ready to scan");
+        } else {
+            // Cancel pressed or timeout - postpone
+            stationState[index] = WAITING_FOR_CARD;
+            LOG_I("%s: Shift postponed - %s", stationName.c_str(), employeeName.c_str());
+            displayStationMessage(stationNumber, "Postponed Shift!", "Scan again to start");
+            holdStationMessage(stationNumber, 3000);
+            displayStationMessage(stationNumber, stationName, "Scan your card");
+        }
+    } else if (stationState[index] == ACTIVE_SCANNING && stationEmployee[index] == employeeName) {
+        // Request confirmation to end shift
+        LOG_I("%s: %s requesting to end shift", stationName.c_str(), employeeName.c_str());
+        stationState[index] = WAITING_END_CONFIRMATION;
+        displayStationMessage(stationNumber, "Press OK to", "End the Shift");
+        
+        // Wait for button press (OK to end, Cancel to continue)
+        if (waitForButtonPress(stationNumber, 30000)) { // 30 second timeout
+            // OK pressed - end shift
+            stationActive[index] = false;
+            stationEmployee[index] = "";
+            stationState[index] = WAITING_FOR_CARD;
+            clearRecentUids(stationNumber); // Reset duplicate prevention
+            LOG_I("%s: Shift ended - %s", stationName.c_str(), employeeName.c_str());
+            if (largeDisplay) {
+                displayStationMessage(stationNumber, stationName, "Shift Ending...", employeeName);
+            } else {
+                displayStationMessage(stationNumber, "Shift Ending...", employeeName);
+            }
+            holdStationMessage(stationNumber, 2000);
+            displayStationMessage(stationNumber, stationName, "Scan your card");
+        } else {
+            // Cancel pressed or timeout - continue working
+            stationState[index] = ACTIVE_SCANNING;
+            LOG_I("%s: Shift ending denied - %s", stationName.c_str(), employeeName.c_str());
+            displayStationMessage(stationNumber, "Denied ending!", "Back to Tag scanning");
+            holdStationMessage(stationNumber, 3000);
+            displayStationMessage(stationNumber, stationName, "Ready to scan");
+        }
+    }
+}
+
+// Buzzer beep function
+void beepBuzzer(int duration = 200) {
+    buzzerPort->set(true);
+    vTaskDelay(pdMS_TO_TICKS(duration)); // Use vTaskDelay instead of delay()
+    buzzerPort->set(false);
+}
+
+// Double beep function for consecutive scan notification
+void doubleBeepBuzzer() {
+    buzzerPort->set(true);
+    vTaskDelay(pdMS_TO_TICKS(50)); // 50ms beep
+    buzzerPort->set(false);
+    vTaskDelay(pdMS_TO_TICKS(50)); // 50ms pause
+    buzzerPort->set(true);
+    vTaskDelay(pdMS_TO_TICKS(50)); // 50ms beep
+    buzzerPort->set(false);
+}
+
+// Check if OK button is pressed (LOW when pressed due to pull-up)
+bool isOKPressed(uint8_t stationNumber) {
+    if (stationNumber < 1 || stationNumber > STATION_COUNT) return false;
+    StationButtons* buttons = stationPorts[stationNumber - 1].buttons;
+    return buttons != nullptr && buttons->isPressed(BUTTON_OK);
+}
+
+// Check if Cancel button is pressed (LOW when pressed due to pull-up)
+bool isCancelPressed(uint8_t stationNumber) {
+    if (stationNumber < 1 || stationNumber > STATION_COUNT) return false;
+    StationButtons* buttons = stationPorts[stationNumber - 1].buttons;
+    return buttons != nullptr && buttons->isPressed(BUTTON_CANCEL);
+}
+
+// Wait for button to be released (for debouncing)
+void waitForButtonRelease(uint8_t stationNumber) {
+    if (stationNumber < 1 || stationNumber > STATION_COUNT) return;
+    
+    while (isOKPressed(stationNumber) || isCancelPressed(stationNumber)) {
+        vTaskDelay(pdMS_TO_TICKS(50)); // Use vTaskDelay instead of delay()
+    }
+    vTaskDelay(pdMS_TO_TICKS(100)); // Use vTaskDelay for additional debounce delay
+}
+
+// Wait for button press with timeout, returns true if OK pressed, false if Cancel or timeout
+bool waitForButtonPress(uint8_t stationNumber, unsigned long timeoutMs) {
+    if (stationNumber < 1 || stationNumber > STATION_COUNT) return false;
+    
+    unsigned long startTime = millis();
+    
+    while (millis() - startTime < timeoutMs) {
+        if (isOKPressed(stationNumber)) {
+            waitForButtonRelease(stationNumber);
+            return true;
+        }
+        if (isCancelPressed(stationNumber)) {
+            waitForButtonRelease(stationNumber);
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(50)); // Use vTaskDelay instead of delay()
+    }
+    
+    return false; // Timeout - treat as cancel
+}
+
+// Check if QC Up button is pressed
+bool isQCUpPressed() {
+    if (qcStationNumber == 0 || stationPorts[qcStationNumber - 1].buttons == nullptr) return false;
+    return stationPorts[qcStationNumber - 1].buttons->isPressed(BUTTON_UP);
+}
+
+// Check if QC Down button is pressed
+bool isQCDownPressed() {
+    if (qcStationNumber == 0 || stationPorts[qcStationNumber - 1].buttons == nullptr) return false;
+    return stationPorts[qcStationNumber - 1].buttons->isPressed(BUTTON_DOWN);
+}
+
+// Wait for QC navigation buttons to be released
+void waitForQCButtonRelease() {
+    while (isQCUpPressed() || isQCDownPressed()) {
+        vTaskDelay(pdMS_TO_TICKS(50)); // Use vTaskDelay instead of delay()
+    }
+    vTaskDelay(pdMS_TO_TICKS(100)); // Use vTaskDelay for additional debounce delay
+}
+
+// LCD of the QC station, nullptr if there is none
+StationDisplay* qcDisplay() {
+    return qcStationNumber != 0 ? stationPorts[qcStationNumber - 1].display : nullptr;
+}
+
+// Display QC parts selection list
+void displayQCPartsList() {
+    StationDisplay* lcd = qcDisplay();
+    if (lcd == nullptr) return;
+    
+    if (!defectDefinitionsLoaded || qcSectionsCount == 0) {
+        lcd->clear();
+        lcd->setCursor(0, 0);
+        lcd->print("No defect data");
+        lcd->setCursor(0, 1);
+        lcd->print("Check connection");
+        return;
+    }
+
+    lcd->clear();
+    
+    // First line: Title at index 3
+    lcd->setCursor(3, 0);
+    lcd->print("-SECTION-");
+    
+    // Display 3 items starting from scroll offset
+    for (int i = 0; i < 3; i++) {
+        int partIndex = qcScrollOffset + i;
+        if (partIndex < qcSectionsCount) {
+            int row = i + 1;
+            
+            // Selected item indented by 1 space, others at index 0
+            if (partIndex == qcSelectedPart) {
+                lcd->setCursor(1, row); // Selected item at index 1
+                lcd->print(qcSections[partIndex].name.c_str());
+            } else {
+                lcd->setCursor(0, row); // Non-selected items at index 0
+                lcd->print(qcSections[partIndex].name.c_str());
+            }
+        }
+    }
+}
+
+// Display QC defect types selection list
+void displayQCTypesList() {
+    StationDisplay* lcd = qcDisplay();
+    if (lcd == nullptr) return;
+    
+    if (!defectDefinitionsLoaded || qcTypesCount == 0) {
+        lcd->clear();
+        lcd->setCursor(0, 0);
+        lcd->print("No types data");
+        lcd->setCursor(0, 1);
+        lcd->print("Check connection");
+        return;
+    }
+
+    lcd->clear();
+    
+    // First line: Title at index 2
+    lcd->setCursor(2, 0);
+    lcd->print("-DEFECT TYPES-");
+    
+    // Display 3 items starting from scroll offset
+    for (int i = 0; i < 3; i++) {
+        int typeIndex = qcTypeScrollOffset + i;
+        if (typeIndex < qcTypesCount) {
+            int row = i + 1;
+            
+            // Selected item indented by 1 space, others at index 0
+            if (typeIndex == qcSelectedType) {
+                lcd->setCursor(1, row); // Selected item at index 1
+                lcd->print(qcTypes[typeIndex].name.c_str());
+            } else {
+                lcd->setCursor(0, row); // Non-selected items at index 0
+                lcd->print(qcTypes[typeIndex].name.c_str());
+            }
+        }
+    }
+}
+
+// Get subtypes array and count based on selected type (dynamic version)
+bool getSubtypesForType(int typeIndex, DefectSubtype*& subtypes, int& count) {
+    if (!defectDefinitionsLoaded || typeIndex < 0 || typeIndex >= qcTypesCount) {
+        subtypes = nullptr;
+        count = 0;
+        return false;
+    }
+    
+    subtypes = qcTypes[typeIndex].subtypes;
+    count = qcTypes[typeIndex].subtypeCount;
+    return true;
+}
+
+// Display QC defect subtypes selection list
+void displayQCSubtypesList() {
+    StationDisplay* lcd = qcDisplay();
+    if (lcd == nullptr) return;
+    
+    lcd->clear();
+    
+    // First line: Title at index 4
+    lcd->setCursor(4, 0);
+    lcd->print("-DEFECT-");
+    
+    // Get subtypes for selected type
+    DefectSubtype* subtypes;
+    int subtypesCount;
+    if (!getSubtypesForType(qcSelectedType, subtypes, subtypesCount)) {
+        lcd->setCursor(0, 1);
+        lcd->print("No subtypes");
+        return;
+    }
+    
+    // Display 3 items starting from scroll offset
+    for (int i = 0; i < 3; i++) {
+        int subtypeIndex = qcSubtypeScrollOffset + i;
+        if (subtypeIndex < subtypesCount) {
+            int row = i + 1;
+            
+            // Selected item indented by 1 space, others at index 0
+            if (subtypeIndex == qcSelectedSubtype) {
+                lcd->setCursor(1, row); // Selected item at index 1
+                lcd->print(subtypes[subtypeIndex].name.c_str());
+            } else {
+                lcd->setCursor(0, row); // Non-selected items at index 0
+                lcd->print(subtypes[subtypeIndex].name.c_str());
+            }
+        }
+    }
+}
+
+// Copy the codes and names of the selected entries - false if an index is out of range
+static bool snapshotQCSelection(QCSelection& selection) {
+    if (!defectDefinitionsLoaded || qcSelectedPart < 0 || qcSelectedPart >= qcSectionsCount) {
+        return false;
+    }
+    DefectSubtype* subtypes;
+    int subtypesCount;
+    if (!getSubtypesForType(qcSelectedType, subtypes, subtypesCount) ||
+        qcSelectedSubtype < 0 || qcSelectedSubtype >= subtypesCount) {
+        return false;
+    }
+    selection.sectionCode = getSectionCode(qcSelectedPart);
+    selection.typeCode = getTypeCode(qcSelectedType);
+    selection.subtypeCode = getSubtypeCode(qcSelectedType, qcSelectedSubtype);
+    snprintf(selection.sectionName, sizeof(selection.sectionName), "%s", qcSections[qcSelectedPart].name.c_str());
+    snprintf(selection.typeName, sizeof(selection.typeName), "%s", qcTypes[qcSelectedType].name.c_str());
+    snprintf(selection.subtypeName, sizeof(selection.subtypeName), "%s", subtypes[qcSelectedSubtype].name.c_str());
+    return true;
+}
+
+// Handle QC multi-step selection navigation: Section -> Type -> Subtype
+// Returns true if complete selection confirmed, false if cancelled
+static bool runQCPartsSelection(QCSelection& selection) {
+    qcCurrentStep = QC_SELECT_SECTION;
+    qcCurrentStep = QC_SELECT_SECTION;
+    
+    // Reset all selections and scroll offsets
+    qcSelectedPart = 0;
+    qcSelectedType = 0;
+    qcSelectedSubtype = 0;
+    qcScrollOffset = 0;
+    qcTypeScrollOffset = 0;
+    qcSubtypeScrollOffset = 0;
+    
+    LOG_I("QC: Starting multi-step selection - Section -> Type -> Subtype");
+    displayQCPartsList();
+    if (!defectDefinitionsLoaded || qcSectionsCount == 0 || qcTypesCount == 0) {
+        vTaskDelay(pdMS_TO_TICKS(1500)); // Leave "No defect data" up for a moment
+        return false;
+    }
+    
+    unsigned long startTime = millis();
+    const unsigned long selectionTimeout = 120000; // 2 minutes timeout for complete selection
+    
+    while (millis() - startTime < selectionTimeout) {
+        // Handle navigation based on current step
+        switch(qcCurrentStep) {
+            case QC_SELECT_SECTION:
+                // Navigation UP
+                if (isQCUpPressed()) {
+                    waitForQCButtonRelease();
+                    qcSelectedPart--;
+                    if (qcSelectedPart < 0) {
+                        qcSelectedPart = qcSectionsCount - 1; // Wrap to bottom
+                    }
+
+                    // Adjust scroll offset if needed
+                    if (qcSelectedPart < qcScrollOffset) {
+                        qcScrollOffset = qcSelectedPart;
+                    } else if (qcSelectedPart >= qcScrollOffset + 3) {
+                        qcScrollOffset = qcSelectedPart - 2;
+                    }
+
+                    LOG_D("QC: Section UP - Selected: %s", qcSections[qcSelectedPart].name.c_str());
+                    displayQCPartsList();
+                    startTime = millis(); // Reset timeout
+                }
+                
+                // Navigation DOWN
+                if (isQCDownPressed()) {
+                    waitForQCButtonRelease();
+                    qcSelectedPart++;
+                    if (qcSelectedPart >= qcSectionsCount) {
+                        qcSelectedPart = 0; // Wrap to top
+                        qcScrollOffset = 0;
+                    }
+
+                    // Adjust scroll offset if needed
+                    if (qcSelectedPart >= qcScrollOffset + 3) {
+                        qcScrollOffset = qcSelectedPart - 2;
+                    } else if (qcSelectedPart < qcScrollOffset) {
+                        qcScrollOffset = qcSelectedPart;
+                    }
+                    
+                    LOG_D("QC: Section DOWN - Selected: %s", qcSections[qcSelectedPart].name.c_str());
+                    displayQCPartsList();
+                    startTime = millis(); // Reset timeout
+                }
+                
+                // OK button - proceed to type selection
+                if (isOKPressed(qcStationNumber)) {
+                    waitForButtonRelease(qcStationNumber);
+                    LOG_I("QC: Section confirmed - %s -> Moving to Type selection", qcSections[qcSelectedPart].name.c_str());
+                    qcCurrentStep = QC_SELECT_TYPE;
+                    qcSelectedType = 0;
+                    qcTypeScrollOffset = 0;
+                    displayQCTypesList();
+                    startTime = millis(); // Reset timeout
+                }
+                
+                // Cancel button - exit selection
+                if (isCancelPressed(qcStationNumber)) {
+                    waitForButtonRelease(qcStationNumber);
+                    LOG_I("QC: Section selection cancelled");
+                    return false;
+                }
+                break;
+                
+            case QC_SELECT_TYPE:
+                // Navigation UP
+                if (isQCUpPressed()) {
+                    waitForQCButtonRelease();
+                    qcSelectedType--;
+                    if (qcSelectedType < 0) {
+                        qcSelectedType = qcTypesCount - 1; // Wrap to bottom
+                    }
+                    
+                    // Adjust scroll offset if needed
+                    if (qcSelectedType < qcTypeScrollOffset) {
+                        qcTypeScrollOffset = qcSelectedType;
+                    } else if (qcSelectedType >= qcTypeScrollOffset + 3) {
+                        qcTypeScrollOffset = qcSelectedType - 2;
+                    }
+                    
+                    LOG_D("QC: Type UP - Selected: %s", qcTypes[qcSelectedType].name.c_str());
+                    displayQCTypesList();
+                    startTime = millis(); // Reset timeout
+                }
+                
+                // Navigation DOWN
+                if (isQCDownPressed()) {
+                    waitForQCButtonRelease();
+                    qcSelectedType++;
+                    if (qcSelectedType >= qcTypesCount) {
+                        qcSelectedType = 0; // Wrap to top
+                        qcTypeScrollOffset = 0;
+                    }
+                    
+                    // Adjust scroll offset if needed
+                    if (qcSelectedType >= qcTypeScrollOffset + 3) {
+                        qcTypeScrollOffset = qcSelectedType - 2;
+                    } else if (qcSelectedType < qcTypeScrollOffset) {
+                        qcTypeScrollOffset = qcSelectedType;
+                    }
+                    
+                    LOG_D("QC: Type DOWN - Selected: %s", qcTypes[qcSelectedType].name.c_str());
+                    displayQCTypesList();
+                    startTime = millis(); // Reset timeout
+                }
+                
+                // OK button - proceed to subtype selection
+                if (isOKPressed(qcStationNumber)) {
+                    waitForButtonRelease(qcStationNumber);
+                    LOG_I("QC: Type confirmed - %s -> Moving to Subtype selection", qcTypes[qcSelectedType].name.c_str());
+                    qcCurrentStep = QC_SELECT_SUBTYPE;
+                    qcSelectedSubtype = 0;
+                    qcSubtypeScrollOffset = 0;
+                    displayQCSubtypesList();
+                    startTime = millis(); // Reset timeout
+                }
+                
+                // Cancel button - go back to section selection
+                if (isCancelPressed(qcStationNumber)) {
+                    waitForButtonRelease(qcStationNumber);
+                    LOG_I("QC: Type selection cancelled - Back to Section selection");
+                    qcCurrentStep = QC_SELECT_SECTION;
+                    displayQCPartsList();
+                    startTime = millis(); // Reset timeout
+                }
+                break;
+                
+            case QC_SELECT_SUBTYPE:
+                // Get subtypes count for current type
+                DefectSubtype* subtypes;
+                int subtypesCount;
+                if (!getSubtypesForType(qcSelectedType, subtypes, subtypesCount)) {
+                    // Handle error case
+                    return false;
+                }
+                
+                // Navigation UP
+                if (subtypesCount > 0 && isQCUpPressed()) {
+                    waitForQCButtonRelease();
+                    qcSelectedSubtype--;
+                    if (qcSelectedSubtype < 0) {
+                        qcSelectedSubtype = subtypesCount - 1; // Wrap to bottom
+                    }
+                    
+                    // Adjust scroll offset if needed
+                    if (qcSelectedSubtype < qcSubtypeScrollOffset) {
+                        qcSubtypeScrollOffset = qcSelectedSubtype;
+                    } else if (qcSelectedSubtype >= qcSubtypeScrollOffset + 3) {
+                        qcSubtypeScrollOffset = qcSelectedSubtype - 2;
+                    }
+                    
+                    LOG_D("QC: Subtype UP - Selected: %s", subtypes[qcSelectedSubtype].name.c_str());
+                    displayQCSubtypesList();
+                    startTime = millis(); // Reset timeout
+                }
+                
+                // Navigation DOWN
+                if (subtypesCount > 0 && isQCDownPressed()) {
+                    waitForQCButtonRelease();
+                    qcSelectedSubtype++;
+                    if (qcSelectedSubtype >= subtypesCount) {
+                        qcSelectedSubtype = 0; // Wrap to top
+                        qcSubtypeScrollOffset = 0;
+                    }
+                    
+                    // Adjust scroll offset if needed
+                    if (qcSelectedSubtype >= qcSubtypeScrollOffset + 3) {
+                        qcSubtypeScrollOffset = qcSelectedSubtype - 2;
+                    } else if (qcSelectedSubtype < qcSubtypeScrollOffset) {
+                        qcSubtypeScrollOffset = qcSelectedSubtype;
+                    }
+                    
+                    LOG_D("QC: Subtype DOWN - Selected: %s", subtypes[qcSelectedSubtype].name.c_str());
+                    displayQCSubtypesList();
+                    startTime = millis(); // Reset timeout
+                }
+                
+                // OK button - complete selection
+                if (isOKPressed(qcStationNumber)) {
+                    waitForButtonRelease(qcStationNumber);
+                    if (!snapshotQCSelection(selection)) {
+                        LOG_W("QC: Selection out of range - cancelled");
+                        return false;
+                    }
+                    LOG_I("QC: Complete selection confirmed!");
+                    LOG_I("Section: %s", selection.sectionName);
+                    LOG_I("Type: %s", selection.typeName);
+                    LOG_I("Subtype: %s", selection.subtypeName);
+                    return true;
+                }
+                
+                // Cancel button - go back to type selection
+                if (isCancelPressed(qcStationNumber)) {
+                    waitForButtonRelease(qcStationNumber);
+                    LOG_I("QC: Subtype selection cancelled - Back to Type selection");
+                    qcCurrentStep = QC_SELECT_TYPE;
+                    displayQCTypesList();
+                    startTime = millis(); // Reset timeout
+                }
+                break;
+        }
+        
+        vTaskDelay(pdMS_TO_TICKS(50)); // Use vTaskDelay instead of delay()
+    }
+    
+    // Timeout
+    LOG_I("QC: Multi-step selection timeout");
+    return false;
+}
+
+// The dialog holds the definitions lock, so a refresh cannot free what it is showing
+bool handleQCPartsSelection(QCSelection& selection) {
+    lockDefectDefinitions(portMAX_DELAY);
+    qcInPartsSelection = true;
+    bool confirmed = runQCPartsSelection(selection);
+    qcInPartsSelection = false;
+    unlockDefectDefinitions();
+    return confirmed;
+}
+
+// LCD lines hold 16 columns: a formatted line that was cut (length is snprintf's result) ends in ".."
+static void markCut(char* line, size_t size, int length) {
+    if (length >= (int)size) {
+        line[size - 3] = '.';
+        line[size - 2] = '.';
+    }
+}
+
+// Update a sewing station's LCD with latest RFID UID and scan count
+void updateSewingDisplay(uint8_t stationNumber, const char* uid, uint32_t scanCount) {
+    const StationDescriptor& station = STATIONS[stationNumber - 1];
+    StationDisplay* display = stationPorts[stationNumber - 1].display;
+    if (display == nullptr) {
+        return; // Counter only - no LCD at this station
+    }
+    
+    char line1[17];
+    char line2[sizeof("Count: 4294967295")];
+    
+    // Format UID for display (the first characters that fit if too long)
+    markCut(line1, sizeof(line1), snprintf(line1, sizeof(line1), "%s: %s", station.shortName, uid));
+    
+    // Format scan count
+    snprintf(line2, sizeof(line2), "Count: %lu", (unsigned long)scanCount);
+    
+    // Update display
+    display->clear();
+    display->setCursor(0, 0);
+    display->print(line1);
+    display->setCursor(0, 1);
+    display->print(line2);
+}
+
+// Update QC LCD with latest RFID UID and scan count
+void updateQCDisplay(uint8_t stationNumber, const char* uid, uint32_t scanCount) {
+    StationDisplay* lcd = stationPorts[stationNumber - 1].display;
+    if (lcd == nullptr) {
+        return;
+    }
+    
+    char line1[17];
+    char line2[sizeof("Count: 4294967295")];
+    char line3[17];
+    
+    // Format UID for display (the first characters that fit if too long)
+    markCut(line1, sizeof(line1), snprintf(line1, sizeof(line1), "QC: %s", uid));
+    
+    // Format scan count and timestamp
+    snprintf(line2, sizeof(line2), "Count: %lu", (unsigned long)scanCount);
+    
+    // Get current time if available
+    struct tm timeinfo;
+    if (timeLocal(&timeinfo)) {
+        strftime(line3, sizeof(line3), "%H:%M:%S", &timeinfo);
+    } else {
+        snprintf(line3, sizeof(line3), "Time: N/A");
+    }
+    
+    // Update display
+    lcd->clear();
+    lcd->setCursor(0, 0);
+    lcd->print(line1);
+    lcd->setCursor(0, 1);
+    lcd->print(line2);
+    lcd->setCursor(0, 2);
+    lcd->print(line3);
+    lcd->setCursor(0, 3);
+    lcd->print("QC Active");
+}
+
+// Next scan ID into scanID - 13 base32 characters, unique across reboots and devices (see scanid.h)
+void generateScanID(char* scanID, size_t size) {
+    static_assert(sizeof(ScannedData::scanID) > SCAN_ID_LENGTH, "scanID must hold a full scan ID");
+    char text[SCAN_ID_LENGTH + 1];
+    scanIdFormat(scanIdNext(), text);
+    snprintf(scanID, size, "%s", text);
+}
+
+// Generate station ID based on station type
+const char* generateStationID(uint8_t stationNumber) {
+    if (stationNumber < 1 || stationNumber > STATION_COUNT) {
+        return "0000"; // Unknown
+    }
+    return STATIONS[stationNumber - 1].stationID;
+}
+
+// Get line number based on station
+uint8_t getLineNumber(uint8_t stationNumber) {
+    if (stationNumber < 1 || stationNumber > STATION_COUNT) {
+        return 0; // Unknown
+    }
+    return STATIONS[stationNumber - 1].lineNumber;
+}
+
+// Convert UID bytes to upper-case hex with bounds checking (text holds UID_HEX_SIZE chars)
+void uidToHex(const uint8_t* uid, uint8_t uidSize, char* text) {
+    if (uid == nullptr || uidSize == 0 || uidSize > 10) {
+        strcpy(text, "INVALID_UID"); // Safety check
+        return;
+    }
+    
+    static const char digits[] = "0123456789ABCDEF";
+    for (uint8_t i = 0; i < uidSize; i++) {
+        text[i * 2] = digits[uid[i] >> 4];
+        text[i * 2 + 1] = digits[uid[i] & 0x0F];
+    }
+    text[uidSize * 2] = '\0';
+}
+
+// Bounded JSON writer for upload frames - writes straight into the TX buffer, nothing on the heap.
+// Compact output with ArduinoJson's escaping, so the text is the same serializeJson() produced.
+struct JsonFrameWriter {
+    char* buffer;
+    size_t capacity;
+    size_t length;
+    
+    void raw(const char* text, size_t n) {
+        if (length + n < capacity) {
+            memcpy(&buffer[length], text, n);
+        }
+        length += n;                       // Keeps counting past the end, so overflow is detected once at the end
+    }
+    
+    void raw(const char* text) {
+        raw(text, strlen(text));
+    }
+    
+    void number(uint32_t value) {
+        char text[11];
+        raw(text, snprintf(text, sizeof(text), "%lu", (unsigned long)value));
+    }
+    
+    // Quoted string of at most maxLength chars (fixed-size fields may fill their array without a terminator)
+    void string(const char* value, size_t maxLength) {
+        raw("\"", 1);
+        for (size_t i = 0; i < maxLength && value[i] != '\0'; i++) {
+            char c = value[i];
+            const char* escape = nullptr;
+            switch (c) {
+                case '"':  escape = "\\\""; break;
+                case '\\': escape = "\\\\"; break;
+                case '\b': escape = "\\b"; break;
+                case '\f': escape = "\\f"; break;
+                case '\n': escape = "\\n"; break;
+                case '\r': escape = "\\r"; break;
+                case '\t': escape = "\\t"; break;
+            }
+            if (escape != nullptr) {
+                raw(escape, 2);
+            } else {
+                raw(&c, 1);
+            }
+        }
+        raw("\"", 1);
+    }
+    
+    // Length written, 0 if it did not fit (the text is NUL-terminated)
+    size_t finish() {
+        if (length >= capacity) {
+            return 0;
+        }
+        buffer[length] = '\0';
+        return length;
+    }
+};
+
+// Encode scans and defects as one rfid_scan_batch JSON message (seq = batch sequence number the server acks, oldest = oldest
+// batch still unacked). Returns its length, 0 if it does not fit in capacity.
+size_t encodeScanBatchJson(uint32_t seq, uint32_t oldest, const ScannedData* records, uint8_t count, char* buffer, size_t capacity) {
+    JsonFrameWriter json = {buffer, capacity, 0};
+    json.raw("{\"action\":\"rfid_scan_batch\",\"seq\":");
+    json.number(seq);
+    json.raw(",\"oldest\":");
+    json.number(oldest);
+    json.raw(",\"data\":[");
+    for (uint8_t i = 0; i < count; i++) {
+        const ScannedData& data = records[i];
+        char uidText[UID_HEX_SIZE];
+        uidToHex(data.uid, data.uidSize, uidText);
+        
+        json.raw(i == 0 ? "{\"ID\":" : ",{\"ID\":");
+        json.string(data.scanID, sizeof(data.scanID));
+        json.raw(",\"Tag_UID\":");
+        json.string(uidText, sizeof(uidText));
+        json.raw(",\"Station_ID\":");
+        json.string(data.stationID, sizeof(data.stationID));
+        json.raw(",\"Time_Stamp\":");
+        json.number(data.timeBase == TIME_BASE_UNIX ? data.timestamp : 0);   // 0 = not known yet
+        if (data.kind == EVENT_DEFECT) {
+            // Same fields as the defect_scan action; QC is not line-specific
+            json.raw(",\"Kind\":\"defect\",\"Section\":");
+            json.number(data.defectSection);
+            json.raw(",\"Type\":");
+            json.number(data.defectType);
+            json.raw(",\"Subtype\":");
+            json.number(data.defectSubtype);
+        } else {
+            json.raw(",\"Station_Number\":");
+            json.number(data.stationNumber); // Single digit station number
+            json.raw(",\"Line_Number\":");
+            json.number(data.lineNumber);
+        }
+        json.raw("}");
+    }
+    json.raw("]}");
+    return json.finish();
+}
+
+// Send a batch of scans and defects to the server as one frame - binary if the server accepted it at connect, else JSON
+bool sendRFIDBatch(uint32_t seq, uint32_t oldest, const ScannedData* records, uint8_t count) {
+    if (!transportPort->connected()) {
+        LOG_W("!! WebSocket not connected, cannot send data");
+        return false;
+    }
+    
+    static uint8_t frame[UPLOAD_BUFFER_SIZE];   // Only the connectivity task sends scans
+    bool binary = transportPort->wireFormat() == WIRE_BINARY;
+    size_t length = binary ? wireEncodeScanBatch(seq, oldest, records, count, frame, sizeof(frame))
+                           : encodeScanBatchJson(seq, oldest, records, count, (char*)frame, sizeof(frame));
+    if (length == 0) {
+        LOG_E("!! Batch of %u scans does not fit in the upload buffer", count);
+        return false;
+    }
+    
+    LOG_D("Sending via WebSocket: %u scans (%u bytes, %s)", count, (unsigned)length, binary ? "binary" : "JSON");
+    bool sent = binary ? transportPort->sendBinary(frame, length) : transportPort->sendText((const char*)frame, length);
+    if (sent) {
+        uploadStats.bytes += length;
+    }
+    return sent;
+}
+
+// Build an upload event for a tag read at a station (defect codes left at 0)
+static void fillEvent(ScannedData& event, uint8_t kind, const CardEvent& card, uint8_t stationNumber) {
+    memset(&event, 0, sizeof(event));
+    // Never waits for SNTP - before the first sync the stamp is boot-relative and resolved at upload
+    uint64_t monotonic = monotonicMs();
+    uint64_t unixMs = timeAtMonotonicMs(monotonic);
+    if (unixMs != 0) {
+        event.timestamp = (uint32_t)(unixMs / 1000);
+        event.timeBase = TIME_BASE_UNIX;
+    } else {
+        event.timestamp = (uint32_t)(monotonic / 1000);
+        event.timeBase = TIME_BASE_BOOT;
+        event.bootEpoch = scanIdBootEpoch();
+    }
+    event.kind = kind;
+    event.stationNumber = stationNumber;
+    event.lineNumber = getLineNumber(stationNumber);
+    event.uidSize = card.uidSize <= sizeof(event.uid) ? card.uidSize : sizeof(event.uid);
+    memcpy(event.uid, card.uid, event.uidSize);
+    
+    // Generate scan ID and station ID
+    generateScanID(event.scanID, sizeof(event.scanID));
+    snprintf(event.stationID, sizeof(event.stationID), "%s", generateStationID(stationNumber));
+}
+
+// Add a scan or defect to its upload lane (Core 1 station tasks). The journal task moves it to flash
+// and the connectivity task uploads it, so the station never waits for the network.
+// A full lane applies its overflow policy from the station table (see lanes.h).
+static bool queueEvent(const ScannedData& event, const char* uidText) {
+    const char* kindName = event.kind == EVENT_DEFECT ? "defect" : "scan";
+    uint8_t lane = laneFor(event);
+    uint32_t droppedBefore = laneStats[lane].dropped;
+    
+    if (!laneEnqueue(event)) {
+        LOG_W("!! %s lane full - %s dropped", laneName(lane), kindName);
+        return false;
+    }
+    if (laneStats[lane].dropped != droppedBefore) {
+        LOG_W("%s lane full - replaced oldest event with %s", laneName(lane), kindName);
+        return true;
+    }
+    // Minimal logging for speed (only essential info)
+    LOG_I("Queued %s %s: %s", STATIONS[event.stationNumber - 1].name, kindName, uidText);
+    return true;
+}
+
+// Add a counted product scan to the upload queue (Core 1 station task)
+bool queueScannedCard(const CardEvent& card, uint8_t stationNumber, const char* uidText) {
+    uint32_t started = clockPort->cycles();
+    ScannedData scannedData;
+    fillEvent(scannedData, EVENT_SCAN, card, stationNumber);
+    bool queued = queueEvent(scannedData, uidText);
+    uint32_t spent = clockPort->cycles() - started;
+    scanCost.scans++;
+    scanCost.cycles += spent;
+    if (spent > scanCost.maxCycles) {
+        scanCost.maxCycles = spent;
+    }
+    
+    // Note: Station counters and LCD updates (including a failure) are handled by the caller
+    return queued;
+}
+
+// Process scanned RFID card and add to queue (Core 1 station task)
+bool processScannedCard(const CardEvent& card, uint8_t stationNumber) {
+    // Cards are compared by key; the hex text is only for the LCD and the log
+    uint64_t cardKey = uidKey(card.uid, card.uidSize);
+    char uidText[UID_HEX_SIZE];
+    uidToHex(card.uid, card.uidSize, uidText);
+    
+    // Check if this is an employee card
+    if (isEmployeeCard(cardKey)) {
+        // Beep for employee card scan
+        beepBuzzer(200); // 200ms beep for employee cards (reduced from 300ms)
+        // Handle employee login/logout
+        handleEmployeeAccess(cardKey, stationNumber);
+        return false; // Don't queue employee cards
+    }
+    
+    // Beep immediately for product card detection (instant feedback)
+    beepBuzzer(100); // 100ms beep for immediate scan confirmation
+    
+    // Check if station is active before scanning regular cards
+    uint8_t index = stationNumber - 1;
+    const StationDescriptor& station = STATIONS[index];
+    const char* stationName = station.name;
+    
+    if (!stationActive[index] || stationState[index] != ACTIVE_SCANNING) {
+        LOG_W("%s is not active - First scan your card", stationName);
+        
+        displayStationMessage(stationNumber, "First scan", "your card");
+        holdStationMessage(stationNumber, 1500);
+        displayStationMessage(stationNumber, stationName, "Scan your card");
+        return false;
+    }
+    
+    // Reject UIDs already counted at this station within its duplicate window (catches A-B-A rescans)
+    // This validation happens BEFORE counting to prevent duplicate increments
+    if (isRecentUid(stationNumber, cardKey)) {
+        // Duplicate scan detected - double beep and reject
+        doubleBeepBuzzer();
+        
+        LOG_I("%s - Duplicate scan rejected: %s", stationName, uidText);
+        
+        // Display message on the station LCD (but don't increment counter)
+        if (station.kind == STATION_QC) {
+            displayStationMessage(stationNumber, "Already logged", "Wait a moment", "to scan again");
+            holdStationMessage(stationNumber, 1500);
+            displayStationMessage(stationNumber, stationName, "Ready to scan");
+        } else {
+            displayStationMessage(stationNumber, "Already scanned", "Try different tag");
+            holdStationMessage(stationNumber, 1500); // Show message for 1.5 seconds
+            // Restore the count display without incrementing
+            updateSewingDisplay(stationNumber, uidText, stationScanCount[index]);
+        }
+        
+        return false; // Don't process duplicates
+    }
+    
+    // Sewing stations count the scan right away; QC remembers the tag once its defect is logged
+    if (station.kind == STATION_SEWING) {
+        rememberUid(stationNumber, cardKey);
+        
+        // NOW increment counter and update LCD display (after duplicate validation)
+        stationScanCount[index]++;
+        updateSewingDisplay(stationNumber, uidText, stationScanCount[index]);
+    }
+    // Note: QC station has special handling below and manages its own counter
+    
+    // Special handling for QC Station - show parts selection
+    if (station.kind == STATION_QC) {
+        LOG_I("QC: Product tag scanned - %s", uidText);
+        char uidLine[17];
+        markCut(uidLine, sizeof(uidLine), snprintf(uidLine, sizeof(uidLine), "UID: %s", uidText));
+        displayStationMessage(stationNumber, "Product scanned!", uidLine, "Select section", "Use UP/DOWN + OK");
+        vTaskDelay(pdMS_TO_TICKS(1000)); // Use vTaskDelay instead of delay()
+        
+        // Show multi-step selection and wait for user choice
+        QCSelection selection;
+        bool selectionConfirmed = handleQCPartsSelection(selection);
+        
+        if (!selectionConfirmed) {
+            // User cancelled or timeout
+            displayStationMessage(stationNumber, "Selection", "Cancelled", "Scan next product");
+            vTaskDelay(pdMS_TO_TICKS(1500)); // Use vTaskDelay instead of delay()
+            displayStationMessage(stationNumber, stationName, "Ready to scan");
+            return false;
+        }
+        
+        // User confirmed complete selection - process as defect (from the snapshot, not the live definitions)
+        LOG_I("QC: Processing defect scan with complete selection:");
+        LOG_I("  Section: %s", selection.sectionName);
+        LOG_I("  Type: %s", selection.typeName);
+        LOG_I("  Subtype: %s", selection.subtypeName);
+        
+        char sectionLine[17];
+        char typeLine[17];
+        char subtypeLine[17];
+        markCut(sectionLine, sizeof(sectionLine), snprintf(sectionLine, sizeof(sectionLine), "Sec:%s", selection.sectionName));
+        markCut(typeLine, sizeof(typeLine), snprintf(typeLine, sizeof(typeLine), "Typ:%s", selection.typeName));
+        markCut(subtypeLine, sizeof(subtypeLine), snprintf(subtypeLine, sizeof(subtypeLine), "Sub:%s", selection.subtypeName));
+        displayStationMessage(stationNumber, "Processing...", sectionLine, typeLine, subtypeLine);
+        vTaskDelay(pdMS_TO_TICKS(1500)); // Use vTaskDelay instead of delay()
+        
+        // Journaled and uploaded with the scans - logged the same way online or offline
+        ScannedData defect;
+        fillEvent(defect, EVENT_DEFECT, card, stationNumber);
+        defect.defectSection = selection.sectionCode;
+        defect.defectType = selection.typeCode;
+        defect.defectSubtype = selection.subtypeCode;
+        
+        if (!queueEvent(defect, uidText)) {
+            LOG_E("QC: Failed to queue defect data");
+            displayStationMessage(stationNumber, "Queue Error!", "Try again");
+            delay(2000);
+            displayStationMessage(stationNumber, stationName, "Ready to scan");
+            return false;
+        }
+        
+        rememberUid(stationNumber, cardKey);
+        stationScanCount[index]++; // Increment QC scan counter
+        updateQCDisplay(stationNumber, uidText, stationScanCount[index]);
+        LOG_I("QC: Defect logged - ID: %s", defect.scanID);
+        
+        // Beep for successful defect scan
+        beepBuzzer(100); // 100ms beep for successful defect (reduced from 150ms)
+        
+        // Show success message
+        if (transportPort->connected()) {
+            char idLine[sizeof("ID:") + SCAN_ID_LENGTH];
+            snprintf(idLine, sizeof(idLine), "ID:%.*s", (int)SCAN_ID_LENGTH, defect.scanID);
+            displayStationMessage(stationNumber, "Defect Logged!", idLine, "Scan next product");
+        } else {
+            displayStationMessage(stationNumber, "Defect Logged!", "Saved offline", "Will sync later");
+        }
+        delay(2000); // Reduced from 3000ms for faster next scan
+        displayStationMessage(stationNumber, stationName, "Ready to scan");
+        return true;
+    }
+    
+    if (!queueScannedCard(card, stationNumber, uidText)) {
+        // Show error on the station LCD for immediate feedback
+        updateSewingDisplay(stationNumber, "Queue Error", stationScanCount[index]);
+        return false;
+    }
+    return true;
+}
+
+// Process the tags of one bulk inventory pass (a bundle dropped on a sewing station) - Core 1 station task
+// The bundle gets one beep and one LCD update instead of one per tag
+void processScannedBundle(const CardBatch& batch, uint8_t stationNumber) {
+    uint8_t index = stationNumber - 1;
+    const char* stationName = STATIONS[index].name;
+    
+    // Employee cards keep their own login/logout dialog
+    bool isEmployee[INVENTORY_MAX_TAGS];
+    uint8_t productCount = 0;
+    for (uint8_t i = 0; i < batch.count; i++) {
+        isEmployee[i] = isEmployeeCard(uidKey(batch.cards[i].uid, batch.cards[i].uidSize));
+        if (isEmployee[i]) {
+            processScannedCard(batch.cards[i], stationNumber);
+        } else {
+            productCount++;
+        }
+    }
+    if (productCount == 0) {
+        return;
+    }
+    
+    // Beep immediately for product card detection (instant feedback)
+    beepBuzzer(100);
+    
+    if (!stationActive[index] || stationState[index] != ACTIVE_SCANNING) {
+        LOG_W("%s is not active - First scan your card", stationName);
+        displayStationMessage(stationNumber, "First scan", "your card");
+        holdStationMessage(stationNumber, 1500);
+        displayStationMessage(stationNumber, stationName, "Scan your card");
+        return;
+    }
+    
+    // Count and queue every tag not already seen in this station's duplicate window
+    uint8_t counted = 0;
+    uint8_t duplicates = 0;
+    uint8_t failed = 0;                  // Counted, but refused by the upload lane
+    char uidText[UID_HEX_SIZE] = "";
+    for (uint8_t i = 0; i < batch.count; i++) {
+        if (isEmployee[i]) {
+            continue;
+        }
+        const CardEvent& card = batch.cards[i];
+        uidToHex(card.uid, card.uidSize, uidText);
+        
+        uint64_t cardKey = uidKey(card.uid, card.uidSize);
+        if (isRecentUid(stationNumber, cardKey)) {
+            duplicates++;
+            continue;
+        }
+        rememberUid(stationNumber, cardKey);
+        stationScanCount[index]++;
+        counted++;
+        if (!queueScannedCard(card, stationNumber, uidText)) {
+            failed++;
+        }
+    }
+    
+    if (failed > 0) {
+        LOG_E("%s - Bundle of %d tags: %d counted, %d duplicates rejected, %d not queued",
+              stationName, productCount, counted, duplicates, failed);
+    } else {
+        LOG_I("%s - Bundle of %d tags: %d counted, %d duplicates rejected",
+              stationName, productCount, counted, duplicates);
+    }
+    
+    if (counted == 0) {
+        // Whole bundle already scanned - double beep and reject
+        doubleBeepBuzzer();
+        displayStationMessage(stationNumber, "Already scanned", "Try different tag");
+        holdStationMessage(stationNumber, 1500);
+        updateSewingDisplay(stationNumber, uidText, stationScanCount[index]);
+        return;
+    }
+    
+    // Tags the lane refused stay on the LCD instead of being hidden behind the bundle count
+    char bundleLabel[17];
+    if (failed > 0) {
+        snprintf(bundleLabel, sizeof(bundleLabel), "+%u !%u lost", counted, failed);
+    } else {
+        snprintf(bundleLabel, sizeof(bundleLabel), "+%u tags", counted);
+    }
+    updateSewingDisplay(stationNumber, bundleLabel, stationScanCount[index]);
+}
+
+// Send the SEL frame for the slot's cascade level - anticollision (NVB 0x20) or full select (NVB 0x70)
+void sendSelectFrame(uint8_t readerIndex, bool fullSelect) {
+    ReaderScanSlot& slot = readerSlots[readerIndex];
+    
+    switch (slot.cascadeLevel) {
+        case 1: slot.frame[0] = PICC_SEL_CL1; break;
+        case 2: slot.frame[0] = PICC_SEL_CL2; break;
+        default: slot.frame[0] = PICC_SEL_CL3; break;
+    }
+    
+    if (fullSelect) {
+        slot.frame[1] = 0x70; // 7 bytes: SEL, NVB, 4 UID bytes/cascade tag, BCC
+        calculateCRC_A(slot.frame, 7, &slot.frame[7]);
+        stationPorts[readerIndex].reader->startTransceive(slot.frame, 9, 0, 0);
+    } else {
+        // NVB: whole bytes sent (SEL, NVB, known UID bytes) in the high nibble, extra known bits in the low nibble
+        uint8_t knownBytes = slot.knownBits / 8;
+        uint8_t extraBits = slot.knownBits % 8;
+        slot.frame[1] = ((2 + knownBytes) << 4) | extraBits;
+        stationPorts[readerIndex].reader->startTransceive(slot.frame, 2 + knownBytes + (extraBits ? 1 : 0), extraBits, extraBits);
+    }
+}
+
+// Start anticollision for the slot's cascade level with no UID bits known
+void startCascadeLevel(uint8_t readerIndex) {
+    ReaderScanSlot& slot = readerSlots[readerIndex];
+    slot.knownBits = 0;
+    memset(&slot.frame[2], 0, 5);
+    sendSelectFrame(readerIndex, false);
+    slot.state = READER_ANTICOLLISION;
+}
+
+// Queue the tags of the current inventory pass to the station task as one batch
+void dispatchInventory(uint8_t readerIndex) {
+    ReaderScanSlot& slot = readerSlots[readerIndex];
+    if (slot.inventory.count == 0) {
+        return;
+    }
+    
+    // Never wait - the other readers keep scanning
+    if (xQueueSend(stationCardQueues[readerIndex], &slot.inventory, 0) != pdTRUE) {
+        stationCardDrops[readerIndex] += slot.inventory.count;
+        LOG_W("Core 1 - Station %d busy, %d card(s) dropped", readerIndex + 1, slot.inventory.count);
+    } else if (slot.inventory.count > 1) {
+        stationBundleCount[readerIndex]++;
+    }
+    slot.inventory.count = 0;
+}
+
+// Send REQA to wake any new card in the field
+void sendRequestA(uint8_t readerIndex) {
+    uint8_t reqa = PICC_REQA;
+    stationPorts[readerIndex].reader->startTransceive(&reqa, 1, 7, 0); // REQA is a 7-bit short frame
+    readerSlots[readerIndex].state = READER_REQA_SENT;
+}
+
+// Advance one reader's scan state machine by a single non-blocking step (Core 1 task)
+void stepReader(uint8_t readerIndex) {
+    ReaderScanSlot& slot = readerSlots[readerIndex];
+    uint8_t buffer[5];
+    uint8_t length;
+    TransceiveResult result;
+    
+    switch (slot.state) {
+        case READER_IDLE:
+            sendRequestA(readerIndex);
+            break;
+            
+        case READER_REQA_SENT:
+            length = 2;
+            result = stationPorts[readerIndex].reader->pollTransceive(buffer, &length);
+            if (result == TRX_PENDING) {
+                break;
+            }
+            slot.pollCount++;
+            slot.totalPolls++;
+            
+            // ATQA bits collide when several cards answer - still a card present
+            if ((result == TRX_OK || result == TRX_COLLISION) && length == 2) {
+                // A pass that keeps running (tag failing select over and over) is handed over with what it has
+                if (slot.inventory.count > 0 && millis() - slot.inventoryStartedAt >= INVENTORY_MAX_PASS_MS) {
+                    dispatchInventory(readerIndex);
+                }
+                slot.cascadeLevel = 1;
+                slot.uidSize = 0;
+                startCascadeLevel(readerIndex);
+            } else {
+                if (result == TRX_ERROR) {
+                    slot.errorCount++;
+                }
+                // No (more) tags answering - every tag of this pass is halted
+                dispatchInventory(readerIndex);
+                sendRequestA(readerIndex); // Empty field - poll again straight away
+            }
+            break;
+            
+        case READER_ANTICOLLISION: {
+            // The answer starts at the first (partially) unknown byte of UID/BCC
+            uint8_t knownBytes = slot.knownBits / 8;
+            uint8_t rxAlign = slot.knownBits % 8;
+            length = 5 - knownBytes;
+            result = stationPorts[readerIndex].reader->pollTransceive(buffer, &length);
+            if (result == TRX_PENDING) {
+                break;
+            }
+            
+            if (result == TRX_OK || result == TRX_COLLISION) {
+                // Merge the received bits behind the known ones
+                for (uint8_t i = 0; i < length; i++) {
+                    uint8_t& target = slot.frame[2 + knownBytes + i];
+                    if (i == 0 && rxAlign) {
+                        uint8_t receivedMask = 0xFF << rxAlign;
+                        target = (target & ~receivedMask) | (buffer[0] & receivedMask);
+                    } else {
+                        target = buffer[i];
+                    }
+                }
+            }
+            
+            if (result == TRX_OK && length == 5 - knownBytes &&
+                (slot.frame[2] ^ slot.frame[3] ^ slot.frame[4] ^ slot.frame[5]) == slot.frame[6]) {
+                sendSelectFrame(readerIndex, true);
+                slot.state = READER_SELECT;
+            } else if (result == TRX_COLLISION) {
+                // Several tags differ at CollPos - follow the tags with a 1 there, the rest answer in a later round
+                slot.collisionCount++;
+                uint8_t collPos = stationPorts[readerIndex].reader->collisionPosition();
+                if (collPos == 0 || collPos <= slot.knownBits) {   // Position not valid, or no progress
+                    slot.errorCount++;
+                    slot.state = READER_IDLE;
+                    break;
+                }
+                slot.knownBits = collPos;
+                slot.frame[2 + (collPos - 1) / 8] |= 1 << ((collPos - 1) % 8);
+                sendSelectFrame(readerIndex, false);
+            } else {
+                if (result != TRX_TIMEOUT) {
+                    slot.errorCount++;
+                }
+                slot.state = READER_IDLE; // Card left or unreadable - start over
+            }
+            break;
+        }
+            
+        case READER_SELECT:
+            length = 3;
+            result = stationPorts[readerIndex].reader->pollTransceive(buffer, &length);
+            if (result == TRX_PENDING) {
+                break;
+            }
+            
+            if (result == TRX_OK && length == 3) {
+                uint8_t crc[2];
+                calculateCRC_A(buffer, 1, crc);
+                if (crc[0] != buffer[1] || crc[1] != buffer[2]) {
+                    slot.errorCount++;
+                    slot.state = READER_IDLE;
+                    break;
+                }
+                
+                // Cascade tag (0x88) means only 3 UID bytes in this level
+                if (slot.frame[2] == PICC_CASCADE_TAG) {
+                    memcpy(&slot.uidBytes[slot.uidSize], &slot.frame[3], 3);
+                    slot.uidSize += 3;
+                } else {
+                    memcpy(&slot.uidBytes[slot.uidSize], &slot.frame[2], 4);
+                    slot.uidSize += 4;
+                }
+                slot.sak = buffer[0];
+                
+                if ((slot.sak & 0x04) && slot.cascadeLevel < 3) {
+                    // UID not complete - continue with the next cascade level
+                    slot.cascadeLevel++;
+                    startCascadeLevel(readerIndex);
+                } else {
+                    slot.state = READER_DONE;
+                }
+            } else {
+                if (result != TRX_TIMEOUT) {
+                    slot.errorCount++;
+                }
+                slot.state = READER_IDLE;
+            }
+            break;
+            
+        case READER_DONE: {
+            // Halt the card and stop crypto communication - a halted tag ignores REQA, so the next one can answer
+            stationPorts[readerIndex].reader->haltA();
+            
+            if (slot.inventory.count == 0) {
+                slot.inventoryStartedAt = millis();
+            }
+            CardEvent& card = slot.inventory.cards[slot.inventory.count++];
+            card.uidSize = slot.uidSize;
+            memcpy(card.uid, slot.uidBytes, slot.uidSize);
+            
+            if (STATIONS[readerIndex].bulkInventory && slot.inventory.count < INVENTORY_MAX_TAGS) {
+                sendRequestA(readerIndex); // Look for the next tag of the bundle
+            } else {
+                dispatchInventory(readerIndex);
+                slot.state = READER_IDLE;
+            }
+            break;
+        }
+    }
+}
+
+// Core 1 Task: Run one station's card handling, buttons and display (one task per station)
+// Shift dialogs and QC defect selection block only this task, never the scanning task
+void stationTask(void *parameter) {
+    uint8_t stationNumber = (uintptr_t)parameter;
+    CardBatch batch;
+    
+    while (true) {
+        if (xQueueReceive(stationCardQueues[stationNumber - 1], &batch, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        
+        // QC logs one garment at a time, so each tag of a batch gets its own defect dialog
+        if (batch.count > 1 && STATIONS[stationNumber - 1].kind == STATION_SEWING) {
+            processScannedBundle(batch, stationNumber);
+        } else {
+            for (uint8_t i = 0; i < batch.count; i++) {
+                processScannedCard(batch.cards[i], stationNumber);
+            }
+        }
+    }
+}
+
+// Core 0 Task: Measure per-reader poll rate with 1..N readers active, then restore all readers ('bench' command)
+void readerBenchTask(void *parameter) {
+    uint32_t pollsBefore[STATION_COUNT];
+    
+    Serial.println("Readers | Total polls/s | Per reader polls/s");
+    for (uint8_t readers = 1; readers <= STATION_COUNT; readers++) {
+        activeReaderCount = readers;
+        vTaskDelay(pdMS_TO_TICKS(100)); // Let the scanning task pick up the new reader count
+        
+        for (uint8_t i = 0; i < STATION_COUNT; i++) {
+            pollsBefore[i] = readerSlots[i].totalPolls;
+        }
+        unsigned long started = millis();
+        vTaskDelay(pdMS_TO_TICKS(READER_BENCH_STEP_MS));
+        unsigned long elapsed = millis() - started;
+        
+        float total = 0;
+        Serial.printf("%7d |", readers);
+        char perReader[96] = "";
+        size_t used = 0;
+        for (uint8_t i = 0; i < readers; i++) {
+            float rate = (readerSlots[i].totalPolls - pollsBefore[i]) * 1000.0f / elapsed;
+            total += rate;
+            if (used < sizeof(perReader)) {
+                used += snprintf(perReader + used, sizeof(perReader) - used, " %s:%.0f", STATIONS[i].shortName, rate);
+            }
+        }
+        Serial.printf(" %13.0f |%s\n", total, perReader);
+    }
+    
+    activeReaderCount = STATION_COUNT;
+    Serial.println(">> Reader benchmark done - all readers active");
+    readerBenchTaskHandle = NULL;
+    vTaskDelete(NULL);
+}
+
+// Core 1 Task: Handle RFID scanning operations (time-critical)
+void rfidScanningTask(void *parameter) {
+    LOG_I("Core 1: Starting RFID scanning task...");
+    
+    // Wait a moment for Core 0 to initialize
+    vTaskDelay(pdMS_TO_TICKS(3000)); // Increased to 3 seconds
+    
+    LOG_I("> Core 1: RFID scanning task ready!");
+    LOG_I("> Ready to scan RFID cards on all %d stations!", STATION_COUNT);
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+        LOG_I(">   %s (%s)", STATIONS[i].name, STATIONS[i].stationID);
+    }
+    LOG_I("> First scan employee cards to activate stations");
+    LOG_I("> Use OK/Cancel buttons to confirm shift start/end");
+    LOG_I("> Station LCDs will show their own scans");
+    
+    unsigned long pollWindowStart = millis();
+    
+    // Main RFID scanning loop - every reader runs its own state machine, interleaved
+    while (true) {
+        uint8_t readerCount = activeReaderCount;   // Lowered temporarily by the 'bench' command
+        for (uint8_t i = 0; i < readerCount; i++) {
+            stepReader(i);
+        }
+        
+        // Recalculate achieved polls/second per reader
+        unsigned long now = millis();
+        if (now - pollWindowStart >= POLL_RATE_WINDOW_MS) {
+            for (uint8_t i = 0; i < STATION_COUNT; i++) {
+                ReaderScanSlot& slot = readerSlots[i];
+                slot.pollsPerSecond = slot.pollCount * 1000.0f / (now - pollWindowStart);
+                
+                // Let the reader adapt its link (e.g. lower the SPI clock) to this window's error rate
+                uint32_t windowErrors = slot.errorCount - slot.windowErrorBase;
+                slot.windowErrorBase = slot.errorCount;
+                if (stationPorts[i].reader->checkPollWindow(slot.pollCount, windowErrors)) {
+                    slot.state = READER_IDLE; // Restart the protocol on the reconfigured link
+                }
+                slot.pollCount = 0;
+            }
+            pollWindowStart = now;
+        }
+        
+        // Readers without a working IRQ line (or mid-protocol) must be polled every tick.
+        // Otherwise sleep until a card answers or it is time to send the next REQA.
+        bool needsPolling = false;
+        for (uint8_t i = 0; i < readerCount; i++) {
+            if (!stationPorts[i].reader->irqDriven() || readerSlots[i].state == READER_DONE) {
+                needsPolling = true;
+            }
+        }
+        
+        if (needsPolling) {
+            // Yield one tick - the readers keep transmitting/receiving on their own meanwhile
+            vTaskDelay(pdMS_TO_TICKS(1));
+        } else {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(RFID_IRQ_REARM_MS));
+        }
+    }
+}
+
+// Move events from the upload lanes into the flash journal (Core 0 task).
+// Flash writes and erases stall for milliseconds, so Core 1 only ever does a non-blocking lane send.
+// Priority-lane events are journaled first and their refs handed to the uploader, which sends them
+// ahead of the scan backlog.
+void journalTask(void *parameter) {
+    ScannedData event;
+    uint8_t lane;
+    
+    while (true) {
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(JOURNAL_IDLE_MS)) == 0 && lanesWaiting() == 0) {
+            // Idle - erase the next sector now rather than in the middle of a burst
+            journalPrepareNextSector();
+            continue;
+        }
+        while (laneDequeue(event, lane)) {
+            JournalRef ref;
+            if (!journalAppend(event, &ref)) {
+                LOG_E("!! Journal append failed - will retry");
+                laneRequeue(event, lane);
+                vTaskDelay(pdMS_TO_TICKS(JOURNAL_IDLE_MS));
+                break;
+            }
+            // If the uploader is this far behind on priority refs, the event just goes out in journal order
+            if (lane == LANE_PRIORITY) {
+                xQueueSend(priorityRefQueue, &ref, 0);
+            }
+        }
+    }
+}
+
+// Count a sent batch and refresh batches/s and records/s once per window
+static void recordUploadBatch(const ScannedData* records, uint8_t count) {
+    uploadStats.batches++;
+    uploadStats.records += count;
+    if (count > uploadStats.maxBatch) {
+        uploadStats.maxBatch = count;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        if (records[i].kind == EVENT_DEFECT) {
+            uploadStats.defects++;
+        }
+    }
+}
+
+static void updateUploadRates() {
+    static uint32_t windowStart = 0;
+    static uint32_t windowBatches = 0;
+    static uint32_t windowRecords = 0;
+    
+    uint32_t now = millis();
+    if (windowStart == 0) {
+        windowStart = now;
+        return;
+    }
+    if (now - windowStart >= UPLOAD_RATE_WINDOW_MS) {
+        float seconds = (now - windowStart) / 1000.0f;
+        uploadStats.batchesPerSecond = (uploadStats.batches - windowBatches) / seconds;
+        uploadStats.recordsPerSecond = (uploadStats.records - windowRecords) / seconds;
+        windowBatches = uploadStats.batches;
+        windowRecords = uploadStats.records;
+        windowStart = now;
+    }
+}
+
+// Batches sent and not yet acknowledged, oldest first (connectivity task only)
+struct InFlightBatch {
+    uint32_t seq;                          // Batch sequence number the server acks
+    uint8_t count;
+    bool acked;
+    bool needsSend;                        // Not on the wire on the current connection (send failed, reconnect, ack timeout)
+    bool retransmit;                       // Sent at least once before
+    uint32_t sentAt;
+    uint32_t sendOrder;                    // Value of transmitCount when it was last sent
+    ScannedData records[UPLOAD_BATCH_MAX];
+    JournalRef refs[UPLOAD_BATCH_MAX];     // Journal records to release on ack
+};
+
+static InFlightBatch inFlight[UPLOAD_WINDOW_BATCHES];
+static uint8_t inFlightHead = 0;
+static uint8_t inFlightCount = 0;
+static uint32_t inFlightRecords = 0;
+static uint32_t nextBatchSeq = 1;          // From 1 at every boot - only meaningful per connection (include/wire.h)
+static uint32_t transmitCount = 0;         // Batches put on the wire since boot
+static uint32_t connectedAt = 0;           // millis() when the current connection came up
+
+// Liveness probe state (connectivity task only)
+static bool pingOutstanding = false;
+static uint32_t pingToken = 0;
+static uint32_t pingSentAt = 0;
+static uint32_t pingAfterSend = 0;         // transmitCount when the ping went out - a pong proves those arrived
+static uint32_t pongConfirmedSend = 0;     // transmitCount up to which a pong released batches (server without acks)
+static uint32_t lastPingAt = 0;
+static uint32_t deadLinkAt = 0;            // millis() of the last missed pong, until its backlog is resent (0 = none)
+
+static InFlightBatch& inFlightAt(uint8_t index) {
+    return inFlight[(inFlightHead + index) % UPLOAD_WINDOW_BATCHES];
+}
+
+// Does the device know yet whether the server acks? It answered the hello, or never answered within
+// UPLOAD_HELLO_TIMEOUT_MS (older back end without the hello, and without acks)
+static bool serverAckModeKnown() {
+    return transportPort->helloAnswered() || millis() - connectedAt >= UPLOAD_HELLO_TIMEOUT_MS;
+}
+
+// May batches be released without the server's ack? Only once it is known not to ack - before that a
+// server that does ack may still lose a frame, and releasing it on a pong would lose its scans
+static bool releaseWithoutAcks() {
+    return !transportPort->serverAcks() && serverAckModeKnown();
+}
+
+// Release the batches sent up to the sendOrder `sentUpTo` - the server read them (server without acks)
+static void releaseSentBatches(uint32_t sentUpTo) {
+    uint32_t confirmed[UPLOAD_WINDOW_BATCHES];
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < inFlightCount; i++) {
+        const InFlightBatch& batch = inFlightAt(i);
+        if (!batch.acked && !batch.needsSend && (int32_t)(sentUpTo - batch.sendOrder) >= 0) {
+            confirmed[count++] = batch.seq;
+        }
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        uploadAcked(confirmed[i], 0);
+    }
+}
+
+// Is this journal record already in the window (or among the first `count` records of the batch being built)?
+// Priority records are sent out of journal order, so the in-order peek can run into them again.
+static bool refInFlight(const JournalRef& ref, const InFlightBatch& building, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (building.refs[i].seq == ref.seq) {
+            return true;
+        }
+    }
+    for (uint8_t i = 0; i < inFlightCount; i++) {
+        const InFlightBatch& batch = inFlightAt(i);
+        for (uint8_t j = 0; j < batch.count; j++) {
+            if (!batch.acked && batch.refs[j].seq == ref.seq) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Fill a batch from the journal: priority records first, then pending records in journal order
+// continuing after `cursor` (the last record the in-order peek returned, nullptr to start at the oldest)
+static uint8_t fillBatchFromJournal(InFlightBatch& batch, uint8_t available, JournalRef* cursor) {
+    uint8_t count = 0;
+    JournalRef ref;
+    while (count < available && xQueueReceive(priorityRefQueue, &ref, 0) == pdTRUE) {
+        if (!refInFlight(ref, batch, count) && journalRead(ref, batch.records[count])) {
+            batch.refs[count++] = ref;
+        }
+    }
+    if (count == available) {
+        return count;
+    }
+    
+    ScannedData peeked[UPLOAD_BATCH_MAX];
+    JournalRef peekedRefs[UPLOAD_BATCH_MAX];
+    uint8_t found = journalPeek(peeked, peekedRefs, available - count, cursor->seq != 0 ? cursor : nullptr);
+    for (uint8_t i = 0; i < found; i++) {
+        if (!refInFlight(peekedRefs[i], batch, count)) {
+            batch.records[count] = peeked[i];
+            batch.refs[count++] = peekedRefs[i];
+        }
+    }
+    if (found > 0) {
+        *cursor = peekedRefs[found - 1];
+    }
+    return count;
+}
+
+// Server confirmed batch `seq` (selective) and every batch up to `cumulative` (0 = none)
+void uploadAcked(uint32_t seq, uint32_t cumulative) {
+    for (uint8_t i = 0; i < inFlightCount; i++) {
+        InFlightBatch& batch = inFlightAt(i);
+        if (batch.acked || (batch.seq != seq && batch.seq > cumulative)) {
+            continue;
+        }
+        batch.acked = true;
+        if (journalMounted()) {
+            journalAck(batch.refs, batch.count);
+        }
+        uint32_t ackMs = millis() - batch.sentAt;
+        if (ackMs > uploadStats.maxAckMs) {
+            uploadStats.maxAckMs = ackMs;
+        }
+        uploadStats.acked += batch.count;
+        inFlightRecords -= batch.count;
+    }
+    
+    // Slide the window past acknowledged batches
+    while (inFlightCount > 0 && inFlight[inFlightHead].acked) {
+        inFlightHead = (inFlightHead + 1) % UPLOAD_WINDOW_BATCHES;
+        inFlightCount--;
+    }
+    uploadStats.inFlight = inFlightCount;
+}
+
+// Give events stamped before the first SNTP sync their Unix time, now that the offset is known.
+// Stamps from an earlier boot cannot be placed any more and go out as 0 (unknown), as before.
+static void backfillTimestamps(ScannedData* records, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        ScannedData& data = records[i];
+        if (data.timeBase != TIME_BASE_BOOT) {
+            continue;
+        }
+        if (data.bootEpoch != scanIdBootEpoch()) {
+            data.timestamp = 0;
+            timeSyncStats.unresolved++;
+        } else {
+            uint64_t unixMs = timeAtMonotonicMs((uint64_t)data.timestamp * 1000);
+            if (unixMs == 0) {
+                continue;                                // Still not synced - sent as 0, kept boot-relative here
+            }
+            data.timestamp = (uint32_t)(unixMs / 1000);
+            timeSyncStats.backfilled++;
+        }
+        data.timeBase = TIME_BASE_UNIX;
+    }
+}
+
+// Put a window batch on the wire; false leaves it marked for the next try
+static bool transmitBatch(InFlightBatch& batch) {
+    backfillTimestamps(batch.records, batch.count);
+    // The head of the window is always unacked - tell the server everything before it is done
+    if (!sendRFIDBatch(batch.seq, inFlightAt(0).seq, batch.records, batch.count)) {
+        LOG_W("Core 0: Failed to send data, will retry next cycle");
+        uploadStats.failures++;
+        endpointSoftError();
+        batch.needsSend = true;
+        return false;
+    }
+    if (batch.retransmit) {
+        uploadStats.retransmits++;
+    } else {
+        recordUploadBatch(batch.records, batch.count);
+    }
+    batch.needsSend = false;
+    batch.retransmit = true;
+    batch.sentAt = millis();
+    batch.sendOrder = ++transmitCount;
+    LOG_I("Core 0: batch %lu (%u scans) sent via WebSocket", (unsigned long)batch.seq, batch.count);
+    if (deadLinkAt != 0) {
+        uploadStats.lastRecoveryMs = batch.sentAt - deadLinkAt;
+        deadLinkAt = 0;
+    }
+    
+    // A server without acks (older back end) cannot confirm a batch - it is released by the next pong
+    // (the server read everything sent before the ping), or right away with pings off
+    if (uploadPingIntervalMs == 0 && releaseWithoutAcks()) {
+        uploadAcked(batch.seq, 0);
+    }
+    return true;
+}
+
+void uploadPong(uint32_t token) {
+    if (!pingOutstanding || token != pingToken) {
+        return;                            // Late answer to a ping from an earlier connection
+    }
+    pingOutstanding = false;
+    uint32_t rtt = millis() - pingSentAt;
+    endpointRtt(rtt);
+    uploadStats.pongs++;
+    uploadStats.lastRttMs = rtt;
+    uploadStats.rttTotalMs += rtt;
+    if (rtt > uploadStats.maxRttMs) {
+        uploadStats.maxRttMs = rtt;
+    }
+    
+    // Before the hello is answered the pong proves nothing - the server may yet turn out to ack
+    if (releaseWithoutAcks()) {
+        releaseSentBatches(pingAfterSend);
+        pongConfirmedSend = pingAfterSend;
+    }
+}
+
+// Follow the connection to the current endpoint: an endpoint that does not open within
+// ENDPOINT_CONNECT_TIMEOUT_MS has failed, and a working one is compared with the others now and then
+static void checkEndpoint(bool connected) {
+    static bool wasConnected = false;
+    static uint32_t connectingSince = 0;   // First seen down with the network up (0 = not counting)
+    static uint32_t lastEvaluateAt = 0;
+    uint32_t now = millis();
+    
+    if (connected) {
+        if (!wasConnected) {
+            connectedAt = now;
+            endpointConnected();
+            LOG_I("Core 0: uploading to %s:%u%s", endpointAt(endpointCurrent()).host,
+                  endpointAt(endpointCurrent()).wsPort, endpointCurrent() == endpointHome() ? "" : " (failover)");
+            lastEvaluateAt = now;
+        }
+        wasConnected = true;
+        connectingSince = 0;
+        if (now - lastEvaluateAt >= ENDPOINT_EVALUATE_MS) {
+            lastEvaluateAt = now;
+            if (endpointReselect(true)) {
+                LOG_I("Core 0: moving to %s:%u", endpointAt(endpointCurrent()).host, endpointAt(endpointCurrent()).wsPort);
+                transportPort->reconnect();
+            }
+        }
+        return;
+    }
+    
+    wasConnected = false;
+    if (!transportPort->networkUp()) {
+        connectingSince = 0;
+        return;
+    }
+    if (connectingSince == 0) {
+        connectingSince = now != 0 ? now : 1;
+    } else if (now - connectingSince >= ENDPOINT_CONNECT_TIMEOUT_MS) {
+        const IngestEndpoint& failed = endpointAt(endpointCurrent());
+        LOG_W("!! %s:%u not reachable for %lu ms", failed.host, failed.wsPort, (unsigned long)(now - connectingSince));
+        endpointFailed();
+        endpointReselect(false);
+        transportPort->reconnect();
+        connectingSince = now;
+    }
+}
+
+// Ping the server and drop the connection if a ping goes unanswered (connection is up)
+static void checkLiveness() {
+    if (uploadPingIntervalMs == 0) {
+        return;
+    }
+    uint32_t now = millis();
+    if (pingOutstanding) {
+        if (now - pingSentAt < uploadPongTimeoutMs) {
+            return;
+        }
+        LOG_W("!! No pong in %lu ms - connection is dead, reconnecting", (unsigned long)(now - pingSentAt));
+        pingOutstanding = false;
+        uploadStats.deadLinks++;
+        for (uint8_t i = 0; i < inFlightCount; i++) {
+            inFlightAt(i).needsSend = !inFlightAt(i).acked;
+        }
+        if (deadLinkAt == 0) {
+            deadLinkAt = now;
+        }
+        endpointFailed();
+        endpointReselect(false);
+        transportPort->reconnect();
+        return;
+    }
+    
+    // A server without acks also gets a ping as soon as something waits to be confirmed by it
+    bool unconfirmed = releaseWithoutAcks() && transmitCount != pongConfirmedSend && inFlightCount > 0;
+    if (now - lastPingAt >= uploadPingIntervalMs || unconfirmed) {
+        if (transportPort->sendPing(pingToken + 1)) {
+            pingToken++;
+            pingOutstanding = true;
+            pingSentAt = now;
+            pingAfterSend = transmitCount;
+        }
+        lastPingAt = now;
+    }
+}
+
+// Send queued scans in batches while the transport is up (Core 0 task).
+// Up to UPLOAD_WINDOW_BATCHES batches are in flight at once; a scan is only released (journal record
+// acknowledged, RAM copy dropped) when the server acks its batch. Unacked batches are sent again after a
+// reconnect or UPLOAD_ACK_TIMEOUT_MS - the server de-duplicates on the scan ID, so delivery is at-least-once.
+// A missed pong (checkLiveness) ends a half-open connection within seconds, and its unacked batches go out again.
+// A batch goes out once it is full or its oldest scan has waited UPLOAD_LINGER_MS; full batches
+// are sent back to back (up to UPLOAD_BATCHES_PER_CALL) so a backlog drains quickly after a reconnect.
+// If the transport is down, the journal (or the RAM queue) just fills up - scanning continues
+void drainScanQueue() {
+    static bool lingering = false;         // A partial batch is being held back
+    static uint32_t lingerStart = 0;       // millis() when it was first seen
+    static JournalRef peekCursor = {0, 0}; // Last journal record handed out in order (seq 0 = start at the oldest)
+    
+    updateUploadRates();
+    checkEndpoint(transportPort->connected());
+    if (!transportPort->connected()) {
+        // Whatever was on the old connection may never have arrived - send it again after the reconnect
+        for (uint8_t i = 0; i < inFlightCount; i++) {
+            inFlightAt(i).needsSend = !inFlightAt(i).acked;
+        }
+        lingering = false;
+        pingOutstanding = false;           // A new connection starts with a fresh ping
+        lastPingAt = millis() - uploadPingIntervalMs;
+        return;
+    }
+    
+    checkLiveness();
+    if (!transportPort->connected()) {
+        return;                            // Dead link dropped - resent after the reconnect
+    }
+    if (uploadPingIntervalMs == 0 && releaseWithoutAcks()) {
+        releaseSentBatches(transmitCount); // Sent while the hello was unanswered - no pong will release them
+    }
+    
+    // Retransmit first, oldest batch first
+    for (uint8_t i = 0; i < inFlightCount; i++) {
+        InFlightBatch& batch = inFlightAt(i);
+        if (batch.acked) {
+            continue;
+        }
+        // No ack is overdue before the server has said whether it acks at all
+        if (!batch.needsSend && serverAckModeKnown() && millis() - batch.sentAt >= UPLOAD_ACK_TIMEOUT_MS) {
+            LOG_W("Core 0: no ack for batch %lu - resending", (unsigned long)batch.seq);
+            batch.needsSend = true;
+            endpointSoftError();
+        }
+        if (batch.needsSend && !transmitBatch(batch)) {
+            return;
+        }
+    }
+    
+    for (uint8_t round = 0; round < UPLOAD_BATCHES_PER_CALL && inFlightCount < UPLOAD_WINDOW_BATCHES; round++) {
+        uint32_t waiting;
+        if (journalMounted()) {
+            waiting = journalPending() > inFlightRecords ? journalPending() - inFlightRecords : 0;
+        } else {
+            waiting = lanesWaiting();
+        }
+        uint8_t available = waiting < UPLOAD_BATCH_MAX ? waiting : UPLOAD_BATCH_MAX;
+        if (available == 0) {
+            lingering = false;
+            return;
+        }
+        
+        // Hold a partial batch back for a moment - more scans of the same bundle are usually on their way.
+        // A defect waiting in the priority lane goes out right away.
+        bool urgent = journalMounted() ? uxQueueMessagesWaiting(priorityRefQueue) > 0 : laneDepth(LANE_PRIORITY) > 0;
+        if (available < UPLOAD_BATCH_MAX && !urgent) {
+            if (!lingering) {
+                lingering = true;
+                lingerStart = millis();
+            }
+            if (millis() - lingerStart < UPLOAD_LINGER_MS) {
+                return;
+            }
+        }
+        
+        InFlightBatch& batch = inFlightAt(inFlightCount);
+        uint8_t count = 0;
+        if (journalMounted()) {
+            // Records stay in flash until acked - with nothing in flight, start over at the oldest pending one
+            if (inFlightCount == 0) {
+                peekCursor.seq = 0;
+            }
+            count = fillBatchFromJournal(batch, available, &peekCursor);
+        } else {
+            uint8_t lane;
+            while (count < available && laneDequeue(batch.records[count], lane)) {
+                count++;
+            }
+        }
+        if (count == 0) {
+            return;
+        }
+        
+        batch.seq = nextBatchSeq++;
+        batch.count = count;
+        batch.acked = false;
+        batch.retransmit = false;
+        inFlightCount++;
+        inFlightRecords += count;
+        uploadStats.inFlight = inFlightCount;
+        lingering = false;
+        
+        if (!transmitBatch(batch) || count < UPLOAD_BATCH_MAX) {
+            return;                        // Send failed (kept in the window) or backlog drained
+        }
+    }
+}
+
+// Create the upload lanes and the per-station card queues (must be created before tasks)
+bool createPipelineQueues() {
+    Serial.print("Creating upload lanes... ");
+    priorityRefQueue = xQueueCreate(PRIORITY_LANE_DEPTH, sizeof(JournalRef));
+    if (!lanesBegin() || priorityRefQueue == NULL) {
+        Serial.println("!! FAILED !!");
+        Serial.println("ERROR: Failed to create queue!");
+        return false;
+    }
+    Serial.println("<> Success!");
+    
+    defectDefinitionsLock = xSemaphoreCreateMutex();
+    if (defectDefinitionsLock == NULL) {
+        Serial.println("ERROR: Failed to create defect definitions lock!");
+        return false;
+    }
+    
+    Serial.print("Creating station card queues... ");
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+        stationCardQueues[i] = xQueueCreate(STATION_CARD_QUEUE_SIZE, sizeof(CardBatch));
+        if (stationCardQueues[i] == NULL) {
+            Serial.println("!! FAILED !!");
+            Serial.println("ERROR: Failed to create station queue!");
+            return false;
+        }
+    }
+    Serial.println("<> Success!");
+    
+    // Find the QC station - the defect dialog and its UP/DOWN buttons belong to it
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+        if (STATIONS[i].kind == STATION_QC && qcStationNumber == 0) {
+            qcStationNumber = i + 1;
+        }
+    }
+    
+    // Employee cards as keys - the scan path compares integers instead of UID strings
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+        employeeKeys[i] = hexUidKey(STATIONS[i].employeeUID);
+    }
+    return true;
+}
+
+// Create the Core 1 tasks - the scanning task and one task per station - and the Core 0 journal task
+void startPipelineTasks() {
+    if (journalMounted()) {
+        Serial.print("Creating Core 0 (Journal) task... ");
+        xTaskCreatePinnedToCore(
+            journalTask,                // Task function
+            "JournalTask",              // Task name
+            4096,                       // Stack size (bytes)
+            NULL,                       // Task parameter
+            1,                          // Task priority
+            &journalTaskHandle,         // Task handle
+            0                           // Core 0 (Protocol Core)
+        );
+        lanesSetConsumer(journalTaskHandle);
+        Serial.println("<> Created!");
+    }
+    
+    // Create Core 1 task for RFID scanning (App Core)
+    Serial.print("Creating Core 1 (RFID Scanning) task... ");
+    xTaskCreatePinnedToCore(
+        rfidScanningTask,           // Task function
+        "RFIDScanningTask",         // Task name
+        4096,                       // Stack size (bytes)
+        NULL,                       // Task parameter
+        2,                          // Task priority (higher than connectivity)
+        &rfidScanningTaskHandle,    // Task handle
+        1                           // Core 1 (App Core)
+    );
+    Serial.println("<> Created!");
+    
+    // Create Core 1 station tasks - one per station so a QC dialog never stalls the sewing lines
+    Serial.print("Creating Core 1 (Station) tasks... ");
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+        char stationTaskName[16];
+        snprintf(stationTaskName, sizeof(stationTaskName), "Station%sTask", STATIONS[i].shortName);
+        xTaskCreatePinnedToCore(
+            stationTask,                // Task function
+            stationTaskName,            // Task name (copied by FreeRTOS)
+            4096,                       // Stack size (bytes)
+            (void*)(uintptr_t)(i + 1),  // Task parameter - station number (1-based)
+            1,                          // Task priority (below scanning)
+            &stationTaskHandles[i],     // Task handle
+            1                           // Core 1 (App Core)
+        );
+    }
+    Serial.println("<> Created!");
+}
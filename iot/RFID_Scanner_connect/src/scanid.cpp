@@ -0,0 +1,74 @@
+#include "scanid.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+static const char SCAN_ID_ALPHABET[] = "0123456789ABCDEFGHJKMNPQRSTVWXYZ";   // Crockford base32
+
+static uint32_t deviceId = 0;
+static uint16_t epoch = 0;
+static uint16_t bootEpoch = 0;
+static uint32_t counter = 0;
+static SettingsStore* epochStore = nullptr;
+static SemaphoreHandle_t scanIdLock = NULL;        // Station tasks take IDs concurrently
+
+// Reserve the epoch after the stored one; it is written back before use so a reset never reuses it
+static bool reserveEpoch() {
+    uint32_t stored = 0;
+    if (epochStore == nullptr) {
+        epoch++;
+        return false;
+    }
+    if (!epochStore->readU32(SCAN_ID_EPOCH_KEY, stored)) {
+        stored = epoch;
+    }
+    epoch = (uint16_t)(stored + 1);
+    return epochStore->writeU32(SCAN_ID_EPOCH_KEY, epoch);
+}
+
+bool scanIdBegin(uint32_t device, SettingsStore* settings) {
+    if (scanIdLock == NULL) {
+        scanIdLock = xSemaphoreCreateMutex();
+    }
+    deviceId = device & SCAN_ID_DEVICE_MASK;
+    epochStore = settings;
+    counter = 0;
+    bool reserved = reserveEpoch();
+    bootEpoch = epoch;
+    return reserved;
+}
+
+uint64_t scanIdNext() {
+    if (scanIdLock == NULL) {
+        scanIdLock = xSemaphoreCreateMutex();
+    }
+    xSemaphoreTake(scanIdLock, portMAX_DELAY);
+    if (counter >= SCAN_ID_COUNTER_LIMIT) {
+        // 16M scans without a reset - move to a fresh epoch (one settings write)
+        reserveEpoch();
+        counter = 0;
+    }
+    uint64_t id = (uint64_t)deviceId << 40 | (uint64_t)epoch << 24 | counter++;
+    xSemaphoreGive(scanIdLock);
+    return id;
+}
+
+// 65 bits of base32, most significant first - the first character only carries the top 4 bits
+void scanIdFormat(uint64_t id, char* text) {
+    for (int8_t i = SCAN_ID_LENGTH - 1; i >= 0; i--) {
+        text[i] = SCAN_ID_ALPHABET[id & 0x1F];
+        id >>= 5;
+    }
+    text[SCAN_ID_LENGTH] = '\0';
+}
+
+uint32_t scanIdDevice() {
+    return deviceId;
+}
+
+uint16_t scanIdEpoch() {
+    return epoch;
+}
+
+uint16_t scanIdBootEpoch() {
+    return bootEpoch;
+}
@@ -0,0 +1,113 @@
+#include "timesync.h"
+#include <atomic>
+#include <stdlib.h>
+
+TimeSyncStats timeSyncStats = {};
+
+static Clock* timeSource = nullptr;
+
+// Unix ms minus monotonic ms, split in two words so 32-bit cores read it without a lock.
+// syncVersion is odd while Core 0 rewrites the halves (sequence lock); 0 = never synced.
+static std::atomic<uint32_t> syncVersion{0};
+static std::atomic<uint32_t> offsetLow{0};
+static std::atomic<uint32_t> offsetHigh{0};
+static std::atomic<uint32_t> lastSyncLow{0};     // Monotonic ms of the last sync, low word (enough for the age)
+static uint64_t lastSyncMonotonic = 0;           // Core 0 only
+
+void timeSyncBegin(Clock* clock) {
+    timeSource = clock;
+}
+
+uint64_t monotonicMs() {
+    return timeSource->monotonicUs() / 1000;
+}
+
+// false if not synced yet
+static bool readOffset(int64_t& offset) {
+    while (true) {
+        uint32_t before = syncVersion.load(std::memory_order_acquire);
+        if (before == 0) {
+            return false;
+        }
+        if (before & 1) {
+            continue;                                // Core 0 is mid-store - a few cycles
+        }
+        uint64_t value = (uint64_t)offsetHigh.load(std::memory_order_relaxed) << 32 |
+                         offsetLow.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (syncVersion.load(std::memory_order_relaxed) == before) {
+            offset = (int64_t)value;
+            return true;
+        }
+    }
+}
+
+void timeSyncSet(uint64_t unixMs) {
+    uint64_t monotonic = monotonicMs();
+    int64_t offset = (int64_t)(unixMs - monotonic);
+    
+    int64_t previous;
+    if (readOffset(previous)) {
+        // Where our clock thought we were vs. where SNTP says we are
+        int32_t drift = (int32_t)(offset - previous);
+        timeSyncStats.lastDriftMs = drift;
+        if (abs(drift) > abs(timeSyncStats.maxDriftMs)) {
+            timeSyncStats.maxDriftMs = drift;
+        }
+        uint64_t interval = monotonic - lastSyncMonotonic;
+        timeSyncStats.driftPpm = interval > 0 ? drift * 1000000.0f / interval : 0.0f;
+    }
+    
+    uint32_t version = syncVersion.load(std::memory_order_relaxed);
+    syncVersion.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    offsetLow.store((uint32_t)offset, std::memory_order_relaxed);
+    offsetHigh.store((uint32_t)((uint64_t)offset >> 32), std::memory_order_relaxed);
+    lastSyncLow.store((uint32_t)monotonic, std::memory_order_relaxed);
+    syncVersion.store(version + 2, std::memory_order_release);
+    lastSyncMonotonic = monotonic;
+    timeSyncStats.syncs++;
+}
+
+uint64_t timeAtMonotonicMs(uint64_t monotonic) {
+    int64_t offset;
+    if (!readOffset(offset)) {
+        return 0;
+    }
+    return (uint64_t)((int64_t)monotonic + offset);
+}
+
+uint64_t timeNowMs() {
+    return timeAtMonotonicMs(monotonicMs());
+}
+
+uint32_t timeNow() {
+    return (uint32_t)(timeNowMs() / 1000);
+}
+
+bool timeLocal(struct tm* timeinfo) {
+    time_t now = (time_t)timeNow();
+    return now != 0 && localtime_r(&now, timeinfo) != nullptr;
+}
+
+uint32_t timeSinceSyncMs() {
+    if (syncVersion.load(std::memory_order_acquire) == 0) {
+        return 0;
+    }
+    return (uint32_t)monotonicMs() - lastSyncLow.load(std::memory_order_relaxed);
+}
+
+TimeSyncState timeSyncState() {
+    if (syncVersion.load(std::memory_order_acquire) == 0) {
+        return TIME_UNSYNCED;
+    }
+    return timeSinceSyncMs() > TIME_SYNC_STALE_MS ? TIME_STALE : TIME_SYNCED;
+}
+
+const char* timeSyncStateName(TimeSyncState state) {
+    switch (state) {
+        case TIME_SYNCED: return "synced";
+        case TIME_STALE: return "stale";
+        default: return "not synced";
+    }
+}
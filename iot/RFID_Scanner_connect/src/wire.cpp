@@ -0,0 +1,145 @@
+#include "wire.h"
+
+// Bounded little-endian writer - every put is a no-op once the buffer is full
+struct WireWriter {
+    uint8_t* buffer;
+    size_t capacity;
+    size_t length;
+    bool overflow;
+
+    void put(uint8_t value) {
+        if (length >= capacity) {
+            overflow = true;
+            return;
+        }
+        buffer[length++] = value;
+    }
+
+    void putU32(uint32_t value) {
+        for (uint8_t i = 0; i < 4; i++) {
+            put((uint8_t)(value >> (8 * i)));
+        }
+    }
+
+    void putBytes(const uint8_t* data, uint8_t size) {
+        put(size);
+        for (uint8_t i = 0; i < size; i++) {
+            put(data[i]);
+        }
+    }
+
+    void putString(const char* text, size_t maxLength) {
+        putBytes((const uint8_t*)text, (uint8_t)strnlen(text, maxLength));
+    }
+};
+
+struct WireReader {
+    const uint8_t* data;
+    size_t length;
+    size_t position;
+    bool error;
+
+    uint8_t get() {
+        if (position >= length) {
+            error = true;
+            return 0;
+        }
+        return data[position++];
+    }
+
+    uint32_t getU32() {
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < 4; i++) {
+            value |= (uint32_t)get() << (8 * i);
+        }
+        return value;
+    }
+
+    // Length-prefixed bytes into a fixed field; false if they do not fit
+    uint8_t getBytes(uint8_t* out, size_t outSize) {
+        uint8_t size = get();
+        if (size > outSize) {
+            error = true;
+            return 0;
+        }
+        for (uint8_t i = 0; i < size; i++) {
+            out[i] = get();
+        }
+        return size;
+    }
+
+    void getString(char* out, size_t outSize) {
+        uint8_t size = getBytes((uint8_t*)out, outSize - 1);
+        out[size] = '\0';
+    }
+};
+
+static void putHeader(WireWriter& writer, WireFrameType type, uint8_t count, uint32_t seq, uint8_t behind) {
+    writer.put(WIRE_MAGIC_0);
+    writer.put(WIRE_MAGIC_1);
+    writer.put(WIRE_VERSION);
+    writer.put(type);
+    writer.put(count);
+    writer.put(behind);
+    writer.putU32(seq);
+}
+
+size_t wireEncodeScanBatch(uint32_t seq, uint32_t oldest, const ScannedData* records, uint8_t count, uint8_t* buffer, size_t capacity) {
+    WireWriter writer = {buffer, capacity, 0, false};
+    putHeader(writer, WIRE_FRAME_SCAN_BATCH, count, seq, (uint8_t)(seq - oldest));
+    for (uint8_t i = 0; i < count; i++) {
+        const ScannedData& data = records[i];
+        writer.put(data.kind);
+        writer.putU32(data.timeBase == TIME_BASE_UNIX ? data.timestamp : 0);   // 0 = not known yet
+        writer.put(data.stationNumber);
+        writer.put(data.lineNumber);
+        writer.putBytes(data.uid, data.uidSize <= sizeof(data.uid) ? data.uidSize : 0);
+        writer.putString(data.scanID, sizeof(data.scanID));
+        writer.putString(data.stationID, sizeof(data.stationID));
+        if (data.kind == EVENT_DEFECT) {
+            writer.put(data.defectSection);
+            writer.put(data.defectType);
+            writer.put(data.defectSubtype);
+        }
+    }
+    return writer.overflow ? 0 : writer.length;
+}
+
+bool wireDecodeHeader(const uint8_t* frame, size_t length, WireHeader& header) {
+    if (length < WIRE_HEADER_SIZE || frame[0] != WIRE_MAGIC_0 || frame[1] != WIRE_MAGIC_1 || frame[2] != WIRE_VERSION) {
+        return false;
+    }
+    header.type = (WireFrameType)frame[3];
+    header.count = frame[4];
+    header.seq = frame[6] | (uint32_t)frame[7] << 8 | (uint32_t)frame[8] << 16 | (uint32_t)frame[9] << 24;
+    header.oldest = header.seq - frame[5];
+    return true;
+}
+
+uint8_t wireDecodeScanBatch(const uint8_t* frame, size_t length, ScannedData* records, uint8_t maxRecords) {
+    WireHeader header;
+    if (!wireDecodeHeader(frame, length, header) || header.type != WIRE_FRAME_SCAN_BATCH || header.count > maxRecords) {
+        return 0;
+    }
+    
+    WireReader reader = {frame, length, WIRE_HEADER_SIZE, false};
+    for (uint8_t i = 0; i < header.count; i++) {
+        ScannedData& data = records[i];
+        memset(&data, 0, sizeof(data));
+        data.kind = reader.get();
+        data.timestamp = reader.getU32();
+        data.stationNumber = reader.get();
+        data.lineNumber = reader.get();
+        data.uidSize = reader.getBytes(data.uid, sizeof(data.uid));
+        reader.getString(data.scanID, sizeof(data.scanID));
+        reader.getString(data.stationID, sizeof(data.stationID));
+        if (data.kind == EVENT_DEFECT) {
+            data.defectSection = reader.get();
+            data.defectType = reader.get();
+            data.defectSubtype = reader.get();
+        } else if (data.kind != EVENT_SCAN) {
+            return 0;
+        }
+    }
+    return reader.error || reader.position != length ? 0 : header.count;
+}